@@ -0,0 +1,566 @@
+//Copyright (c) 2026 Kaizhi Liu
+//Licensed under the Apache License, Version 2.0.
+
+/* Microbenchmarks for the hot paths of the node, with JSON output so that runs can be diffed.
+ *
+ *   storage_node_bench [--filter <substring>] [--repetitions <n>] [--quick] [--out <file.json>]
+ *
+ * Suites, by benchmark name prefix:
+ *   socket/...       length-prefixed framing (Socket::sendData / recvFrame) over a socketpair and over TCP loopback:
+ *                    one-way throughput per frame size, and 64-byte ping-pong round trips.
+ *   thread_pool/...  post() and enqueue() throughput from an outside thread, and submit-to-start latency.
+ *   logger/...       cost of a LOG_INFO call on the producer side (ring never full, ring full with Drop, filtered out).
+ *   buffers/...      BufferPool acquire/release per size class, alone and from four threads, against new/delete; and the
+ *                    scratch of one request (header copy plus formatted reply) in an Arena against std::string.
+ *   storage/...      StorageEngine put and get of 4 KiB and 1 MiB objects, stat, and a sequential range scan.
+ *
+ * Every benchmark runs once to warm up and then --repetitions times (default 5) with a fixed amount of work and
+ * fixed seeds; the JSON reports the median repetition together with the fastest and slowest, plus latency
+ * percentiles where the benchmark measures individual operations.
+ * Storage benchmarks work in a scratch directory under the system temp directory, removed at exit.
+ */
+
+#include "net/include/Socket.hpp"
+#include "utils/include/Arena.hpp"
+#include "utils/include/AsyncLogger.hpp"
+#include "utils/include/BufferPool.hpp"
+#include "utils/include/Metrics.hpp"
+#include "utils/include/ThreadPool.hpp"
+#include "core/include/StorageEngine.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <functional>
+#include <optional>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifndef _WIN32
+    #include <netinet/in.h>
+    #include <netinet/tcp.h>
+    #include <sys/socket.h>
+#endif
+
+namespace {
+
+    using Clock = std::chrono::steady_clock;
+    using namespace ref_storage;
+
+    // One repetition: `ops` operations (and `bytes` of payload) in `elapsed`, plus per-operation latencies if measured.
+    struct Run {
+        uint64_t ops = 0;
+        uint64_t bytes = 0;
+        Clock::duration elapsed{};
+        std::optional<utils::HistogramSnapshot> latency;
+
+        [[nodiscard]] double nsPerOp() const {
+            return ops ? static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()) / static_cast<double>(ops) : 0;
+        }
+    };
+
+    struct Benchmark {
+        std::string name;
+        std::function<Run()> run;
+    };
+
+    struct Options {
+        std::string filter;
+        size_t repetitions = 5;
+        bool quick = false;
+        std::string out;
+    };
+
+    Options g_options;
+
+    // Distinguishes the scratch directories of concurrent runs.
+    std::string runId() {
+        static const std::string id = std::to_string(Clock::now().time_since_epoch().count());
+        return id;
+    }
+
+    // Work per repetition, cut by 10 with --quick.
+    uint64_t scaled(uint64_t n) { return g_options.quick ? std::max<uint64_t>(1, n / 10) : n; }
+
+    // ==========================================
+    // Socket framing
+    // ==========================================
+#ifndef _WIN32
+    std::pair<net::Socket, net::Socket> socketPair() {
+        int fds[2];
+        if (::socketpair(AF_UNIX, SOCK_STREAM, 0, fds) != 0) throw std::runtime_error("socketpair failed");
+        return {net::Socket(net::SocketHandle(fds[0])), net::Socket(net::SocketHandle(fds[1]))};
+    }
+
+    std::pair<net::Socket, net::Socket> loopbackPair() {
+        net::Socket listener;
+        listener.setReuseAddress(true);
+        listener.bindAndListen(0, "::1");
+
+        sockaddr_in6 addr{};
+        socklen_t len = sizeof(addr);
+        ::getsockname(listener.handle().native_handle(), reinterpret_cast<sockaddr*>(&addr), &len);
+        int fd = ::socket(AF_INET6, SOCK_STREAM, 0);
+        if (fd < 0 || ::connect(fd, reinterpret_cast<sockaddr*>(&addr), len) != 0) throw std::runtime_error("connect to loopback failed");
+        net::Socket client{net::SocketHandle(fd)};
+        net::Socket server = listener.acceptClient();
+        // sendData() writes the header and the payload separately, so with Nagle on a ping-pong waits out the peer's
+        // delayed ACK (tens of ms) on every round; measure the framing instead.
+        int one = 1;
+        ::setsockopt(client.handle().native_handle(), IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        ::setsockopt(server.handle().native_handle(), IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        return {std::move(client), std::move(server)};
+    }
+
+    Run frameThroughput(std::pair<net::Socket, net::Socket> pair, size_t frameSize) {
+        const uint64_t frames = scaled(std::max<uint64_t>(2000, (256ull << 20) / frameSize / 4));
+        std::vector<char> payload(frameSize, 'x');
+        std::vector<char> sink(frameSize);
+
+        auto begin = Clock::now();
+        std::thread sender([&]() {
+            for (uint64_t i = 0; i < frames; ++i) pair.first.sendData(payload.data(), payload.size(), 0);
+        });
+        for (uint64_t i = 0; i < frames; ++i) pair.second.recvFrame(sink.data(), sink.size());
+        sender.join();
+        return {frames, frames * frameSize, Clock::now() - begin, std::nullopt};
+    }
+
+    Run framePingPong(std::pair<net::Socket, net::Socket> pair) {
+        const uint64_t rounds = scaled(20000);
+        char payload[64] = {};
+        char echo[64];
+        utils::Histogram latency;
+
+        std::thread echoer([&]() {
+            char buf[64];
+            for (uint64_t i = 0; i < rounds; ++i) {
+                size_t n = pair.second.recvFrame(buf, sizeof(buf));
+                pair.second.sendData(buf, n, 0);
+            }
+        });
+        auto begin = Clock::now();
+        for (uint64_t i = 0; i < rounds; ++i) {
+            auto sent = Clock::now();
+            pair.first.sendData(payload, sizeof(payload), 0);
+            pair.first.recvFrame(echo, sizeof(echo));
+            latency.record(Clock::now() - sent);
+        }
+        auto elapsed = Clock::now() - begin;
+        echoer.join();
+        return {rounds, rounds * sizeof(payload) * 2, elapsed, latency.snapshot()};
+    }
+
+    void addSocketBenchmarks(std::vector<Benchmark>& out) {
+        for (size_t size : {64, 4096, 65536, 1 << 20}) {
+            out.push_back({"socket/socketpair/throughput/" + std::to_string(size), [size]() { return frameThroughput(socketPair(), size); }});
+            out.push_back({"socket/loopback/throughput/" + std::to_string(size), [size]() { return frameThroughput(loopbackPair(), size); }});
+        }
+        out.push_back({"socket/socketpair/pingpong/64", []() { return framePingPong(socketPair()); }});
+        out.push_back({"socket/loopback/pingpong/64", []() { return framePingPong(loopbackPair()); }});
+    }
+#else
+    void addSocketBenchmarks(std::vector<Benchmark>&) { }
+#endif
+
+    // ==========================================
+    // Thread pool
+    // ==========================================
+    // A few hundred nanoseconds of work, so that queueing overhead dominates.
+    void smallWork(std::atomic<uint64_t>& sink) {
+        uint64_t x = sink.load(std::memory_order_relaxed);
+        for (int i = 0; i < 64; ++i) x = x * 6364136223846793005ull + 1442695040888963407ull;
+        sink.fetch_add(x & 1, std::memory_order_relaxed);
+    }
+
+    size_t poolThreads() { return std::clamp<size_t>(std::thread::hardware_concurrency(), 2, 16); }
+
+    Run poolThroughput(bool withFuture) {
+        const uint64_t tasks = scaled(500000);
+        std::atomic<uint64_t> sink{0};
+        std::atomic<uint64_t> done{0};
+        utils::ThreadPool pool(poolThreads());
+        auto work = [&]() {
+            smallWork(sink);
+            done.fetch_add(1, std::memory_order_release);
+        };
+
+        auto begin = Clock::now();
+        for (uint64_t i = 0; i < tasks; ++i) {
+            if (withFuture) pool.enqueue(work);
+            else pool.post(work);
+        }
+        while (done.load(std::memory_order_acquire) < tasks) std::this_thread::yield();
+        return {tasks, 0, Clock::now() - begin, std::nullopt};
+    }
+
+    // One task in flight at a time: time from post() to the task starting on a worker.
+    Run poolLatency() {
+        const uint64_t tasks = scaled(50000);
+        utils::ThreadPool pool(poolThreads());
+        utils::Histogram latency;
+        std::atomic<bool> started{false};
+
+        auto begin = Clock::now();
+        for (uint64_t i = 0; i < tasks; ++i) {
+            started.store(false, std::memory_order_relaxed);
+            auto submitted = Clock::now();
+            pool.post([&, submitted]() {
+                latency.record(Clock::now() - submitted);
+                started.store(true, std::memory_order_release);
+            });
+            while (!started.load(std::memory_order_acquire)) std::this_thread::yield();
+        }
+        return {tasks, 0, Clock::now() - begin, latency.snapshot()};
+    }
+
+    void addThreadPoolBenchmarks(std::vector<Benchmark>& out) {
+        out.push_back({"thread_pool/post/throughput", []() { return poolThroughput(false); }});
+        out.push_back({"thread_pool/enqueue/throughput", []() { return poolThroughput(true); }});
+        out.push_back({"thread_pool/post/start_latency", []() { return poolLatency(); }});
+    }
+
+    // ==========================================
+    // Logger
+    // ==========================================
+    // Bursts stay below the ring capacity and are followed by a pause, so the producer never waits for the consumer.
+    Run loggerBurst() {
+        constexpr uint64_t kBurst = 4096;
+        const uint64_t bursts = scaled(50);
+        utils::AsyncLogger::getInstance().setOverflowPolicy(utils::OverflowPolicy::Block);
+        Clock::duration elapsed{};
+        for (uint64_t b = 0; b < bursts; ++b) {
+            auto begin = Clock::now();
+            for (uint64_t i = 0; i < kBurst; ++i) LOG_INFO("bench record {} of burst {} key={}", i, b, "bench/object");
+            elapsed += Clock::now() - begin;
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        }
+        return {bursts * kBurst, 0, elapsed, std::nullopt};
+    }
+
+    // A producer that outruns the consumer: with Drop, records that find the ring full are counted and discarded.
+    Run loggerSaturated() {
+        const uint64_t calls = scaled(1000000);
+        utils::AsyncLogger::getInstance().setOverflowPolicy(utils::OverflowPolicy::Drop);
+        auto begin = Clock::now();
+        for (uint64_t i = 0; i < calls; ++i) LOG_INFO("bench record {} key={}", i, "bench/object");
+        auto elapsed = Clock::now() - begin;
+        utils::AsyncLogger::getInstance().setOverflowPolicy(utils::OverflowPolicy::Block);
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+        return {calls, 0, elapsed, std::nullopt};
+    }
+
+    // Below the runtime minimum level: the cost every disabled LOG_DEBUG pays.
+    Run loggerFiltered() {
+        const uint64_t calls = scaled(10000000);
+        auto begin = Clock::now();
+        for (uint64_t i = 0; i < calls; ++i) LOG_DEBUG("bench record {} key={}", i, "bench/object");
+        return {calls, 0, Clock::now() - begin, std::nullopt};
+    }
+
+    void addLoggerBenchmarks(std::vector<Benchmark>& out) {
+        out.push_back({"logger/info/burst", []() { return loggerBurst(); }});
+        out.push_back({"logger/info/saturated_drop", []() { return loggerSaturated(); }});
+        out.push_back({"logger/debug/filtered", []() { return loggerFiltered(); }});
+    }
+
+    // ==========================================
+    // Buffers
+    // ==========================================
+    utils::BufferPool& bufferPool() {
+        static utils::BufferPool pool(1 << 20);
+        return pool;
+    }
+
+    // `threads` threads each acquire and release `size`-byte buffers, touching the first byte of each.
+    Run bufferChurn(size_t size, size_t threads, bool pooled) {
+        const uint64_t perThread = scaled(2000000 / threads);
+        std::atomic<uint64_t> sink{0};
+        auto work = [&]() {
+            uint64_t local = 0;
+            for (uint64_t i = 0; i < perThread; ++i) {
+                if (pooled) {
+                    utils::BufferPool::Buffer buffer = bufferPool().acquire(size);
+                    buffer.data()[0] = static_cast<char>(i);
+                    local += static_cast<uint64_t>(buffer.data()[0]);
+                } else {
+                    std::unique_ptr<char[]> buffer(new char[size]);
+                    buffer[0] = static_cast<char>(i);
+                    local += static_cast<uint64_t>(buffer[0]);
+                }
+            }
+            sink.fetch_add(local, std::memory_order_relaxed);
+        };
+
+        auto begin = Clock::now();
+        std::vector<std::thread> workers;
+        for (size_t t = 1; t < threads; ++t) workers.emplace_back(work);
+        work();
+        for (auto& worker : workers) worker.join();
+        return {perThread * threads, 0, Clock::now() - begin, std::nullopt};
+    }
+
+    // What RequestHandler does per request: keep the header, split off the key, format the reply.
+    Run requestScratch(bool arena) {
+        const uint64_t requests = scaled(2000000);
+        const std::string header = "PUT bench/objects/0000000042 4096";
+        utils::Arena scratch(bufferPool());
+        size_t sink = 0;
+
+        auto begin = Clock::now();
+        for (uint64_t i = 0; i < requests; ++i) {
+            if (arena) {
+                std::string_view input = scratch.copy(header);
+                std::string_view key = input.substr(4, input.rfind(' ') - 4);
+                sink += scratch.format("OK {} {}", key.size(), i).size();
+                scratch.reset();
+            } else {
+                std::string input(header);
+                std::string key = input.substr(4, input.rfind(' ') - 4);
+                sink += ("OK " + std::to_string(key.size()) + " " + std::to_string(i)).size();
+            }
+        }
+        auto elapsed = Clock::now() - begin;
+        if (sink == 0) std::puts("");
+        return {requests, 0, elapsed, std::nullopt};
+    }
+
+    void addBufferBenchmarks(std::vector<Benchmark>& out) {
+        for (size_t size : {4096, 262144}) {
+            out.push_back({"buffers/pool/acquire_release/" + std::to_string(size), [size]() { return bufferChurn(size, 1, true); }});
+            out.push_back({"buffers/heap/new_delete/" + std::to_string(size), [size]() { return bufferChurn(size, 1, false); }});
+        }
+        out.push_back({"buffers/pool/acquire_release_4threads/4096", []() { return bufferChurn(4096, 4, true); }});
+        out.push_back({"buffers/heap/new_delete_4threads/4096", []() { return bufferChurn(4096, 4, false); }});
+        out.push_back({"buffers/arena/request_scratch", []() { return requestScratch(true); }});
+        out.push_back({"buffers/heap/request_scratch", []() { return requestScratch(false); }});
+    }
+
+    // ==========================================
+    // Storage engine
+    // ==========================================
+    struct StorageFixture {
+        std::filesystem::path dir;
+        std::unique_ptr<core::StorageEngine> engine;
+    };
+
+    StorageFixture& storage() {
+        static StorageFixture fixture = []() {
+            StorageFixture f;
+            f.dir = std::filesystem::temp_directory_path() / ("refstorage-bench-" + runId());
+            std::filesystem::remove_all(f.dir);
+            f.engine = std::make_unique<core::StorageEngine>(std::vector<std::filesystem::path>{f.dir});
+            return f;
+        }();
+        return fixture;
+    }
+
+    std::vector<char> randomPayload(size_t size, uint32_t seed) {
+        std::vector<char> data(size);
+        std::mt19937 rng(seed);
+        for (auto& c : data) c = static_cast<char>(rng());
+        return data;
+    }
+
+    std::string objectKey(size_t size, uint64_t i) { return "bench-" + std::to_string(size) + "-" + std::to_string(i); }
+
+    Run storagePut(size_t size, uint64_t objects);
+
+    // Get and stat read what the put benchmark of the same size wrote; write it first when they run on their own.
+    void ensureObjects(size_t size, uint64_t objects) {
+        if (!storage().engine->stat(objectKey(size, objects - 1))) storagePut(size, objects);
+    }
+
+    Run storagePut(size_t size, uint64_t objects) {
+        auto payload = randomPayload(size, 42);
+        utils::Histogram latency;
+        auto begin = Clock::now();
+        for (uint64_t i = 0; i < objects; ++i) {
+            auto started = Clock::now();
+            auto writer = storage().engine->createWriter(objectKey(size, i));
+            for (size_t off = 0; off < size; off += 256 * 1024) writer.write(payload.data() + off, std::min<size_t>(256 * 1024, size - off));
+            writer.commit();
+            latency.record(Clock::now() - started);
+        }
+        return {objects, objects * size, Clock::now() - begin, latency.snapshot()};
+    }
+
+    Run storageGet(size_t size, uint64_t objects) {
+        ensureObjects(size, objects);
+        std::vector<char> buf(256 * 1024);
+        utils::Histogram latency;
+        auto begin = Clock::now();
+        for (uint64_t i = 0; i < objects; ++i) {
+            auto started = Clock::now();
+            auto reader = storage().engine->openReader(objectKey(size, i));
+            while (reader.remaining() > 0) reader.read(buf.data(), buf.size());
+            if (!reader.verified()) throw std::runtime_error("checksum mismatch in get benchmark");
+            latency.record(Clock::now() - started);
+        }
+        return {objects, objects * size, Clock::now() - begin, latency.snapshot()};
+    }
+
+    Run storageStat(size_t size, uint64_t objects) {
+        ensureObjects(size, objects);
+        auto begin = Clock::now();
+        for (uint64_t i = 0; i < objects; ++i) {
+            if (!storage().engine->stat(objectKey(size, i))) throw std::runtime_error("missing object in stat benchmark");
+        }
+        return {objects, 0, Clock::now() - begin, std::nullopt};
+    }
+
+    // Sequential 256 KiB range reads over one 64 MiB object, as GETRANGE serves them.
+    Run storageScan() {
+        constexpr uint64_t kObject = 64ull << 20;
+        constexpr uint64_t kChunk = 256 * 1024;
+        ensureObjects(kObject, 1);
+
+        uint64_t ops = 0;
+        auto begin = Clock::now();
+        auto range = storage().engine->openRange(objectKey(kObject, 0), 0, kObject);
+        while (range.next(kChunk)) ++ops;
+        return {ops, kObject, Clock::now() - begin, std::nullopt};
+    }
+
+    void addStorageBenchmarks(std::vector<Benchmark>& out) {
+        const uint64_t small = scaled(2000);
+        const uint64_t large = scaled(100);
+        out.push_back({"storage/put/4096", [small]() { return storagePut(4096, small); }});
+        out.push_back({"storage/get/4096", [small]() { return storageGet(4096, small); }});
+        out.push_back({"storage/stat/4096", [small]() { return storageStat(4096, small); }});
+        out.push_back({"storage/put/1048576", [large]() { return storagePut(1 << 20, large); }});
+        out.push_back({"storage/get/1048576", [large]() { return storageGet(1 << 20, large); }});
+        out.push_back({"storage/scan/range_256k", []() { return storageScan(); }});
+    }
+
+    // ==========================================
+    // Driver and JSON output
+    // ==========================================
+    void appendJsonString(std::string& out, const std::string& text) {
+        out += '"';
+        for (char c : text) {
+            if (c == '"' || c == '\\') out += '\\';
+            out += c;
+        }
+        out += '"';
+    }
+
+    std::string jsonResult(const std::string& name, std::vector<Run>& runs) {
+        std::sort(runs.begin(), runs.end(), [](const Run& a, const Run& b) { return a.nsPerOp() < b.nsPerOp(); });
+        const Run& median = runs[runs.size() / 2];
+        double seconds = std::chrono::duration<double>(median.elapsed).count();
+
+        std::string out = "    {\"name\": ";
+        appendJsonString(out, name);
+        out += ", \"repetitions\": " + std::to_string(runs.size());
+        out += ", \"ops\": " + std::to_string(median.ops);
+        out += ", \"ns_per_op\": " + std::to_string(median.nsPerOp());
+        out += ", \"ns_per_op_min\": " + std::to_string(runs.front().nsPerOp());
+        out += ", \"ns_per_op_max\": " + std::to_string(runs.back().nsPerOp());
+        out += ", \"ops_per_sec\": " + std::to_string(seconds > 0 ? static_cast<double>(median.ops) / seconds : 0);
+        if (median.bytes) out += ", \"bytes_per_sec\": " + std::to_string(seconds > 0 ? static_cast<double>(median.bytes) / seconds : 0);
+        if (median.latency) {
+            const auto& h = *median.latency;
+            out += ", \"latency_ns\": {\"mean\": " + std::to_string(h.mean()) +
+                   ", \"p50\": " + std::to_string(h.percentile(0.50)) +
+                   ", \"p90\": " + std::to_string(h.percentile(0.90)) +
+                   ", \"p99\": " + std::to_string(h.percentile(0.99)) +
+                   ", \"p999\": " + std::to_string(h.percentile(0.999)) +
+                   ", \"max\": " + std::to_string(h.max) + "}";
+        }
+        out += "}";
+        return out;
+    }
+
+    bool parseArgs(int argc, char** argv) {
+        for (int i = 1; i < argc; ++i) {
+            std::string arg = argv[i];
+            bool hasValue = i + 1 < argc;
+            if (arg == "--filter" && hasValue) g_options.filter = argv[++i];
+            else if (arg == "--repetitions" && hasValue) g_options.repetitions = std::max<size_t>(1, std::strtoull(argv[++i], nullptr, 10));
+            else if (arg == "--out" && hasValue) g_options.out = argv[++i];
+            else if (arg == "--quick") g_options.quick = true;
+            else return false;
+        }
+        return true;
+    }
+
+}
+
+int main(int argc, char** argv) {
+    if (!parseArgs(argc, argv)) {
+        std::fprintf(stderr, "Usage: %s [--filter <substring>] [--repetitions <n>] [--quick] [--out <file.json>]\n", argv[0]);
+        return 2;
+    }
+
+    // The logger benchmarks need a running logger; storage code logs through it as well.
+    auto logDir = std::filesystem::temp_directory_path() / ("refstorage-bench-log-" + runId());
+    std::filesystem::create_directories(logDir);
+    utils::LoggerOptions logOptions;
+    logOptions.console = utils::ConsoleOutput::Off;
+    logOptions.compress_rotated = false;
+    auto& logger = utils::AsyncLogger::getInstance();
+    logger.init((logDir / "bench.log").string(), logOptions);
+    std::thread logThread([&logger]() { logger.consumeLogs(); });
+
+    std::vector<Benchmark> benchmarks;
+    addSocketBenchmarks(benchmarks);
+    addThreadPoolBenchmarks(benchmarks);
+    addLoggerBenchmarks(benchmarks);
+    addBufferBenchmarks(benchmarks);
+    addStorageBenchmarks(benchmarks);
+
+    std::vector<std::string> results;
+    for (const auto& bench : benchmarks) {
+        if (!g_options.filter.empty() && bench.name.find(g_options.filter) == std::string::npos) continue;
+        std::fprintf(stderr, "%s ...\n", bench.name.c_str());
+        try {
+            bench.run();
+            std::vector<Run> runs;
+            for (size_t r = 0; r < g_options.repetitions; ++r) runs.push_back(bench.run());
+            results.push_back(jsonResult(bench.name, runs));
+        } catch (const std::exception& e) {
+            std::fprintf(stderr, "%s failed: %s\n", bench.name.c_str(), e.what());
+        }
+    }
+
+    logger.stop();
+    logThread.join();
+    std::error_code ec;
+    std::filesystem::remove_all(logDir, ec);
+    std::filesystem::remove_all(storage().dir, ec);
+
+    std::string json = "{\n  \"context\": {";
+    json += "\"hardware_concurrency\": " + std::to_string(std::thread::hardware_concurrency());
+    json += ", \"repetitions\": " + std::to_string(g_options.repetitions);
+    json += std::string(", \"quick\": ") + (g_options.quick ? "true" : "false");
+#ifdef NDEBUG
+    json += ", \"build\": \"release\"";
+#else
+    json += ", \"build\": \"debug\"";
+#endif
+    json += ", \"timestamp\": " + std::to_string(std::chrono::duration_cast<std::chrono::seconds>(
+                                      std::chrono::system_clock::now().time_since_epoch()).count());
+    json += "},\n  \"benchmarks\": [\n";
+    for (size_t i = 0; i < results.size(); ++i) {
+        json += results[i];
+        json += i + 1 < results.size() ? ",\n" : "\n";
+    }
+    json += "  ]\n}\n";
+
+    if (g_options.out.empty()) {
+        std::fputs(json.c_str(), stdout);
+    } else if (FILE* f = std::fopen(g_options.out.c_str(), "w")) {
+        std::fputs(json.c_str(), f);
+        std::fclose(f);
+    } else {
+        std::fprintf(stderr, "Cannot write %s\n", g_options.out.c_str());
+        return 1;
+    }
+    return 0;
+}
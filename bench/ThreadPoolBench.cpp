@@ -0,0 +1,187 @@
+//Copyright (c) 2026 Liu Kaizhi
+//Licensed under the Apache License, Version 2.0.
+
+/* Throughput comparison between the work-stealing utils::ThreadPool and the previous
+ * single-queue design (reproduced below as LegacyThreadPool).
+ *
+ *   thread_pool_bench [tasks per run]
+ *
+ * Two workloads are measured at 1..64 worker threads:
+ *   external  - one outside thread submits every task (the accept loop pattern).
+ *   spawn     - tasks submit follow-up tasks from inside the pool (fan-out pattern).
+ *
+ * A third table compares the submission paths of the new pool from an outside thread:
+ * enqueue() (with future), post() (fire-and-forget) and postBulk() in batches of 64.
+ */
+
+#include "utils/include/ThreadPool.hpp"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <queue>
+
+namespace {
+
+    class LegacyThreadPool {
+    public:
+        explicit LegacyThreadPool(size_t threads) {
+            for (size_t i = 0; i < threads; i++) {
+                workers.emplace_back([this]() {
+                    while (true) {
+                        std::packaged_task<void()> task;
+                        {
+                            std::unique_lock<std::mutex> lock(queue_mutex);
+                            condition.wait(lock, [this] { return stop || !tasks.empty(); });
+                            if (stop && tasks.empty()) return;
+                            task = std::move(tasks.front());
+                            tasks.pop();
+                        }
+                        task();
+                    }
+                });
+            }
+        }
+
+        ~LegacyThreadPool() {
+            {
+                std::unique_lock<std::mutex> lock(queue_mutex);
+                stop = true;
+            }
+            condition.notify_all();
+            for (std::thread& worker : workers) worker.join();
+        }
+
+        template <class F>
+        auto enqueue(F&& f) -> std::future<std::invoke_result_t<F>> {
+            using return_type = std::invoke_result_t<F>;
+            auto promise = std::make_shared<std::promise<return_type>>();
+            auto future = promise->get_future();
+            auto task = [promise, f = std::forward<F>(f)]() mutable {
+                f();
+                promise->set_value();
+            };
+            {
+                std::unique_lock<std::mutex> lock(queue_mutex);
+                tasks.emplace(std::move(task));
+            }
+            condition.notify_one();
+            return future;
+        }
+
+    private:
+        std::vector<std::thread> workers;
+        std::queue<std::packaged_task<void()>> tasks;
+        std::mutex queue_mutex;
+        std::condition_variable condition;
+        bool stop = false;
+    };
+
+    // A few hundred nanoseconds of work, so that queueing overhead dominates.
+    void smallWork(std::atomic<uint64_t>& sink) {
+        uint64_t x = sink.load(std::memory_order_relaxed);
+        for (int i = 0; i < 64; ++i) x = x * 6364136223846793005ull + 1442695040888963407ull;
+        sink.fetch_add(x & 1, std::memory_order_relaxed);
+    }
+
+    template <class Pool>
+    double runExternal(size_t threads, size_t tasks) {
+        std::atomic<uint64_t> sink{0};
+        std::atomic<size_t> done{0};
+        auto begin = std::chrono::steady_clock::now();
+        {
+            Pool pool(threads);
+            for (size_t i = 0; i < tasks; ++i) {
+                pool.enqueue([&]() {
+                    smallWork(sink);
+                    done.fetch_add(1, std::memory_order_relaxed);
+                });
+            }
+            while (done.load(std::memory_order_acquire) < tasks) std::this_thread::yield();
+        }
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - begin;
+        return static_cast<double>(tasks) / elapsed.count();
+    }
+
+    // Each root task spawns `kFanOut` children from inside the pool.
+    template <class Pool>
+    double runSpawn(size_t threads, size_t tasks) {
+        constexpr size_t kFanOut = 64;
+        std::atomic<uint64_t> sink{0};
+        std::atomic<size_t> done{0};
+        size_t roots = tasks / kFanOut;
+        size_t total = roots * (kFanOut + 1);
+        auto begin = std::chrono::steady_clock::now();
+        {
+            Pool pool(threads);
+            for (size_t i = 0; i < roots; ++i) {
+                pool.enqueue([&]() {
+                    for (size_t c = 0; c < kFanOut; ++c) {
+                        pool.enqueue([&]() {
+                            smallWork(sink);
+                            done.fetch_add(1, std::memory_order_relaxed);
+                        });
+                    }
+                    done.fetch_add(1, std::memory_order_relaxed);
+                });
+            }
+            while (done.load(std::memory_order_acquire) < total) std::this_thread::yield();
+        }
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - begin;
+        return static_cast<double>(total) / elapsed.count();
+    }
+
+    enum class Submit { Enqueue, Post, Bulk };
+
+    double runSubmit(Submit mode, size_t threads, size_t tasks) {
+        constexpr size_t kBatch = 64;
+        std::atomic<uint64_t> sink{0};
+        std::atomic<size_t> done{0};
+        auto work = [&]() {
+            smallWork(sink);
+            done.fetch_add(1, std::memory_order_relaxed);
+        };
+        auto begin = std::chrono::steady_clock::now();
+        {
+            ref_storage::utils::ThreadPool pool(threads);
+            if (mode == Submit::Bulk) {
+                std::vector<decltype(work)> batch(kBatch, work);
+                for (size_t i = 0; i + kBatch <= tasks; i += kBatch) pool.postBulk(batch.begin(), batch.end());
+                tasks -= tasks % kBatch;
+            } else {
+                for (size_t i = 0; i < tasks; ++i) {
+                    if (mode == Submit::Post) pool.post(work);
+                    else pool.enqueue(work);
+                }
+            }
+            while (done.load(std::memory_order_acquire) < tasks) std::this_thread::yield();
+        }
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - begin;
+        return static_cast<double>(tasks) / elapsed.count();
+    }
+
+}
+
+int main(int argc, char** argv) {
+    size_t tasks = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 200000;
+    const size_t thread_counts[] = {1, 2, 4, 8, 16, 32, 64};
+
+    std::printf("%-8s %-8s %16s %16s %8s\n", "workload", "threads", "legacy (ops/s)", "stealing (ops/s)", "speedup");
+    for (size_t threads : thread_counts) {
+        double legacy = runExternal<LegacyThreadPool>(threads, tasks);
+        double stealing = runExternal<ref_storage::utils::ThreadPool>(threads, tasks);
+        std::printf("%-8s %-8zu %16.0f %16.0f %7.2fx\n", "external", threads, legacy, stealing, stealing / legacy);
+    }
+    for (size_t threads : thread_counts) {
+        double legacy = runSpawn<LegacyThreadPool>(threads, tasks);
+        double stealing = runSpawn<ref_storage::utils::ThreadPool>(threads, tasks);
+        std::printf("%-8s %-8zu %16.0f %16.0f %7.2fx\n", "spawn", threads, legacy, stealing, stealing / legacy);
+    }
+
+    std::printf("\n%-8s %16s %16s %16s\n", "threads", "enqueue (ops/s)", "post (ops/s)", "postBulk (ops/s)");
+    for (size_t threads : thread_counts) {
+        std::printf("%-8zu %16.0f %16.0f %16.0f\n", threads, runSubmit(Submit::Enqueue, threads, tasks),
+                    runSubmit(Submit::Post, threads, tasks), runSubmit(Submit::Bulk, threads, tasks));
+    }
+    return 0;
+}
@@ -0,0 +1,200 @@
+//Copyright (c) 2026 Kaizhi Liu
+//Licensed under the Apache License, Version 2.0.
+
+/* Concurrency check for the lock-free queues under the thread pool (not part of the node).
+ *
+ *   work_stealing_check [rounds]
+ *
+ * Each round runs three checks and fails loudly on the first item that is lost, duplicated or out of order:
+ *   deque     - one owner pushes and pops a WorkStealingDeque that starts tiny (so it grows under the thieves)
+ *               while several thieves steal from it; every item must be taken exactly once.
+ *   injector  - several producers push single nodes and chains into an MpscQueue while one consumer drains it;
+ *               every node must arrive exactly once, and each producer's nodes in the order it pushed them.
+ *   pool      - outside threads post() into a ThreadPool while the tasks post follow-ups from inside it, so
+ *               both the injector and the worker deques are in play; every task must run exactly once.
+ * Exits with status 1 on a failure.
+ */
+
+#include "utils/include/MpscQueue.hpp"
+#include "utils/include/ThreadPool.hpp"
+#include "utils/include/WorkStealingDeque.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace {
+
+    using ref_storage::utils::MpscNode;
+    using ref_storage::utils::MpscQueue;
+    using ref_storage::utils::ThreadPool;
+    using ref_storage::utils::WorkStealingDeque;
+
+    // Counts how often each of `total` items was seen, and reports the first that was not seen exactly once.
+    class Tally {
+    public:
+        explicit Tally(size_t total) : seen_(std::make_unique<std::atomic<uint32_t>[]>(total)), total_(total) {
+            for (size_t i = 0; i < total_; ++i) seen_[i].store(0, std::memory_order_relaxed);
+        }
+
+        void mark(size_t item) { seen_[item].fetch_add(1, std::memory_order_relaxed); }
+
+        bool check(const char* what) const {
+            for (size_t i = 0; i < total_; ++i) {
+                uint32_t count = seen_[i].load(std::memory_order_relaxed);
+                if (count != 1) {
+                    std::fprintf(stderr, "%s: item %zu seen %u times\n", what, i, count);
+                    return false;
+                }
+            }
+            return true;
+        }
+
+    private:
+        std::unique_ptr<std::atomic<uint32_t>[]> seen_;
+        size_t total_;
+    };
+
+    bool checkDeque(size_t thieves, size_t items) {
+        WorkStealingDeque<uint64_t> deque(2);
+        Tally tally(items);
+        std::atomic<bool> done{false};
+
+        std::vector<std::thread> threads;
+        for (size_t i = 0; i < thieves; ++i) {
+            threads.emplace_back([&]() {
+                while (true) {
+                    // Read before stealing: once the owner is done, an Empty steal means nothing is left.
+                    bool last = done.load(std::memory_order_acquire);
+                    uint64_t item = 0;
+                    auto result = deque.steal(item);
+                    if (result == WorkStealingDeque<uint64_t>::StealResult::Success) tally.mark(item);
+                    else if (result == WorkStealingDeque<uint64_t>::StealResult::Empty && last) return;
+                }
+            });
+        }
+
+        // Bursts of pushes followed by a few pops keep the owner and the thieves meeting at the last element.
+        uint64_t next = 0;
+        while (next < items) {
+            for (size_t burst = 1 + next % 7; burst > 0 && next < items; --burst) deque.push(next++);
+            uint64_t item = 0;
+            for (size_t pops = next % 3; pops > 0 && deque.pop(item); --pops) tally.mark(item);
+        }
+        uint64_t item = 0;
+        while (deque.pop(item)) tally.mark(item);
+        done.store(true, std::memory_order_release);
+        for (auto& thread : threads) thread.join();
+        return tally.check("deque");
+    }
+
+    struct Item : MpscNode {
+        uint32_t producer = 0;
+        uint32_t seq = 0;
+    };
+
+    bool checkInjector(size_t producers, size_t per_producer) {
+        MpscQueue<Item> queue;
+        std::vector<Item> items(producers * per_producer);
+        for (size_t p = 0; p < producers; ++p) {
+            for (size_t s = 0; s < per_producer; ++s) {
+                items[p * per_producer + s].producer = static_cast<uint32_t>(p);
+                items[p * per_producer + s].seq = static_cast<uint32_t>(s);
+            }
+        }
+
+        std::vector<std::thread> threads;
+        for (size_t p = 0; p < producers; ++p) {
+            threads.emplace_back([&, p]() {
+                Item* mine = &items[p * per_producer];
+                for (size_t s = 0; s < per_producer;) {
+                    // Every fourth push is a chain of up to eight nodes, as postBulk() does.
+                    size_t length = s % 4 == 3 ? std::min<size_t>(8, per_producer - s) : 1;
+                    if (length == 1) {
+                        queue.push(&mine[s]);
+                    } else {
+                        for (size_t i = s; i + 1 < s + length; ++i) mine[i].next.store(&mine[i + 1], std::memory_order_relaxed);
+                        queue.pushChain(&mine[s], &mine[s + length - 1]);
+                    }
+                    s += length;
+                }
+            });
+        }
+
+        std::vector<uint32_t> expected(producers, 0);
+        size_t received = 0;
+        bool ok = true;
+        while (received < items.size() && ok) {
+            Item* item = queue.pop();
+            if (!item) continue;
+            if (item->seq != expected[item->producer]) {
+                std::fprintf(stderr, "injector: expected %u from producer %u, got %u\n", expected[item->producer], item->producer, item->seq);
+                ok = false;
+            }
+            expected[item->producer] = item->seq + 1;
+            ++received;
+        }
+        for (auto& thread : threads) thread.join();
+        if (ok && queue.pop()) {
+            std::fprintf(stderr, "injector: more nodes than were pushed\n");
+            ok = false;
+        }
+        return ok;
+    }
+
+    bool checkPool(size_t workers, size_t posters, size_t per_poster) {
+        // Every outside task posts one follow-up from inside the pool: ids [0, n) outside, [n, 2n) inside.
+        size_t outside = posters * per_poster;
+        Tally tally(2 * outside);
+        std::atomic<size_t> remaining{2 * outside};
+        {
+            ThreadPool pool(workers);
+            std::vector<std::thread> threads;
+            for (size_t p = 0; p < posters; ++p) {
+                threads.emplace_back([&, p]() {
+                    for (size_t i = 0; i < per_poster; ++i) {
+                        size_t id = p * per_poster + i;
+                        pool.post([&, id]() {
+                            tally.mark(id);
+                            pool.post([&, id]() {
+                                tally.mark(outside + id);
+                                remaining.fetch_sub(1, std::memory_order_release);
+                            });
+                            remaining.fetch_sub(1, std::memory_order_release);
+                        });
+                    }
+                });
+            }
+            for (auto& thread : threads) thread.join();
+            auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(30);
+            while (remaining.load(std::memory_order_acquire) > 0 && std::chrono::steady_clock::now() < deadline) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+            if (remaining.load(std::memory_order_acquire) > 0) {
+                std::fprintf(stderr, "pool: %zu tasks never ran\n", remaining.load());
+                return false;
+            }
+        }
+        return tally.check("pool");
+    }
+
+}
+
+int main(int argc, char** argv) {
+    size_t rounds = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 20;
+    size_t threads = std::max<size_t>(2, std::thread::hardware_concurrency());
+
+    for (size_t round = 1; round <= rounds; ++round) {
+        if (!checkDeque(threads, 200000) || !checkInjector(threads, 50000) || !checkPool(threads, 4, 20000)) {
+            std::printf("round %zu: FAILED\n", round);
+            return 1;
+        }
+        std::printf("round %zu: ok\n", round);
+    }
+    return 0;
+}
@@ -0,0 +1,83 @@
+//Copyright (c) 2026 Kaizhi Liu
+//Licensed under the Apache License, Version 2.0.
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include "net/include/AsyncSocket.hpp"
+#include "RequestHandler.hpp"
+
+namespace ref_storage::core {
+
+    /* One data connection: everything it needs lives in its slot, so serving a connection allocates nothing
+     * beyond what RequestHandler takes from the buffer pool.
+     */
+    struct Connection {
+        // Stable for the life of the connection; stale once the slot is closed (see ConnectionTable).
+        uint64_t id = 0;
+        // Set for thread-per-connection clients; event-loop connections are owned by net::TcpServer.
+        std::optional<net::AsyncSocket> socket;
+        // The session state: stream buffer, readahead window and request trace.
+        std::optional<RequestHandler> handler;
+        std::chrono::steady_clock::time_point opened;
+        // Lets a draining node end the session between two requests; kept across reuse of the slot.
+        SessionGate gate;
+    };
+
+    /* Fixed-capacity slab of connections addressed by generation-tagged ids.
+     * An id packs the slot index (low 32 bits) with the slot's generation (high 32 bits). Closing a slot bumps its
+     * generation before the slot goes back on the free list, so an id kept past close() no longer resolves, even
+     * after the slot has been handed to another connection. Id 0 is never issued.
+     *
+     * open() and close() pop and push a lock-free free list, so accepting and dropping connections takes no lock
+     * and the table never grows or moves a live connection. A slot belongs to whoever opened it until it is closed.
+     */
+    class ConnectionTable {
+    public:
+        explicit ConnectionTable(size_t capacity);
+        ~ConnectionTable();
+
+        ConnectionTable(const ConnectionTable&) = delete;
+        ConnectionTable& operator=(const ConnectionTable&) = delete;
+
+        // A free slot with a fresh id and an empty socket and handler, or nullptr when all slots are in use.
+        Connection* open();
+        // Destroys the slot's socket and handler, and recycles it.
+        void close(Connection& conn);
+        // The connection behind id, or nullptr if the id is malformed or its slot has been closed since.
+        [[nodiscard]] Connection* find(uint64_t id) noexcept;
+
+        /* Ask every open connection to end at its next gap between requests (SessionGate::drain). Idle connections
+         * close at once; the table empties as the requests in progress are answered. Connections opened afterwards
+         * are not affected, so stop accepting first.
+         */
+        void drain();
+        // End every connection now, whatever it is doing (SessionGate::cut).
+        void cut();
+
+        [[nodiscard]] size_t size() const noexcept { return in_use_.load(std::memory_order_relaxed); }
+        [[nodiscard]] size_t capacity() const noexcept { return capacity_; }
+
+    private:
+        static constexpr uint32_t kNoSlot = UINT32_MAX;
+
+        struct Slot {
+            Connection conn;
+            std::atomic<uint32_t> generation{1};
+            std::atomic<uint32_t> next_free{kNoSlot};
+        };
+
+        void push(uint32_t index) noexcept;
+
+        size_t capacity_;
+        std::unique_ptr<Slot[]> slots_;
+        // Index of the first free slot in the low 32 bits, a pop counter against ABA in the high 32 bits.
+        std::atomic<uint64_t> free_head_;
+        std::atomic<size_t> in_use_{0};
+    };
+
+}
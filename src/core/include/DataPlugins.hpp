@@ -0,0 +1,86 @@
+//Copyright (c) 2026 Kaizhi Liu
+//Licensed under the Apache License, Version 2.0.
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "PluginAPI.hpp"
+
+namespace ref_storage::core {
+
+    /* Data-path plugins loaded at run time (RsDataPlugin in PluginAPI.hpp), consulted by RequestHandler.
+     * Plugins are only ever added, so the request path reads the table without a lock: add() fills the next slot
+     * and then publishes the new count.
+     */
+    class DataPlugins {
+    public:
+        static constexpr size_t kMaxPlugins = 16;
+        // Room a request hook gets for its reply or rejection reason.
+        static constexpr size_t kReplyCapacity = 4096;
+
+        struct Outcome {
+            RsVerdict verdict = RS_PASS;
+            // RS_REJECT, RS_REPLY: the plugin's text. RS_PASS, RS_REPLACE (bodies): the data to store.
+            std::string_view text;
+        };
+
+        struct Stats {
+            std::string name;
+            std::vector<std::string> opcodes;
+            uint64_t requests = 0;
+            uint64_t rejected = 0;
+            uint64_t replied = 0;
+            uint64_t chunks = 0;
+            uint64_t replaced = 0;
+        };
+
+        static DataPlugins& global();
+
+        // Register the plugin behind a library's entry point; throws std::runtime_error if it is refused.
+        // Returns the plugin's name.
+        std::string add(RsDataPluginEntryFunc entry);
+
+        [[nodiscard]] bool empty() const noexcept { return count_.load(std::memory_order_acquire) == 0; }
+        [[nodiscard]] bool hasBodyHooks() const noexcept { return body_hooks_.load(std::memory_order_acquire); }
+
+        /* Run the request hooks on one header. A custom opcode goes to the plugin that claimed it alone; any other
+         * op goes through every plugin in load order until one does not pass. The reply is written to out.
+         */
+        Outcome onRequest(uint64_t connection, std::string_view op, std::string_view args, char* out, size_t capacity);
+
+        /* Run the body hooks on one chunk held in data (chunk.data is filled in here). A plugin that replaces the
+         * chunk writes into the other of data and scratch, and the next plugin sees the replacement; both buffers
+         * must hold capacity bytes. The returned text is the data to store, or the reason of a rejection.
+         */
+        Outcome onBody(RsBodyChunk chunk, char* data, size_t len, char* scratch, size_t capacity);
+
+        [[nodiscard]] std::vector<Stats> stats() const;
+
+    private:
+        struct Plugin {
+            RsDataPlugin desc{};
+            std::string name;
+            std::vector<std::string> opcodes;
+            std::atomic<uint64_t> requests{0};
+            std::atomic<uint64_t> rejected{0};
+            std::atomic<uint64_t> replied{0};
+            std::atomic<uint64_t> chunks{0};
+            std::atomic<uint64_t> replaced{0};
+        };
+
+        Outcome runRequest(Plugin& plugin, const RsRequest& request, char* out, size_t capacity);
+
+        std::mutex mutex_;      // serialises add()
+        std::array<std::unique_ptr<Plugin>, kMaxPlugins> plugins_;
+        std::atomic<size_t> count_{0};
+        std::atomic<bool> body_hooks_{false};
+    };
+
+}
@@ -0,0 +1,85 @@
+//Copyright (c) 2026 Kaizhi Liu
+//Licensed under the Apache License, Version 2.0.
+
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "utils/include/AsyncLogger.hpp"
+#include "utils/include/Topology.hpp"
+#include "utils/include/Trace.hpp"
+#include "StorageEngine.hpp"
+
+namespace ref_storage::core {
+
+    /* Everything config.json can set. A file is read over a base configuration (the node's built-in defaults), so
+     * a key it leaves out keeps its default; unknown keys and out-of-range values are errors. Parsing has no side
+     * effects: the server validates a whole file before it applies any of it.
+     *
+     *   { "node_id": "...", "master_url": "...", "address": "::1", "port": 12344, "metrics_port": 0,
+     *     "admin":       { "address": "::1", "port": 12345 },
+     *     "storage":     { "tiers": [{"name": "hot", "dirs": ["data"]}], "readahead_budget_mb": 256,
+     *                      "migration": { "scan_interval_s", "cold_after_s", "min_free_ratio", "promote_heat",
+     *                                     "max_mb_per_sec" } },
+     *     "threads":     { "clients", "min", "max", "grow_after_ms", "idle_timeout_ms", "client_weight",
+     *                      "client_queue_limit", "affinity": "none|node|core", "listener_node" },
+     *     "io":          { "async", "loops", "max_connections" },
+     *     "log":         { "level": "debug|info|warn|error|fatal", "overflow": "block|drop|drop_debug_first",
+     *                      "output": "text|binary", "console": "off|buffered|flushed", "ring_capacity",
+     *                      "max_file_mb", "compress_rotated" },
+     *     "trace":       { "slow_threshold_ms", "sample_every", "ring_capacity" },
+     *     "hot_restart": { "path", "drain_timeout_s" } }
+     *
+     * Only the settings listed in liveChanges() can change on a running node ('reload'); the rest are read once,
+     * at startup.
+     */
+    struct NodeConfig {
+        std::string node_id;
+        std::string master_url;
+
+        std::string address;
+        int port = 0;
+        std::string admin_address;
+        int admin_port = 0;
+        int metrics_port = 0;
+
+        std::vector<StorageEngine::Tier> tiers;
+        uint64_t readahead_budget = StorageEngine::kDefaultReadaheadBudget;
+        StorageEngine::MigrationPolicy migration;
+
+        // 0: the thread count passed to Server::start().
+        size_t client_threads = 0;
+        size_t min_threads = 0;
+        size_t max_threads = 0;
+        std::chrono::milliseconds grow_after{5};
+        std::chrono::milliseconds idle_timeout{30000};
+        uint32_t client_weight = 8;
+        size_t client_queue_limit = 1024;
+        utils::Affinity worker_affinity = utils::Affinity::None;
+        int listener_node = -1;
+
+        bool async_io = false;
+        size_t io_loops = 2;
+        size_t max_connections = 4096;
+
+        utils::LoggerOptions log;
+        utils::TraceOptions trace;
+
+        std::string hot_restart_path;
+        std::chrono::seconds drain_timeout{30};
+
+        // Throws std::runtime_error naming the offending key.
+        static NodeConfig parse(std::string_view text, const NodeConfig& base);
+        static NodeConfig load(const std::filesystem::path& path, const NodeConfig& base);
+
+        // Settings that differ from `current`, as "key: old -> new", split by whether a running node can apply them.
+        [[nodiscard]] std::vector<std::string> liveChanges(const NodeConfig& current) const;
+        [[nodiscard]] std::vector<std::string> restartChanges(const NodeConfig& current) const;
+    };
+
+}
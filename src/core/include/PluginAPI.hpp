@@ -1,6 +1,9 @@
 #ifndef PLUGIN_API_HPP
 #define PLUGIN_API_HPP
 
+#include <stddef.h>
+#include <stdint.h>
+
 #ifdef _WIN32
     #define PLUGIN_EXPORT __declspec(dllexport)
 #else
@@ -10,6 +13,84 @@
 extern "C" {
     typedef const char* (*GetCommandNameFunc)();
     typedef void (*ExecuteCommandFunc)(const char* args, char* reply_buffer, int max_len);
+
+    /* ==========================================
+     * Data-path plugins
+     * ==========================================
+     * A library that exports RS_DATA_PLUGIN_ENTRY ("RefStorageDataPlugin") is loaded with the admin 'load' command
+     * as a data-path plugin instead of a command plugin. The host calls the entry point once with its ABI version;
+     * the plugin fills in the descriptor and returns 0, or returns non-zero to refuse (e.g. an ABI it cannot serve).
+     *
+     * Versioning: the major version (high 16 bits) changes when a struct or a call changes incompatibly, and the
+     * host refuses plugins built against another major. Minor versions only append fields to the end of structs:
+     * struct_size tells the host how much of RsDataPlugin the plugin knows about.
+     *
+     * Memory: every view points at host memory that is valid only for the duration of the call. Hooks never
+     * allocate for the host; they write into the RsOutput buffers the host passes in, and set len.
+     * Hooks run on the thread that serves the connection, concurrently for different connections, so they must be
+     * thread-safe; a hook must not block for long, or it stalls that connection (or, with async I/O, its event loop).
+     * Plugins stay loaded until the node exits.
+     */
+    #define RS_DATA_PLUGIN_ABI_VERSION ((1u << 16) | 0u)
+    #define RS_DATA_PLUGIN_ABI_MAJOR(v) ((v) >> 16)
+    #define RS_DATA_PLUGIN_ENTRY "RefStorageDataPlugin"
+
+    // Read-only window onto host memory.
+    typedef struct RsView {
+        const char* data;
+        size_t len;
+    } RsView;
+
+    // Host-provided buffer for a hook's output: the hook writes up to capacity bytes at data and sets len.
+    typedef struct RsOutput {
+        char* data;
+        size_t capacity;
+        size_t len;
+    } RsOutput;
+
+    typedef enum RsVerdict {
+        RS_PASS = 0,        // let the host serve the request (or store the chunk) as usual
+        RS_REJECT = 1,      // refuse: the output holds the reason, sent to the client as "ERR <reason>"
+        RS_REPLY = 2,       // requests only: the output is the complete reply, and the host does nothing else
+        RS_REPLACE = 3      // body chunks only: store the output instead of the chunk
+    } RsVerdict;
+
+    // The header frame of one request, "<op> <args>".
+    typedef struct RsRequest {
+        uint64_t connection_id;     // stable for the life of a connection
+        RsView op;
+        RsView args;
+    } RsRequest;
+
+    // A piece of a request body (PUT, MPU_PART) on its way to the storage engine.
+    typedef struct RsBodyChunk {
+        uint64_t connection_id;
+        RsView op;
+        RsView args;                // the header arguments of the request the chunk belongs to
+        uint64_t offset;            // of the chunk within the body as sent by the client
+        uint64_t total;             // declared body size
+        RsView data;
+    } RsBodyChunk;
+
+    /* The hooks take a batch of count items with one output and one verdict each; verdicts start out as RS_PASS.
+     * Any hook may be NULL.
+     *   on_requests  sees every request header. Requests whose op is in opcodes reach only the plugin that claimed
+     *                them, which must answer RS_REPLY or RS_REJECT; other ops may be passed, rejected or answered.
+     *   on_body      sees the body of every upload as it streams in. RS_REJECT aborts the upload (the rest of the
+     *                body is still read, and nothing is stored); RS_REPLACE stores the output bytes in its place,
+     *                with an output capacity equal to the chunk size.
+     */
+    typedef struct RsDataPlugin {
+        uint32_t abi_version;               // RS_DATA_PLUGIN_ABI_VERSION as compiled into the plugin
+        uint32_t struct_size;               // sizeof(RsDataPlugin) as compiled into the plugin
+        const char* name;
+        const char* const* opcodes;         // NULL-terminated list of custom opcodes, or NULL
+        void* context;                      // passed back to every hook
+        void (*on_requests)(void* context, const RsRequest* requests, RsOutput* outputs, RsVerdict* verdicts, size_t count);
+        void (*on_body)(void* context, const RsBodyChunk* chunks, RsOutput* outputs, RsVerdict* verdicts, size_t count);
+    } RsDataPlugin;
+
+    typedef int (*RsDataPluginEntryFunc)(uint32_t host_abi_version, RsDataPlugin* plugin);
 }
 
-#endif // PLUGIN_API_HPP
\ No newline at end of file
+#endif // PLUGIN_API_HPP
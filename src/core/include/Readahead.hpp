@@ -0,0 +1,75 @@
+//Copyright (c) 2026 Liu Kaizhi
+//Licensed under the Apache License, Version 2.0.
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <optional>
+
+namespace ref_storage::core {
+
+    /* Node-wide cap on the bytes that all streams together may have prefetched ahead of their readers.
+     * Streams ask for budget when their window grows and hand it back when the window collapses or the stream ends,
+     * so a burst of sequential downloads cannot push the working set of everybody else out of the page cache.
+     */
+    class ReadaheadBudget {
+    public:
+        explicit ReadaheadBudget(uint64_t limitBytes) : limit_(limitBytes) { }
+
+        // Reserve up to `wanted` bytes; return how much was actually granted (possibly 0).
+        uint64_t grant(uint64_t wanted) noexcept;
+        void release(uint64_t bytes) noexcept { in_use_.fetch_sub(bytes, std::memory_order_relaxed); }
+
+        void setLimit(uint64_t limitBytes) noexcept { limit_.store(limitBytes, std::memory_order_relaxed); }
+        [[nodiscard]] uint64_t limit() const noexcept { return limit_.load(std::memory_order_relaxed); }
+        [[nodiscard]] uint64_t inUse() const noexcept { return in_use_.load(std::memory_order_relaxed); }
+
+    private:
+        std::atomic<uint64_t> limit_;
+        std::atomic<uint64_t> in_use_{0};
+    };
+
+    /* Per-stream sequential-access detector with an adaptive readahead window.
+     * Every completed read is reported through onRead(). Two back-to-back contiguous reads mark the stream as
+     * sequential; from then on the window starts at kMinWindow and doubles on every further sequential read up to
+     * kMaxWindow, within what the budget grants. A read that does not continue where the last one ended
+     * collapses the window and returns its budget.
+     * onRead() answers with the range that should be prefetched, asynchronously, so that the data the client asks
+     * for next is already in flight; like the kernel's own readahead, the next batch is requested once the reader
+     * has consumed half of the current window.
+     */
+    class Readahead {
+    public:
+        static constexpr uint64_t kMinWindow = 128 * 1024;
+        static constexpr uint64_t kMaxWindow = 8 * 1024 * 1024;
+
+        struct Prefetch {
+            uint64_t offset = 0;
+            uint64_t length = 0;
+        };
+
+        explicit Readahead(ReadaheadBudget* budget = nullptr) noexcept : budget_(budget) { }
+        ~Readahead() { reset(); }
+
+        Readahead(Readahead&& other) noexcept;
+        Readahead& operator=(Readahead&& other) noexcept;
+        Readahead(const Readahead&) = delete;
+        Readahead& operator=(const Readahead&) = delete;
+
+        std::optional<Prefetch> onRead(uint64_t offset, uint64_t length, uint64_t streamSize) noexcept;
+
+        // Forget the access history and return the budget (e.g. the stream moved on to another object).
+        void reset() noexcept;
+
+        [[nodiscard]] uint64_t window() const noexcept { return window_; }
+
+    private:
+        ReadaheadBudget* budget_ = nullptr;
+        uint64_t next_offset_ = 0;
+        uint64_t prefetched_end_ = 0;
+        uint64_t window_ = 0;
+        uint32_t sequential_hits_ = 0;
+    };
+
+}
@@ -3,10 +3,137 @@
 
 #pragma once
 
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "net/include/AsyncSocket.hpp"
+#include "utils/include/Arena.hpp"
+#include "utils/include/BufferPool.hpp"
+#include "utils/include/Trace.hpp"
+#include "DataPlugins.hpp"
+#include "StorageEngine.hpp"
+
 namespace ref_storage::core {
 
-   class RequestHandler {
+    /* Where one connection stands between requests, for a node that is draining (a hot restart hands its traffic
+     * to a new process). The handler marks the gaps between requests; drain() ends the session in such a gap, at once
+     * if it is idle, or as soon as the request in progress has been answered; cut() ends it at once, in a request
+     * or not. Lives in the connection's slot, which outlives the handler, so both are safe at any time.
+     */
+    class SessionGate {
+    public:
+        // A new session takes the slot: a drain or cut aimed at the previous one no longer applies.
+        void open();
+        // The session waits for its next request on fd. false if the node is draining: the session must end.
+        bool idle(net::SocketHandle::NativeSocketType fd);
+        // A header arrived. false if the session was drained while it waited: the header is dropped.
+        bool busy();
+        // The session has ended; its descriptor is about to be closed.
+        void close();
+        // Thread-safe. An idle session is woken by shutting down the reading side of its socket.
+        void drain();
+        // Thread-safe. Shut the socket down both ways: the request in progress fails on its next send or receive.
+        void cut();
+
+    private:
+        std::mutex mutex_;
+        net::SocketHandle::NativeSocketType fd_ = net::SocketHandle::kInvalid;
+        bool waiting_ = false;      // between requests
+        bool draining_ = false;
+    };
+
+    /* Data-plane protocol spoken over the length-prefixed framing of net::Socket.
+     * Every request starts with a text header frame "<OP> <args...>":
+     *
+     *   PUT <key> <size>   followed by the payload as a sequence of frames of at most kStreamChunkSize bytes.
+     *                      Reply: "OK <size> <crc32>" or "ERR <reason>".
+     *   GET <key>          Reply: "OK <size> <crc32>" followed by the payload as frames of at most
+     *                      kStreamChunkSize bytes, or "ERR <reason>".
+     *   GETRANGE <key> <offset> <length>
+     *                      Reply: "OK <length> <object size>" followed by the bytes of the range as frames of at most
+     *                      kStreamChunkSize bytes. Only the blocks the range touches are read and verified, and the
+     *                      frames are sent straight from the page cache.
+     *   DEL <key>          Reply: "OK" or "ERR <reason>".
+     *
+     * Multipart upload (parts of one upload may be sent concurrently over different connections):
+     *   MPU_CREATE <key>                       Reply: "OK <upload_id>".
+     *   MPU_PART <upload_id> <part> <size>     Body framed as for PUT. Reply: "OK <size> <crc32>".
+     *   MPU_COMPLETE <upload_id> <part>[:<crc32>] ...
+     *                                          Manifest: the parts in object order, optionally with the checksum
+     *                                          the client computed. Reply: "OK <size> <crc32>".
+     *   MPU_ABORT <upload_id>                  Reply: "OK".
+     *
+     * Any other frame is echoed back, as the node did before the storage protocol existed.
+     *
+     * Data-path plugins (DataPlugins, PluginAPI.hpp) see every header before it is served and every upload chunk
+     * before it is stored; they can answer or refuse a request, serve opcodes of their own, and refuse or rewrite
+     * upload bodies. They get views of this handler's buffers and write into buffers it provides.
+     *
+     * Payloads never have to fit in memory: each transfer reuses one buffer of kStreamChunkSize bytes, taken from the
+     * NUMA node of the worker that serves the connection. The header text, its tokens and the reply live in a
+     * per-request arena from the same pool, so a request allocates nothing on the general heap for them.
+     * Backpressure falls out of the blocking sockets: the next chunk is only received after the previous one
+     * reached the storage engine, and the next chunk is only read from disk after the previous one was sent,
+     * so a slow disk or a slow client simply closes the TCP window.
+     *
+     * Each request is traced from its header frame to its reply (see utils::RequestTracer), split into parsing,
+     * queueing for the blocking pool, receiving the body, storage calls and sending.
+     */
+    class RequestHandler {
+    public:
+        static constexpr size_t kStreamChunkSize = 256 * 1024;
+
+        // Holds a header, its tokens, the reply and a plugin's reply buffer (DataPlugins::kReplyCapacity).
+        static constexpr size_t kArenaChunkSize = 16 * 1024;
+
+        // buffers must hand out blocks of at least kStreamChunkSize bytes; connection_id is what plugins see.
+        RequestHandler(StorageEngine& engine, utils::BufferPool& buffers, uint64_t connection_id = 0);
+
+        /* Serve requests on one connection until the peer disconnects, or gate (if any) is drained.
+         * Storage calls are offloaded to the loop's blocking pool when sock runs on an event loop, and made inline
+         * otherwise, so the same coroutine serves both kinds of connection.
+         */
+        utils::Task<void> serve(net::AsyncSocket& sock, SessionGate* gate = nullptr);
+
+    private:
+        utils::Task<void> handlePut(net::AsyncSocket& sock, std::string_view args);
+        utils::Task<void> handleGet(net::AsyncSocket& sock, std::string_view args);
+        utils::Task<void> handleGetRange(net::AsyncSocket& sock, std::string_view args);
+        utils::Task<void> handleDel(net::AsyncSocket& sock, std::string_view args);
+        utils::Task<void> handleMultipartCreate(net::AsyncSocket& sock, std::string_view args);
+        utils::Task<void> handleMultipartPart(net::AsyncSocket& sock, std::string_view args);
+        utils::Task<void> handleMultipartComplete(net::AsyncSocket& sock, std::string_view args);
+        utils::Task<void> handleMultipartAbort(net::AsyncSocket& sock, std::string_view args);
+        // A request a plugin answered or refused; upload bodies are still read, to keep the framing in sync.
+        utils::Task<void> handlePluginVerdict(net::AsyncSocket& sock, std::string_view op, std::string_view args,
+                                              RsVerdict verdict, std::string_view text);
+
+        // Receive a body of exactly `total` bytes into writer (if any); the body is drained even on failure.
+        utils::Task<void> receiveBody(net::AsyncSocket& sock, uint64_t total, std::optional<ObjectWriter>& writer, std::string& error);
+
+        // msg must stay valid until the reply is sent: a literal, or text in arena_.
+        utils::Task<void> reply(net::AsyncSocket& sock, std::string_view msg);
+
+        StorageEngine& engine_;
+        utils::BufferPool& buffers_;
+        uint64_t connection_id_;
+        utils::BufferPool::Buffer buffer_;
+        // Output of body plugins that rewrite chunks; taken from buffers_ on first use.
+        utils::BufferPool::Buffer plugin_scratch_;
+        // Scratch of the request in progress; reset when its reply has gone out.
+        utils::Arena arena_;
+        // Header of the request in progress, in arena_.
+        std::string_view request_op_;
+        std::string_view request_args_;
+
+        // Sequential-access state for range requests on this connection; reset when the client switches objects.
+        std::string readahead_key_;
+        Readahead range_readahead_;
 
-   };
+        // Stage timestamps of the request in progress.
+        utils::TraceSpan trace_;
+    };
 
-}
\ No newline at end of file
+}
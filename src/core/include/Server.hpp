@@ -7,13 +7,26 @@
 #include <string>
 #include <vector>
 #include <mutex>
+#include <condition_variable>
 #include <memory>
 #include <atomic>
 #include <unordered_map>
 #include <functional>
 #include <thread>
+#include <chrono>
+#include <optional>
 #include "net/include/Socket.hpp"
+#include "net/include/TcpServer.hpp"
 #include "utils/include/ThreadPool.hpp"
+#include "utils/include/Scheduler.hpp"
+#include "utils/include/BufferPool.hpp"
+#include "utils/include/Topology.hpp"
+#include "utils/include/AsyncLogger.hpp"
+#include "utils/include/Metrics.hpp"
+#include "utils/include/Trace.hpp"
+#include "StorageEngine.hpp"
+#include "NodeConfig.hpp"
+#include "ConnectionTable.hpp"
 
 namespace ref_storage::core {
     class Server {
@@ -32,6 +45,14 @@ namespace ref_storage::core {
         Server(const Server&) = delete;
         Server& operator=(const Server&) = delete;
 
+        /* Hot restart, new side: have init() take the listeners and the index over from the node that serves
+         * hot_restart_path_ (as configured). Call before init(); the node starts cold when no node answers there.
+         */
+        void takeOver() { takeover_requested_ = true; }
+
+        /* Settings come from config_path (see NodeConfig) where given; the file's port, if it has one, wins over
+         * the argument. A missing file leaves the built-in defaults, a malformed one throws std::runtime_error.
+         */
         void init(int port = 12344, const std::string& config_path = "");
         void start(size_t thread_const = std::thread::hardware_concurrency());
         void stop();
@@ -50,17 +71,72 @@ namespace ref_storage::core {
         ~Server();
 
         void doInit(int port, const std::string& config_path);
-        void serverChatWorker(net::Socket& Socket);
+        void serverChatWorker(uint64_t connection_id);
+        utils::Task<void> serveAsyncClient(net::AsyncSocket& sock);
 
+        // Outlives the pool: connection handlers hold its buffers until their task ends.
+        std::unique_ptr<utils::BufferPool> buffer_pool_;
         std::unique_ptr<utils::ThreadPool> thread_pool_;
-        std::vector<net::Socket> client_sockets_;
+        // Every task goes through a lane; declared after the pool so that it is torn down first.
+        std::unique_ptr<utils::Scheduler> scheduler_;
+        utils::Scheduler::LaneId client_lane_ = 0;
+        utils::Scheduler::LaneId admin_lane_ = 0;
+        std::thread log_thread_;
+        std::unique_ptr<StorageEngine> storage_engine_;
+        // Data connections of both serving modes; at most max_connections_, further clients are turned away.
+        std::unique_ptr<ConnectionTable> connections_;
+        size_t max_connections_ = 4096;
         net::Socket listen_socket_;
-        std::mutex mutex_;
         static std::once_flag init_flag;
 
         int port_;
         std::string address_;
+        std::string admin_address_ = "::1";
+        int admin_port_ = 12345;
+        // Identity, from config.json; not used by the node itself yet.
+        std::string node_id_;
+        std::string master_url_;
+        // Data directories grouped into tiers, fastest first; tiering only kicks in with more than one tier.
+        std::vector<StorageEngine::Tier> storage_tiers_;
+        StorageEngine::MigrationPolicy migration_policy_;
+        uint64_t readahead_budget_ = StorageEngine::kDefaultReadaheadBudget;
         size_t num_threads_;
+        // Client threads; 0 takes the count passed to start().
+        size_t client_threads_ = 0;
+        // Elastic pool bounds; 0 derives them from start(): min = reserved lanes + 1, max = 4 x clients + reserved.
+        size_t pool_min_threads_ = 0;
+        size_t pool_max_threads_ = 0;
+        std::chrono::milliseconds pool_grow_after_{5};
+        std::chrono::milliseconds pool_idle_timeout_{30000};
+        [[nodiscard]] size_t reservedThreads() const { return admin_lane_options_.max_threads + background_lane_options_.max_threads; }
+        std::string handleThreadsCommand(const std::string& args);
+        // Client sessions get the thread count passed to start(); admin and background lanes come on top.
+        utils::LaneOptions admin_lane_options_{"admin", 2, 2, 16, 1};
+        utils::LaneOptions background_lane_options_{"background", 1, 1, 256, 1};
+        uint32_t client_lane_weight_ = 8;
+        size_t client_queue_limit_ = 1024;
+        // Placement: pool workers per worker_affinity_; the accept and admin threads on listener_node_ (-1: anywhere).
+        utils::Affinity worker_affinity_ = utils::Affinity::None;
+        int listener_node_ = -1;
+        // Serve clients as coroutines on io_loops_ event loops instead of one pool thread per connection.
+        bool async_io_ = false;
+        size_t io_loops_ = 2;
+        std::unique_ptr<net::TcpServer> tcp_server_;
+        void pinListenerThread() const;
+        // Logger: a full ring sheds Debug records first and makes the other levels wait for the consumer.
+        // Binary output goes to server.log.bin, to be read with storage_log_decode.
+        utils::LoggerOptions log_options_{utils::LogLevel::Debug, utils::OverflowPolicy::DropDebugFirst};
+        // Request tracing: requests over 100 ms go to the log with their stage breakdown; 1 in 64 is kept for 'traces'.
+        utils::TraceOptions trace_options_;
+        std::string handleTracesCommand(const std::string& args);
+        // Sampling CPU profiler (utils::Profiler); writes collapsed stacks for flame graphs.
+        std::string handleProfileCommand(const std::string& args);
+        // Ends a timed 'profile <seconds>' run at its deadline. Every start and stop bumps profile_run_, and the
+        // timer only collects the run it was armed for.
+        std::mutex profile_mutex_;
+        std::condition_variable profile_cv_;
+        uint64_t profile_run_ = 0;
+        std::thread profile_timer_;
 
         // ==========================================
         // 业务层控制 (数据面)
@@ -70,6 +146,51 @@ namespace ref_storage::core {
         void stopBusiness();
         void acceptBusinessConnections();
 
+        // ==========================================
+        // 热重启 (POSIX)
+        // ==========================================
+        /* A new binary started with --hot-restart connects to hot_restart_path_ and gets the business, admin and metrics
+         * listeners (SCM_RIGHTS) and an index checkpoint; it serves at once. This node then stops accepting, ends its
+         * connections between requests, streams the keys it still changes to the new node, and exits once drained
+         * (or after drain_timeout_). Off unless configured (an empty path). The socket file is private to the node's
+         * user, and requests from any other user are refused.
+         */
+        std::string hot_restart_path_;
+        std::chrono::seconds drain_timeout_{30};
+        // Set once the listeners belong to a successor; the accept loops wind down.
+        std::atomic<bool> retiring_{false};
+        // Accept loops still running on the shared listeners.
+        std::atomic<int> accepting_{0};
+        net::Socket handover_listen_socket_{net::SocketHandle()};
+        // New side, between takeOver() and the predecessor's last word.
+        net::Socket predecessor_{net::SocketHandle()};
+        std::optional<net::Socket> inherited_business_;
+        std::optional<net::Socket> inherited_admin_;
+        std::optional<net::Socket> inherited_metrics_;
+        std::filesystem::path takeover_checkpoint_;
+        bool takeover_requested_ = false;
+        bool connectToPredecessor();
+        void listenForHandover();
+        void handOver(net::Socket& channel);
+        void retire(net::Socket& channel);
+        void followPredecessor();
+
+        // ==========================================
+        // 配置 (config.json)
+        // ==========================================
+        /* The knobs above are the node's configuration; NodeConfig is their file form. 'reload' re-reads the file
+         * over default_config_ (so a key taken out of the file goes back to its default), validates all of it, then
+         * applies the settings a running node can change and reports the rest as needing a restart.
+         */
+        std::filesystem::path config_path_;
+        NodeConfig default_config_;
+        std::mutex config_mutex_;   // serialises reloads, and guards handing_over_
+        // Set by handOver() for good once a successor is taking over (cleared if it fails): reloads are refused.
+        bool handing_over_ = false;
+        [[nodiscard]] NodeConfig currentConfig() const;
+        void applyConfig(const NodeConfig& config);
+        std::string reloadConfig(const std::string& path);
+
         // ==========================================
         // 运维层控制 (控制面)
         // ==========================================
@@ -80,8 +201,22 @@ namespace ref_storage::core {
         net::Socket admin_listen_socket_;
 
         void registerCommands();
+        // Node-level metrics (accepts, connections, pool and lane gauges); data-path metrics register themselves.
+        void registerMetrics();
+        std::string renderStats() const;
+        utils::Counter* accepted_metric_ = nullptr;
+        utils::Gauge* active_metric_ = nullptr;
+        utils::Counter* rejected_metric_ = nullptr;
         void acceptAdminConnections();
         void adminWorker(std::shared_ptr<net::Socket> admin_sock);
+
+        // Prometheus scrapes: GET /metrics on the admin port, and on address_:metrics_port_ when that is non-zero.
+        int metrics_port_ = 0;
+        net::Socket metrics_listen_socket_;
+        std::mutex metrics_mutex_;
+        std::string metrics_body_;
+        void acceptMetricsConnections();
+        void serveHttp(net::Socket& sock);
     };
 }
 
@@ -3,10 +3,417 @@
 
 #pragma once
 
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstddef>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <shared_mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+#include "utils/include/Checksum.hpp"
+#include "Readahead.hpp"
+
 namespace ref_storage::core {
 
+    /* Granularity of the per-extent block index. Every extent file <path> has a sidecar <path>.bidx holding
+     * an 8-byte header ("RSBI" + block size) followed by one CRC-32 per block, so a range read only has to read
+     * and verify the blocks it touches, and only loads 4 bytes of index per block.
+     */
+    inline constexpr uint32_t kBlockSize = 4 * 1024;
+
+    // One contiguous piece of an object's payload, stored as a whole file in one of the data directories.
+    struct Extent {
+        uint32_t dir = 0;        // index into the engine's data directories
+        std::string path;        // relative to that data directory
+        uint64_t length = 0;
+        uint32_t crc32 = 0;
+
+        bool operator==(const Extent&) const = default;
+    };
+
+    // Metadata kept in memory for every committed object.
+    struct ObjectInfo {
+        uint64_t size = 0;
+        uint32_t crc32 = 0;
+        std::vector<Extent> extents;   // payload in order; a plain PUT has exactly one
+    };
+
+    class StorageEngine;
+
+    /* Keeps the payload files of one object version on disk for as long as a reader holds it. Files the engine drops
+     * in the meantime (overwrite, delete, migration) are only unlinked when their last lease goes away.
+     */
+    class ExtentLease {
+    public:
+        ExtentLease() = default;
+        ExtentLease(ExtentLease&& other) noexcept;
+        ExtentLease& operator=(ExtentLease&& other) noexcept;
+        ExtentLease(const ExtentLease&) = delete;
+        ExtentLease& operator=(const ExtentLease&) = delete;
+        ~ExtentLease() { release(); }
+
+        // Full paths of the leased extents, in object order.
+        [[nodiscard]] const std::vector<std::filesystem::path>& paths() const noexcept { return paths_; }
+
+    private:
+        friend class StorageEngine;
+        ExtentLease(const StorageEngine* engine, std::vector<std::filesystem::path> paths)
+            : engine_(engine), paths_(std::move(paths)) { }
+
+        void release() noexcept;
+
+        const StorageEngine* engine_ = nullptr;
+        std::vector<std::filesystem::path> paths_;
+    };
+
+    /* Streaming writer for one file of payload (a whole object, or one part of a multipart upload).
+     * Bytes are appended to a temporary file and checksummed as they arrive, so the caller only ever holds
+     * the chunk it is currently writing. Nothing becomes visible to readers until commit(), which hands the
+     * finished file to the engine to be published atomically. A writer destroyed without commit() discards its data.
+     */
+    class ObjectWriter {
+    public:
+        using PublishFunc = std::function<void(const std::filesystem::path& tmpPath, const ObjectInfo& info)>;
+
+        ObjectWriter(ObjectWriter&& other) noexcept;
+        ObjectWriter& operator=(ObjectWriter&& other) noexcept;
+        ObjectWriter(const ObjectWriter&) = delete;
+        ObjectWriter& operator=(const ObjectWriter&) = delete;
+        ~ObjectWriter();
+
+        void write(const char* data, size_t len);
+        ObjectInfo commit();
+        void abort();
+
+        [[nodiscard]] uint64_t bytesWritten() const noexcept { return size_; }
+
+    private:
+        friend class StorageEngine;
+        ObjectWriter(std::filesystem::path tmpPath, PublishFunc publish);
+
+        void appendBlockCrc(uint32_t crc);
+
+        std::filesystem::path tmp_path_;
+        PublishFunc publish_;
+        std::ofstream out_;
+        std::ofstream index_out_;
+        utils::Crc32 crc_;
+        uint32_t block_crc_ = 0;
+        uint32_t block_fill_ = 0;
+        uint64_t size_ = 0;
+        bool finished_ = false;
+    };
+
+    /* Streaming reader for one object.
+     * read() fills the caller's buffer from disk one chunk at a time, walking the extents in order.
+     * The checksum is recomputed on the way through so that verified() can tell, once the whole object
+     * has been read, whether it was intact. Reads also drive a Readahead window, so the extents ahead of the
+     * reader are already being fetched from disk while the current chunk is on the wire.
+     */
+    class ObjectReader {
+    public:
+        ObjectReader(ObjectReader&&) noexcept = default;
+        ObjectReader& operator=(ObjectReader&&) noexcept = default;
+        ObjectReader(const ObjectReader&) = delete;
+        ObjectReader& operator=(const ObjectReader&) = delete;
+
+        // Return the number of bytes copied into buf; 0 at end of object.
+        size_t read(char* buf, size_t len);
+
+        [[nodiscard]] const ObjectInfo& info() const noexcept { return info_; }
+        [[nodiscard]] uint64_t remaining() const noexcept { return info_.size - offset_; }
+        [[nodiscard]] bool verified() const noexcept { return offset_ == info_.size && crc_.value() == info_.crc32; }
+
+    private:
+        friend class StorageEngine;
+        ObjectReader(ObjectInfo info, ExtentLease lease, ReadaheadBudget* budget);
+
+        ObjectInfo info_;
+        ExtentLease lease_;
+        size_t extent_index_ = 0;
+        uint64_t extent_offset_ = 0;
+        std::ifstream in_;
+        utils::Crc32 crc_;
+        uint64_t offset_ = 0;
+        Readahead readahead_;
+    };
+
+    // A piece of a byte range that lives in a single file.
+    struct RangeSegment {
+        std::filesystem::path path;
+        uint64_t offset = 0;
+        uint64_t length = 0;
+    };
+
+    /* Walks a byte range of an object extent by extent.
+     * next() returns the following piece of the range (never crossing an extent), after reading and verifying
+     * exactly the blocks that piece touches against the block index. The caller can then ship the piece with a
+     * zero-copy file send: the blocks were just read, so the send is served from the page cache.
+     * Extents written before the block index existed are returned unverified.
+     */
+    class RangeReader {
+    public:
+        RangeReader(RangeReader&&) noexcept = default;
+        RangeReader& operator=(RangeReader&&) noexcept = default;
+
+        std::optional<RangeSegment> next(size_t maxLen);
+
+        /* Feed the pieces handed out by next() into a caller-owned readahead window. The window outlives the
+         * reader so that a client streaming an object through consecutive range requests is still detected.
+         */
+        void setReadahead(Readahead* readahead) noexcept { readahead_ = readahead; }
+
+        [[nodiscard]] uint64_t remaining() const noexcept { return end_ - offset_; }
+        [[nodiscard]] const ObjectInfo& info() const noexcept { return info_; }
+
+    private:
+        friend class StorageEngine;
+        RangeReader(ObjectInfo info, ExtentLease lease, uint64_t offset, uint64_t length);
+
+        void verifyBlocks(uint64_t extentOffset, uint64_t length);
+
+        ObjectInfo info_;
+        ExtentLease lease_;
+        uint64_t offset_ = 0;
+        uint64_t end_ = 0;
+
+        // Files of the extent currently being verified, kept open between calls.
+        size_t open_extent_ = SIZE_MAX;
+        std::ifstream data_in_;
+        std::ifstream index_in_;
+        bool has_index_ = false;
+        uint32_t block_size_ = kBlockSize;
+        std::vector<char> scratch_;
+        std::vector<uint32_t> expected_;
+        Readahead* readahead_ = nullptr;
+    };
+
+    /* Object store backed by plain files spread over one or more data directories (typically one per disk).
+     * Directories are grouped into tiers, fastest first (e.g. NVMe, then HDD). New objects are always written to
+     * tier 0; a background migrator demotes objects that went cold and promotes cold-tier objects that became hot
+     * again, see MigrationPolicy. Readers never notice: they follow the extent list in the index.
+     * The first directory of tier 0 is the primary one and holds the index:
+     *   <dir0>/meta/<key>              size, checksum and extent list
+     *   <dir0>/objects/<key>@<v>       payload of a plain PUT
+     *   <dirN>/extents/<id>.<n>@<v>    parts of a multipart object, left on the disk they were uploaded to
+     *   <dirN>/uploads/<id>.<n>        committed parts of an upload that is still open
+     *   <dirN>/tmp/                    in-progress writes
+     * Every payload file is accompanied by its block index (<file>.bidx).
+     * A payload file is written once and never reused: every write, and every migrated copy, gets a new version
+     * suffix @<v>. A replaced or deleted version is unlinked once no reader holds a lease on it (ExtentLease), so a
+     * reader keeps streaming the version it looked up whatever happens to the key meanwhile. Leases only cover this
+     * process: while a hot restart has two processes serving the same directories, nothing is unlinked until the
+     * previous one has exited (see writeCheckpoint()).
+     * The index is rebuilt from meta/ on startup, and payload files it does not reference are swept.
+     * All errors are reported with exceptions.
+     */
     class StorageEngine {
+    public:
+        struct Tier {
+            std::string name;
+            std::vector<std::filesystem::path> dirs;
+        };
+
+        struct MigrationPolicy {
+            std::chrono::seconds scan_interval{30};
+            // Demote objects on a faster tier that have not been read for this long...
+            std::chrono::seconds cold_after{3600};
+            // ...or, coldest first, regardless of age while the faster tier has less free space than this.
+            double min_free_ratio = 0.10;
+            // Promote objects on a slower tier once their (halved every scan) read count reaches this.
+            uint32_t promote_heat = 16;
+            // Copy bandwidth shared by all migrations, so they never compete seriously with foreground I/O.
+            uint64_t max_bytes_per_sec = 64ull * 1024 * 1024;
+        };
+
+        // A single tier made of the given directories.
+        explicit StorageEngine(std::vector<std::filesystem::path> dataDirs);
+        explicit StorageEngine(std::vector<Tier> tiers);
+        /* Take over from a node that still runs on the same directories (hot restart): the index comes from the
+         * checkpoint it wrote (writeCheckpoint), which is deleted once read, and tmp/ and uploads/ are left alone,
+         * since the other node is still finishing writes there. An unusable checkpoint falls back to scanning meta/.
+         */
+        StorageEngine(std::vector<Tier> tiers, const std::filesystem::path& checkpoint);
+        ~StorageEngine();
+
+        StorageEngine(const StorageEngine&) = delete;
+        StorageEngine& operator=(const StorageEngine&) = delete;
+
+        [[nodiscard]] ObjectWriter createWriter(const std::string& key);
+        [[nodiscard]] ObjectReader openReader(const std::string& key) const;
+        // Byte range [offset, offset + length) of an object; throws std::out_of_range if it is not inside the object.
+        [[nodiscard]] RangeReader openRange(const std::string& key, uint64_t offset, uint64_t length) const;
+
+        [[nodiscard]] std::optional<ObjectInfo> stat(const std::string& key) const;
+        bool remove(const std::string& key);
+        [[nodiscard]] size_t objectCount() const;
+
+        static constexpr uint64_t kDefaultReadaheadBudget = 256 * 1024 * 1024;
+        [[nodiscard]] ReadaheadBudget& readaheadBudget() const noexcept { return readahead_budget_; }
+
+        // ==========================================
+        // Multipart upload
+        // ==========================================
+        /* A multipart upload lets a client send the parts of one object concurrently, over as many connections
+         * as it likes, and then commit them with a manifest listing the part numbers in order.
+         * Parts are spread over the data directories by part number so that concurrent parts hit different
+         * disks. On completion nothing is copied: the part files are renamed in place and become the extents
+         * of the object, and the object checksum is derived from the part checksums.
+         */
+        struct ManifestEntry {
+            uint32_t part = 0;
+            std::optional<uint32_t> crc32;   // verified against the stored part when present
+        };
+
+        [[nodiscard]] std::string createUpload(const std::string& key);
+        [[nodiscard]] ObjectWriter createPartWriter(const std::string& uploadId, uint32_t partNumber);
+        ObjectInfo completeUpload(const std::string& uploadId, const std::vector<ManifestEntry>& manifest);
+        bool abortUpload(const std::string& uploadId);
+
+        // ==========================================
+        // Tiering
+        // ==========================================
+        void startMigrator(const MigrationPolicy& policy);
+        void stopMigrator();
+        [[nodiscard]] size_t tierCount() const noexcept { return tier_dirs_.size(); }
+        // Number of objects currently living on each tier.
+        [[nodiscard]] std::vector<size_t> objectsPerTier() const;
+
+        // ==========================================
+        // Hot restart
+        // ==========================================
+        /* Write the index, read statistics included, to <dir0>/index.checkpoint for the process taking over, and
+         * return its path. Every key changed from then on is recorded for takeChanges(), and the payload files this
+         * process drops are no longer unlinked but kept for takeRemovals(): a reader in the other process may still
+         * be streaming them. An engine built from a checkpoint keeps its dropped files the same way until
+         * resumeRemovals().
+         */
+        std::filesystem::path writeCheckpoint();
+        // Keys changed since writeCheckpoint(), waiting up to `wait` for the first; each is returned once per call.
+        [[nodiscard]] std::vector<std::string> takeChanges(std::chrono::milliseconds wait);
+        // The hand-over was called off: forget the recorded keys, stop recording, and unlink the kept files.
+        void stopTrackingChanges();
+        // Re-read the metadata of keys another process changed, and drop the ones it removed.
+        void refresh(const std::vector<std::string>& keys);
+        // The payload files dropped since writeCheckpoint(), for the process taking over to unlink; each is returned once.
+        [[nodiscard]] std::vector<std::filesystem::path> takeRemovals();
+        /* The other process has exited: unlink the files kept since the checkpoint, and the ones it passed on,
+         * as soon as no reader here holds them; from now on dropped files go at once again.
+         */
+        void resumeRemovals(const std::vector<std::filesystem::path>& inherited);
+
+        // Keys map directly to file names, so only a conservative character set is accepted.
+        static bool isValidKey(const std::string& key) noexcept;
+
+        static std::filesystem::path blockIndexPath(const std::filesystem::path& payload);
+
+    private:
+        friend class ExtentLease;
+
+        // Read statistics the migrator bases its decisions on; updated with relaxed atomics under the shared lock.
+        struct AccessStats {
+            std::atomic<uint32_t> heat{0};
+            std::atomic<int64_t> last_access{0};   // steady clock, seconds
+        };
+
+        struct IndexEntry {
+            ObjectInfo info;
+            std::unique_ptr<AccessStats> access = std::make_unique<AccessStats>();
+        };
+
+        struct Upload {
+            std::string id;
+            std::string key;
+            std::mutex mutex;
+            std::map<uint32_t, Extent> parts;
+            bool closed = false;
+        };
+
+        /* Move finished payload files into place and swap the index entry, atomically with respect to readers.
+         * With `expected`, the swap only happens if the object still has exactly those extents (used by the
+         * migrator, which must not clobber an object that was overwritten while it was being copied).
+         */
+        bool publish(const std::string& key, ObjectInfo info,
+                     const std::vector<std::pair<std::filesystem::path, std::filesystem::path>>& renames,
+                     const ObjectInfo* expected = nullptr);
+        // With `lease`, the object's extents are leased before the index lock is released.
+        [[nodiscard]] std::optional<ObjectInfo> lookup(const std::string& key, bool recordAccess, ExtentLease* lease = nullptr) const;
+        void writeMeta(const std::filesystem::path& path, const ObjectInfo& info) const;
+        // Unlink extents no longer in the index; the ones under lease are left to the last release.
+        void removeExtents(const std::vector<Extent>& extents) const;
+        void releaseExtents(const std::vector<std::filesystem::path>& paths) const noexcept;
+        // Remove versioned payload files (and their block indexes) that no index entry refers to.
+        void sweepOrphans();
+        void openDirs(std::vector<Tier> tiers, bool cleanup);
+        // Returns the number of objects skipped for unreadable metadata.
+        size_t loadIndex();
+        bool loadCheckpoint(const std::filesystem::path& path);
+        // The object's metadata file, or nothing if it is missing, corrupt or refers to missing payload.
+        [[nodiscard]] std::optional<ObjectInfo> readMeta(const std::string& key) const;
+        // Called with the index lock held by everything that changes an entry.
+        void noteChange(const std::string& key);
+        [[nodiscard]] std::shared_ptr<Upload> findUpload(const std::string& uploadId) const;
+
+        void migratorLoop();
+        void migrationPass();
+        bool migrate(const std::string& key, const ObjectInfo& info, uint32_t targetTier);
+        void copyExtent(const Extent& from, const std::filesystem::path& to);
+        [[nodiscard]] uint32_t pickDir(uint32_t tier) const;
+        [[nodiscard]] uint32_t tierOf(const ObjectInfo& info) const { return info.extents.empty() ? 0 : dir_tier_[info.extents[0].dir]; }
+
+        [[nodiscard]] std::filesystem::path extentPath(const Extent& extent) const { return dirs_.at(extent.dir) / extent.path; }
+        [[nodiscard]] std::filesystem::path metaPath(const std::string& key) const { return dirs_[0] / "meta" / key; }
+        [[nodiscard]] std::filesystem::path newTmpPath(uint32_t dir, const std::string& name) const;
+        // `path` with a fresh version suffix in place of any it had.
+        [[nodiscard]] static std::string newVersion(const std::string& path);
+
+        std::vector<std::filesystem::path> dirs_;
+        std::vector<uint32_t> dir_tier_;                   // tier of each directory
+        std::vector<std::vector<uint32_t>> tier_dirs_;     // directories of each tier
+        std::vector<std::string> tier_names_;
+
+        mutable std::shared_mutex index_mutex_;
+        std::unordered_map<std::string, IndexEntry> index_;
+
+        mutable ReadaheadBudget readahead_budget_{kDefaultReadaheadBudget};
+
+        // Leases held by readers, per payload path, and the leased files already dropped from the index.
+        mutable std::mutex leases_mutex_;
+        mutable std::unordered_map<std::string, size_t> leased_;
+        mutable std::unordered_set<std::string> doomed_;
+        // Set while another process serves the same directories: files to unlink are collected in kept_ instead.
+        mutable bool keep_removed_ = false;
+        mutable std::vector<std::filesystem::path> kept_;
+
+        // Keys changed since writeCheckpoint(), for the process that took over.
+        std::atomic<bool> track_changes_{false};
+        std::mutex changes_mutex_;
+        std::condition_variable changes_cv_;
+        std::vector<std::string> changes_;
+
+        mutable std::mutex uploads_mutex_;
+        std::unordered_map<std::string, std::shared_ptr<Upload>> uploads_;
 
+        MigrationPolicy policy_;
+        std::thread migrator_;
+        std::mutex migrator_mutex_;
+        std::condition_variable migrator_cv_;
+        bool migrator_stop_ = false;
+        // Migration throttle: bytes copied since the window started.
+        std::chrono::steady_clock::time_point throttle_start_;
+        uint64_t throttle_bytes_ = 0;
     };
 
-}
\ No newline at end of file
+}
@@ -0,0 +1,86 @@
+//Copyright (c) 2026 Kaizhi Liu
+//Licensed under the Apache License, Version 2.0.
+
+#include "../include/ConnectionTable.hpp"
+#include <stdexcept>
+
+namespace ref_storage::core {
+
+    namespace {
+        constexpr uint64_t kTagStep = uint64_t{1} << 32;
+
+        uint64_t makeId(uint32_t index, uint32_t generation) {
+            return (static_cast<uint64_t>(generation) << 32) | index;
+        }
+    }
+
+    ConnectionTable::ConnectionTable(size_t capacity)
+        : capacity_(capacity), slots_(new Slot[capacity]), free_head_(kNoSlot) {
+        if (capacity == 0 || capacity >= kNoSlot) throw std::invalid_argument("Connection table capacity out of range");
+        // Chain the slots in index order, so a lightly loaded node keeps reusing the first few.
+        for (size_t i = capacity; i > 0; --i) push(static_cast<uint32_t>(i - 1));
+    }
+
+    ConnectionTable::~ConnectionTable() = default;
+
+    void ConnectionTable::push(uint32_t index) noexcept {
+        uint64_t head = free_head_.load(std::memory_order_relaxed);
+        uint64_t desired;
+        do {
+            slots_[index].next_free.store(static_cast<uint32_t>(head), std::memory_order_relaxed);
+            desired = ((head & ~uint64_t{UINT32_MAX}) + kTagStep) | index;
+        } while (!free_head_.compare_exchange_weak(head, desired, std::memory_order_release, std::memory_order_relaxed));
+    }
+
+    Connection* ConnectionTable::open() {
+        uint64_t head = free_head_.load(std::memory_order_acquire);
+        uint32_t index;
+        do {
+            index = static_cast<uint32_t>(head);
+            if (index == kNoSlot) return nullptr;
+            // May read a slot another thread has just popped; the tag makes the exchange below fail in that case.
+            uint32_t next = slots_[index].next_free.load(std::memory_order_relaxed);
+            uint64_t desired = ((head & ~uint64_t{UINT32_MAX}) + kTagStep) | next;
+            if (free_head_.compare_exchange_weak(head, desired, std::memory_order_acquire, std::memory_order_acquire)) break;
+        } while (true);
+
+        in_use_.fetch_add(1, std::memory_order_relaxed);
+        Slot& slot = slots_[index];
+        slot.conn.gate.open();
+        slot.conn.id = makeId(index, slot.generation.load(std::memory_order_relaxed));
+        slot.conn.opened = std::chrono::steady_clock::now();
+        return &slot.conn;
+    }
+
+    void ConnectionTable::close(Connection& conn) {
+        uint32_t index = static_cast<uint32_t>(conn.id);
+        Slot& slot = slots_[index];
+        // The handler's buffer goes back to the pool and the socket closes before anyone else can take the slot.
+        conn.handler.reset();
+        conn.socket.reset();
+        conn.id = 0;
+
+        uint32_t generation = slot.generation.load(std::memory_order_relaxed) + 1;
+        slot.generation.store(generation == 0 ? 1 : generation, std::memory_order_release);
+        in_use_.fetch_sub(1, std::memory_order_relaxed);
+        push(index);
+    }
+
+    Connection* ConnectionTable::find(uint64_t id) noexcept {
+        uint32_t index = static_cast<uint32_t>(id);
+        if (index >= capacity_) return nullptr;
+        Slot& slot = slots_[index];
+        if (slot.generation.load(std::memory_order_acquire) != static_cast<uint32_t>(id >> 32)) return nullptr;
+        return &slot.conn;
+    }
+
+    void ConnectionTable::drain() {
+        // Free slots are drained as well, which is harmless: open() clears the gate of the slot it hands out.
+        for (size_t i = 0; i < capacity_; ++i) slots_[i].conn.gate.drain();
+    }
+
+    void ConnectionTable::cut() {
+        for (size_t i = 0; i < capacity_; ++i) slots_[i].conn.gate.cut();
+    }
+
+}
@@ -0,0 +1,136 @@
+//Copyright (c) 2026 Kaizhi Liu
+//Licensed under the Apache License, Version 2.0.
+
+#include "../include/DataPlugins.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <format>
+#include <stdexcept>
+#include <utility>
+
+namespace ref_storage::core {
+
+    namespace {
+        // The part of RsDataPlugin that version 1.0 defined; newer minors may only append to it.
+        constexpr size_t kMinDescriptorSize = offsetof(RsDataPlugin, on_body) + sizeof(RsDataPlugin::on_body);
+
+        // What a hook wrote, clamped to the buffer it was given.
+        std::string_view written(const RsOutput& output) {
+            return {output.data, std::min(output.len, output.capacity)};
+        }
+    }
+
+    DataPlugins& DataPlugins::global() {
+        static DataPlugins instance;
+        return instance;
+    }
+
+    std::string DataPlugins::add(RsDataPluginEntryFunc entry) {
+        auto plugin = std::make_unique<Plugin>();
+        if (entry(RS_DATA_PLUGIN_ABI_VERSION, &plugin->desc) != 0) throw std::runtime_error("The plugin refused to load");
+
+        const RsDataPlugin& desc = plugin->desc;
+        if (RS_DATA_PLUGIN_ABI_MAJOR(desc.abi_version) != RS_DATA_PLUGIN_ABI_MAJOR(RS_DATA_PLUGIN_ABI_VERSION)) {
+            throw std::runtime_error(std::format("Plugin ABI {}.{} does not match the node's {}.{}",
+                                                 desc.abi_version >> 16, desc.abi_version & 0xFFFF,
+                                                 RS_DATA_PLUGIN_ABI_VERSION >> 16, RS_DATA_PLUGIN_ABI_VERSION & 0xFFFF));
+        }
+        if (desc.struct_size < kMinDescriptorSize) throw std::runtime_error("Plugin descriptor is truncated");
+        plugin->name = desc.name ? desc.name : "unnamed";
+        for (const char* const* op = desc.opcodes; op && *op; ++op) plugin->opcodes.emplace_back(*op);
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        size_t count = count_.load(std::memory_order_relaxed);
+        if (count == kMaxPlugins) throw std::runtime_error(std::format("At most {} data plugins can be loaded", kMaxPlugins));
+        for (size_t i = 0; i < count; ++i) {
+            for (const auto& op : plugin->opcodes) {
+                const auto& taken = plugins_[i]->opcodes;
+                if (std::find(taken.begin(), taken.end(), op) != taken.end()) {
+                    throw std::runtime_error(std::format("Opcode {} is already handled by plugin {}", op, plugins_[i]->name));
+                }
+            }
+        }
+        if (desc.on_body) body_hooks_.store(true, std::memory_order_release);
+        std::string name = plugin->name;
+        plugins_[count] = std::move(plugin);
+        count_.store(count + 1, std::memory_order_release);
+        return name;
+    }
+
+    DataPlugins::Outcome DataPlugins::runRequest(Plugin& plugin, const RsRequest& request, char* out, size_t capacity) {
+        RsOutput output{out, capacity, 0};
+        RsVerdict verdict = RS_PASS;
+        plugin.desc.on_requests(plugin.desc.context, &request, &output, &verdict, 1);
+        plugin.requests.fetch_add(1, std::memory_order_relaxed);
+        if (verdict == RS_REJECT) {
+            plugin.rejected.fetch_add(1, std::memory_order_relaxed);
+            return {RS_REJECT, written(output)};
+        }
+        if (verdict == RS_REPLY) {
+            plugin.replied.fetch_add(1, std::memory_order_relaxed);
+            return {RS_REPLY, written(output)};
+        }
+        return {};
+    }
+
+    DataPlugins::Outcome DataPlugins::onRequest(uint64_t connection, std::string_view op, std::string_view args,
+                                                char* out, size_t capacity) {
+        size_t count = count_.load(std::memory_order_acquire);
+        RsRequest request{connection, {op.data(), op.size()}, {args.data(), args.size()}};
+
+        for (size_t i = 0; i < count; ++i) {
+            Plugin& plugin = *plugins_[i];
+            if (std::find(plugin.opcodes.begin(), plugin.opcodes.end(), op) == plugin.opcodes.end()) continue;
+            if (!plugin.desc.on_requests) return {RS_REJECT, "Plugin has no request hook"};
+            Outcome outcome = runRequest(plugin, request, out, capacity);
+            // A custom opcode means nothing to the host, so passing it on is the same as refusing it.
+            if (outcome.verdict == RS_PASS) return {RS_REJECT, "Unhandled opcode"};
+            return outcome;
+        }
+
+        for (size_t i = 0; i < count; ++i) {
+            Plugin& plugin = *plugins_[i];
+            if (!plugin.desc.on_requests) continue;
+            Outcome outcome = runRequest(plugin, request, out, capacity);
+            if (outcome.verdict != RS_PASS) return outcome;
+        }
+        return {};
+    }
+
+    DataPlugins::Outcome DataPlugins::onBody(RsBodyChunk chunk, char* data, size_t len, char* scratch, size_t capacity) {
+        size_t count = count_.load(std::memory_order_acquire);
+        Outcome outcome{RS_PASS, {data, len}};
+        for (size_t i = 0; i < count; ++i) {
+            Plugin& plugin = *plugins_[i];
+            if (!plugin.desc.on_body) continue;
+            chunk.data = {outcome.text.data(), outcome.text.size()};
+            RsOutput output{scratch, capacity, 0};
+            RsVerdict verdict = RS_PASS;
+            plugin.desc.on_body(plugin.desc.context, &chunk, &output, &verdict, 1);
+            plugin.chunks.fetch_add(1, std::memory_order_relaxed);
+            if (verdict == RS_REJECT) {
+                plugin.rejected.fetch_add(1, std::memory_order_relaxed);
+                return {RS_REJECT, written(output)};
+            }
+            if (verdict == RS_REPLACE) {
+                plugin.replaced.fetch_add(1, std::memory_order_relaxed);
+                outcome = {RS_REPLACE, written(output)};
+                // The buffer the chunk was read from becomes the next plugin's output.
+                scratch = const_cast<char*>(chunk.data.data);
+            }
+        }
+        return outcome;
+    }
+
+    std::vector<DataPlugins::Stats> DataPlugins::stats() const {
+        std::vector<Stats> out;
+        size_t count = count_.load(std::memory_order_acquire);
+        for (size_t i = 0; i < count; ++i) {
+            const Plugin& plugin = *plugins_[i];
+            out.push_back({plugin.name, plugin.opcodes, plugin.requests.load(), plugin.rejected.load(),
+                           plugin.replied.load(), plugin.chunks.load(), plugin.replaced.load()});
+        }
+        return out;
+    }
+
+}
@@ -0,0 +1,320 @@
+//Copyright (c) 2026 Kaizhi Liu
+//Licensed under the Apache License, Version 2.0.
+
+#include "../include/NodeConfig.hpp"
+#include <algorithm>
+#include <cmath>
+#include <format>
+#include <fstream>
+#include <functional>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+#include <utility>
+#include "utils/include/Json.hpp"
+
+namespace ref_storage::core {
+
+    namespace {
+        using utils::Json;
+
+        template <typename E>
+        using Names = std::vector<std::pair<std::string_view, E>>;
+
+        const Names<utils::LogLevel> kLevels = {{"debug", utils::LogLevel::Debug}, {"info", utils::LogLevel::Info},
+                                                {"warn", utils::LogLevel::Warn}, {"error", utils::LogLevel::Error},
+                                                {"fatal", utils::LogLevel::Fatal}};
+        const Names<utils::OverflowPolicy> kOverflow = {{"block", utils::OverflowPolicy::Block},
+                                                        {"drop", utils::OverflowPolicy::Drop},
+                                                        {"drop_debug_first", utils::OverflowPolicy::DropDebugFirst}};
+        const Names<utils::LogOutput> kOutputs = {{"text", utils::LogOutput::Text}, {"binary", utils::LogOutput::Binary}};
+        const Names<utils::ConsoleOutput> kConsole = {{"off", utils::ConsoleOutput::Off},
+                                                      {"buffered", utils::ConsoleOutput::Buffered},
+                                                      {"flushed", utils::ConsoleOutput::Flushed}};
+        const Names<utils::Affinity> kAffinity = {{"none", utils::Affinity::None}, {"node", utils::Affinity::Node},
+                                                  {"core", utils::Affinity::Core}};
+
+        constexpr uint64_t kMiB = 1024 * 1024;
+
+        [[noreturn]] void invalid(const std::string& key, std::string_view what) {
+            throw std::runtime_error(std::format("{}: {}", key, what));
+        }
+
+        // Visit the members of the object at `key`; a member without a reader is an unknown setting.
+        using Readers = std::vector<std::pair<std::string_view, std::function<void(const Json&, const std::string&)>>>;
+        void readObject(const Json& json, const std::string& key, const Readers& readers) {
+            if (!json.isObject()) invalid(key.empty() ? "config" : key, "expected an object");
+            for (const auto& [name, value] : json.asObject()) {
+                std::string member = key.empty() ? name : key + "." + name;
+                auto reader = std::find_if(readers.begin(), readers.end(), [&](const auto& r) { return r.first == name; });
+                if (reader == readers.end()) invalid(member, "unknown setting");
+                reader->second(value, member);
+            }
+        }
+
+        double number(const Json& json, const std::string& key, double min, double max) {
+            if (json.type() != Json::Type::Number) invalid(key, "expected a number");
+            double value = json.asNumber();
+            if (value < min || value > max) invalid(key, std::format("{} is outside [{}, {}]", value, min, max));
+            return value;
+        }
+
+        template <typename T>
+        T integer(const Json& json, const std::string& key, T min = 0, T max = std::numeric_limits<T>::max()) {
+            double value = number(json, key, static_cast<double>(min), static_cast<double>(max));
+            if (std::trunc(value) != value) invalid(key, "expected an integer");
+            // A 64-bit maximum rounds up to 2^64 as a double, which the range check lets through; casting it is UB.
+            if (value >= std::ldexp(1.0, std::numeric_limits<T>::digits)) invalid(key, std::format("{} is too large", value));
+            return static_cast<T>(value);
+        }
+
+        bool flag(const Json& json, const std::string& key) {
+            if (json.type() != Json::Type::Bool) invalid(key, "expected true or false");
+            return json.asBool();
+        }
+
+        const std::string& text(const Json& json, const std::string& key) {
+            if (json.type() != Json::Type::String) invalid(key, "expected a string");
+            return json.asString();
+        }
+
+        template <typename E>
+        E choice(const Json& json, const std::string& key, const Names<E>& names) {
+            const std::string& value = text(json, key);
+            for (const auto& [name, e] : names) {
+                if (name == value) return e;
+            }
+            std::string allowed;
+            for (const auto& entry : names) allowed += std::format("{}{}", allowed.empty() ? "" : ", ", entry.first);
+            invalid(key, std::format("\"{}\" is not one of {}", value, allowed));
+        }
+
+        template <typename E>
+        std::string_view nameOf(E value, const Names<E>& names) {
+            for (const auto& [name, e] : names) {
+                if (e == value) return name;
+            }
+            return "?";
+        }
+
+        std::vector<StorageEngine::Tier> readTiers(const Json& json, const std::string& key) {
+            if (json.type() != Json::Type::Array || json.asArray().empty()) invalid(key, "expected a non-empty array of tiers");
+            std::vector<StorageEngine::Tier> tiers;
+            for (size_t i = 0; i < json.asArray().size(); ++i) {
+                StorageEngine::Tier tier;
+                readObject(json.asArray()[i], std::format("{}[{}]", key, i), {
+                    {"name", [&](const Json& v, const std::string& k) { tier.name = text(v, k); }},
+                    {"dirs", [&](const Json& v, const std::string& k) {
+                        if (v.type() != Json::Type::Array || v.asArray().empty()) invalid(k, "expected a non-empty array of directories");
+                        for (const auto& dir : v.asArray()) {
+                            if (text(dir, k).empty()) invalid(k, "empty directory");
+                            tier.dirs.emplace_back(dir.asString());
+                        }
+                    }},
+                });
+                if (tier.name.empty() || tier.dirs.empty()) invalid(std::format("{}[{}]", key, i), "a tier needs a name and dirs");
+                tiers.push_back(std::move(tier));
+            }
+            return tiers;
+        }
+
+        // How a setting is shown in a change report, in the units the file uses.
+        std::string show(const std::string& value) { return value.empty() ? "\"\"" : value; }
+        std::string show(bool value) { return value ? "true" : "false"; }
+        std::string show(double value) { return std::format("{}", value); }
+        template <typename T> requires std::is_integral_v<T>
+        std::string show(T value) { return std::to_string(value); }
+        template <typename Rep, typename Period>
+        std::string show(std::chrono::duration<Rep, Period> value) { return std::to_string(value.count()); }
+
+        std::string show(const std::vector<StorageEngine::Tier>& tiers) {
+            std::string out;
+            for (const auto& tier : tiers) {
+                out += std::format("{}{}(", out.empty() ? "" : " ", tier.name);
+                for (size_t i = 0; i < tier.dirs.size(); ++i) out += (i ? "," : "") + tier.dirs[i].string();
+                out += ")";
+            }
+            return out;
+        }
+
+        class Diff {
+        public:
+            template <typename T>
+            void add(std::string_view key, const T& before, const T& after) {
+                std::string was = show(before), now = show(after);
+                if (was != now) changes_.push_back(std::format("{}: {} -> {}", key, was, now));
+            }
+
+            template <typename E>
+            void add(std::string_view key, E before, E after, const Names<E>& names) {
+                if (before != after) changes_.push_back(std::format("{}: {} -> {}", key, nameOf(before, names), nameOf(after, names)));
+            }
+
+            std::vector<std::string> take() { return std::move(changes_); }
+
+        private:
+            std::vector<std::string> changes_;
+        };
+
+        double millis(std::chrono::microseconds value) { return static_cast<double>(value.count()) / 1000.0; }
+    }
+
+    NodeConfig NodeConfig::parse(std::string_view source, const NodeConfig& base) {
+        Json document = Json::parse(source);
+        NodeConfig c = base;
+        auto port = [](const Json& v, const std::string& k) { return integer<int>(v, k, 1, 65535); };
+
+        readObject(document, "", {
+            {"node_id", [&](const Json& v, const std::string& k) { c.node_id = text(v, k); }},
+            {"master_url", [&](const Json& v, const std::string& k) { c.master_url = text(v, k); }},
+            {"address", [&](const Json& v, const std::string& k) { c.address = text(v, k); }},
+            {"port", [&](const Json& v, const std::string& k) { c.port = port(v, k); }},
+            {"metrics_port", [&](const Json& v, const std::string& k) { c.metrics_port = integer<int>(v, k, 0, 65535); }},
+            {"admin", [&](const Json& v, const std::string& k) {
+                readObject(v, k, {
+                    {"address", [&](const Json& v, const std::string& k) { c.admin_address = text(v, k); }},
+                    {"port", [&](const Json& v, const std::string& k) { c.admin_port = port(v, k); }},
+                });
+            }},
+            {"storage", [&](const Json& v, const std::string& k) {
+                readObject(v, k, {
+                    {"tiers", [&](const Json& v, const std::string& k) { c.tiers = readTiers(v, k); }},
+                    {"readahead_budget_mb", [&](const Json& v, const std::string& k) {
+                        c.readahead_budget = integer<uint64_t>(v, k, 0, 1ull << 20) * kMiB;
+                    }},
+                    {"migration", [&](const Json& v, const std::string& k) {
+                        auto& m = c.migration;
+                        readObject(v, k, {
+                            {"scan_interval_s", [&](const Json& v, const std::string& k) {
+                                m.scan_interval = std::chrono::seconds(integer<int64_t>(v, k, 1, 86400));
+                            }},
+                            {"cold_after_s", [&](const Json& v, const std::string& k) {
+                                m.cold_after = std::chrono::seconds(integer<int64_t>(v, k, 0, 365ll * 86400));
+                            }},
+                            {"min_free_ratio", [&](const Json& v, const std::string& k) { m.min_free_ratio = number(v, k, 0, 1); }},
+                            {"promote_heat", [&](const Json& v, const std::string& k) { m.promote_heat = integer<uint32_t>(v, k, 1); }},
+                            {"max_mb_per_sec", [&](const Json& v, const std::string& k) {
+                                m.max_bytes_per_sec = integer<uint64_t>(v, k, 1, 1ull << 20) * kMiB;
+                            }},
+                        });
+                    }},
+                });
+            }},
+            {"threads", [&](const Json& v, const std::string& k) {
+                readObject(v, k, {
+                    {"clients", [&](const Json& v, const std::string& k) { c.client_threads = integer<size_t>(v, k, 0, 4096); }},
+                    {"min", [&](const Json& v, const std::string& k) { c.min_threads = integer<size_t>(v, k, 0, 4096); }},
+                    {"max", [&](const Json& v, const std::string& k) { c.max_threads = integer<size_t>(v, k, 0, 4096); }},
+                    {"grow_after_ms", [&](const Json& v, const std::string& k) {
+                        c.grow_after = std::chrono::milliseconds(integer<int64_t>(v, k, 1, 60000));
+                    }},
+                    {"idle_timeout_ms", [&](const Json& v, const std::string& k) {
+                        c.idle_timeout = std::chrono::milliseconds(integer<int64_t>(v, k, 1, 86400000));
+                    }},
+                    {"client_weight", [&](const Json& v, const std::string& k) { c.client_weight = integer<uint32_t>(v, k, 1, 1000); }},
+                    {"client_queue_limit", [&](const Json& v, const std::string& k) { c.client_queue_limit = integer<size_t>(v, k, 1); }},
+                    {"affinity", [&](const Json& v, const std::string& k) { c.worker_affinity = choice(v, k, kAffinity); }},
+                    {"listener_node", [&](const Json& v, const std::string& k) { c.listener_node = integer<int>(v, k, -1, 1023); }},
+                });
+                if (c.min_threads && c.max_threads && c.min_threads > c.max_threads) invalid(k, "min is above max");
+            }},
+            {"io", [&](const Json& v, const std::string& k) {
+                readObject(v, k, {
+                    {"async", [&](const Json& v, const std::string& k) { c.async_io = flag(v, k); }},
+                    {"loops", [&](const Json& v, const std::string& k) { c.io_loops = integer<size_t>(v, k, 1, 256); }},
+                    {"max_connections", [&](const Json& v, const std::string& k) { c.max_connections = integer<size_t>(v, k, 1, 1u << 20); }},
+                });
+            }},
+            {"log", [&](const Json& v, const std::string& k) {
+                readObject(v, k, {
+                    {"level", [&](const Json& v, const std::string& k) { c.log.min_level = choice(v, k, kLevels); }},
+                    {"overflow", [&](const Json& v, const std::string& k) { c.log.overflow = choice(v, k, kOverflow); }},
+                    {"output", [&](const Json& v, const std::string& k) { c.log.output = choice(v, k, kOutputs); }},
+                    {"console", [&](const Json& v, const std::string& k) { c.log.console = choice(v, k, kConsole); }},
+                    {"ring_capacity", [&](const Json& v, const std::string& k) { c.log.capacity = integer<size_t>(v, k, 16, 1u << 20); }},
+                    {"max_file_mb", [&](const Json& v, const std::string& k) { c.log.max_file_size = integer<size_t>(v, k, 1, 1u << 20) * kMiB; }},
+                    {"compress_rotated", [&](const Json& v, const std::string& k) { c.log.compress_rotated = flag(v, k); }},
+                });
+            }},
+            {"trace", [&](const Json& v, const std::string& k) {
+                readObject(v, k, {
+                    {"slow_threshold_ms", [&](const Json& v, const std::string& k) {
+                        c.trace.slow_threshold = std::chrono::microseconds(std::llround(number(v, k, 0, 3600e3) * 1000));
+                    }},
+                    {"sample_every", [&](const Json& v, const std::string& k) { c.trace.sample_every = integer<uint32_t>(v, k); }},
+                    {"ring_capacity", [&](const Json& v, const std::string& k) { c.trace.ring_capacity = integer<size_t>(v, k, 0, 1u << 20); }},
+                });
+            }},
+            {"hot_restart", [&](const Json& v, const std::string& k) {
+                readObject(v, k, {
+                    {"path", [&](const Json& v, const std::string& k) { c.hot_restart_path = text(v, k); }},
+                    {"drain_timeout_s", [&](const Json& v, const std::string& k) {
+                        c.drain_timeout = std::chrono::seconds(integer<int64_t>(v, k, 0, 86400));
+                    }},
+                });
+            }},
+        });
+        return c;
+    }
+
+    NodeConfig NodeConfig::load(const std::filesystem::path& path, const NodeConfig& base) {
+        std::ifstream in(path, std::ios::binary);
+        if (!in) throw std::runtime_error(std::format("Cannot open config file {}", path.string()));
+        std::stringstream text;
+        text << in.rdbuf();
+        try {
+            return parse(text.str(), base);
+        } catch (const std::exception& e) {
+            throw std::runtime_error(std::format("{}: {}", path.string(), e.what()));
+        }
+    }
+
+    std::vector<std::string> NodeConfig::liveChanges(const NodeConfig& current) const {
+        Diff diff;
+        diff.add("threads.min", current.min_threads, min_threads);
+        diff.add("threads.max", current.max_threads, max_threads);
+        diff.add("storage.readahead_budget_mb", current.readahead_budget / kMiB, readahead_budget / kMiB);
+        diff.add("storage.migration.scan_interval_s", current.migration.scan_interval, migration.scan_interval);
+        diff.add("storage.migration.cold_after_s", current.migration.cold_after, migration.cold_after);
+        diff.add("storage.migration.min_free_ratio", current.migration.min_free_ratio, migration.min_free_ratio);
+        diff.add("storage.migration.promote_heat", current.migration.promote_heat, migration.promote_heat);
+        diff.add("storage.migration.max_mb_per_sec", current.migration.max_bytes_per_sec / kMiB, migration.max_bytes_per_sec / kMiB);
+        diff.add("log.level", current.log.min_level, log.min_level, kLevels);
+        diff.add("log.overflow", current.log.overflow, log.overflow, kOverflow);
+        diff.add("trace.slow_threshold_ms", millis(current.trace.slow_threshold), millis(trace.slow_threshold));
+        diff.add("trace.sample_every", current.trace.sample_every, trace.sample_every);
+        diff.add("trace.ring_capacity", current.trace.ring_capacity, trace.ring_capacity);
+        return diff.take();
+    }
+
+    std::vector<std::string> NodeConfig::restartChanges(const NodeConfig& current) const {
+        Diff diff;
+        diff.add("node_id", current.node_id, node_id);
+        diff.add("master_url", current.master_url, master_url);
+        diff.add("address", current.address, address);
+        diff.add("port", current.port, port);
+        diff.add("metrics_port", current.metrics_port, metrics_port);
+        diff.add("admin.address", current.admin_address, admin_address);
+        diff.add("admin.port", current.admin_port, admin_port);
+        diff.add("storage.tiers", current.tiers, tiers);
+        diff.add("threads.clients", current.client_threads, client_threads);
+        diff.add("threads.grow_after_ms", current.grow_after, grow_after);
+        diff.add("threads.idle_timeout_ms", current.idle_timeout, idle_timeout);
+        diff.add("threads.client_weight", current.client_weight, client_weight);
+        diff.add("threads.client_queue_limit", current.client_queue_limit, client_queue_limit);
+        diff.add("threads.affinity", current.worker_affinity, worker_affinity, kAffinity);
+        diff.add("threads.listener_node", current.listener_node, listener_node);
+        diff.add("io.async", current.async_io, async_io);
+        diff.add("io.loops", current.io_loops, io_loops);
+        diff.add("io.max_connections", current.max_connections, max_connections);
+        diff.add("log.output", current.log.output, log.output, kOutputs);
+        diff.add("log.console", current.log.console, log.console, kConsole);
+        diff.add("log.ring_capacity", current.log.capacity, log.capacity);
+        diff.add("log.max_file_mb", current.log.max_file_size / kMiB, log.max_file_size / kMiB);
+        diff.add("log.compress_rotated", current.log.compress_rotated, log.compress_rotated);
+        diff.add("hot_restart.path", current.hot_restart_path, hot_restart_path);
+        diff.add("hot_restart.drain_timeout_s", current.drain_timeout, drain_timeout);
+        return diff.take();
+    }
+
+}
@@ -0,0 +1,72 @@
+//Copyright (c) 2026 Liu Kaizhi
+//Licensed under the Apache License, Version 2.0.
+
+
+#include "../include/Readahead.hpp"
+#include <algorithm>
+#include <utility>
+
+namespace ref_storage::core {
+
+    uint64_t ReadaheadBudget::grant(uint64_t wanted) noexcept {
+        uint64_t used = in_use_.load(std::memory_order_relaxed);
+        while (true) {
+            uint64_t cap = limit_.load(std::memory_order_relaxed);
+            uint64_t granted = used >= cap ? 0 : std::min(wanted, cap - used);
+            if (granted == 0) return 0;
+            if (in_use_.compare_exchange_weak(used, used + granted, std::memory_order_relaxed)) return granted;
+        }
+    }
+
+    Readahead::Readahead(Readahead&& other) noexcept
+        : budget_(other.budget_), next_offset_(other.next_offset_), prefetched_end_(other.prefetched_end_),
+          window_(std::exchange(other.window_, 0)), sequential_hits_(other.sequential_hits_) { }
+
+    Readahead& Readahead::operator=(Readahead&& other) noexcept {
+        if (this != &other) {
+            reset();
+            budget_ = other.budget_;
+            next_offset_ = other.next_offset_;
+            prefetched_end_ = other.prefetched_end_;
+            window_ = std::exchange(other.window_, 0);
+            sequential_hits_ = other.sequential_hits_;
+        }
+        return *this;
+    }
+
+    void Readahead::reset() noexcept {
+        if (budget_ && window_ > 0) budget_->release(window_);
+        window_ = 0;
+        prefetched_end_ = 0;
+        sequential_hits_ = 0;
+        next_offset_ = 0;
+    }
+
+    std::optional<Readahead::Prefetch> Readahead::onRead(uint64_t offset, uint64_t length, uint64_t streamSize) noexcept {
+        uint64_t end = offset + length;
+        if (offset != next_offset_) {
+            // Random access: whatever was prefetched is unlikely to be used.
+            reset();
+            next_offset_ = end;
+            return std::nullopt;
+        }
+        next_offset_ = end;
+
+        if (++sequential_hits_ >= 2 && window_ < kMaxWindow) {
+            uint64_t desired = window_ == 0 ? kMinWindow : std::min(window_ * 2, kMaxWindow);
+            window_ += budget_ ? budget_->grant(desired - window_) : desired - window_;
+        }
+        if (window_ == 0) return std::nullopt;
+
+        prefetched_end_ = std::max(prefetched_end_, end);
+        if (prefetched_end_ - end >= window_ / 2) return std::nullopt;
+
+        uint64_t target = std::min(end + window_, streamSize);
+        if (target <= prefetched_end_) return std::nullopt;
+
+        Prefetch prefetch{prefetched_end_, target - prefetched_end_};
+        prefetched_end_ = target;
+        return prefetch;
+    }
+
+}
@@ -3,8 +3,490 @@
 
 
 #include "../include/RequestHandler.hpp"
+#include "utils/include/AsyncLogger.hpp"
+#include "utils/include/Metrics.hpp"
+#include "utils/include/Trace.hpp"
+#include <array>
+#include <charconv>
+#include <stdexcept>
 
 namespace ref_storage::core {
 
+    namespace {
 
-}
\ No newline at end of file
+        // Split "<OP> <rest>" at the first space.
+        void splitCommand(std::string_view input, std::string_view& op, std::string_view& args) {
+            size_t space_pos = input.find(' ');
+            if (space_pos != std::string_view::npos) {
+                op = input.substr(0, space_pos);
+                args = input.substr(space_pos + 1);
+            } else {
+                op = input;
+                args = {};
+            }
+        }
+
+        bool parseU64(std::string_view text, uint64_t& value) {
+            auto [ptr, ec] = std::from_chars(text.data(), text.data() + text.size(), value);
+            return ec == std::errc() && ptr == text.data() + text.size();
+        }
+
+        // kPlugin: answered or refused by a data-path plugin, including the plugins' own opcodes.
+        enum Op { kPut, kGet, kGetRange, kDel, kMpuCreate, kMpuPart, kMpuComplete, kMpuAbort, kEcho, kPlugin, kOpCount };
+        constexpr const char* kOpNames[kOpCount] = {
+            "PUT", "GET", "GETRANGE", "DEL", "MPU_CREATE", "MPU_PART", "MPU_COMPLETE", "MPU_ABORT", "ECHO", "PLUGIN"
+        };
+
+        // Request latency runs from the header frame to the last byte of the reply; storage latency covers one engine call.
+        struct HandlerMetrics {
+            std::array<utils::Histogram*, kOpCount> request{};
+            utils::Histogram& storage_open = storage("open");
+            utils::Histogram& storage_write = storage("write");
+            utils::Histogram& storage_commit = storage("commit");
+            utils::Histogram& storage_read = storage("read");
+            utils::Histogram& storage_delete = storage("delete");
+
+            HandlerMetrics() {
+                for (size_t op = 0; op < kOpCount; ++op) {
+                    request[op] = &utils::MetricsRegistry::global().histogram(
+                        "refstorage_request_duration_seconds", "Data-plane request latency by opcode.",
+                        std::format("op=\"{}\"", kOpNames[op]));
+                }
+            }
+
+            static utils::Histogram& storage(const char* op) {
+                return utils::MetricsRegistry::global().histogram(
+                    "refstorage_storage_io_duration_seconds", "Latency of storage engine calls by operation.",
+                    std::format("op=\"{}\"", op));
+            }
+        };
+
+        HandlerMetrics& metrics() {
+            static HandlerMetrics instance;
+            return instance;
+        }
+
+        // Wrap an engine call for offload(): the wait for a pool thread and the hop back to the loop count as queueing.
+        template <typename F>
+        auto timedStorage(utils::TraceSpan& trace, utils::Histogram& histogram, F fn) {
+            trace.enter(utils::TraceStage::Queue);
+            return [&trace, &histogram, fn = std::move(fn)]() mutable {
+                struct LeaveStorage {
+                    utils::TraceSpan& trace;
+                    ~LeaveStorage() { trace.enter(utils::TraceStage::Queue); }
+                } leave{trace};
+                trace.enter(utils::TraceStage::Storage);
+                utils::ScopedTimer timer(histogram);
+                return fn();
+            };
+        }
+
+    }
+
+    void SessionGate::open() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        fd_ = net::SocketHandle::kInvalid;
+        waiting_ = false;
+        draining_ = false;
+    }
+
+    bool SessionGate::idle(net::SocketHandle::NativeSocketType fd) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        fd_ = fd;
+        if (draining_) return false;
+        waiting_ = true;
+        return true;
+    }
+
+    bool SessionGate::busy() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        waiting_ = false;
+        return !draining_;
+    }
+
+    void SessionGate::close() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        fd_ = net::SocketHandle::kInvalid;
+        waiting_ = false;
+    }
+
+    void SessionGate::drain() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        draining_ = true;
+        if (fd_ == net::SocketHandle::kInvalid || !waiting_) return;
+        // Only the reading side: the next receive sees end-of-stream, and nothing the client sent is answered half-way.
+#ifdef _WIN32
+        shutdown(fd_, SD_RECEIVE);
+#else
+        shutdown(fd_, SHUT_RD);
+#endif
+        waiting_ = false;
+    }
+
+    void SessionGate::cut() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        draining_ = true;
+        if (fd_ == net::SocketHandle::kInvalid) return;
+#ifdef _WIN32
+        shutdown(fd_, SD_BOTH);
+#else
+        shutdown(fd_, SHUT_RDWR);
+#endif
+    }
+
+    RequestHandler::RequestHandler(StorageEngine& engine, utils::BufferPool& buffers, uint64_t connection_id)
+        : engine_(engine), buffers_(buffers), connection_id_(connection_id), buffer_(buffers.acquire(kStreamChunkSize)),
+          arena_(buffers, kArenaChunkSize), range_readahead_(&engine.readaheadBudget()) {
+        if (buffer_.size() < kStreamChunkSize) throw std::invalid_argument("Buffer pool blocks are smaller than a stream chunk");
+    }
+
+    utils::Task<void> RequestHandler::reply(net::AsyncSocket& sock, std::string_view msg) {
+        trace_.enter(utils::TraceStage::Send);
+        co_await sock.send(msg.data(), msg.size());
+    }
+
+    utils::Task<void> RequestHandler::serve(net::AsyncSocket& sock, SessionGate* gate) {
+        // However the session ends, the gate lets go of the descriptor before it is closed.
+        struct LeaveGate {
+            SessionGate* gate;
+            ~LeaveGate() { if (gate) gate->close(); }
+        } leave{gate};
+        const auto fd = sock.socket().handle().native_handle();
+
+        while (true) {
+            if (gate && !gate->idle(fd)) {
+                LOG_INFO("Business client released: the node is draining.");
+                co_return;
+            }
+            // Header frames are small; anything bigger than one chunk is a protocol violation.
+            size_t len = co_await sock.recvFrame(buffer_.data(), kStreamChunkSize);
+            if (gate && !gate->busy()) {
+                LOG_INFO("Business client released: the node is draining.");
+                co_return;
+            }
+            if (len == 0) {
+                LOG_INFO("Business client disconnected normally.");
+                co_return;
+            }
+
+            auto started = std::chrono::steady_clock::now();
+            trace_.begin();
+            // The body of the request reuses buffer_, so the header is kept in the arena.
+            std::string_view input = arena_.copy({buffer_.data(), len});
+            std::string_view op, args;
+            splitCommand(input, op, args);
+            request_op_ = op;
+            request_args_ = args;
+
+            DataPlugins::Outcome intercepted;
+            auto& plugins = DataPlugins::global();
+            if (!plugins.empty()) {
+                char* out = static_cast<char*>(arena_.allocate(DataPlugins::kReplyCapacity, 1));
+                intercepted = plugins.onRequest(connection_id_, op, args, out, DataPlugins::kReplyCapacity);
+            }
+
+            Op kind = kEcho;
+            if (intercepted.verdict != RS_PASS) {
+                kind = kPlugin;
+                co_await handlePluginVerdict(sock, op, args, intercepted.verdict, intercepted.text);
+            }
+            else if (op == "PUT") { kind = kPut; co_await handlePut(sock, args); }
+            else if (op == "GET") { kind = kGet; co_await handleGet(sock, args); }
+            else if (op == "GETRANGE") { kind = kGetRange; co_await handleGetRange(sock, args); }
+            else if (op == "DEL") { kind = kDel; co_await handleDel(sock, args); }
+            else if (op == "MPU_CREATE") { kind = kMpuCreate; co_await handleMultipartCreate(sock, args); }
+            else if (op == "MPU_PART") { kind = kMpuPart; co_await handleMultipartPart(sock, args); }
+            else if (op == "MPU_COMPLETE") { kind = kMpuComplete; co_await handleMultipartComplete(sock, args); }
+            else if (op == "MPU_ABORT") { kind = kMpuAbort; co_await handleMultipartAbort(sock, args); }
+            else {
+                LOG_INFO("[收到消息]: {}", input);
+                co_await reply(sock, arena_.format("服务端已收到: [{}]", input));
+            }
+            metrics().request[kind]->record(std::chrono::steady_clock::now() - started);
+            utils::RequestTracer::global().finish(trace_, kOpNames[kind],
+                                                  kind == kEcho ? std::string_view() : args.substr(0, args.find(' ')));
+            arena_.reset();
+        }
+    }
+
+    utils::Task<void> RequestHandler::receiveBody(net::AsyncSocket& sock, uint64_t total, std::optional<ObjectWriter>& writer, std::string& error) {
+        // The body is always consumed, even when the upload was refused, to keep the framing in sync.
+        uint64_t received = 0;
+        while (received < total) {
+            trace_.enter(utils::TraceStage::Recv);
+            size_t len = co_await sock.recvFrame(buffer_.data(), kStreamChunkSize);
+            if (len == 0) throw std::runtime_error("Connection closed during request body");
+            if (len > total - received) throw std::runtime_error("Request body exceeds declared size");
+            received += len;
+            trace_.addBytes(len);
+            if (!writer) continue;
+
+            std::string_view chunk(buffer_.data(), len);
+            auto& plugins = DataPlugins::global();
+            if (plugins.hasBodyHooks()) {
+                if (!plugin_scratch_) plugin_scratch_ = buffers_.acquire(kStreamChunkSize);
+                RsBodyChunk info{connection_id_, {request_op_.data(), request_op_.size()},
+                                 {request_args_.data(), request_args_.size()}, received - len, total, {}};
+                DataPlugins::Outcome outcome = plugins.onBody(info, buffer_.data(), len, plugin_scratch_.data(), kStreamChunkSize);
+                if (outcome.verdict == RS_REJECT) {
+                    error = outcome.text.empty() ? std::string("Rejected by plugin") : std::string(outcome.text);
+                    writer.reset();
+                    continue;
+                }
+                chunk = outcome.text;
+            }
+            try {
+                co_await net::offload(sock.loop(), timedStorage(trace_, metrics().storage_write, [&]() {
+                    writer->write(chunk.data(), chunk.size());
+                }));
+            } catch (const std::exception& e) {
+                error = e.what();
+                writer.reset();
+            }
+        }
+    }
+
+    utils::Task<void> RequestHandler::handlePluginVerdict(net::AsyncSocket& sock, std::string_view op, std::string_view args,
+                                                          RsVerdict verdict, std::string_view text) {
+        if (op == "PUT" || op == "MPU_PART") {
+            // The declared size is the last argument of both.
+            uint64_t total = 0;
+            if (!parseU64(args.substr(args.rfind(' ') + 1), total)) {
+                co_await reply(sock, "ERR malformed upload header");
+                throw std::runtime_error("Malformed upload header");
+            }
+            std::optional<ObjectWriter> none;
+            std::string ignored;
+            co_await receiveBody(sock, total, none, ignored);
+        }
+        if (verdict == RS_REPLY) co_await reply(sock, text);
+        else co_await reply(sock, arena_.format("ERR {}", text.empty() ? std::string_view("Rejected by plugin") : text));
+    }
+
+    utils::Task<void> RequestHandler::handlePut(net::AsyncSocket& sock, std::string_view args) {
+        std::string_view key, size_text;
+        splitCommand(args, key, size_text);
+        uint64_t total = 0;
+        if (!parseU64(size_text, total)) {
+            // The payload length is unknown, so the stream cannot be resynchronised.
+            co_await reply(sock, "ERR usage: PUT <key> <size>");
+            throw std::runtime_error("Malformed PUT header");
+        }
+
+        std::optional<ObjectWriter> writer;
+        std::string error;
+        try {
+            writer.emplace(co_await net::offload(sock.loop(), timedStorage(trace_, metrics().storage_open, [&]() {
+                return engine_.createWriter(std::string(key));
+            })));
+        } catch (const std::exception& e) {
+            error = e.what();
+        }
+
+        co_await receiveBody(sock, total, writer, error);
+        if (!writer) {
+            LOG_ERROR("PUT '{}' failed: {}", key, error);
+            co_await reply(sock, arena_.format("ERR {}", error));
+            co_return;
+        }
+
+        std::string_view result;
+        try {
+            ObjectInfo info = co_await net::offload(sock.loop(), timedStorage(trace_, metrics().storage_commit, [&]() {
+                return writer->commit();
+            }));
+            LOG_DEBUG("PUT '{}' committed: {} bytes, crc32 {}", key, info.size, info.crc32);
+            result = arena_.format("OK {} {}", info.size, info.crc32);
+        } catch (const std::exception& e) {
+            LOG_ERROR("PUT '{}' commit failed: {}", key, e.what());
+            result = arena_.format("ERR {}", e.what());
+        }
+        co_await reply(sock, result);
+    }
+
+    utils::Task<void> RequestHandler::handleGet(net::AsyncSocket& sock, std::string_view key) {
+        std::optional<ObjectReader> reader;
+        std::string error;
+        try {
+            reader.emplace(co_await net::offload(sock.loop(), timedStorage(trace_, metrics().storage_open, [&]() {
+                return engine_.openReader(std::string(key));
+            })));
+        } catch (const std::exception& e) {
+            error = e.what();
+        }
+        if (!reader) {
+            co_await reply(sock, arena_.format("ERR {}", error));
+            co_return;
+        }
+
+        const ObjectInfo& info = reader->info();
+        co_await reply(sock, arena_.format("OK {} {}", info.size, info.crc32));
+
+        while (reader->remaining() > 0) {
+            size_t len = co_await net::offload(sock.loop(), timedStorage(trace_, metrics().storage_read, [&]() {
+                return reader->read(buffer_.data(), kStreamChunkSize);
+            }));
+            trace_.enter(utils::TraceStage::Send);
+            trace_.addBytes(len);
+            co_await sock.send(buffer_.data(), len);
+        }
+        // The header has already gone out, so corruption can only be reported by dropping the connection.
+        if (!reader->verified()) {
+            LOG_ERROR("GET '{}': checksum mismatch, object is corrupt.", key);
+            throw std::runtime_error("Checksum mismatch while streaming object");
+        }
+    }
+
+    utils::Task<void> RequestHandler::handleGetRange(net::AsyncSocket& sock, std::string_view args) {
+        std::string_view key, rest, offset_text, length_text;
+        splitCommand(args, key, rest);
+        splitCommand(rest, offset_text, length_text);
+        uint64_t offset = 0, length = 0;
+        if (!parseU64(offset_text, offset) || !parseU64(length_text, length)) {
+            co_await reply(sock, "ERR usage: GETRANGE <key> <offset> <length>");
+            co_return;
+        }
+
+        std::optional<RangeReader> range;
+        std::string error;
+        try {
+            range.emplace(co_await net::offload(sock.loop(), timedStorage(trace_, metrics().storage_open, [&]() {
+                return engine_.openRange(std::string(key), offset, length);
+            })));
+        } catch (const std::exception& e) {
+            error = e.what();
+        }
+        if (!range) {
+            co_await reply(sock, arena_.format("ERR {}", error));
+            co_return;
+        }
+
+        if (key != readahead_key_) {
+            range_readahead_.reset();
+            readahead_key_ = key;
+        }
+        range->setReadahead(&range_readahead_);
+
+        co_await reply(sock, arena_.format("OK {} {}", length, range->info().size));
+        // A verification failure after the header can only be reported by dropping the connection.
+        while (auto segment = co_await net::offload(sock.loop(), timedStorage(trace_, metrics().storage_read, [&]() {
+                   return range->next(kStreamChunkSize);
+               }))) {
+            trace_.enter(utils::TraceStage::Send);
+            trace_.addBytes(segment->length);
+            co_await sock.sendFileFrame(segment->path.string(), segment->offset, static_cast<size_t>(segment->length));
+        }
+    }
+
+    utils::Task<void> RequestHandler::handleDel(net::AsyncSocket& sock, std::string_view key) {
+        bool removed = co_await net::offload(sock.loop(), timedStorage(trace_, metrics().storage_delete, [&]() {
+            return engine_.remove(std::string(key));
+        }));
+        if (removed) co_await reply(sock, "OK");
+        else co_await reply(sock, arena_.format("ERR No such object: {}", key));
+    }
+
+    utils::Task<void> RequestHandler::handleMultipartCreate(net::AsyncSocket& sock, std::string_view key) {
+        std::string_view result;
+        try {
+            std::string upload_id = co_await net::offload(sock.loop(), timedStorage(trace_, metrics().storage_open, [&]() {
+                return engine_.createUpload(std::string(key));
+            }));
+            result = arena_.format("OK {}", upload_id);
+        } catch (const std::exception& e) {
+            result = arena_.format("ERR {}", e.what());
+        }
+        co_await reply(sock, result);
+    }
+
+    utils::Task<void> RequestHandler::handleMultipartPart(net::AsyncSocket& sock, std::string_view args) {
+        std::string_view upload_id, rest, part_text, size_text;
+        splitCommand(args, upload_id, rest);
+        splitCommand(rest, part_text, size_text);
+        uint64_t part = 0, total = 0;
+        if (!parseU64(size_text, total)) {
+            co_await reply(sock, "ERR usage: MPU_PART <upload_id> <part> <size>");
+            throw std::runtime_error("Malformed MPU_PART header");
+        }
+
+        std::optional<ObjectWriter> writer;
+        std::string error = "Invalid part number: " + std::string(part_text);
+        if (parseU64(part_text, part) && part <= UINT32_MAX) {
+            try {
+                writer.emplace(co_await net::offload(sock.loop(), timedStorage(trace_, metrics().storage_open, [&]() {
+                    return engine_.createPartWriter(std::string(upload_id), static_cast<uint32_t>(part));
+                })));
+            } catch (const std::exception& e) {
+                error = e.what();
+            }
+        }
+
+        co_await receiveBody(sock, total, writer, error);
+        if (!writer) {
+            co_await reply(sock, arena_.format("ERR {}", error));
+            co_return;
+        }
+
+        std::string_view result;
+        try {
+            ObjectInfo info = co_await net::offload(sock.loop(), timedStorage(trace_, metrics().storage_commit, [&]() {
+                return writer->commit();
+            }));
+            result = arena_.format("OK {} {}", info.size, info.crc32);
+        } catch (const std::exception& e) {
+            result = arena_.format("ERR {}", e.what());
+        }
+        co_await reply(sock, result);
+    }
+
+    utils::Task<void> RequestHandler::handleMultipartComplete(net::AsyncSocket& sock, std::string_view args) {
+        std::string_view upload_id, rest;
+        splitCommand(args, upload_id, rest);
+
+        std::vector<StorageEngine::ManifestEntry> manifest;
+        while (!rest.empty()) {
+            std::string_view token, tail;
+            splitCommand(rest, token, tail);
+            rest = tail;
+            if (token.empty()) continue;
+
+            StorageEngine::ManifestEntry entry;
+            uint64_t value = 0;
+            size_t colon = token.find(':');
+            if (!parseU64(token.substr(0, colon), value) || value > UINT32_MAX) {
+                co_await reply(sock, arena_.format("ERR Invalid manifest entry: {}", token));
+                co_return;
+            }
+            entry.part = static_cast<uint32_t>(value);
+            if (colon != std::string_view::npos) {
+                if (!parseU64(token.substr(colon + 1), value) || value > UINT32_MAX) {
+                    co_await reply(sock, arena_.format("ERR Invalid manifest entry: {}", token));
+                    co_return;
+                }
+                entry.crc32 = static_cast<uint32_t>(value);
+            }
+            manifest.push_back(entry);
+        }
+
+        std::string_view result;
+        try {
+            ObjectInfo info = co_await net::offload(sock.loop(), timedStorage(trace_, metrics().storage_commit, [&]() {
+                return engine_.completeUpload(std::string(upload_id), manifest);
+            }));
+            result = arena_.format("OK {} {}", info.size, info.crc32);
+        } catch (const std::exception& e) {
+            LOG_ERROR("MPU_COMPLETE {} failed: {}", upload_id, e.what());
+            result = arena_.format("ERR {}", e.what());
+        }
+        co_await reply(sock, result);
+    }
+
+    utils::Task<void> RequestHandler::handleMultipartAbort(net::AsyncSocket& sock, std::string_view upload_id) {
+        bool aborted = co_await net::offload(sock.loop(), timedStorage(trace_, metrics().storage_delete, [&]() {
+            return engine_.abortUpload(std::string(upload_id));
+        }));
+        if (aborted) co_await reply(sock, "OK");
+        else co_await reply(sock, arena_.format("ERR No such upload: {}", upload_id));
+    }
+
+}
@@ -2,8 +2,19 @@
 //Licensed under the Apache License, Version 2.0.
 
 #include "../include/Server.hpp"
+#include "../include/RequestHandler.hpp"
+#include "../include/DataPlugins.hpp"
 #include "utils/include/AsyncLogger.hpp"
+#include "utils/include/Profiler.hpp"
+#include "net/include/HttpContext.hpp"
+#include "net/include/HttpResponse.hpp"
+#include "net/include/UnixSocket.hpp"
 #include <chrono>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
 #include <iostream>
 
 // 跨平台动态库加载头文件
@@ -17,6 +28,59 @@
 
 namespace ref_storage::core {
 
+    namespace {
+
+        // Accept loops wake up this often to notice that they should stop: a listener shared with another process
+        // cannot be closed under them.
+        constexpr int kAcceptPollMs = 200;
+
+        // How long a retiring node waits for the sessions it cut off to notice and end.
+        constexpr std::chrono::seconds kCutGrace{5};
+
+        // Stops the running profile, writes the collapsed stacks to `file` (by default next to the log) and summarises
+        // them for the console.
+        std::string finishProfile(utils::Profiler& profiler, const std::string& file) {
+            utils::ProfileReport report = profiler.stop();
+            std::string path = file.empty() ? std::format("profile-{}.folded", std::chrono::duration_cast<std::chrono::seconds>(
+                                                  std::chrono::system_clock::now().time_since_epoch()).count()) : file;
+            std::ofstream out(path, std::ios::binary | std::ios::trunc);
+            out << report.folded;
+            if (!out) return std::format("Profile stopped, but {} could not be written.", path);
+            LOG_INFO("[Admin] Profile written to {} ({} samples).", path, report.samples);
+
+            std::string reply = std::format("Profile: {} samples at {} Hz over {} ms on {} threads ({} dropped), written to {}\n",
+                                            report.samples, report.hz, report.duration.count(), report.threads,
+                                            report.dropped, path);
+            for (const auto& [function, samples] : report.top) {
+                reply += std::format("{:>6} {}\n", samples, function);
+            }
+            return reply;
+        }
+
+        // Counts a running accept loop, so that a retiring node knows when its listeners are no longer in use.
+        class AcceptLoop {
+        public:
+            explicit AcceptLoop(std::atomic<int>& count) : count_(count) { count_.fetch_add(1); }
+            ~AcceptLoop() { count_.fetch_sub(1); }
+            AcceptLoop(const AcceptLoop&) = delete;
+            AcceptLoop& operator=(const AcceptLoop&) = delete;
+        private:
+            std::atomic<int>& count_;
+        };
+
+        // Keeps the open-connections gauge right however a session ends.
+        class ActiveConnection {
+        public:
+            explicit ActiveConnection(utils::Gauge* gauge) : gauge_(gauge) { if (gauge_) gauge_->add(); }
+            ~ActiveConnection() { if (gauge_) gauge_->sub(); }
+            ActiveConnection(const ActiveConnection&) = delete;
+            ActiveConnection& operator=(const ActiveConnection&) = delete;
+        private:
+            utils::Gauge* gauge_;
+        };
+
+    }
+
     std::once_flag Server::init_flag;
 
     // ==========================================
@@ -43,7 +107,7 @@ namespace ref_storage::core {
     }
 
     Server::Server() : thread_pool_(nullptr), is_running_(false), admin_running_(false),
-                       port_(12344), address_("::1"),
+                       port_(12344), address_("::1"), storage_tiers_{{"hot", {"data"}}},
                        num_threads_(std::thread::hardware_concurrency()){ }
 
     Server::~Server() { stop(); }
@@ -57,38 +121,119 @@ namespace ref_storage::core {
 
     void Server::doInit(int port, const std::string &config_path) {
         port_ = port;
+        default_config_ = currentConfig();
+        if (!config_path.empty()) {
+            config_path_ = config_path;
+            if (std::filesystem::exists(config_path_)) {
+                applyConfig(NodeConfig::load(config_path_, default_config_));
+                LOG_SYNC_INFO("Loaded {}: node '{}', master {}.", config_path, node_id_, master_url_);
+            } else {
+                LOG_SYNC_WARN("Config file {} not found, using built-in defaults.", config_path);
+            }
+        }
+
+        // After the config, which says where the running node listens for a successor.
+        if (takeover_requested_) connectToPredecessor();
+        if (!takeover_checkpoint_.empty()) {
+            storage_engine_ = std::make_unique<StorageEngine>(storage_tiers_, takeover_checkpoint_);
+        } else {
+            storage_engine_ = std::make_unique<StorageEngine>(storage_tiers_);
+        }
+        storage_engine_->readaheadBudget().setLimit(readahead_budget_);
     }
 
     void Server::start(size_t thread_const) {
         if (admin_running_) return;
+        if (client_threads_) thread_const = client_threads_;
 
         if (!thread_pool_) {
-            thread_pool_ = std::make_unique<utils::ThreadPool>(thread_const);
+            // The pool starts with a thread per client plus the reserved lanes, then follows the load within its bounds.
+            utils::ThreadPool::ElasticOptions pool_options;
+            pool_options.initial_threads = thread_const + reservedThreads();
+            pool_options.max_threads = pool_max_threads_ ? pool_max_threads_ : 4 * thread_const + reservedThreads();
+            pool_options.max_threads = std::max(pool_options.max_threads, reservedThreads() + 1);
+            pool_options.min_threads = pool_min_threads_ ? pool_min_threads_ : reservedThreads() + 1;
+            pool_options.grow_after = pool_grow_after_;
+            pool_options.idle_timeout = pool_idle_timeout_;
+
+            // Client and background share a priority and split spare threads 8:1; admin always goes first.
+            std::vector<utils::LaneOptions> lanes = {
+                {"client", 1, pool_options.max_threads - reservedThreads(), client_queue_limit_, client_lane_weight_},
+                admin_lane_options_,
+                background_lane_options_,
+            };
+            buffer_pool_ = std::make_unique<utils::BufferPool>(RequestHandler::kStreamChunkSize);
+            connections_ = std::make_unique<ConnectionTable>(max_connections_);
+            thread_pool_ = std::make_unique<utils::ThreadPool>(pool_options, worker_affinity_);
+            scheduler_ = std::make_unique<utils::Scheduler>(*thread_pool_, std::move(lanes));
+            client_lane_ = scheduler_->lane("client");
+            admin_lane_ = scheduler_->lane("admin");
             num_threads_ = thread_const;
         }
 
         admin_running_ = true;
 
-        utils::AsyncLogger::getInstance().init("server.log", utils::LogLevel::Debug);
-        thread_pool_->enqueue([]() { utils::AsyncLogger::getInstance().consumeLogs(); });
+        // The log consumer never returns while the logger runs, so it gets its own thread rather than a pool slot.
+        utils::AsyncLogger::getInstance().init(log_options_.output == utils::LogOutput::Binary ? "server.log.bin" : "server.log", log_options_);
+        log_thread_ = std::thread([]() { utils::AsyncLogger::getInstance().consumeLogs(); });
 
         registerCommands();
+        registerMetrics();
+        utils::RequestTracer::global().configure(trace_options_);
+        storage_engine_->startMigrator(migration_policy_);
+        LOG_INFO("Topology: {}. Worker affinity: {}.", utils::Topology::system().describe(),
+                 utils::affinityName(worker_affinity_));
 
         // 1. 启动运维监听
         std::thread([this]() {
+            pinListenerThread();
             try {
-                admin_listen_socket_ = net::Socket();
-                admin_listen_socket_.setReuseAddress(true);
-                admin_listen_socket_.bindAndListen(12345, "::1");
-                LOG_INFO("[Admin] Admin interface listening on [::1]:12345");
+                if (inherited_admin_) {
+                    admin_listen_socket_ = std::move(*inherited_admin_);
+                    inherited_admin_.reset();
+                } else {
+                    admin_listen_socket_ = net::Socket();
+                    admin_listen_socket_.setReuseAddress(true);
+                    admin_listen_socket_.bindAndListen(admin_port_, admin_address_.c_str());
+                }
+                admin_listen_socket_.setNonBlocking(true);
+                LOG_INFO("[Admin] Admin interface listening on [{}]:{}", admin_address_, admin_port_);
                 acceptAdminConnections();
             } catch (const std::exception& e) {
                 LOG_ERROR("[Admin] Failed to start admin interface: {}", e.what());
             }
         }).detach();
 
+        if (metrics_port_ != 0 || inherited_metrics_) {
+            std::thread([this]() {
+                pinListenerThread();
+                try {
+                    if (inherited_metrics_) {
+                        metrics_listen_socket_ = std::move(*inherited_metrics_);
+                        inherited_metrics_.reset();
+                    } else {
+                        metrics_listen_socket_ = net::Socket();
+                        metrics_listen_socket_.setReuseAddress(true);
+                        metrics_listen_socket_.bindAndListen(metrics_port_, address_.c_str());
+                    }
+                    metrics_listen_socket_.setNonBlocking(true);
+                    LOG_INFO("[Admin] Metrics endpoint listening on {}:{}/metrics", address_, metrics_port_);
+                    acceptMetricsConnections();
+                } catch (const std::exception& e) {
+                    LOG_ERROR("[Admin] Failed to start metrics endpoint: {}", e.what());
+                }
+            }).detach();
+        }
+
         // 2. 随主进程启动业务层
         startBusiness();
+
+        // 3. 热重启: 告知旧进程已接管, 否则等待下一次热重启
+        if (predecessor_.handle().is_valid_handle()) {
+            std::thread([this]() { followPredecessor(); }).detach();
+        } else {
+            listenForHandover();
+        }
     }
 
     // ==========================================
@@ -97,13 +242,29 @@ namespace ref_storage::core {
     void Server::startBusiness() {
         if (is_running_) return;
         try {
-            listen_socket_ = net::Socket();
-            listen_socket_.setReuseAddress(true);
+            if (inherited_business_) {
+                listen_socket_ = std::move(*inherited_business_);
+                inherited_business_.reset();
+            } else {
+                listen_socket_ = net::Socket();
+                listen_socket_.setReuseAddress(true);
+                listen_socket_.bindAndListen(port_, address_.c_str());
+            }
 
-            listen_socket_.bindAndListen(port_, address_.c_str());
+            if (async_io_) {
+                // Event-loop mode: the loops own the listener; storage calls run on the client lane's threads.
+                tcp_server_ = std::make_unique<net::TcpServer>(io_loops_, thread_pool_.get(),
+                    [this](net::AsyncSocket& sock) { return serveAsyncClient(sock); });
+                tcp_server_->start(std::move(listen_socket_));
+                is_running_ = true;
+                LOG_SYNC_INFO("Business Server STARTED on port {} ({} event loops)...", port_, io_loops_);
+                return;
+            }
+            listen_socket_.setNonBlocking(true);
             is_running_ = true;
 
             std::thread([this]() {
+                pinListenerThread();
                 this->acceptBusinessConnections();
             }).detach();
 
@@ -113,26 +274,40 @@ namespace ref_storage::core {
         }
     }
 
+    void Server::pinListenerThread() const {
+        const auto& topology = utils::Topology::system();
+        if (listener_node_ < 0 || static_cast<size_t>(listener_node_) >= topology.nodeCount()) return;
+        if (!utils::Topology::pinCurrentThread(topology.cpusOfNode(listener_node_))) {
+            LOG_WARN("Could not pin listener thread to NUMA node {}.", listener_node_);
+        }
+    }
+
     void Server::stopBusiness() {
         if (!is_running_) return;
         LOG_INFO("Pausing business server. Disconnecting all clients...");
 
         is_running_ = false;
 
+        if (tcp_server_) {
+            tcp_server_->stop();
+            tcp_server_.reset();
+        }
         net::Socket empty_socket;
         listen_socket_ = std::move(empty_socket);
-
-        std::lock_guard<std::mutex> lock(mutex_);
-        client_sockets_.clear();
+        // Idle clients are disconnected now, busy ones as soon as their request has been answered.
+        connections_->drain();
 
         LOG_INFO("Business server PAUSED. Waiting for 'start' command...");
     }
 
     void Server::acceptBusinessConnections() {
+        AcceptLoop running(accepting_);
         while (is_running_) {
             try {
-                net::Socket client = listen_socket_.acceptClient();
-                this->add_client_socket(std::move(client));
+                std::optional<net::Socket> client = listen_socket_.tryAcceptClient(kAcceptPollMs);
+                if (!client) continue;
+                accepted_metric_->add();
+                this->add_client_socket(std::move(*client));
             } catch (...) {
                 if (!is_running_) break;
                 LOG_ERROR("Business accept error.");
@@ -149,10 +324,24 @@ namespace ref_storage::core {
         stopBusiness();
 
         admin_running_ = false;
+        if (storage_engine_) storage_engine_->stopMigrator();
+        {
+            // A timed profile still running is left as it is; only its timer goes.
+            std::lock_guard<std::mutex> lock(profile_mutex_);
+            ++profile_run_;
+            profile_cv_.notify_all();
+        }
+        if (profile_timer_.joinable()) profile_timer_.join();
         net::Socket empty_admin;
         admin_listen_socket_ = std::move(empty_admin);
+        net::Socket empty_metrics;
+        metrics_listen_socket_ = std::move(empty_metrics);
+        net::Socket empty_handover;
+        handover_listen_socket_ = std::move(empty_handover);
 
         LOG_INFO("Node completely shut down.");
+        utils::AsyncLogger::getInstance().stop();
+        if (log_thread_.joinable()) log_thread_.join();
     }
 
     // ==========================================
@@ -170,39 +359,349 @@ namespace ref_storage::core {
     net::Socket* Server::get_socket() { return &(listen_socket_); }
 
     void Server::add_client_socket(net::Socket client_socket) {
-        mutex_.lock();
-        client_sockets_.push_back(std::move(client_socket));
-        size_t index = client_sockets_.size() - 1;
-        mutex_.unlock();
-        thread_pool_->enqueue([this, index]() {
-            std::lock_guard<std::mutex> lock(mutex_);
-            this->serverChatWorker(client_sockets_.at(index));
-        });
+        Connection* conn = connections_->open();
+        if (!conn) {
+            rejected_metric_->add();
+            LOG_WARN("Connection table is full ({} connections), connection dropped.", connections_->capacity());
+            return;
+        }
+        conn->socket.emplace(std::move(client_socket));
+        // Accepted just as the node paused: drain() may have passed this slot before open() cleared its gate.
+        if (!is_running_) {
+            connections_->close(*conn);
+            return;
+        }
+        uint64_t id = conn->id;
+        bool queued = scheduler_->trySubmit(client_lane_, [this, id]() { this->serverChatWorker(id); });
+        if (!queued) {
+            LOG_WARN("Client lane is full, connection dropped.");
+            connections_->close(*conn);
+        }
     }
 
     void Server::add_chat_worker(net::Socket &socket) { }
 
-    void Server::serverChatWorker(net::Socket& Socket) {
-        auto shared_sock = std::make_shared<net::Socket>(std::move(Socket));
-        thread_pool_->enqueue([shared_sock]() {
-            LOG_INFO("New business client connected.");
+    void Server::serverChatWorker(uint64_t connection_id) {
+        Connection* conn = connections_->find(connection_id);
+        if (!conn) return;
+        LOG_INFO("New business client connected.");
+        {
+            ActiveConnection active(active_metric_);
             try {
-                while (true) {
-                    std::vector<char> buffer = shared_sock->recvData(0);
-                    if (buffer.empty()) {
-                        LOG_INFO("Business client disconnected normally.");
-                        break;
+                RequestHandler& handler = conn->handler.emplace(*storage_engine_, *buffer_pool_, conn->id);
+                utils::syncWait(handler.serve(*conn->socket, &conn->gate));
+            } catch (const std::exception& e) {
+                LOG_ERROR("[异常退出]: {}", e.what());
+            }
+        }
+        connections_->close(*conn);
+    }
+
+    utils::Task<void> Server::serveAsyncClient(net::AsyncSocket& sock) {
+        accepted_metric_->add();
+        Connection* conn = connections_->open();
+        if (!conn) {
+            rejected_metric_->add();
+            LOG_WARN("Connection table is full ({} connections), connection dropped.", connections_->capacity());
+            co_return;
+        }
+        LOG_INFO("New business client connected.");
+        ActiveConnection active(active_metric_);
+        try {
+            RequestHandler& handler = conn->handler.emplace(*storage_engine_, *buffer_pool_, conn->id);
+            co_await handler.serve(sock, &conn->gate);
+        } catch (...) {
+            connections_->close(*conn);
+            throw;
+        }
+        connections_->close(*conn);
+    }
+
+    // ==========================================
+    // 热重启
+    // ==========================================
+    bool Server::connectToPredecessor() {
+        if (hot_restart_path_.empty()) {
+            LOG_SYNC_WARN("Hot restart: hot_restart.path is not configured, starting cold.");
+            return false;
+        }
+        try {
+            net::Socket channel = net::connectUnix(hot_restart_path_);
+            net::sendFds(channel, "TAKEOVER", {});
+            std::vector<int> fds;
+            std::string reply = net::recvFds(channel, fds);
+            std::vector<net::Socket> passed;
+            for (int fd : fds) passed.emplace_back(net::SocketHandle(fd));
+
+            // "HANDOVER <business> <admin> <metrics> <checkpoint>": 1 for each listener attached, in that order.
+            std::istringstream words(reply);
+            std::string verb, checkpoint;
+            int offered[3] = {0, 0, 0};
+            if (!(words >> verb >> offered[0] >> offered[1] >> offered[2]) || verb != "HANDOVER") {
+                throw std::runtime_error("unexpected reply: " + reply);
+            }
+            std::getline(words >> std::ws, checkpoint);
+            std::optional<net::Socket>* listeners[3] = {&inherited_business_, &inherited_admin_, &inherited_metrics_};
+            size_t next = 0;
+            for (int i = 0; i < 3; ++i) {
+                if (!offered[i]) continue;
+                if (next == passed.size()) throw std::runtime_error("a listener is missing from the hand-over");
+                listeners[i]->emplace(std::move(passed[next++]));
+            }
+            takeover_checkpoint_ = checkpoint;
+            predecessor_ = std::move(channel);
+            LOG_SYNC_INFO("Hot restart: took {} listener(s) and the index over from the running node.", next);
+            return true;
+        } catch (const std::exception& e) {
+            inherited_business_.reset();
+            inherited_admin_.reset();
+            inherited_metrics_.reset();
+            takeover_checkpoint_.clear();
+            LOG_SYNC_WARN("Hot restart: nothing to take over on {} ({}), starting cold.", hot_restart_path_, e.what());
+            return false;
+        }
+    }
+
+    void Server::listenForHandover() {
+        if (hot_restart_path_.empty()) return;
+        std::thread([this]() {
+            try {
+                handover_listen_socket_ = net::listenUnix(hot_restart_path_);
+                handover_listen_socket_.setNonBlocking(true);
+                LOG_INFO("[HotRestart] A successor can take over on {}", hot_restart_path_);
+            } catch (const std::exception& e) {
+                LOG_WARN("[HotRestart] Hot restart unavailable: {}", e.what());
+                return;
+            }
+            while (admin_running_ && !retiring_) {
+                try {
+                    std::optional<net::Socket> channel = handover_listen_socket_.tryAcceptClient(kAcceptPollMs);
+                    if (!channel) continue;
+                    // The hand-over gives away the listeners and retires this node: only our own user may ask.
+                    if (!net::peerIsSameUser(*channel)) {
+                        LOG_WARN("[HotRestart] Refused a hand-over request from another user.");
+                        continue;
                     }
-                    std::string receivedMsg(buffer.data(), buffer.size());
-                    LOG_INFO("[收到消息]: {}", receivedMsg);
+                    std::vector<int> fds;
+                    std::string request = net::recvFds(*channel, fds);
+                    // Requests carry no descriptors; close any that came along.
+                    for (int fd : fds) net::SocketHandle(fd).close_handle();
+                    if (request != "TAKEOVER") {
+                        LOG_WARN("[HotRestart] Ignoring unexpected request: {}", request);
+                        continue;
+                    }
+                    handOver(*channel);
+                    retire(*channel);
+                    return;
+                } catch (const std::exception& e) {
+                    if (!admin_running_) break;
+                    LOG_ERROR("[HotRestart] Hand-over called off: {}", e.what());
+                }
+            }
+        }).detach();
+    }
+
+    void Server::handOver(net::Socket& channel) {
+        LOG_INFO("[HotRestart] A successor is taking over.");
+        {
+            // From the checkpoint on, the successor runs the migrator; two would move the same files. A reload must
+            // not start it again, so it is refused from here on.
+            std::lock_guard<std::mutex> lock(config_mutex_);
+            handing_over_ = true;
+            storage_engine_->stopMigrator();
+        }
+        std::filesystem::path checkpoint;
+        try {
+            checkpoint = storage_engine_->writeCheckpoint();
+            std::vector<int> fds;
+            auto offer = [&fds](const net::Socket& listener) {
+                if (!listener.handle().is_valid_handle()) return 0;
+                fds.push_back(listener.handle().native_handle());
+                return 1;
+            };
+            // The listener members exist from the start; only those that were bound are handed over.
+            int business = is_running_ ? offer(tcp_server_ ? tcp_server_->listener() : listen_socket_) : 0;
+            int admin = offer(admin_listen_socket_);
+            int metrics = metrics_port_ != 0 ? offer(metrics_listen_socket_) : 0;
+            net::sendFds(channel, std::format("HANDOVER {} {} {} {}", business, admin, metrics,
+                                              std::filesystem::absolute(checkpoint).string()), fds);
+
+            std::vector<int> none;
+            std::string reply = net::recvFds(channel, none);
+            if (reply != "READY") throw std::runtime_error(reply.empty() ? "the successor went away" : "unexpected reply: " + reply);
+        } catch (...) {
+            storage_engine_->stopTrackingChanges();
+            std::error_code ec;
+            if (!checkpoint.empty()) std::filesystem::remove(checkpoint, ec);
+            std::lock_guard<std::mutex> lock(config_mutex_);
+            storage_engine_->startMigrator(migration_policy_);
+            handing_over_ = false;
+            throw;
+        }
+    }
+
+    void Server::retire(net::Socket& channel) {
+        LOG_INFO("[HotRestart] The successor is serving. Draining...");
+        retiring_ = true;
+        is_running_ = false;
+        if (tcp_server_) tcp_server_->releaseListener();
+        while (accepting_.load() > 0) std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        // The successor listens on the same sockets: only this process's descriptors go.
+        listen_socket_.closeShared();
+        admin_listen_socket_.closeShared();
+        metrics_listen_socket_.closeShared();
+        handover_listen_socket_.closeShared();
 
-                    std::string replyMsg = "服务端已收到: [" + receivedMsg + "]";
-                    shared_sock->sendData(replyMsg.c_str(), replyMsg.size());
+        // Idle connections close now and their clients reconnect to the successor; busy ones finish their request.
+        connections_->drain();
+        auto forwardChanges = [&](std::chrono::milliseconds wait) {
+            std::string message;
+            for (const auto& key : storage_engine_->takeChanges(wait)) {
+                message += (message.empty() ? "CHANGED " : " ") + key;
+                if (message.size() >= 64 * 1024) {
+                    net::sendFds(channel, message, {});
+                    message.clear();
                 }
-            } catch (const std::exception& e) {
-                LOG_ERROR("[异常退出]: {}", e.what());
             }
-        });
+            if (!message.empty()) net::sendFds(channel, message, {});
+        };
+        auto deadline = std::chrono::steady_clock::now() + drain_timeout_;
+        try {
+            while (connections_->size() > 0 && std::chrono::steady_clock::now() < deadline) {
+                forwardChanges(std::chrono::milliseconds(50));
+            }
+            size_t abandoned = connections_->size();
+            if (abandoned > 0) {
+                LOG_WARN("[HotRestart] {} connection(s) still busy after {} s; cutting them off.", abandoned, drain_timeout_.count());
+                connections_->cut();
+                // A cut session may still finish a write before it notices; its key must reach the successor.
+                auto grace = std::chrono::steady_clock::now() + kCutGrace;
+                while (connections_->size() > 0 && std::chrono::steady_clock::now() < grace) {
+                    forwardChanges(std::chrono::milliseconds(50));
+                }
+                if (connections_->size() > 0) {
+                    LOG_ERROR("[HotRestart] {} session(s) still running after being cut off.", connections_->size());
+                }
+            }
+            forwardChanges(std::chrono::milliseconds(0));
+            // Files this node dropped since the checkpoint are still here: the successor unlinks them once we are gone.
+            std::string removals;
+            for (const auto& path : storage_engine_->takeRemovals()) {
+                removals += (removals.empty() ? "REMOVED\n" : "\n") + path.string();
+                if (removals.size() >= 64 * 1024) {
+                    net::sendFds(channel, removals, {});
+                    removals.clear();
+                }
+            }
+            if (!removals.empty()) net::sendFds(channel, removals, {});
+            net::sendFds(channel, std::format("DRAINED {}", abandoned), {});
+        } catch (const std::exception& e) {
+            LOG_ERROR("[HotRestart] Lost the successor while draining: {}", e.what());
+        }
+
+        LOG_INFO("[HotRestart] Hand-over complete. Exiting.");
+        if (tcp_server_) {
+            tcp_server_->stop();
+            tcp_server_.reset();
+        }
+        stop();
+    }
+
+    void Server::followPredecessor() {
+        std::vector<std::filesystem::path> removals;
+        try {
+            net::sendFds(predecessor_, "READY", {});
+            LOG_INFO("[HotRestart] Serving. The previous node is draining.");
+            bool drained = false;
+            while (true) {
+                std::vector<int> none;
+                std::string message = net::recvFds(predecessor_, none);
+                if (message.empty()) {
+                    // The channel closes when the previous process exits.
+                    if (!drained) LOG_WARN("[HotRestart] The previous node went away before it had drained.");
+                    break;
+                }
+                std::istringstream words(message);
+                std::string verb;
+                words >> verb;
+                if (verb == "REMOVED") {
+                    // Payload files the previous node dropped; paths may contain spaces, so one per line.
+                    std::string path;
+                    std::getline(words, path);
+                    while (std::getline(words, path)) {
+                        if (!path.empty()) removals.emplace_back(path);
+                    }
+                } else if (verb == "CHANGED") {
+                    // Writes the previous node finished after the checkpoint.
+                    std::vector<std::string> keys;
+                    for (std::string key; words >> key;) keys.push_back(std::move(key));
+                    storage_engine_->refresh(keys);
+                } else if (verb == "DRAINED") {
+                    size_t abandoned = 0;
+                    words >> abandoned;
+                    LOG_INFO("[HotRestart] The previous node has drained ({} connection(s) cut off).", abandoned);
+                    drained = true;
+                }
+            }
+        } catch (const std::exception& e) {
+            LOG_ERROR("[HotRestart] Lost the previous node: {}", e.what());
+        }
+        // Nobody else reads the superseded versions any more.
+        storage_engine_->resumeRemovals(removals);
+        predecessor_ = net::Socket(net::SocketHandle());
+        listenForHandover();
+    }
+
+    // ==========================================
+    // 运行指标
+    // ==========================================
+    void Server::registerMetrics() {
+        auto& registry = utils::MetricsRegistry::global();
+        accepted_metric_ = &registry.counter("refstorage_connections_accepted_total", "Data connections accepted.");
+        active_metric_ = &registry.gauge("refstorage_connections_active", "Data connections being served.");
+        rejected_metric_ = &registry.counter("refstorage_connections_rejected_total",
+                                             "Data connections closed on accept because the connection table was full.");
+
+        registry.gaugeFunction("refstorage_pool_threads", "Live worker threads.", "",
+                               [this]() { return static_cast<double>(thread_pool_->size()); });
+        registry.gaugeFunction("refstorage_pool_idle_threads", "Worker threads parked for lack of work.", "",
+                               [this]() { return static_cast<double>(thread_pool_->idleWorkers()); });
+        registry.gaugeFunction("refstorage_pool_pending_tasks", "Tasks queued in the pool and not yet started.", "",
+                               [this]() { return static_cast<double>(thread_pool_->pendingTasks()); });
+        for (const auto& lane : scheduler_->stats()) {
+            std::string labels = std::format("lane=\"{}\"", lane.name);
+            registry.gaugeFunction("refstorage_lane_queued_tasks", "Tasks waiting in a scheduler lane.", labels,
+                                   [this, name = lane.name]() {
+                                       for (const auto& s : scheduler_->stats()) if (s.name == name) return static_cast<double>(s.queued);
+                                       return 0.0;
+                                   });
+            registry.gaugeFunction("refstorage_lane_running_tasks", "Tasks of a scheduler lane running now.", labels,
+                                   [this, name = lane.name]() {
+                                       for (const auto& s : scheduler_->stats()) if (s.name == name) return static_cast<double>(s.running);
+                                       return 0.0;
+                                   });
+        }
+        registry.gaugeFunction("refstorage_log_dropped_records", "Log records dropped because the logger ring was full.", "",
+                               []() { return static_cast<double>(utils::AsyncLogger::getInstance().droppedCount()); });
+    }
+
+    std::string Server::renderStats() const {
+        // Histograms are recorded in nanoseconds and shown in microseconds; empty ones are left out.
+        std::string out;
+        for (const auto& sample : utils::MetricsRegistry::global().collect()) {
+            std::string name = sample.labels.empty() ? sample.name : sample.name + "{" + sample.labels + "}";
+            if (sample.kind != utils::MetricKind::Histogram) {
+                out += std::format("{} {}\n", name, static_cast<int64_t>(sample.value));
+                continue;
+            }
+            const auto& h = sample.histogram;
+            if (h.count == 0) continue;
+            auto us = [](uint64_t ns) { return static_cast<double>(ns) / 1000.0; };
+            out += std::format("{} count={} us(avg/p50/p90/p99/p999/max)={:.1f}/{:.1f}/{:.1f}/{:.1f}/{:.1f}/{:.1f}\n",
+                               name, h.count, us(h.mean()), us(h.percentile(0.50)), us(h.percentile(0.90)),
+                               us(h.percentile(0.99)), us(h.percentile(0.999)), us(h.max));
+        }
+        return out;
     }
 
     // ==========================================
@@ -230,7 +729,61 @@ namespace ref_storage::core {
         command_handlers_["status"] = [this](const std::string& args) {
             std::string state = this->is_running_ ? "RUNNING" : "PAUSED";
             return std::format("Business State: [{}]. Threads: {}, Clients: {}",
-                               state, num_threads_, client_sockets_.size());
+                               state, thread_pool_->size(), connections_->size());
+        };
+
+        command_handlers_["profile"] = [this](const std::string& args) {
+            return this->handleProfileCommand(args);
+        };
+
+        command_handlers_["stats"] = [this](const std::string&) {
+            return this->renderStats();
+        };
+
+        command_handlers_["reload"] = [this](const std::string& args) {
+            return this->reloadConfig(args);
+        };
+
+        command_handlers_["threads"] = [this](const std::string& args) {
+            return this->handleThreadsCommand(args);
+        };
+
+        command_handlers_["traces"] = [this](const std::string& args) {
+            return this->handleTracesCommand(args);
+        };
+
+        command_handlers_["topology"] = [this](const std::string&) {
+            const auto& topology = utils::Topology::system();
+            std::string out = std::format("{}. Worker affinity: {}, listener node: {}.\n", topology.describe(),
+                                          utils::affinityName(worker_affinity_), listener_node_);
+            for (size_t node = 0; node < topology.nodeCount(); ++node) {
+                out += std::format("node{}: {} idle I/O buffers\n", node, buffer_pool_->cached(node));
+            }
+            return out;
+        };
+
+        command_handlers_["lanes"] = [this](const std::string&) {
+            std::string out;
+            for (const auto& lane : this->scheduler_->stats()) {
+                out += std::format("{}: queued={} running={} submitted={} completed={} rejected={} "
+                                   "queue_us(avg/p50/p99/max)={}/{}/{}/{}\n",
+                                   lane.name, lane.queued, lane.running, lane.submitted, lane.completed,
+                                   lane.rejected, lane.queue_avg.count(), lane.queue_p50.count(),
+                                   lane.queue_p99.count(), lane.queue_max.count());
+            }
+            return out;
+        };
+
+        command_handlers_["plugins"] = [this](const std::string&) {
+            std::string out;
+            for (const auto& plugin : DataPlugins::global().stats()) {
+                std::string opcodes;
+                for (const auto& op : plugin.opcodes) opcodes += (opcodes.empty() ? "" : ",") + op;
+                out += std::format("{}: opcodes=[{}] requests={} rejected={} replied={} chunks={} replaced={}\n",
+                                   plugin.name, opcodes, plugin.requests, plugin.rejected, plugin.replied,
+                                   plugin.chunks, plugin.replaced);
+            }
+            return out.empty() ? std::string("No data-path plugins loaded.") : out;
         };
 
         command_handlers_["load"] = [this](const std::string& args) {
@@ -255,6 +808,29 @@ namespace ref_storage::core {
                 return "Failed to load plugin: " + error_msg;
             }
 
+            // Data-path plugins export a single entry point; anything else is taken for a command plugin.
+            RsDataPluginEntryFunc data_entry = nullptr;
+#ifdef _WIN32
+            data_entry = (RsDataPluginEntryFunc)GetProcAddress(hPlugin, RS_DATA_PLUGIN_ENTRY);
+#else
+            data_entry = (RsDataPluginEntryFunc)dlsym(hPlugin, RS_DATA_PLUGIN_ENTRY);
+#endif
+            if (data_entry) {
+                try {
+                    std::string name = DataPlugins::global().add(data_entry);
+                    LOG_INFO("[Admin] Loaded data-path plugin: {} ({})", name, args);
+                    return "Successfully loaded data-path plugin: '" + name + "'";
+                } catch (const std::exception& e) {
+#ifdef _WIN32
+                    FreeLibrary(hPlugin);
+#else
+                    dlclose(hPlugin);
+#endif
+                    LOG_ERROR("[Admin] Data-path plugin {} refused: {}", args, e.what());
+                    return std::string("Failed to load data-path plugin: ") + e.what();
+                }
+            }
+
             typedef const char* (*GetNameFunc)();
             typedef void (*ExecuteFunc)(const char*, char*, int);
             GetNameFunc get_name = nullptr;
@@ -289,21 +865,393 @@ namespace ref_storage::core {
         };
     }
 
+    // ==========================================
+    // 配置加载与热更新
+    // ==========================================
+    NodeConfig Server::currentConfig() const {
+        NodeConfig config;
+        config.node_id = node_id_;
+        config.master_url = master_url_;
+        config.address = address_;
+        config.port = port_;
+        config.admin_address = admin_address_;
+        config.admin_port = admin_port_;
+        config.metrics_port = metrics_port_;
+        config.tiers = storage_tiers_;
+        config.readahead_budget = readahead_budget_;
+        config.migration = migration_policy_;
+        config.client_threads = client_threads_;
+        config.min_threads = pool_min_threads_;
+        config.max_threads = pool_max_threads_;
+        config.grow_after = pool_grow_after_;
+        config.idle_timeout = pool_idle_timeout_;
+        config.client_weight = client_lane_weight_;
+        config.client_queue_limit = client_queue_limit_;
+        config.worker_affinity = worker_affinity_;
+        config.listener_node = listener_node_;
+        config.async_io = async_io_;
+        config.io_loops = io_loops_;
+        config.max_connections = max_connections_;
+        config.log = log_options_;
+        config.trace = trace_options_;
+        config.hot_restart_path = hot_restart_path_;
+        config.drain_timeout = drain_timeout_;
+        return config;
+    }
+
+    void Server::applyConfig(const NodeConfig& config) {
+        node_id_ = config.node_id;
+        master_url_ = config.master_url;
+        address_ = config.address;
+        port_ = config.port;
+        admin_address_ = config.admin_address;
+        admin_port_ = config.admin_port;
+        metrics_port_ = config.metrics_port;
+        storage_tiers_ = config.tiers;
+        readahead_budget_ = config.readahead_budget;
+        migration_policy_ = config.migration;
+        client_threads_ = config.client_threads;
+        pool_min_threads_ = config.min_threads;
+        pool_max_threads_ = config.max_threads;
+        pool_grow_after_ = config.grow_after;
+        pool_idle_timeout_ = config.idle_timeout;
+        client_lane_weight_ = config.client_weight;
+        client_queue_limit_ = config.client_queue_limit;
+        worker_affinity_ = config.worker_affinity;
+        listener_node_ = config.listener_node;
+        async_io_ = config.async_io;
+        io_loops_ = config.io_loops;
+        max_connections_ = config.max_connections;
+        log_options_ = config.log;
+        trace_options_ = config.trace;
+        hot_restart_path_ = config.hot_restart_path;
+        drain_timeout_ = config.drain_timeout;
+    }
+
+    std::string Server::reloadConfig(const std::string& path) {
+        std::lock_guard<std::mutex> lock(config_mutex_);
+        if (handing_over_) return std::string("Config not applied: the node is handing over to a successor.");
+        std::filesystem::path file = path.empty() ? config_path_ : std::filesystem::path(path);
+        if (file.empty()) return std::string("Usage: reload [<config file>] (the node was started without one)");
+
+        NodeConfig next;
+        try {
+            next = NodeConfig::load(file, default_config_);
+        } catch (const std::exception& e) {
+            LOG_WARN("[Admin] Config reload rejected: {}", e.what());
+            return std::format("Config not applied: {}", e.what());
+        }
+
+        // Check the file against the running node too, so that nothing below can fail half-way through.
+        auto& pool = *thread_pool_;
+        size_t max_threads = std::max(next.max_threads ? next.max_threads : 4 * num_threads_ + reservedThreads(),
+                                      reservedThreads() + 1);
+        size_t min_threads = next.min_threads ? next.min_threads : reservedThreads() + 1;
+        if (max_threads > pool.capacity()) {
+            return std::format("Config not applied: threads.max: {} is above the pool capacity of {}, fixed at startup",
+                               max_threads, pool.capacity());
+        }
+        if (min_threads > max_threads) {
+            return std::format("Config not applied: threads.min: {} is above threads.max ({})", min_threads, max_threads);
+        }
+
+        NodeConfig current = currentConfig();
+        std::vector<std::string> applied = next.liveChanges(current);
+        std::vector<std::string> pending = next.restartChanges(current);
+
+        if (next.min_threads != current.min_threads || next.max_threads != current.max_threads) {
+            pool.setBounds(min_threads, max_threads);
+            scheduler_->setThreadBudget(client_lane_, pool.maxThreads() - reservedThreads());
+            pool_min_threads_ = next.min_threads;
+            pool_max_threads_ = next.max_threads;
+        }
+
+        storage_engine_->readaheadBudget().setLimit(next.readahead_budget);
+        readahead_budget_ = next.readahead_budget;
+
+        const auto& m = next.migration;
+        const auto& was = migration_policy_;
+        if (m.scan_interval != was.scan_interval || m.cold_after != was.cold_after || m.min_free_ratio != was.min_free_ratio ||
+            m.promote_heat != was.promote_heat || m.max_bytes_per_sec != was.max_bytes_per_sec) {
+            // The migrator reads its policy unlocked, so it is restarted rather than updated in place.
+            storage_engine_->stopMigrator();
+            storage_engine_->startMigrator(m);
+            migration_policy_ = m;
+        }
+
+        auto& logger = utils::AsyncLogger::getInstance();
+        logger.setMinLevel(next.log.min_level);
+        logger.setOverflowPolicy(next.log.overflow);
+        log_options_.min_level = next.log.min_level;
+        log_options_.overflow = next.log.overflow;
+
+        const auto& t = next.trace;
+        if (t.slow_threshold != trace_options_.slow_threshold || t.sample_every != trace_options_.sample_every ||
+            t.ring_capacity != trace_options_.ring_capacity) {
+            utils::RequestTracer::global().configure(t);
+            trace_options_ = t;
+        }
+
+        config_path_ = file;
+        LOG_INFO("[Admin] Reloaded {}: {} setting(s) applied, {} need a restart.", file.string(), applied.size(), pending.size());
+        std::string out = std::format("Reloaded {}: {} setting(s) applied, {} need a restart.\n", file.string(),
+                                      applied.size(), pending.size());
+        for (const auto& change : applied) out += "applied " + change + "\n";
+        for (const auto& change : pending) out += "restart " + change + "\n";
+        return out;
+    }
+
+    std::string Server::handleThreadsCommand(const std::string& args) {
+        static const std::string usage = "Usage: threads [<count> | min <count> | max <count>]";
+        auto& pool = *thread_pool_;
+        if (!args.empty()) {
+            std::string which, value = args;
+            size_t space_pos = args.find(' ');
+            if (space_pos != std::string::npos) {
+                which = args.substr(0, space_pos);
+                value = args.substr(space_pos + 1);
+            }
+            size_t count = 0;
+            try {
+                size_t used = 0;
+                count = std::stoul(value, &used);
+                if (used != value.size()) return usage;
+            } catch (const std::exception&) {
+                return usage;
+            }
+
+            if (which.empty()) {
+                pool.resize(count);
+            } else if (which == "min") {
+                pool.setBounds(count, pool.maxThreads());
+            } else if (which == "max") {
+                pool.setBounds(pool.minThreads(), std::max(count, reservedThreads() + 1));
+                // Clients may use whatever the reserved lanes leave of the new maximum.
+                scheduler_->setThreadBudget(client_lane_, pool.maxThreads() - reservedThreads());
+            } else {
+                return usage;
+            }
+            LOG_INFO("[Admin] Thread pool set to '{}'.", args);
+        }
+        return std::format("Pool threads: live={} idle={} min={} max={} capacity={}",
+                           pool.size(), pool.idleWorkers(), pool.minThreads(), pool.maxThreads(), pool.capacity());
+    }
+
+    std::string Server::handleProfileCommand(const std::string& args) {
+        static const std::string usage = "Usage: profile [start [<hz>] | stop [<file>] | <seconds> [<hz>]]";
+        auto& profiler = utils::Profiler::global();
+        std::vector<std::string> words;
+        for (size_t pos = 0; pos < args.size();) {
+            size_t end = args.find(' ', pos);
+            if (end == std::string::npos) end = args.size();
+            if (end > pos) words.push_back(args.substr(pos, end - pos));
+            pos = end + 1;
+        }
+        auto number = [](const std::string& text, int fallback) {
+            try {
+                size_t used = 0;
+                int value = std::stoi(text, &used);
+                return used == text.size() && value > 0 ? value : -1;
+            } catch (const std::exception&) {
+                return text.empty() ? fallback : -1;
+            }
+        };
+
+        try {
+            if (words.empty()) return std::string(profiler.running() ? "Profiler: running" : "Profiler: idle");
+            if (words[0] == "stop") {
+                if (words.size() > 2) return usage;
+                std::lock_guard<std::mutex> lock(profile_mutex_);
+                std::string reply = finishProfile(profiler, words.size() > 1 ? words[1] : "");
+                ++profile_run_;
+                profile_cv_.notify_all();
+                return reply;
+            }
+
+            bool timed = words[0] != "start";
+            int seconds = timed ? number(words[0], -1) : 0;
+            int hz = number(words.size() > 1 ? words[1] : "", 99);
+            if (seconds < 0 || hz < 0 || words.size() > 2) return usage;
+
+            // A timed run returns at once: a timer thread collects it, so the admin lane is not held for its length.
+            std::thread previous;
+            {
+                std::lock_guard<std::mutex> lock(profile_mutex_);
+                profiler.start(hz);
+                uint64_t run = ++profile_run_;
+                profile_cv_.notify_all();
+                if (timed) {
+                    previous = std::move(profile_timer_);
+                    profile_timer_ = std::thread([this, run, seconds]() {
+                        std::unique_lock<std::mutex> lock(profile_mutex_);
+                        if (profile_cv_.wait_for(lock, std::chrono::seconds(seconds), [&]() { return profile_run_ != run; })) return;
+                        ++profile_run_;
+                        try {
+                            finishProfile(utils::Profiler::global(), "");
+                        } catch (const std::exception& e) {
+                            LOG_ERROR("[Admin] Timed profile failed: {}", e.what());
+                        }
+                    });
+                }
+            }
+            // The previous timer's run has ended (the profiler was idle), so it is exiting or already gone.
+            if (previous.joinable()) previous.join();
+
+            if (!timed) {
+                LOG_INFO("[Admin] Profiler started at {} Hz.", hz);
+                return std::format("Profiler started at {} Hz. Use 'profile stop' to collect.", hz);
+            }
+            LOG_INFO("[Admin] Profiling for {} s at {} Hz.", seconds, hz);
+            return std::format("Profiling for {} s at {} Hz; the profile is written next to the log when it ends "
+                               "('profile stop' ends it early).", seconds, hz);
+        } catch (const std::exception& e) {
+            return std::string("Profiler error: ") + e.what();
+        }
+    }
+
+    std::string Server::handleTracesCommand(const std::string& args) {
+        static const std::string usage = "Usage: traces [<count> | threshold <ms>]";
+        auto& tracer = utils::RequestTracer::global();
+        size_t count = 20;
+        if (!args.empty()) {
+            std::string which, value = args;
+            size_t space_pos = args.find(' ');
+            if (space_pos != std::string::npos) {
+                which = args.substr(0, space_pos);
+                value = args.substr(space_pos + 1);
+            }
+            size_t number = 0;
+            try {
+                size_t used = 0;
+                number = std::stoul(value, &used);
+                if (used != value.size()) return usage;
+            } catch (const std::exception&) {
+                return usage;
+            }
+
+            if (which == "threshold") {
+                // Recorded as the running configuration, so that 'reload' and a hot restart start from it.
+                std::lock_guard<std::mutex> lock(config_mutex_);
+                tracer.setSlowThreshold(std::chrono::milliseconds(number));
+                trace_options_.slow_threshold = std::chrono::milliseconds(number);
+                LOG_INFO("[Admin] Slow-request threshold set to {} ms.", number);
+                return std::format("Slow-request threshold: {} ms", number);
+            }
+            if (!which.empty()) return usage;
+            count = number;
+        }
+
+        utils::TraceOptions options = tracer.options();
+        std::string out = std::format("Slow requests: {} (threshold {} ms), sampling 1 in {}\n", tracer.slowCount(),
+                                      std::chrono::duration_cast<std::chrono::milliseconds>(options.slow_threshold).count(),
+                                      options.sample_every);
+        for (const auto& record : tracer.recent(count)) {
+            std::time_t second = std::chrono::system_clock::to_time_t(record.started);
+            std::ostringstream when;
+            when << std::put_time(std::localtime(&second), "%H:%M:%S");
+            out += std::format("{} {}{} {} total={}us", when.str(), record.op, record.slow ? " [slow]" : "",
+                               record.detail, record.total_ns / 1000);
+            for (size_t stage = 0; stage < utils::kTraceStages; ++stage) {
+                out += std::format(" {}={}", utils::traceStageName(static_cast<utils::TraceStage>(stage)),
+                                   record.stage_ns[stage] / 1000);
+            }
+            out += std::format(" bytes={}\n", record.bytes);
+        }
+        return out;
+    }
+
     void Server::acceptAdminConnections() {
-        while (admin_running_) {
+        AcceptLoop running(accepting_);
+        while (admin_running_ && !retiring_) {
             try {
-                net::Socket admin_client = admin_listen_socket_.acceptClient();
-                auto shared_admin_sock = std::make_shared<net::Socket>(std::move(admin_client));
-                thread_pool_->enqueue([this, shared_admin_sock]() {
+                std::optional<net::Socket> admin_client = admin_listen_socket_.tryAcceptClient(kAcceptPollMs);
+                if (!admin_client) continue;
+                auto shared_admin_sock = std::make_shared<net::Socket>(std::move(*admin_client));
+                bool queued = scheduler_->trySubmit(admin_lane_, [this, shared_admin_sock]() {
                     this->adminWorker(shared_admin_sock);
                 });
+                if (!queued) LOG_WARN("[Admin] Admin lane is full, console rejected.");
             } catch (...) {
                 if (!admin_running_) break;
             }
         }
     }
 
+    void Server::acceptMetricsConnections() {
+        AcceptLoop running(accepting_);
+        while (admin_running_ && !retiring_) {
+            try {
+                std::optional<net::Socket> client = metrics_listen_socket_.tryAcceptClient(kAcceptPollMs);
+                if (!client) continue;
+                auto shared_sock = std::make_shared<net::Socket>(std::move(*client));
+                bool queued = scheduler_->trySubmit(admin_lane_, [this, shared_sock]() {
+                    try {
+                        this->serveHttp(*shared_sock);
+                    } catch (...) { }
+                });
+                if (!queued) LOG_WARN("[Admin] Admin lane is full, metrics scrape rejected.");
+            } catch (...) {
+                if (!admin_running_) break;
+            }
+        }
+    }
+
+    void Server::serveHttp(net::Socket& sock) {
+        net::HttpContext request;
+        char chunk[2048];
+        while (!request.complete()) {
+            size_t n = sock.recvSome(chunk, sizeof(chunk));
+            if (n == 0) return;
+            if (!request.feed(chunk, n)) break;
+        }
+
+        net::HttpResponse response;
+        const bool head = request.method() == "HEAD";
+        response.setHeadOnly(head);
+        response.addHeader("Connection", "close");
+        if (request.failed()) {
+            response.setStatus(400, "Bad Request");
+        } else if (request.method() != "GET" && !head) {
+            response.setStatus(405, "Method Not Allowed");
+            response.addHeader("Allow", "GET, HEAD");
+        } else if (request.path() != "/metrics") {
+            response.setStatus(404, "Not Found");
+        } else {
+            // Scrapers that ask for OpenMetrics get it; everyone else gets the classic text format.
+            const bool openMetrics = request.header("Accept").find("application/openmetrics-text") != std::string_view::npos;
+            response.addHeader("Content-Type", openMetrics ? "application/openmetrics-text; version=1.0.0; charset=utf-8"
+                                                           : "text/plain; version=0.0.4; charset=utf-8");
+            // Scrapes render into one long-lived buffer, so a steady scrape interval does not reallocate it.
+            std::lock_guard<std::mutex> lock(metrics_mutex_);
+            response.body().swap(metrics_body_);
+            utils::renderMetrics(utils::MetricsRegistry::global().collect(),
+                                 openMetrics ? utils::ExpositionFormat::OpenMetrics : utils::ExpositionFormat::Prometheus,
+                                 response.body());
+            std::string wire;
+            response.serialize(wire);
+            response.body().swap(metrics_body_);
+            sock.sendRaw(wire.data(), wire.size());
+            return;
+        }
+        std::string wire;
+        response.serialize(wire);
+        sock.sendRaw(wire.data(), wire.size());
+    }
+
     void Server::adminWorker(std::shared_ptr<net::Socket> admin_sock) {
+        // The console speaks length-prefixed frames; a frame header that reads "GET " or "HEAD" would announce a
+        // frame far beyond Socket::kMaxFrameSize, so those four bytes can only start an HTTP request.
+        char prefix[4];
+        try {
+            if (admin_sock->peek(prefix, sizeof(prefix)) == sizeof(prefix) &&
+                (std::memcmp(prefix, "GET ", 4) == 0 || std::memcmp(prefix, "HEAD", 4) == 0)) {
+                serveHttp(*admin_sock);
+                return;
+            }
+        } catch (...) {
+            return;
+        }
+
         LOG_INFO("[Admin] New console connected.");
         try {
             while (admin_running_) {
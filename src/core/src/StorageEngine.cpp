@@ -3,8 +3,1028 @@
 
 
 #include "../include/StorageEngine.hpp"
+#include "utils/include/AsyncLogger.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <format>
+#include <random>
+#include <set>
+#include <stdexcept>
+#include <utility>
+
+#ifdef __linux__
+#include <fcntl.h>
+#include <unistd.h>
+#endif
 
 namespace ref_storage::core {
 
+    namespace fs = std::filesystem;
+
+    namespace {
+
+        // Names payload and temporary files. Starts at a random point: during a hot restart two processes write
+        // into the same directories.
+        uint64_t nextFileId() {
+            static std::atomic<uint64_t> seq{(static_cast<uint64_t>(std::random_device{}()) << 32) ^
+                                             static_cast<uint64_t>(std::chrono::system_clock::now().time_since_epoch().count())};
+            return seq.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        // Unlink payload files together with their block indexes; missing ones are fine.
+        void unlinkPayloads(const std::vector<fs::path>& paths) {
+            std::error_code ec;
+            for (const auto& path : paths) {
+                fs::remove(path, ec);
+                fs::remove(StorageEngine::blockIndexPath(path), ec);
+            }
+        }
+
+        /* Ask the kernel to start reading [offset, offset + length) of an object into the page cache.
+         * posix_fadvise(WILLNEED) queues the I/O and returns, so the reader never waits for its own readahead.
+         */
+        void prefetchRange(const ObjectInfo& info, const std::vector<fs::path>& paths, uint64_t offset, uint64_t length) {
+#ifdef __linux__
+            uint64_t extent_start = 0;
+            for (size_t i = 0; i < info.extents.size() && length > 0; ++i) {
+                uint64_t extent_end = extent_start + info.extents[i].length;
+                if (offset < extent_end) {
+                    uint64_t in_extent = offset - extent_start;
+                    uint64_t take = std::min(length, info.extents[i].length - in_extent);
+                    int fd = open(paths[i].c_str(), O_RDONLY | O_CLOEXEC);
+                    if (fd >= 0) {
+                        posix_fadvise(fd, static_cast<off_t>(in_extent), static_cast<off_t>(take), POSIX_FADV_WILLNEED);
+                        close(fd);
+                    }
+                    offset += take;
+                    length -= take;
+                }
+                extent_start = extent_end;
+            }
+#else
+            (void)info; (void)paths; (void)offset; (void)length;
+#endif
+        }
+
+    }
+
+    // ==========================================
+    // ExtentLease
+    // ==========================================
+    ExtentLease::ExtentLease(ExtentLease&& other) noexcept
+        : engine_(std::exchange(other.engine_, nullptr)), paths_(std::move(other.paths_)) { }
+
+    ExtentLease& ExtentLease::operator=(ExtentLease&& other) noexcept {
+        if (this != &other) {
+            release();
+            engine_ = std::exchange(other.engine_, nullptr);
+            paths_ = std::move(other.paths_);
+        }
+        return *this;
+    }
+
+    void ExtentLease::release() noexcept {
+        if (engine_) std::exchange(engine_, nullptr)->releaseExtents(paths_);
+    }
+
+    // ==========================================
+    // ObjectWriter
+    // ==========================================
+    ObjectWriter::ObjectWriter(fs::path tmpPath, PublishFunc publish)
+        : tmp_path_(std::move(tmpPath)), publish_(std::move(publish)) {
+        out_.open(tmp_path_, std::ios::binary | std::ios::trunc);
+        if (!out_.is_open()) throw std::runtime_error("Failed to create upload file: " + tmp_path_.string());
+        index_out_.open(StorageEngine::blockIndexPath(tmp_path_), std::ios::binary | std::ios::trunc);
+        if (!index_out_.is_open()) throw std::runtime_error("Failed to create block index for: " + tmp_path_.string());
+        uint32_t block_size = kBlockSize;
+        index_out_.write("RSBI", 4);
+        index_out_.write(reinterpret_cast<const char*>(&block_size), sizeof(block_size));
+    }
+
+    ObjectWriter::ObjectWriter(ObjectWriter&& other) noexcept
+        : tmp_path_(std::move(other.tmp_path_)), publish_(std::move(other.publish_)),
+          out_(std::move(other.out_)), index_out_(std::move(other.index_out_)), crc_(other.crc_),
+          block_crc_(other.block_crc_), block_fill_(other.block_fill_), size_(other.size_), finished_(other.finished_) {
+        other.finished_ = true;
+    }
+
+    ObjectWriter& ObjectWriter::operator=(ObjectWriter&& other) noexcept {
+        if (this != &other) {
+            abort();
+            tmp_path_ = std::move(other.tmp_path_);
+            publish_ = std::move(other.publish_);
+            out_ = std::move(other.out_);
+            index_out_ = std::move(other.index_out_);
+            crc_ = other.crc_;
+            block_crc_ = other.block_crc_;
+            block_fill_ = other.block_fill_;
+            size_ = other.size_;
+            finished_ = std::exchange(other.finished_, true);
+        }
+        return *this;
+    }
+
+    ObjectWriter::~ObjectWriter() { abort(); }
+
+    void ObjectWriter::write(const char* data, size_t len) {
+        if (finished_) throw std::logic_error("write() on a finished ObjectWriter");
+        if (len == 0) return;
+        out_.write(data, static_cast<std::streamsize>(len));
+        if (!out_) throw std::runtime_error("Failed to write upload file: " + tmp_path_.string());
+        crc_.append(data, len);
+        size_ += len;
+
+        // Checksum each kBlockSize block of the file separately for the block index.
+        while (len > 0) {
+            size_t take = std::min<size_t>(len, kBlockSize - block_fill_);
+            block_crc_ = utils::Crc32::update(block_crc_, data, take);
+            block_fill_ += static_cast<uint32_t>(take);
+            data += take;
+            len -= take;
+            if (block_fill_ == kBlockSize) appendBlockCrc(block_crc_);
+        }
+    }
+
+    void ObjectWriter::appendBlockCrc(uint32_t crc) {
+        index_out_.write(reinterpret_cast<const char*>(&crc), sizeof(crc));
+        block_crc_ = 0;
+        block_fill_ = 0;
+    }
+
+    ObjectInfo ObjectWriter::commit() {
+        if (finished_) throw std::logic_error("commit() on a finished ObjectWriter");
+        out_.flush();
+        if (!out_) throw std::runtime_error("Failed to flush upload file: " + tmp_path_.string());
+        out_.close();
+
+        if (block_fill_ > 0) appendBlockCrc(block_crc_);
+        index_out_.flush();
+        if (!index_out_) throw std::runtime_error("Failed to write block index for: " + tmp_path_.string());
+        index_out_.close();
+
+        ObjectInfo info{size_, crc_.value(), {}};
+        publish_(tmp_path_, info);
+        finished_ = true;
+        return info;
+    }
+
+    void ObjectWriter::abort() {
+        if (finished_) return;
+        finished_ = true;
+        if (out_.is_open()) out_.close();
+        if (index_out_.is_open()) index_out_.close();
+        std::error_code ec;
+        fs::remove(tmp_path_, ec);
+        fs::remove(StorageEngine::blockIndexPath(tmp_path_), ec);
+    }
+
+    // ==========================================
+    // ObjectReader
+    // ==========================================
+    ObjectReader::ObjectReader(ObjectInfo info, ExtentLease lease, ReadaheadBudget* budget)
+        : info_(std::move(info)), lease_(std::move(lease)), readahead_(budget) { }
+
+    size_t ObjectReader::read(char* buf, size_t len) {
+        if (remaining() == 0 || len == 0) return 0;
+
+        // Skip finished (or empty) extents and open the next one lazily.
+        while (extent_offset_ == info_.extents[extent_index_].length) {
+            ++extent_index_;
+            extent_offset_ = 0;
+            if (in_.is_open()) in_.close();
+        }
+        if (!in_.is_open()) {
+            in_.open(lease_.paths()[extent_index_], std::ios::binary);
+            if (!in_.is_open()) throw std::runtime_error("Failed to open object file: " + lease_.paths()[extent_index_].string());
+        }
+
+        uint64_t left = info_.extents[extent_index_].length - extent_offset_;
+        if (len > left) len = static_cast<size_t>(left);
+
+        in_.read(buf, static_cast<std::streamsize>(len));
+        auto got = static_cast<size_t>(in_.gcount());
+        if (got == 0) throw std::runtime_error("Object file is shorter than its metadata");
+        crc_.append(buf, got);
+        if (auto prefetch = readahead_.onRead(offset_, got, info_.size)) {
+            prefetchRange(info_, lease_.paths(), prefetch->offset, prefetch->length);
+        }
+        extent_offset_ += got;
+        offset_ += got;
+        return got;
+    }
+
+    // ==========================================
+    // RangeReader
+    // ==========================================
+    RangeReader::RangeReader(ObjectInfo info, ExtentLease lease, uint64_t offset, uint64_t length)
+        : info_(std::move(info)), lease_(std::move(lease)), offset_(offset), end_(offset + length) { }
+
+    std::optional<RangeSegment> RangeReader::next(size_t maxLen) {
+        if (remaining() == 0 || maxLen == 0) return std::nullopt;
+
+        // Locate the extent holding offset_. Objects have few extents, so a linear scan is fine.
+        size_t index = 0;
+        uint64_t extent_start = 0;
+        while (extent_start + info_.extents[index].length <= offset_) {
+            extent_start += info_.extents[index].length;
+            ++index;
+        }
+        const Extent& extent = info_.extents[index];
+
+        if (index != open_extent_) {
+            data_in_ = std::ifstream(lease_.paths()[index], std::ios::binary);
+            if (!data_in_.is_open()) throw std::runtime_error("Failed to open object file: " + lease_.paths()[index].string());
+            index_in_ = std::ifstream(StorageEngine::blockIndexPath(lease_.paths()[index]), std::ios::binary);
+            has_index_ = false;
+            char magic[4] = {};
+            if (index_in_.read(magic, 4) && index_in_.read(reinterpret_cast<char*>(&block_size_), sizeof(block_size_))) {
+                // Only the block size ObjectWriter uses: a corrupt or foreign sidecar is treated as absent.
+                has_index_ = std::string_view(magic, 4) == "RSBI" && block_size_ == kBlockSize;
+            }
+            open_extent_ = index;
+        }
+
+        RangeSegment segment;
+        segment.path = lease_.paths()[index];
+        segment.offset = offset_ - extent_start;
+        segment.length = std::min<uint64_t>({maxLen, end_ - offset_, extent.length - segment.offset});
+
+        if (readahead_) {
+            if (auto prefetch = readahead_->onRead(offset_, segment.length, info_.size)) {
+                prefetchRange(info_, lease_.paths(), prefetch->offset, prefetch->length);
+            }
+        }
+        if (has_index_) verifyBlocks(segment.offset, segment.length);
+
+        offset_ += segment.length;
+        return segment;
+    }
+
+    void RangeReader::verifyBlocks(uint64_t extentOffset, uint64_t length) {
+        uint64_t first = extentOffset / block_size_;
+        uint64_t last = (extentOffset + length - 1) / block_size_;
+        auto count = static_cast<size_t>(last - first + 1);
+
+        expected_.resize(count);
+        index_in_.clear();
+        index_in_.seekg(static_cast<std::streamoff>(8 + first * sizeof(uint32_t)));
+        if (!index_in_.read(reinterpret_cast<char*>(expected_.data()), static_cast<std::streamsize>(count * sizeof(uint32_t)))) {
+            throw std::runtime_error("Block index is shorter than its extent: " + lease_.paths()[open_extent_].string());
+        }
+
+        scratch_.resize(block_size_);
+        data_in_.clear();
+        data_in_.seekg(static_cast<std::streamoff>(first * block_size_));
+        for (size_t i = 0; i < count; ++i) {
+            data_in_.read(scratch_.data(), block_size_);
+            auto got = static_cast<size_t>(data_in_.gcount());
+            if (got == 0 || utils::Crc32::update(0, scratch_.data(), got) != expected_[i]) {
+                LOG_ERROR("Block {} of '{}' failed verification.", first + i, lease_.paths()[open_extent_].string());
+                throw std::runtime_error("Block checksum mismatch");
+            }
+            data_in_.clear();
+        }
+    }
+
+    // ==========================================
+    // StorageEngine
+    // ==========================================
+    StorageEngine::StorageEngine(std::vector<fs::path> dataDirs)
+        : StorageEngine(std::vector<Tier>{Tier{"default", std::move(dataDirs)}}) { }
+
+    StorageEngine::StorageEngine(std::vector<Tier> tiers) {
+        openDirs(std::move(tiers), true);
+        // Objects whose metadata could not be read may still be recovered by hand; leave their files alone.
+        if (loadIndex() == 0) sweepOrphans();
+        LOG_INFO("StorageEngine ready on {} data dir(s) in {} tier(s) with {} objects.", dirs_.size(), tier_dirs_.size(), index_.size());
+    }
+
+    StorageEngine::StorageEngine(std::vector<Tier> tiers, const fs::path& checkpoint) {
+        openDirs(std::move(tiers), false);
+        // The previous process still serves from these files until it has drained.
+        keep_removed_ = true;
+        if (!loadCheckpoint(checkpoint)) {
+            LOG_WARN("Index checkpoint {} is unusable, rebuilding the index from meta/.", checkpoint.string());
+            loadIndex();
+        }
+        std::error_code ec;
+        fs::remove(checkpoint, ec);
+        LOG_INFO("StorageEngine taken over on {} data dir(s) in {} tier(s) with {} objects.", dirs_.size(), tier_dirs_.size(), index_.size());
+    }
+
+    void StorageEngine::openDirs(std::vector<Tier> tiers, bool cleanup) {
+        for (auto& tier : tiers) {
+            if (tier.dirs.empty()) throw std::invalid_argument("Storage tier '" + tier.name + "' has no data directory");
+            std::vector<uint32_t> indices;
+            for (auto& dir : tier.dirs) {
+                indices.push_back(static_cast<uint32_t>(dirs_.size()));
+                dir_tier_.push_back(static_cast<uint32_t>(tier_dirs_.size()));
+                dirs_.push_back(std::move(dir));
+            }
+            tier_dirs_.push_back(std::move(indices));
+            tier_names_.push_back(std::move(tier.name));
+        }
+        if (dirs_.empty()) throw std::invalid_argument("StorageEngine needs at least one data directory");
+
+        fs::create_directories(dirs_[0] / "meta");
+        for (const auto& dir : dirs_) {
+            fs::create_directories(dir / "objects");
+            fs::create_directories(dir / "extents");
+            fs::create_directories(dir / "uploads");
+            fs::create_directories(dir / "tmp");
+            if (!cleanup) continue;
+
+            // Uploads are not persisted: anything left here belongs to a previous run that never committed.
+            std::error_code ec;
+            for (const auto& entry : fs::directory_iterator(dir / "tmp", ec)) fs::remove(entry.path(), ec);
+            for (const auto& entry : fs::directory_iterator(dir / "uploads", ec)) fs::remove(entry.path(), ec);
+        }
+    }
+
+    StorageEngine::~StorageEngine() { stopMigrator(); }
+
+    bool StorageEngine::isValidKey(const std::string& key) noexcept {
+        if (key.empty() || key.size() > 255 || key.front() == '.') return false;
+        for (char c : key) {
+            bool ok = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') ||
+                      c == '.' || c == '_' || c == '-';
+            if (!ok) return false;
+        }
+        return true;
+    }
+
+    fs::path StorageEngine::newTmpPath(uint32_t dir, const std::string& name) const {
+        return dirs_[dir] / "tmp" / (name + "." + std::to_string(nextFileId()) + ".part");
+    }
+
+    std::string StorageEngine::newVersion(const std::string& path) {
+        // Keys cannot contain '@', so the suffix is unambiguous.
+        size_t at = path.rfind('@');
+        std::string base = at != std::string::npos && at > path.rfind('/') ? path.substr(0, at) : path;
+        return base + "@" + std::to_string(nextFileId());
+    }
+
+    ObjectWriter StorageEngine::createWriter(const std::string& key) {
+        if (!isValidKey(key)) throw std::invalid_argument("Invalid object key: " + key);
+        return ObjectWriter(newTmpPath(0, key), [this, key](const fs::path& tmp, const ObjectInfo& written) {
+            ObjectInfo info = written;
+            Extent extent{0, newVersion("objects/" + key), info.size, info.crc32};
+            fs::path final_path = extentPath(extent);
+            info.extents.push_back(std::move(extent));
+            publish(key, std::move(info), {{tmp, final_path}});
+        });
+    }
+
+    fs::path StorageEngine::blockIndexPath(const fs::path& payload) {
+        fs::path index = payload;
+        index += ".bidx";
+        return index;
+    }
+
+    RangeReader StorageEngine::openRange(const std::string& key, uint64_t offset, uint64_t length) const {
+        ExtentLease lease;
+        auto info = lookup(key, true, &lease);
+        if (!info) throw std::out_of_range("No such object: " + key);
+        if (offset > info->size || length > info->size - offset) throw std::out_of_range("Range outside of object: " + key);
+        return RangeReader(std::move(*info), std::move(lease), offset, length);
+    }
+
+    ObjectReader StorageEngine::openReader(const std::string& key) const {
+        ExtentLease lease;
+        auto info = lookup(key, true, &lease);
+        if (!info) throw std::out_of_range("No such object: " + key);
+        return ObjectReader(std::move(*info), std::move(lease), &readahead_budget_);
+    }
+
+    std::optional<ObjectInfo> StorageEngine::stat(const std::string& key) const {
+        return lookup(key, false);
+    }
+
+    std::optional<ObjectInfo> StorageEngine::lookup(const std::string& key, bool recordAccess, ExtentLease* lease) const {
+        std::shared_lock<std::shared_mutex> lock(index_mutex_);
+        auto it = index_.find(key);
+        if (it == index_.end()) return std::nullopt;
+        if (recordAccess) {
+            auto now = std::chrono::duration_cast<std::chrono::seconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+            it->second.access->heat.fetch_add(1, std::memory_order_relaxed);
+            it->second.access->last_access.store(now, std::memory_order_relaxed);
+        }
+        if (lease) {
+            // Taken under the index lock: whoever replaces this version finds the lease when it drops the files.
+            std::vector<fs::path> paths;
+            paths.reserve(it->second.info.extents.size());
+            for (const auto& extent : it->second.info.extents) paths.push_back(extentPath(extent));
+            std::lock_guard<std::mutex> leases(leases_mutex_);
+            for (const auto& path : paths) ++leased_[path.string()];
+            *lease = ExtentLease(this, std::move(paths));
+        }
+        return it->second.info;
+    }
+
+    bool StorageEngine::remove(const std::string& key) {
+        ObjectInfo old;
+        {
+            std::unique_lock<std::shared_mutex> lock(index_mutex_);
+            auto it = index_.find(key);
+            if (it == index_.end()) return false;
+            old = std::move(it->second.info);
+            index_.erase(it);
+            std::error_code ec;
+            fs::remove(metaPath(key), ec);
+            noteChange(key);
+        }
+        removeExtents(old.extents);
+        return true;
+    }
+
+    size_t StorageEngine::objectCount() const {
+        std::shared_lock<std::shared_mutex> lock(index_mutex_);
+        return index_.size();
+    }
+
+    bool StorageEngine::publish(const std::string& key, ObjectInfo info,
+                                const std::vector<std::pair<fs::path, fs::path>>& renames,
+                                const ObjectInfo* expected) {
+        fs::path meta_tmp = newTmpPath(0, key + ".meta");
+        writeMeta(meta_tmp, info);
+
+        ObjectInfo old;
+        {
+            // Payload first, metadata last: until the metadata rename the previous version stays intact.
+            std::unique_lock<std::shared_mutex> lock(index_mutex_);
+            auto it = index_.find(key);
+            if (expected && (it == index_.end() || it->second.info.extents != expected->extents)) {
+                lock.unlock();
+                std::error_code ec;
+                fs::remove(meta_tmp, ec);
+                return false;
+            }
+
+            for (const auto& [from, to] : renames) {
+                fs::rename(from, to);
+                std::error_code ec;
+                fs::rename(blockIndexPath(from), blockIndexPath(to), ec);
+            }
+            fs::rename(meta_tmp, metaPath(key));
+
+            if (it == index_.end()) it = index_.try_emplace(key).first;
+            old = std::exchange(it->second.info, std::move(info));
+            noteChange(key);
+            if (!expected) {
+                // A fresh write: the new version starts hot on tier 0.
+                auto now = std::chrono::duration_cast<std::chrono::seconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+                it->second.access->heat.store(0, std::memory_order_relaxed);
+                it->second.access->last_access.store(now, std::memory_order_relaxed);
+            }
+        }
+
+        // New versions never reuse a file, so every extent of the replaced one goes (once its readers are done).
+        removeExtents(old.extents);
+        return true;
+    }
+
+    void StorageEngine::writeMeta(const fs::path& path, const ObjectInfo& info) const {
+        std::ofstream meta(path, std::ios::trunc);
+        meta << info.size << ' ' << info.crc32 << ' ' << info.extents.size() << '\n';
+        for (const auto& extent : info.extents) {
+            meta << extent.dir << ' ' << extent.length << ' ' << extent.crc32 << ' ' << extent.path << '\n';
+        }
+        meta.flush();
+        if (!meta) throw std::runtime_error("Failed to write metadata: " + path.string());
+    }
+
+    void StorageEngine::removeExtents(const std::vector<Extent>& extents) const {
+        std::vector<fs::path> unused;
+        {
+            std::lock_guard<std::mutex> lock(leases_mutex_);
+            for (const auto& extent : extents) {
+                fs::path path = extentPath(extent);
+                if (leased_.count(path.string())) doomed_.insert(path.string());
+                else if (keep_removed_) kept_.push_back(std::move(path));
+                else unused.push_back(std::move(path));
+            }
+        }
+        unlinkPayloads(unused);
+    }
+
+    void StorageEngine::releaseExtents(const std::vector<fs::path>& paths) const noexcept {
+        std::vector<fs::path> unused;
+        {
+            std::lock_guard<std::mutex> lock(leases_mutex_);
+            for (const auto& path : paths) {
+                auto it = leased_.find(path.string());
+                if (it == leased_.end() || --it->second > 0) continue;
+                leased_.erase(it);
+                if (doomed_.erase(path.string())) (keep_removed_ ? kept_ : unused).push_back(path);
+            }
+        }
+        unlinkPayloads(unused);
+    }
+
+    void StorageEngine::sweepOrphans() {
+        std::unordered_set<std::string> referenced;
+        {
+            std::shared_lock<std::shared_mutex> lock(index_mutex_);
+            for (const auto& [key, entry] : index_) {
+                for (const auto& extent : entry.info.extents) referenced.insert(extentPath(extent).string());
+            }
+        }
+        // Versions replaced or deleted while a reader held them, when the node stopped before the reader let go.
+        size_t swept = 0;
+        std::error_code ec;
+        for (const auto& dir : dirs_) {
+            for (const char* sub : {"objects", "extents"}) {
+                for (const auto& entry : fs::directory_iterator(dir / sub, ec)) {
+                    fs::path payload = entry.path();
+                    if (payload.extension() == ".bidx") payload.replace_extension();
+                    // Only versioned files: anything else predates versioning and is referenced by its old name.
+                    if (payload.filename().string().find('@') == std::string::npos || referenced.count(payload.string())) continue;
+                    std::error_code remove_ec;
+                    if (fs::remove(entry.path(), remove_ec) && entry.path() == payload) ++swept;
+                }
+            }
+        }
+        if (swept) LOG_INFO("Removed {} unreferenced payload file(s).", swept);
+    }
+
+    std::optional<ObjectInfo> StorageEngine::readMeta(const std::string& key) const {
+        std::ifstream meta(metaPath(key));
+        if (!meta) return std::nullopt;
+
+        ObjectInfo info;
+        size_t count = 0;
+        bool ok = static_cast<bool>(meta >> info.size >> info.crc32);
+        if (ok && (meta >> count)) {
+            for (size_t i = 0; ok && i < count; ++i) {
+                Extent extent;
+                ok = static_cast<bool>(meta >> extent.dir >> extent.length >> extent.crc32 >> extent.path);
+                ok = ok && extent.dir < dirs_.size();
+                info.extents.push_back(std::move(extent));
+            }
+        } else if (ok) {
+            // Metadata written before extents existed: the payload is the single file objects/<key>.
+            info.extents.push_back({0, "objects/" + key, info.size, info.crc32});
+        }
+
+        for (const auto& extent : info.extents) ok = ok && fs::exists(extentPath(extent));
+        if (!ok) return std::nullopt;
+        return info;
+    }
+
+    size_t StorageEngine::loadIndex() {
+        std::unique_lock<std::shared_mutex> lock(index_mutex_);
+        index_.clear();
+        size_t skipped = 0;
+        for (const auto& entry : fs::directory_iterator(dirs_[0] / "meta")) {
+            if (!entry.is_regular_file()) continue;
+            std::string key = entry.path().filename().string();
+            auto info = readMeta(key);
+            if (!info) {
+                LOG_WARN("Skipping object '{}' with missing or corrupt metadata.", key);
+                ++skipped;
+                continue;
+            }
+            auto now = std::chrono::duration_cast<std::chrono::seconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+            auto& slot = index_[std::move(key)];
+            slot.info = std::move(*info);
+            slot.access->last_access.store(now, std::memory_order_relaxed);
+        }
+        return skipped;
+    }
+
+    // ==========================================
+    // Hot restart
+    // ==========================================
+    /* Checkpoint format (text, like the metadata files):
+     *   RSCK 1 <data dirs> <objects>
+     * and per object
+     *   <key> <heat> <seconds since last read> <size> <crc32> <extents>
+     *   <dir> <length> <crc32> <path>          once per extent
+     */
+    fs::path StorageEngine::writeCheckpoint() {
+        fs::path path = dirs_[0] / "index.checkpoint";
+        fs::path tmp = newTmpPath(0, "index.checkpoint");
+        auto now = std::chrono::duration_cast<std::chrono::seconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+        {
+            // Writers wait for the shared lock, so every change after the snapshot is tracked.
+            std::shared_lock<std::shared_mutex> lock(index_mutex_);
+            std::ofstream out(tmp, std::ios::trunc);
+            out << "RSCK 1 " << dirs_.size() << ' ' << index_.size() << '\n';
+            for (const auto& [key, entry] : index_) {
+                const ObjectInfo& info = entry.info;
+                int64_t idle = std::max<int64_t>(0, now - entry.access->last_access.load(std::memory_order_relaxed));
+                out << key << ' ' << entry.access->heat.load(std::memory_order_relaxed) << ' ' << idle << ' '
+                    << info.size << ' ' << info.crc32 << ' ' << info.extents.size() << '\n';
+                for (const auto& extent : info.extents) {
+                    out << extent.dir << ' ' << extent.length << ' ' << extent.crc32 << ' ' << extent.path << '\n';
+                }
+            }
+            out.flush();
+            if (!out) throw std::runtime_error("Failed to write index checkpoint: " + tmp.string());
+            track_changes_.store(true, std::memory_order_relaxed);
+        }
+        {
+            std::lock_guard<std::mutex> lock(leases_mutex_);
+            keep_removed_ = true;
+        }
+        fs::rename(tmp, path);
+        return path;
+    }
+
+    bool StorageEngine::loadCheckpoint(const fs::path& path) {
+        std::ifstream in(path);
+        std::string magic;
+        int version = 0;
+        size_t dirs = 0, count = 0;
+        if (!(in >> magic >> version >> dirs >> count) || magic != "RSCK" || version != 1 || dirs != dirs_.size()) return false;
+
+        std::unordered_map<std::string, IndexEntry> index;
+        index.reserve(count);
+        auto now = std::chrono::duration_cast<std::chrono::seconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+        for (size_t n = 0; n < count; ++n) {
+            std::string key;
+            uint32_t heat = 0;
+            int64_t idle = 0;
+            size_t extents = 0;
+            ObjectInfo info;
+            if (!(in >> key >> heat >> idle >> info.size >> info.crc32 >> extents)) return false;
+            for (size_t i = 0; i < extents; ++i) {
+                Extent extent;
+                if (!(in >> extent.dir >> extent.length >> extent.crc32 >> extent.path) || extent.dir >= dirs_.size()) return false;
+                info.extents.push_back(std::move(extent));
+            }
+            auto& slot = index[std::move(key)];
+            slot.info = std::move(info);
+            slot.access->heat.store(heat, std::memory_order_relaxed);
+            slot.access->last_access.store(now - idle, std::memory_order_relaxed);
+        }
+
+        std::unique_lock<std::shared_mutex> lock(index_mutex_);
+        index_ = std::move(index);
+        return true;
+    }
+
+    void StorageEngine::noteChange(const std::string& key) {
+        if (!track_changes_.load(std::memory_order_relaxed)) return;
+        std::lock_guard<std::mutex> lock(changes_mutex_);
+        changes_.push_back(key);
+        changes_cv_.notify_all();
+    }
+
+    std::vector<std::string> StorageEngine::takeChanges(std::chrono::milliseconds wait) {
+        std::unique_lock<std::mutex> lock(changes_mutex_);
+        changes_cv_.wait_for(lock, wait, [this] { return !changes_.empty(); });
+        std::vector<std::string> keys = std::move(changes_);
+        changes_.clear();
+        lock.unlock();
+        std::sort(keys.begin(), keys.end());
+        keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+        return keys;
+    }
+
+    void StorageEngine::stopTrackingChanges() {
+        track_changes_.store(false, std::memory_order_relaxed);
+        {
+            std::lock_guard<std::mutex> lock(changes_mutex_);
+            changes_.clear();
+        }
+        resumeRemovals({});
+    }
+
+    std::vector<fs::path> StorageEngine::takeRemovals() {
+        std::lock_guard<std::mutex> lock(leases_mutex_);
+        return std::exchange(kept_, {});
+    }
+
+    void StorageEngine::resumeRemovals(const std::vector<fs::path>& inherited) {
+        std::vector<fs::path> unused;
+        {
+            std::lock_guard<std::mutex> lock(leases_mutex_);
+            keep_removed_ = false;
+            std::vector<fs::path> kept = std::exchange(kept_, {});
+            kept.insert(kept.end(), inherited.begin(), inherited.end());
+            for (auto& path : kept) {
+                if (leased_.count(path.string())) doomed_.insert(path.string());
+                else unused.push_back(std::move(path));
+            }
+        }
+        unlinkPayloads(unused);
+    }
+
+    void StorageEngine::refresh(const std::vector<std::string>& keys) {
+        auto now = std::chrono::duration_cast<std::chrono::seconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+        for (const auto& key : keys) {
+            if (!isValidKey(key)) continue;
+            auto info = readMeta(key);
+            std::unique_lock<std::shared_mutex> lock(index_mutex_);
+            if (!info) {
+                index_.erase(key);
+                continue;
+            }
+            auto [it, added] = index_.try_emplace(key);
+            it->second.info = std::move(*info);
+            if (added) it->second.access->last_access.store(now, std::memory_order_relaxed);
+        }
+    }
+
+    // ==========================================
+    // Multipart upload
+    // ==========================================
+    std::shared_ptr<StorageEngine::Upload> StorageEngine::findUpload(const std::string& uploadId) const {
+        std::lock_guard<std::mutex> lock(uploads_mutex_);
+        auto it = uploads_.find(uploadId);
+        if (it == uploads_.end()) throw std::out_of_range("No such upload: " + uploadId);
+        return it->second;
+    }
+
+    std::string StorageEngine::createUpload(const std::string& key) {
+        if (!isValidKey(key)) throw std::invalid_argument("Invalid object key: " + key);
+
+        static thread_local std::mt19937_64 rng{std::random_device{}()};
+        auto upload = std::make_shared<Upload>();
+        upload->id = std::format("{:016x}", rng());
+        upload->key = key;
+
+        std::lock_guard<std::mutex> lock(uploads_mutex_);
+        uploads_[upload->id] = upload;
+        return upload->id;
+    }
+
+    ObjectWriter StorageEngine::createPartWriter(const std::string& uploadId, uint32_t partNumber) {
+        auto upload = findUpload(uploadId);
+        // New data always lands on tier 0; spread the parts over its disks.
+        const auto& hot_dirs = tier_dirs_[0];
+        uint32_t dir = hot_dirs[partNumber % hot_dirs.size()];
+        std::string name = uploadId + "." + std::to_string(partNumber);
+
+        return ObjectWriter(newTmpPath(dir, name), [this, upload, dir, name, partNumber](const fs::path& tmp, const ObjectInfo& info) {
+            std::lock_guard<std::mutex> lock(upload->mutex);
+            if (upload->closed) throw std::runtime_error("Upload is no longer open: " + upload->id);
+            Extent part{dir, "uploads/" + name, info.size, info.crc32};
+            fs::rename(tmp, extentPath(part));
+            fs::rename(blockIndexPath(tmp), blockIndexPath(extentPath(part)));
+            upload->parts[partNumber] = std::move(part);
+        });
+    }
+
+    ObjectInfo StorageEngine::completeUpload(const std::string& uploadId, const std::vector<ManifestEntry>& manifest) {
+        auto upload = findUpload(uploadId);
+        if (manifest.empty()) throw std::invalid_argument("Empty manifest");
+
+        std::lock_guard<std::mutex> lock(upload->mutex);
+        if (upload->closed) throw std::runtime_error("Upload is no longer open: " + uploadId);
+
+        ObjectInfo info;
+        std::vector<std::pair<fs::path, fs::path>> renames;
+        std::set<uint32_t> used;
+        for (const auto& entry : manifest) {
+            auto it = upload->parts.find(entry.part);
+            if (it == upload->parts.end()) throw std::invalid_argument("Manifest references missing part " + std::to_string(entry.part));
+            if (!used.insert(entry.part).second) throw std::invalid_argument("Manifest repeats part " + std::to_string(entry.part));
+            if (entry.crc32 && *entry.crc32 != it->second.crc32) throw std::invalid_argument("Checksum mismatch for part " + std::to_string(entry.part));
+
+            Extent extent = it->second;
+            extent.path = newVersion("extents/" + uploadId + "." + std::to_string(entry.part));
+            renames.emplace_back(extentPath(it->second), extentPath(extent));
+
+            info.crc32 = utils::Crc32::combine(info.crc32, extent.crc32, extent.length);
+            info.size += extent.length;
+            info.extents.push_back(std::move(extent));
+        }
+
+        publish(upload->key, info, renames);
+        upload->closed = true;
+
+        // Parts that were uploaded but left out of the manifest.
+        std::vector<Extent> unused;
+        for (const auto& [number, part] : upload->parts) {
+            if (!used.count(number)) unused.push_back(part);
+        }
+        removeExtents(unused);
+
+        {
+            std::lock_guard<std::mutex> uploads_lock(uploads_mutex_);
+            uploads_.erase(uploadId);
+        }
+        LOG_INFO("Multipart upload {} completed as '{}': {} parts, {} bytes.", uploadId, upload->key, manifest.size(), info.size);
+        return info;
+    }
+
+    bool StorageEngine::abortUpload(const std::string& uploadId) {
+        std::shared_ptr<Upload> upload;
+        {
+            std::lock_guard<std::mutex> lock(uploads_mutex_);
+            auto it = uploads_.find(uploadId);
+            if (it == uploads_.end()) return false;
+            upload = std::move(it->second);
+            uploads_.erase(it);
+        }
+
+        std::lock_guard<std::mutex> lock(upload->mutex);
+        upload->closed = true;
+        std::vector<Extent> parts;
+        for (const auto& [number, part] : upload->parts) parts.push_back(part);
+        removeExtents(parts);
+        return true;
+    }
+
+    // ==========================================
+    // Tiering
+    // ==========================================
+    void StorageEngine::startMigrator(const MigrationPolicy& policy) {
+        if (tier_dirs_.size() < 2 || migrator_.joinable()) return;
+        policy_ = policy;
+        migrator_stop_ = false;
+        throttle_start_ = std::chrono::steady_clock::now();
+        throttle_bytes_ = 0;
+        migrator_ = std::thread([this]() { migratorLoop(); });
+        LOG_INFO("Tier migrator started ({} tiers, {} MiB/s).", tier_dirs_.size(), policy_.max_bytes_per_sec >> 20);
+    }
+
+    void StorageEngine::stopMigrator() {
+        {
+            std::lock_guard<std::mutex> lock(migrator_mutex_);
+            migrator_stop_ = true;
+        }
+        migrator_cv_.notify_all();
+        if (migrator_.joinable()) migrator_.join();
+    }
+
+    std::vector<size_t> StorageEngine::objectsPerTier() const {
+        std::vector<size_t> counts(tier_dirs_.size(), 0);
+        std::shared_lock<std::shared_mutex> lock(index_mutex_);
+        for (const auto& [key, entry] : index_) ++counts[tierOf(entry.info)];
+        return counts;
+    }
+
+    void StorageEngine::migratorLoop() {
+        while (true) {
+            {
+                std::unique_lock<std::mutex> lock(migrator_mutex_);
+                migrator_cv_.wait_for(lock, policy_.scan_interval, [this] { return migrator_stop_; });
+                if (migrator_stop_) return;
+            }
+            try {
+                migrationPass();
+            } catch (const std::exception& e) {
+                LOG_ERROR("Tier migration pass failed: {}", e.what());
+            }
+        }
+    }
+
+    uint32_t StorageEngine::pickDir(uint32_t tier) const {
+        // The directory of the tier with the most free space.
+        uint32_t best = tier_dirs_[tier][0];
+        uintmax_t best_free = 0;
+        for (uint32_t dir : tier_dirs_[tier]) {
+            std::error_code ec;
+            auto info = fs::space(dirs_[dir], ec);
+            if (!ec && info.available > best_free) {
+                best_free = info.available;
+                best = dir;
+            }
+        }
+        return best;
+    }
+
+    void StorageEngine::migrationPass() {
+        struct Candidate {
+            std::string key;
+            ObjectInfo info;
+            uint32_t tier;
+            uint32_t heat;
+            int64_t last_access;
+        };
+
+        auto now = std::chrono::duration_cast<std::chrono::seconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+        std::vector<Candidate> demote, promote;
+        {
+            std::shared_lock<std::shared_mutex> lock(index_mutex_);
+            for (const auto& [key, entry] : index_) {
+                // Halve the heat every pass so that it reflects recent reads only.
+                uint32_t heat = entry.access->heat.load(std::memory_order_relaxed);
+                entry.access->heat.store(heat / 2, std::memory_order_relaxed);
+
+                uint32_t tier = tierOf(entry.info);
+                int64_t last = entry.access->last_access.load(std::memory_order_relaxed);
+                if (tier + 1 < tier_dirs_.size()) demote.push_back({key, entry.info, tier, heat, last});
+                if (tier > 0 && heat >= policy_.promote_heat) promote.push_back({key, entry.info, tier, heat, last});
+            }
+        }
+
+        // Coldest first.
+        std::sort(demote.begin(), demote.end(), [](const Candidate& a, const Candidate& b) {
+            return a.last_access != b.last_access ? a.last_access < b.last_access : a.heat < b.heat;
+        });
+        std::sort(promote.begin(), promote.end(), [](const Candidate& a, const Candidate& b) { return a.heat > b.heat; });
+
+        auto tier_under_pressure = [this](uint32_t tier) {
+            for (uint32_t dir : tier_dirs_[tier]) {
+                std::error_code ec;
+                auto info = fs::space(dirs_[dir], ec);
+                if (!ec && info.capacity > 0 &&
+                    static_cast<double>(info.available) / static_cast<double>(info.capacity) >= policy_.min_free_ratio) return false;
+            }
+            return true;
+        };
+
+        size_t demoted = 0, promoted = 0;
+        for (const auto& candidate : demote) {
+            bool cold = now - candidate.last_access >= policy_.cold_after.count();
+            if (!cold && !tier_under_pressure(candidate.tier)) continue;
+            if (migrate(candidate.key, candidate.info, candidate.tier + 1)) ++demoted;
+            std::lock_guard<std::mutex> lock(migrator_mutex_);
+            if (migrator_stop_) return;
+        }
+        for (const auto& candidate : promote) {
+            uint32_t target = candidate.tier - 1;
+            if (tier_under_pressure(target)) continue;
+            if (migrate(candidate.key, candidate.info, target)) ++promoted;
+            std::lock_guard<std::mutex> lock(migrator_mutex_);
+            if (migrator_stop_) return;
+        }
+        if (demoted || promoted) LOG_INFO("Tier migration pass: {} demoted, {} promoted.", demoted, promoted);
+    }
+
+    bool StorageEngine::migrate(const std::string& key, const ObjectInfo& info, uint32_t targetTier) {
+        // Hold the source files for the length of the copy, like any reader.
+        ExtentLease lease;
+        auto current = lookup(key, false, &lease);
+        if (!current || current->extents != info.extents) return false;
+
+        uint32_t target_dir = pickDir(targetTier);
+        ObjectInfo moved = info;
+        std::vector<std::pair<fs::path, fs::path>> renames;
+
+        auto discard = [&renames]() {
+            std::error_code ec;
+            for (const auto& [tmp, to] : renames) {
+                fs::remove(tmp, ec);
+                fs::remove(blockIndexPath(tmp), ec);
+            }
+        };
+
+        try {
+            for (auto& extent : moved.extents) {
+                fs::path tmp = newTmpPath(target_dir, "migrate");
+                renames.emplace_back(tmp, fs::path());
+                copyExtent(extent, tmp);
+                // A new version: the copy must not share a name with a file that is still leased somewhere.
+                extent.dir = target_dir;
+                extent.path = newVersion(extent.path);
+                renames.back().second = extentPath(extent);
+            }
+            if (publish(key, moved, renames, &info)) {
+                LOG_DEBUG("Migrated '{}' ({} bytes) to tier '{}'.", key, info.size, tier_names_[targetTier]);
+                return true;
+            }
+        } catch (const std::exception& e) {
+            LOG_WARN("Migration of '{}' to tier '{}' failed: {}", key, tier_names_[targetTier], e.what());
+        }
+        // Overwritten, removed or unreadable while we were copying: leave the object alone.
+        discard();
+        return false;
+    }
+
+    void StorageEngine::copyExtent(const Extent& from, const fs::path& to) {
+        constexpr size_t kCopyChunk = 1024 * 1024;
+        std::ifstream in(extentPath(from), std::ios::binary);
+        std::ofstream out(to, std::ios::binary | std::ios::trunc);
+        if (!in.is_open() || !out.is_open()) throw std::runtime_error("Failed to open files for migration");
+
+        std::vector<char> buffer(kCopyChunk);
+        utils::Crc32 crc;
+        uint64_t copied = 0;
+        while (copied < from.length) {
+            in.read(buffer.data(), static_cast<std::streamsize>(std::min<uint64_t>(kCopyChunk, from.length - copied)));
+            auto got = static_cast<size_t>(in.gcount());
+            if (got == 0) throw std::runtime_error("Extent is shorter than its metadata");
+            out.write(buffer.data(), static_cast<std::streamsize>(got));
+            crc.append(buffer.data(), got);
+            copied += got;
+
+            // Throttle: sleep until the copy is back under max_bytes_per_sec (averaged over one-second windows).
+            throttle_bytes_ += got;
+            auto elapsed = std::chrono::steady_clock::now() - throttle_start_;
+            auto allowed = std::chrono::duration<double>(static_cast<double>(throttle_bytes_) / static_cast<double>(policy_.max_bytes_per_sec));
+            if (allowed > elapsed) {
+                std::unique_lock<std::mutex> lock(migrator_mutex_);
+                migrator_cv_.wait_for(lock, allowed - elapsed, [this] { return migrator_stop_; });
+                if (migrator_stop_) throw std::runtime_error("Migrator stopping");
+            }
+            if (elapsed > std::chrono::seconds(1)) {
+                throttle_start_ = std::chrono::steady_clock::now();
+                throttle_bytes_ = 0;
+            }
+        }
+        out.flush();
+        if (!out) throw std::runtime_error("Failed to write migrated extent");
+        // Migration doubles as a scrub: never propagate a corrupt extent to another tier.
+        if (crc.value() != from.crc32) throw std::runtime_error("Checksum mismatch while migrating extent");
+
+        std::error_code ec;
+        fs::copy_file(blockIndexPath(extentPath(from)), blockIndexPath(to), fs::copy_options::overwrite_existing, ec);
+    }
 
-}
\ No newline at end of file
+}
@@ -2,22 +2,26 @@
 //Licensed under the Apache License, Version 2.0.
 
 #include "core/include/Server.hpp"
+#include <string_view>
 
-int main() {
+int main(int argc, char* argv[]) {
     // 1. 全局网络环境初始化 (静态成员函数)
     ref_storage::core::Server::init_env();
 
     // 2. 获取服务器的全局唯一实例
     auto& server = ref_storage::core::Server::get_instance();
 
-    // 3. 初始化并启动服务器 (内部会分离出业务监听和运维监听)
-    server.init(12344);
+    // 3. 热重启 (--hot-restart): 从正在运行的旧进程接管监听套接字与索引, 旧进程排空后退出
+    if (argc > 1 && std::string_view(argv[1]) == "--hot-restart") server.takeOver();
+
+    // 4. 初始化并启动服务器 (读取 config.json, 内部会分离出业务监听和运维监听)
+    server.init(12344, "config.json");
     server.start();
 
-    // 4. 挂起主线程，直到系统收到彻底关机的指令
+    // 5. 挂起主线程，直到系统收到彻底关机的指令
     server.waitForShutdown();
 
-    // 5. 全局网络环境清理 (静态成员函数)
+    // 6. 全局网络环境清理 (静态成员函数)
     ref_storage::core::Server::cleanup_env();
 
     return 0;
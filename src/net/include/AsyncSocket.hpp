@@ -0,0 +1,52 @@
+//Copyright (c) 2026 Kaizhi Liu
+//Licensed under the Apache License, Version 2.0.
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include "Socket.hpp"
+#include "EventLoop.hpp"
+#include "utils/include/Task.hpp"
+
+namespace ref_storage::net {
+
+    /* Awaitable operations on a connected Socket, speaking the same length-prefixed framing.
+     *
+     *   size_t len = co_await sock.recvFrame(buf, cap);
+     *   co_await sock.send(data, len);
+     *
+     * With an EventLoop the socket is switched to non-blocking mode and every operation suspends on the loop until
+     * the kernel is ready, so one loop thread serves any number of connections. Without a loop the operations block
+     * the calling thread and complete without ever suspending; the same handler code then runs thread-per-connection.
+     * Operations must be awaited one at a time (per direction).
+     */
+    class AsyncSocket {
+    public:
+        explicit AsyncSocket(Socket&& sock, EventLoop* loop = nullptr);
+        ~AsyncSocket();
+
+        AsyncSocket(const AsyncSocket&) = delete;
+        AsyncSocket& operator=(const AsyncSocket&) = delete;
+
+        // See Socket::recvFrame(char*, size_t): 0 means the peer closed the connection.
+        utils::Task<size_t> recvFrame(char* buffer, size_t capacity);
+
+        // One frame, as Socket::sendData(). Empty payloads are not sent.
+        utils::Task<void> send(const void* data, size_t len);
+
+        // See Socket::sendFileFrame().
+        utils::Task<void> sendFileFrame(std::string filepath, uint64_t offset, size_t count);
+
+        [[nodiscard]] EventLoop* loop() const noexcept { return _loop; }
+        [[nodiscard]] const Socket& socket() const noexcept { return _sock; }
+
+    private:
+        utils::Task<bool> recvAll(char* data, size_t len);
+        utils::Task<void> sendAll(const char* data, size_t len);
+
+        Socket _sock;
+        EventLoop* _loop;
+    };
+
+}
@@ -0,0 +1,139 @@
+//Copyright (c) 2026 Kaizhi Liu
+//Licensed under the Apache License, Version 2.0.
+
+#pragma once
+
+#include <atomic>
+#include <coroutine>
+#include <cstdint>
+#include <exception>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+#include "utils/include/Task.hpp"
+#include "utils/include/ThreadPool.hpp"
+#include "utils/include/UniqueFunction.hpp"
+
+namespace ref_storage::net {
+
+    /* Single-threaded epoll reactor that drives coroutines.
+     * Everything a coroutine spawned on a loop does between two suspension points runs on the loop's thread:
+     * readiness waits, cross-thread post() and offloaded work all resume their coroutine on the owning loop.
+     * Blocking work (disk I/O) must not run on the loop; offload() moves it to the blocking pool.
+     * Linux only (epoll + eventfd); constructing a loop elsewhere throws.
+     */
+    class EventLoop {
+    public:
+        explicit EventLoop(utils::ThreadPool* blockingPool = nullptr);
+        ~EventLoop();
+
+        EventLoop(const EventLoop&) = delete;
+        EventLoop& operator=(const EventLoop&) = delete;
+
+        // Run on the calling thread until stop().
+        void run();
+        // Thread-safe.
+        void stop();
+        // Run fn on the loop thread. Thread-safe.
+        void post(utils::UniqueFunction<void()> fn);
+        // Start task on the loop thread. Thread-safe.
+        void spawn(utils::Task<void> task);
+
+        [[nodiscard]] bool isInLoopThread() const noexcept { return std::this_thread::get_id() == _thread; }
+        [[nodiscard]] utils::ThreadPool* blockingPool() const noexcept { return _blockingPool; }
+
+        struct IoAwaiter {
+            EventLoop& loop;
+            int fd;
+            bool write;
+            bool await_ready() const noexcept { return false; }
+            void await_suspend(std::coroutine_handle<> h) { loop.watch(fd, write, h); }
+            void await_resume() const noexcept {}
+        };
+
+        // Suspend until fd is readable / writable (or has an error, which the retried operation then reports).
+        IoAwaiter readable(int fd) noexcept { return {*this, fd, false}; }
+        IoAwaiter writable(int fd) noexcept { return {*this, fd, true}; }
+
+        // Drop fd from the interest set; must be called on the loop thread before the fd is closed.
+        void forget(int fd) noexcept;
+        // Drop fd from the interest set and resume whoever waits on it, as if it had become ready. Loop thread only.
+        void cancel(int fd);
+
+    private:
+        struct Waiters {
+            std::coroutine_handle<> reader;
+            std::coroutine_handle<> writer;
+        };
+
+        void watch(int fd, bool write, std::coroutine_handle<> h);
+        void arm(int fd, const Waiters& waiters, bool added);
+        void runPending();
+
+        int _epollFd = -1;
+        int _wakeFd = -1;
+        utils::ThreadPool* _blockingPool;
+        std::thread::id _thread;
+        std::atomic<bool> _stop{false};
+
+        std::mutex _mutex;
+        std::vector<utils::UniqueFunction<void()>> _pending;
+        std::unordered_map<int, Waiters> _waiters;
+    };
+
+    namespace detail {
+
+        template <typename R>
+        struct OffloadResult {
+            std::optional<R> value;
+            R get() { return std::move(*value); }
+            template <typename F> void run(F& fn) { value.emplace(fn()); }
+        };
+
+        template <>
+        struct OffloadResult<void> {
+            void get() const noexcept {}
+            template <typename F> void run(F& fn) { fn(); }
+        };
+
+        template <typename F>
+        struct OffloadAwaiter {
+            using R = std::invoke_result_t<F&>;
+            EventLoop* loop;
+            F fn;
+            OffloadResult<R> result;
+            std::exception_ptr error;
+
+            bool await_ready() const noexcept { return false; }
+            void await_suspend(std::coroutine_handle<> h) {
+                loop->blockingPool()->post([this, h]() {
+                    try {
+                        result.run(fn);
+                    } catch (...) {
+                        error = std::current_exception();
+                    }
+                    loop->post([h]() { h.resume(); });
+                });
+            }
+            R await_resume() {
+                if (error) std::rethrow_exception(error);
+                return result.get();
+            }
+        };
+
+    }
+
+    /* Run blocking work off the loop and resume on it with the result (or exception).
+     * Without a loop, or a loop without a blocking pool, fn simply runs inline; this is what lets one coroutine
+     * handler serve both event-loop connections and thread-per-connection ones.
+     */
+    template <typename F>
+    utils::Task<std::invoke_result_t<F&>> offload(EventLoop* loop, F fn) {
+        if (!loop || !loop->blockingPool()) co_return fn();
+        co_return co_await detail::OffloadAwaiter<F>{loop, std::move(fn), {}, nullptr};
+    }
+
+}
@@ -3,10 +3,50 @@
 
 #pragma once
 
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
 namespace ref_storage::net {
 
+    /* Incremental parser for one HTTP/1.x request head (request line and headers).
+     * Feed it bytes as they arrive until complete() or failed(); request bodies are not read, which is all
+     * the GET-only endpoints of the node need.
+     */
     class HttpContext {
+    public:
+        static constexpr size_t kMaxHeadBytes = 8 * 1024;
+
+        // Append received bytes and parse as far as possible. Returns false once the request is malformed or too large.
+        bool feed(const char* data, size_t len);
+
+        [[nodiscard]] bool complete() const noexcept { return _state == State::Complete; }
+        [[nodiscard]] bool failed() const noexcept { return _state == State::Failed; }
+
+        [[nodiscard]] const std::string& method() const noexcept { return _method; }
+        // Target without the query string.
+        [[nodiscard]] const std::string& path() const noexcept { return _path; }
+        [[nodiscard]] const std::string& version() const noexcept { return _version; }
+        // Value of the first header with this name (case-insensitive), or empty.
+        [[nodiscard]] std::string_view header(std::string_view name) const;
+
+        void reset();
+
+    private:
+        enum class State { RequestLine, Headers, Complete, Failed };
+
+        bool parseRequestLine(std::string_view line);
+        bool parseHeader(std::string_view line);
 
+        State _state = State::RequestLine;
+        std::string _buffer;
+        size_t _parsed = 0;
+        std::string _method;
+        std::string _path;
+        std::string _version;
+        std::vector<std::pair<std::string, std::string>> _headers;
     };
 
-}
\ No newline at end of file
+}
@@ -3,10 +3,38 @@
 
 #pragma once
 
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
 namespace ref_storage::net {
 
+    /* An HTTP/1.1 response assembled into a caller-owned buffer.
+     * body() is kept between responses, so a handler that renders into it reuses the same allocation;
+     * serialize() writes the status line, the headers (Content-Length included) and the body into `out`.
+     */
     class HttpResponse {
+    public:
+        void setStatus(int code, std::string_view reason);
+        void addHeader(std::string_view name, std::string_view value);
+        // Omit the body from serialize() (HEAD requests); Content-Length still reports its size.
+        void setHeadOnly(bool headOnly) noexcept { _headOnly = headOnly; }
+
+        [[nodiscard]] std::string& body() noexcept { return _body; }
+        [[nodiscard]] int status() const noexcept { return _status; }
+
+        void serialize(std::string& out) const;
+
+        // Forget status and headers and empty the body, keeping its capacity.
+        void reset();
 
+    private:
+        int _status = 200;
+        std::string _reason = "OK";
+        std::vector<std::pair<std::string, std::string>> _headers;
+        std::string _body;
+        bool _headOnly = false;
     };
 
-}
\ No newline at end of file
+}
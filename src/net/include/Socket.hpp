@@ -7,6 +7,7 @@
 #include <stdexcept>
 #include "SocketHandle.hpp"
 #include <cstdint>
+#include <optional>
 #include <vector>
 
 namespace ref_storage::net {
@@ -20,6 +21,13 @@ namespace ref_storage::net {
      */
 
     class Socket {
+    public:
+        /* Upper bound for a single length-prefixed frame.
+         * The 32-bit header comes straight from the peer, so it must never be trusted as an allocation size.
+         * Payloads larger than this have to be sent as a stream of frames (see RequestHandler).
+         */
+        static constexpr size_t kMaxFrameSize = 16 * 1024 * 1024;
+
     private:
         SocketHandle _fd = SocketHandle();
 
@@ -47,6 +55,9 @@ namespace ref_storage::net {
         // Destructor: automatically close(fd)
         ~Socket();
 
+        // Underlying handle, for code that drives the socket itself (AsyncSocket, event loops).
+        [[nodiscard]] const SocketHandle& handle() const noexcept { return _fd; }
+
         // =========== Core API ===========
 
         // Server settings. enable: toggle switch
@@ -67,6 +78,19 @@ namespace ref_storage::net {
          */
         [[nodiscard]] Socket acceptClient() const;
 
+        /* Accept a connection if one arrives within timeout_ms; the listener must be non-blocking.
+         * Returns nothing on timeout, and when the connection was taken first by another process that shares
+         * the listener. Either way the caller gets control back regularly, which a blocking accept() on a
+         * shared listener cannot promise: closing it in one process does not wake the accept.
+         */
+        [[nodiscard]] std::optional<Socket> tryAcceptClient(int timeout_ms) const;
+
+        /* Close this process's descriptor without shutting the socket down.
+         * For a socket another process also holds (a listener handed over in a hot restart), where the shutdown
+         * that the destructor performs would stop it for both.
+         */
+        void closeShared() noexcept;
+
         /* Send data.
          * Return the actual number of bytes sent. */
         void sendData(const void *buf, size_t len, int timeout_ms = 1000) const;
@@ -78,13 +102,48 @@ namespace ref_storage::net {
          */
         [[nodiscard]] std::vector<char> recvData(size_t expectedSize = 0) const;
 
+        /* Receive one length-prefixed frame into a caller-owned buffer.
+         * The buffer is reused across calls and only grows up to maxSize, so a streaming transfer
+         * keeps a single bounded allocation no matter how many frames it consists of.
+         * Frames larger than maxSize are rejected before anything is allocated.
+         * Return the payload length; 0 means the peer closed the connection (or sent an empty frame).
+         */
+        size_t recvFrame(std::vector<char>& buffer, size_t maxSize = kMaxFrameSize) const;
+
+        // Same as above, into a fixed buffer of `capacity` bytes (a pooled buffer); larger frames are rejected.
+        size_t recvFrame(char* buffer, size_t capacity) const;
+
         /* [Core] Cross-Platform Zero-Copy File Transfer
          * offset: file offset, count: number of bytes to send.
          * Here, we will first assume that what is being transmitted is the entire file. */
         void sendFile(const std::string& filepath);
 
+        /* Send one length-prefixed frame whose payload is bytes [offset, offset + count) of a file.
+         * The payload goes from the page cache to the socket without passing through user space
+         * (sendfile on Linux, TransmitFile on Windows). count must not exceed kMaxFrameSize.
+         */
+        void sendFileFrame(const std::string& filepath, uint64_t offset, size_t count) const;
+
+        // =========== Raw (unframed) I/O, for the HTTP endpoint ===========
+
+        /* Wait for len bytes and copy them without consuming them.
+         * Returns the number of bytes available (less than len if the peer closed first).
+         */
+        size_t peek(char* buf, size_t len) const;
+
+        // Receive whatever is available, up to len bytes; 0 means the peer closed the connection.
+        size_t recvSome(char* buf, size_t len) const;
+
+        // Send all len bytes without a frame header.
+        void sendRaw(const void* data, size_t len) const;
+
     private:
         void throw_last_error(const char* operation) const;
+        void sendAll(const char* data, size_t len, const char* operation) const;
+        // Receive exactly len bytes; false if the peer closed the connection first.
+        bool recvAll(char* data, size_t len, const char* operation) const;
+        // Receive a frame header and check it against maxSize; 0 on close or for an empty frame.
+        uint32_t recvFrameHeader(size_t maxSize) const;
     };
 
 }
\ No newline at end of file
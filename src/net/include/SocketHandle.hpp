@@ -39,7 +39,7 @@ namespace ref_storage::net {
      */
 
     class SocketHandle {
-    private:
+    public:
 #ifdef _WIN32
         using NativeSocketType = SOCKET;
         static constexpr NativeSocketType kInvalid = INVALID_SOCKET;
@@ -48,6 +48,7 @@ namespace ref_storage::net {
         static constexpr NativeSocketType kInvalid = -1;
 #endif
 
+    private:
         NativeSocketType _handle = kInvalid;
 
     public:
@@ -3,10 +3,69 @@
 
 #pragma once
 
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+#include "Socket.hpp"
+#include "AsyncSocket.hpp"
+#include "EventLoop.hpp"
+
 namespace ref_storage::net {
 
+    /* Connection server on a set of event loops, one thread each.
+     * Loop 0 also accepts; connections are handed to the loops round-robin and served by a handler coroutine
+     * for their whole lifetime, so idle connections cost a coroutine frame instead of a thread.
+     */
     class TcpServer {
+    public:
+        using Handler = std::function<utils::Task<void>(AsyncSocket&)>;
+
+        TcpServer(size_t loops, utils::ThreadPool* blockingPool, Handler handler);
+        ~TcpServer();
+
+        TcpServer(const TcpServer&) = delete;
+        TcpServer& operator=(const TcpServer&) = delete;
+
+        // Take a bound, listening socket and start serving it.
+        void start(Socket&& listener);
+
+        // Stop accepting, shut down every open connection, wait for the handlers to finish, join the loops.
+        void stop();
+
+        /* Stop accepting and give the listener up without shutting it down, for a hot restart: another process
+         * accepts on it from now on. Open connections are left alone; stop() still waits for them.
+         */
+        void releaseListener();
+
+        [[nodiscard]] const Socket& listener() const noexcept { return _listener; }
+        [[nodiscard]] size_t connections() const noexcept { return _active.load(std::memory_order_relaxed); }
+
+    private:
+        struct Loop {
+            std::unique_ptr<EventLoop> loop;
+            std::thread thread;
+            std::unordered_set<int> fds;   // open connections, touched only on the loop thread
+        };
+
+        utils::Task<void> acceptLoop();
+        utils::Task<void> serveConnection(Socket sock, size_t loopIndex);
+
+        std::vector<Loop> _loops;
+        Handler _handler;
+        Socket _listener;
+        size_t _next = 0;
+        bool _started = false;
+        std::atomic<bool> _stopping{false};
+        std::atomic<bool> _released{false};
 
+        std::atomic<size_t> _active{0};
+        std::mutex _mutex;
+        std::condition_variable _drained;
     };
 
-}
\ No newline at end of file
+}
@@ -0,0 +1,42 @@
+//Copyright (c) 2026 Kaizhi Liu
+//Licensed under the Apache License, Version 2.0.
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "Socket.hpp"
+
+namespace ref_storage::net {
+
+    /* Unix domain stream sockets, for talking to another process on the same host and passing it open file
+     * descriptors along with a message (SCM_RIGHTS); this is how a hot restart hands its listeners to the new binary.
+     * The returned Sockets speak the usual length-prefixed frames, so sendData / recvData work on them as well.
+     * POSIX only: on Windows every function throws std::runtime_error.
+     */
+
+    // Most descriptors a single message may carry.
+    inline constexpr size_t kMaxPassedFds = 16;
+
+    /* Bind path and listen on it, with the socket file readable and writable by its owner only. A socket file nobody
+     * listens on any more (its process is gone) is replaced; one that still accepts connections belongs to a live
+     * process and makes this throw.
+     */
+    Socket listenUnix(const std::string& path);
+
+    Socket connectUnix(const std::string& path);
+
+    // Send message as one frame, with fds attached to it. The descriptors stay open in this process too.
+    void sendFds(const Socket& channel, std::string_view message, const std::vector<int>& fds);
+
+    /* Receive one frame sent by sendFds or sendData; an empty string means the peer closed the connection.
+     * Descriptors that came with it are appended to fds, and belong to the caller from then on.
+     */
+    std::string recvFds(const Socket& channel, std::vector<int>& fds);
+
+    // Whether the process at the other end of channel runs as this process's effective user (SO_PEERCRED).
+    bool peerIsSameUser(const Socket& channel);
+
+}
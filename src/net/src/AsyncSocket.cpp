@@ -0,0 +1,147 @@
+//Copyright (c) 2026 Kaizhi Liu
+//Licensed under the Apache License, Version 2.0.
+
+#include "../include/AsyncSocket.hpp"
+#include "utils/include/AsyncLogger.hpp"
+#include "utils/include/Metrics.hpp"
+#include <algorithm>
+#include <system_error>
+
+namespace ref_storage::net {
+
+    namespace {
+
+        // Traffic of data connections, payload plus the 4-byte frame header.
+        struct TrafficMetrics {
+            utils::Counter& received = utils::MetricsRegistry::global().counter(
+                "refstorage_net_received_bytes_total", "Bytes received on data connections, frame headers included.");
+            utils::Counter& sent = utils::MetricsRegistry::global().counter(
+                "refstorage_net_sent_bytes_total", "Bytes sent on data connections, frame headers included.");
+        };
+
+        TrafficMetrics& traffic() {
+            static TrafficMetrics metrics;
+            return metrics;
+        }
+
+    }
+
+    AsyncSocket::AsyncSocket(Socket&& sock, EventLoop* loop) : _sock(std::move(sock)), _loop(loop) {
+        if (_loop) _sock.setNonBlocking(true);
+    }
+
+    AsyncSocket::~AsyncSocket() {
+#ifdef __linux__
+        if (_loop) _loop->forget(_sock.handle().native_handle());
+#endif
+    }
+
+    utils::Task<size_t> AsyncSocket::recvFrame(char* buffer, size_t capacity) {
+        if (!_loop) {
+            size_t len = _sock.recvFrame(buffer, capacity);
+            if (len > 0) traffic().received.add(len + sizeof(uint32_t));
+            co_return len;
+        }
+
+        uint32_t datasize = 0;
+        if (!co_await recvAll(reinterpret_cast<char*>(&datasize), sizeof(datasize))) co_return 0;
+        datasize = ntohl(datasize);
+        if (datasize == 0) co_return 0;
+        if (datasize > std::min(capacity, Socket::kMaxFrameSize)) {
+            LOG_ERROR("Rejecting frame of {} bytes (limit {}).", datasize, std::min(capacity, Socket::kMaxFrameSize));
+            throw std::runtime_error("recv() frame exceeds maximum size");
+        }
+        if (!co_await recvAll(buffer, datasize)) co_return 0;
+        traffic().received.add(datasize + sizeof(uint32_t));
+        co_return datasize;
+    }
+
+    utils::Task<void> AsyncSocket::send(const void* data, size_t len) {
+        if (!data || len == 0) co_return;
+        traffic().sent.add(len + sizeof(uint32_t));
+        if (!_loop) {
+            _sock.sendData(data, len);
+            co_return;
+        }
+
+        uint32_t net_len = htonl(static_cast<uint32_t>(len));
+        co_await sendAll(reinterpret_cast<const char*>(&net_len), sizeof(net_len));
+        co_await sendAll(static_cast<const char*>(data), len);
+    }
+
+#ifdef __linux__
+
+    utils::Task<bool> AsyncSocket::recvAll(char* data, size_t len) {
+        int fd = _sock.handle().native_handle();
+        size_t received = 0;
+        while (received < len) {
+            ssize_t result = recv(fd, data + received, len - received, 0);
+            if (result > 0) { received += static_cast<size_t>(result); continue; }
+            if (result == 0) {
+                LOG_INFO("Connection closed by peer. FD: {}", fd);
+                co_return false;
+            }
+            if (errno == EAGAIN || errno == EWOULDBLOCK) co_await _loop->readable(fd);
+            else if (errno != EINTR) throw std::system_error(errno, std::system_category(), "recv() failed");
+        }
+        co_return true;
+    }
+
+    utils::Task<void> AsyncSocket::sendAll(const char* data, size_t len) {
+        int fd = _sock.handle().native_handle();
+        while (len > 0) {
+            ssize_t result = ::send(fd, data, len, MSG_NOSIGNAL);
+            if (result > 0) { data += result; len -= static_cast<size_t>(result); continue; }
+            if (result < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) co_await _loop->writable(fd);
+            else if (result < 0 && errno == EINTR) continue;
+            else throw std::system_error(errno, std::system_category(), "send() failed");
+        }
+    }
+
+    utils::Task<void> AsyncSocket::sendFileFrame(std::string filepath, uint64_t offset, size_t count) {
+        if (count > 0) traffic().sent.add(count + sizeof(uint32_t));
+        if (!_loop) {
+            _sock.sendFileFrame(filepath, offset, count);
+            co_return;
+        }
+        if (count == 0) co_return;
+        if (count > Socket::kMaxFrameSize) throw std::invalid_argument("sendFileFrame() count exceeds maximum frame size");
+
+        uint32_t net_len = htonl(static_cast<uint32_t>(count));
+        co_await sendAll(reinterpret_cast<const char*>(&net_len), sizeof(net_len));
+
+        int file_fd = open(filepath.c_str(), O_RDONLY);
+        if (file_fd < 0) throw std::runtime_error("Failed to open file.");
+        int fd = _sock.handle().native_handle();
+        auto file_offset = static_cast<off_t>(offset);
+        size_t remaining = count;
+        try {
+            while (remaining > 0) {
+                ssize_t sent_bytes = sendfile(fd, file_fd, &file_offset, remaining);
+                if (sent_bytes > 0) { remaining -= static_cast<size_t>(sent_bytes); continue; }
+                if (sent_bytes < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) { co_await _loop->writable(fd); continue; }
+                if (sent_bytes < 0 && errno == EINTR) continue;
+                // The frame header is already out; a short payload leaves the stream unusable.
+                throw std::runtime_error("Failed to send file range.");
+            }
+        } catch (...) {
+            close(file_fd);
+            throw;
+        }
+        close(file_fd);
+    }
+
+#else
+
+    utils::Task<bool> AsyncSocket::recvAll(char*, size_t) { co_return false; }
+    utils::Task<void> AsyncSocket::sendAll(const char*, size_t) { co_return; }
+
+    utils::Task<void> AsyncSocket::sendFileFrame(std::string filepath, uint64_t offset, size_t count) {
+        if (count > 0) traffic().sent.add(count + sizeof(uint32_t));
+        _sock.sendFileFrame(filepath, offset, count);
+        co_return;
+    }
+
+#endif
+
+}
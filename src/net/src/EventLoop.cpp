@@ -0,0 +1,161 @@
+//Copyright (c) 2026 Kaizhi Liu
+//Licensed under the Apache License, Version 2.0.
+
+#include "../include/EventLoop.hpp"
+#include "utils/include/AsyncLogger.hpp"
+#include <stdexcept>
+#include <system_error>
+
+#ifdef __linux__
+    #include <sys/epoll.h>
+    #include <sys/eventfd.h>
+    #include <unistd.h>
+    #include <cerrno>
+#endif
+
+namespace ref_storage::net {
+
+#ifdef __linux__
+
+    EventLoop::EventLoop(utils::ThreadPool* blockingPool) : _blockingPool(blockingPool), _thread(std::this_thread::get_id()) {
+        _epollFd = epoll_create1(EPOLL_CLOEXEC);
+        if (_epollFd < 0) throw std::system_error(errno, std::system_category(), "epoll_create1() failed");
+        _wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (_wakeFd < 0) {
+            int err = errno;
+            close(_epollFd);
+            throw std::system_error(err, std::system_category(), "eventfd() failed");
+        }
+        epoll_event ev{};
+        ev.events = EPOLLIN;
+        ev.data.fd = _wakeFd;
+        epoll_ctl(_epollFd, EPOLL_CTL_ADD, _wakeFd, &ev);
+    }
+
+    EventLoop::~EventLoop() {
+        close(_wakeFd);
+        close(_epollFd);
+    }
+
+    void EventLoop::post(utils::UniqueFunction<void()> fn) {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _pending.push_back(std::move(fn));
+        }
+        uint64_t one = 1;
+        [[maybe_unused]] ssize_t n = write(_wakeFd, &one, sizeof(one));
+    }
+
+    void EventLoop::spawn(utils::Task<void> task) {
+        post([task = std::move(task)]() mutable { utils::spawn(std::move(task)); });
+    }
+
+    void EventLoop::stop() {
+        _stop.store(true, std::memory_order_release);
+        uint64_t one = 1;
+        [[maybe_unused]] ssize_t n = write(_wakeFd, &one, sizeof(one));
+    }
+
+    void EventLoop::runPending() {
+        std::vector<utils::UniqueFunction<void()>> batch;
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            batch.swap(_pending);
+        }
+        for (auto& fn : batch) fn();
+    }
+
+    void EventLoop::arm(int fd, const Waiters& waiters, bool added) {
+        epoll_event ev{};
+        ev.events = EPOLLONESHOT | EPOLLRDHUP;
+        if (waiters.reader) ev.events |= EPOLLIN;
+        if (waiters.writer) ev.events |= EPOLLOUT;
+        ev.data.fd = fd;
+        if (epoll_ctl(_epollFd, added ? EPOLL_CTL_ADD : EPOLL_CTL_MOD, fd, &ev) < 0) {
+            throw std::system_error(errno, std::system_category(), "epoll_ctl() failed");
+        }
+    }
+
+    void EventLoop::watch(int fd, bool write, std::coroutine_handle<> h) {
+        auto [it, added] = _waiters.try_emplace(fd);
+        (write ? it->second.writer : it->second.reader) = h;
+        try {
+            arm(fd, it->second, added);
+        } catch (...) {
+            if (added) _waiters.erase(it);
+            else (write ? it->second.writer : it->second.reader) = nullptr;
+            throw;
+        }
+    }
+
+    void EventLoop::forget(int fd) noexcept {
+        if (_waiters.erase(fd)) epoll_ctl(_epollFd, EPOLL_CTL_DEL, fd, nullptr);
+    }
+
+    void EventLoop::cancel(int fd) {
+        auto it = _waiters.find(fd);
+        if (it == _waiters.end()) return;
+        Waiters waiters = it->second;
+        _waiters.erase(it);
+        epoll_ctl(_epollFd, EPOLL_CTL_DEL, fd, nullptr);
+        if (waiters.reader) waiters.reader.resume();
+        if (waiters.writer) waiters.writer.resume();
+    }
+
+    void EventLoop::run() {
+        _thread = std::this_thread::get_id();
+        std::vector<epoll_event> events(256);
+        std::vector<std::coroutine_handle<>> ready;
+
+        while (!_stop.load(std::memory_order_acquire)) {
+            int n = epoll_wait(_epollFd, events.data(), static_cast<int>(events.size()), -1);
+            if (n < 0) {
+                if (errno == EINTR) continue;
+                throw std::system_error(errno, std::system_category(), "epoll_wait() failed");
+            }
+
+            ready.clear();
+            for (int i = 0; i < n; ++i) {
+                int fd = events[i].data.fd;
+                if (fd == _wakeFd) {
+                    uint64_t value;
+                    [[maybe_unused]] ssize_t r = read(_wakeFd, &value, sizeof(value));
+                    continue;
+                }
+                auto it = _waiters.find(fd);
+                if (it == _waiters.end()) continue;
+
+                uint32_t ev = events[i].events;
+                bool failed = ev & (EPOLLERR | EPOLLHUP);
+                Waiters& w = it->second;
+                if (w.reader && (ev & (EPOLLIN | EPOLLRDHUP) || failed)) ready.push_back(std::exchange(w.reader, nullptr));
+                if (w.writer && (ev & EPOLLOUT || failed)) ready.push_back(std::exchange(w.writer, nullptr));
+                // One-shot disarmed the fd; re-arm for a waiter that did not fire.
+                if (w.reader || w.writer) arm(fd, w, false);
+            }
+
+            for (auto h : ready) h.resume();
+            runPending();
+        }
+        runPending();
+    }
+
+#else
+
+    EventLoop::EventLoop(utils::ThreadPool* blockingPool) : _blockingPool(blockingPool) {
+        throw std::runtime_error("EventLoop is only available on Linux");
+    }
+    EventLoop::~EventLoop() = default;
+    void EventLoop::run() {}
+    void EventLoop::stop() {}
+    void EventLoop::post(utils::UniqueFunction<void()>) {}
+    void EventLoop::spawn(utils::Task<void>) {}
+    void EventLoop::forget(int) noexcept {}
+    void EventLoop::cancel(int) {}
+    void EventLoop::watch(int, bool, std::coroutine_handle<>) {}
+    void EventLoop::arm(int, const Waiters&, bool) {}
+    void EventLoop::runPending() {}
+
+#endif
+
+}
@@ -3,8 +3,91 @@
 
 
 #include "../include/HttpContext.hpp"
+#include <algorithm>
+#include <cctype>
 
 namespace ref_storage::net {
 
+    namespace {
 
-}
\ No newline at end of file
+        bool equalsIgnoreCase(std::string_view a, std::string_view b) {
+            return a.size() == b.size() && std::equal(a.begin(), a.end(), b.begin(), [](char x, char y) {
+                return std::tolower(static_cast<unsigned char>(x)) == std::tolower(static_cast<unsigned char>(y));
+            });
+        }
+
+        std::string_view trim(std::string_view text) {
+            while (!text.empty() && (text.front() == ' ' || text.front() == '\t')) text.remove_prefix(1);
+            while (!text.empty() && (text.back() == ' ' || text.back() == '\t')) text.remove_suffix(1);
+            return text;
+        }
+
+    }
+
+    bool HttpContext::feed(const char* data, size_t len) {
+        if (_state == State::Failed) return false;
+        if (_state == State::Complete) return true;
+        _buffer.append(data, len);
+
+        while (_state == State::RequestLine || _state == State::Headers) {
+            size_t eol = _buffer.find("\r\n", _parsed);
+            if (eol == std::string::npos) {
+                if (_buffer.size() > kMaxHeadBytes) _state = State::Failed;
+                break;
+            }
+            std::string_view line(_buffer.data() + _parsed, eol - _parsed);
+            _parsed = eol + 2;
+
+            bool ok = true;
+            if (_state == State::RequestLine) {
+                ok = parseRequestLine(line);
+                if (ok) _state = State::Headers;
+            } else if (line.empty()) {
+                _state = State::Complete;
+            } else {
+                ok = parseHeader(line);
+            }
+            if (!ok || _parsed > kMaxHeadBytes) _state = State::Failed;
+        }
+        return _state != State::Failed;
+    }
+
+    bool HttpContext::parseRequestLine(std::string_view line) {
+        size_t first = line.find(' ');
+        size_t second = first == std::string_view::npos ? first : line.find(' ', first + 1);
+        if (second == std::string_view::npos) return false;
+
+        _method.assign(line.substr(0, first));
+        std::string_view target = line.substr(first + 1, second - first - 1);
+        _version.assign(line.substr(second + 1));
+        if (_method.empty() || target.empty() || _version.rfind("HTTP/1.", 0) != 0) return false;
+
+        _path.assign(target.substr(0, target.find('?')));
+        return true;
+    }
+
+    bool HttpContext::parseHeader(std::string_view line) {
+        size_t colon = line.find(':');
+        if (colon == std::string_view::npos || colon == 0) return false;
+        _headers.emplace_back(std::string(line.substr(0, colon)), std::string(trim(line.substr(colon + 1))));
+        return true;
+    }
+
+    std::string_view HttpContext::header(std::string_view name) const {
+        for (const auto& [key, value] : _headers) {
+            if (equalsIgnoreCase(key, name)) return value;
+        }
+        return {};
+    }
+
+    void HttpContext::reset() {
+        _state = State::RequestLine;
+        _buffer.clear();
+        _parsed = 0;
+        _method.clear();
+        _path.clear();
+        _version.clear();
+        _headers.clear();
+    }
+
+}
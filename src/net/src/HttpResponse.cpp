@@ -3,8 +3,38 @@
 
 
 #include "../include/HttpResponse.hpp"
+#include <format>
 
 namespace ref_storage::net {
 
+    void HttpResponse::setStatus(int code, std::string_view reason) {
+        _status = code;
+        _reason.assign(reason);
+    }
 
-}
\ No newline at end of file
+    void HttpResponse::addHeader(std::string_view name, std::string_view value) {
+        _headers.emplace_back(std::string(name), std::string(value));
+    }
+
+    void HttpResponse::serialize(std::string& out) const {
+        out.clear();
+        out += std::format("HTTP/1.1 {} {}\r\n", _status, _reason);
+        for (const auto& [name, value] : _headers) {
+            out += name;
+            out += ": ";
+            out += value;
+            out += "\r\n";
+        }
+        out += std::format("Content-Length: {}\r\n\r\n", _body.size());
+        if (!_headOnly) out += _body;
+    }
+
+    void HttpResponse::reset() {
+        _status = 200;
+        _reason = "OK";
+        _headers.clear();
+        _body.clear();
+        _headOnly = false;
+    }
+
+}
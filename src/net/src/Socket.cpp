@@ -3,6 +3,10 @@
 
 #include "../include/Socket.hpp"
 #include "utils/include/AsyncLogger.hpp"
+#include <algorithm>
+#ifndef _WIN32
+    #include <poll.h>
+#endif
 
 namespace ref_storage::net {
 
@@ -14,11 +18,11 @@ namespace ref_storage::net {
         _fd = SocketHandle::create_socket_handle();
         if (_fd.native_handle() == -1) throw_last_error("create_socket_handle() failed: ");
 #endif
-        LOG_INFO("Socket created successfully. FD: {}", _fd.native_handle());
+        LOG_DEBUG("Socket created successfully. FD: {}", _fd.native_handle());
     }
 
     Socket::Socket(SocketHandle&& fd) : _fd(std::move(fd)) {
-        if (_fd.is_valid_handle()) LOG_INFO("Socket handle moved/wrapped. FD: {}", _fd.native_handle());
+        if (_fd.is_valid_handle()) LOG_DEBUG("Socket handle moved/wrapped. FD: {}", _fd.native_handle());
     }
 
     Socket::Socket(Socket &&other) noexcept {
@@ -28,7 +32,7 @@ namespace ref_storage::net {
     Socket & Socket::operator=(Socket &&other) noexcept {
         if (this != &other) {
             if (_fd.is_valid_handle()) {
-                LOG_INFO("Closing old socket FD: {} due to move assignment.", _fd.native_handle());
+                LOG_DEBUG("Closing old socket FD: {} due to move assignment.", _fd.native_handle());
                 _fd.close_handle();
             }
             _fd = std::move(other._fd);
@@ -39,7 +43,7 @@ namespace ref_storage::net {
 
     Socket::~Socket() {
         if (_fd.is_valid_handle()) {
-            LOG_INFO("Socket closing. FD: {}", _fd.native_handle());
+            LOG_DEBUG("Socket closing. FD: {}", _fd.native_handle());
             _fd.close_handle();
         }
     }
@@ -107,6 +111,43 @@ namespace ref_storage::net {
         return CommunicationSocket;
     }
 
+    std::optional<Socket> Socket::tryAcceptClient(int timeout_ms) const {
+        if (!_fd.is_valid_handle()) throw_last_error("Invalid socket. ");
+#ifdef _WIN32
+        WSAPOLLFD pfd{_fd.native_handle(), POLLRDNORM, 0};
+        int ready = WSAPoll(&pfd, 1, timeout_ms);
+#else
+        pollfd pfd{_fd.native_handle(), POLLIN, 0};
+        int ready = poll(&pfd, 1, timeout_ms);
+#endif
+        if (ready < 0) throw_last_error("poll() failed");
+        if (ready == 0) return std::nullopt;
+
+        Socket client(_fd.accept_handle());
+        if (!client._fd.is_valid_handle()) {
+#ifdef _WIN32
+            if (WSAGetLastError() == WSAEWOULDBLOCK) return std::nullopt;
+#else
+            if (errno == EAGAIN || errno == EWOULDBLOCK || errno == ECONNABORTED || errno == EINTR) return std::nullopt;
+#endif
+            throw_last_error("accept() failed");
+        }
+        // Windows passes the listener's non-blocking mode on to accepted sockets; they are served blocking.
+        client.setNonBlocking(false);
+        return client;
+    }
+
+    void Socket::closeShared() noexcept {
+        if (!_fd.is_valid_handle()) return;
+        LOG_DEBUG("Socket released. FD: {}", _fd.native_handle());
+        SocketHandle::NativeSocketType handle = _fd.release_handle();
+#ifdef _WIN32
+        closesocket(handle);
+#else
+        close(handle);
+#endif
+    }
+
     void Socket::sendData(const void *buf, size_t len, int timeout_ms) const {
         if (!buf || len == 0 || !_fd.is_valid_handle()) return;
 
@@ -173,6 +214,10 @@ namespace ref_storage::net {
 
             datasize = ntohl(datasize);
             if (datasize == 0) return buffet;
+            if (datasize > kMaxFrameSize) {
+                LOG_ERROR("Rejecting frame of {} bytes (limit {}). FD: {}", datasize, kMaxFrameSize, _fd.native_handle());
+                throw std::runtime_error("recv() frame exceeds maximum size");
+            }
             buffet.resize(datasize);
             size_t total_received = 0;
 
@@ -190,6 +235,61 @@ namespace ref_storage::net {
         return buffet;
     }
 
+    bool Socket::recvAll(char* data, size_t len, const char* operation) const {
+        size_t total_received = 0;
+        while (total_received < len) {
+#ifdef _WIN32
+            int result = recv(_fd.native_handle(), data + total_received, static_cast<int>(len - total_received), 0);
+#else
+            ssize_t result = recv(_fd.native_handle(), data + total_received, len - total_received, 0);
+#endif
+            if (result > 0) total_received += static_cast<size_t>(result);
+            else if (result == 0) return false;
+            else throw_last_error(operation);
+        }
+        return true;
+    }
+
+    uint32_t Socket::recvFrameHeader(size_t maxSize) const {
+        if (!_fd.is_valid_handle()) throw_last_error("Invalid socket. ");
+
+        uint32_t datasize = 0;
+        if (!recvAll(reinterpret_cast<char*>(&datasize), sizeof(datasize), "recv() header failed")) {
+            LOG_INFO("Connection closed by peer. FD: {}", _fd.native_handle());
+            return 0;
+        }
+
+        datasize = ntohl(datasize);
+        if (datasize > maxSize) {
+            LOG_ERROR("Rejecting frame of {} bytes (limit {}). FD: {}", datasize, maxSize, _fd.native_handle());
+            throw std::runtime_error("recv() frame exceeds maximum size");
+        }
+        return datasize;
+    }
+
+    size_t Socket::recvFrame(std::vector<char>& buffer, size_t maxSize) const {
+        uint32_t datasize = recvFrameHeader(maxSize);
+        if (datasize == 0) return 0;
+        if (buffer.size() < datasize) buffer.resize(datasize);
+
+        if (!recvAll(buffer.data(), datasize, "recv() payload failed")) {
+            LOG_INFO("Connection closed by peer mid-frame. FD: {}", _fd.native_handle());
+            return 0;
+        }
+        return datasize;
+    }
+
+    size_t Socket::recvFrame(char* buffer, size_t capacity) const {
+        uint32_t datasize = recvFrameHeader(std::min(capacity, kMaxFrameSize));
+        if (datasize == 0) return 0;
+
+        if (!recvAll(buffer, datasize, "recv() payload failed")) {
+            LOG_INFO("Connection closed by peer mid-frame. FD: {}", _fd.native_handle());
+            return 0;
+        }
+        return datasize;
+    }
+
     void Socket::sendFile(const std::string& filepath) {
 #ifdef _WIN32
         HANDLE hFile = CreateFileA(filepath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
@@ -211,6 +311,89 @@ namespace ref_storage::net {
 #endif
     }
 
+    void Socket::sendAll(const char* data, size_t len, const char* operation) const {
+        while (len > 0) {
+#ifdef _WIN32
+            int loc_sent = send(_fd.native_handle(), data, static_cast<int>(len), 0);
+#else
+            ssize_t loc_sent = send(_fd.native_handle(), data, len, 0);
+#endif
+            if (loc_sent > 0) { len -= loc_sent; data += loc_sent; }
+            else if (loc_sent == 0) throw std::runtime_error("Connection closed by peer during send.");
+            else throw_last_error(operation);
+        }
+    }
+
+    void Socket::sendFileFrame(const std::string& filepath, uint64_t offset, size_t count) const {
+        if (!_fd.is_valid_handle()) throw_last_error("Invalid socket. ");
+        if (count == 0) return;
+        if (count > kMaxFrameSize) throw std::invalid_argument("sendFileFrame() count exceeds maximum frame size");
+
+        uint32_t net_len = htonl(static_cast<uint32_t>(count));
+        sendAll(reinterpret_cast<const char*>(&net_len), sizeof(net_len), "send() header failed: ");
+
+#ifdef _WIN32
+        HANDLE hFile = CreateFileA(filepath.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (hFile == INVALID_HANDLE_VALUE) throw std::runtime_error("Failed to open file.");
+        LARGE_INTEGER pos;
+        pos.QuadPart = static_cast<LONGLONG>(offset);
+        BOOL result = SetFilePointerEx(hFile, pos, nullptr, FILE_BEGIN);
+        if (result) result = TransmitFile(_fd.native_handle(), hFile, static_cast<DWORD>(count), 0, nullptr, nullptr, TF_USE_DEFAULT_WORKER);
+        CloseHandle(hFile);
+        if (result == FALSE) throw std::runtime_error("TransmitFile() failed. ");
+#elif __linux__
+        int file_fd = open(filepath.c_str(), O_RDONLY);
+        if (file_fd < 0) throw std::runtime_error("Failed to open file.");
+        auto file_offset = static_cast<off_t>(offset);
+        size_t remaining = count;
+        while (remaining > 0) {
+            ssize_t sent_bytes = sendfile(_fd.native_handle(), file_fd, &file_offset, remaining);
+            if (sent_bytes > 0) { remaining -= static_cast<size_t>(sent_bytes); continue; }
+            if (sent_bytes < 0 && (errno == EAGAIN || errno == EINTR)) continue;
+            close(file_fd);
+            // The frame header is already out; a short payload leaves the stream unusable.
+            throw std::runtime_error("Failed to send file range.");
+        }
+        close(file_fd);
+#endif
+    }
+
+    size_t Socket::peek(char* buf, size_t len) const {
+        if (!_fd.is_valid_handle()) throw_last_error("Invalid socket. ");
+        // Linux waits for len bytes (or EOF) in one call. Windows cannot combine MSG_PEEK with MSG_WAITALL,
+        // so poll for the rest for up to a second and then settle for what has arrived.
+        for (int attempt = 0;; ++attempt) {
+#ifdef _WIN32
+            int result = recv(_fd.native_handle(), buf, static_cast<int>(len), MSG_PEEK);
+#else
+            ssize_t result = recv(_fd.native_handle(), buf, len, MSG_PEEK | MSG_WAITALL);
+#endif
+            if (result < 0) throw_last_error("recv() peek failed");
+            if (static_cast<size_t>(result) >= len || result == 0 || attempt == 100) return static_cast<size_t>(result);
+#ifdef _WIN32
+            Sleep(10);
+#else
+            usleep(10000);
+#endif
+        }
+    }
+
+    size_t Socket::recvSome(char* buf, size_t len) const {
+        if (!_fd.is_valid_handle()) throw_last_error("Invalid socket. ");
+#ifdef _WIN32
+        int result = recv(_fd.native_handle(), buf, static_cast<int>(len), 0);
+#else
+        ssize_t result = recv(_fd.native_handle(), buf, len, 0);
+#endif
+        if (result < 0) throw_last_error("recv() failed");
+        return static_cast<size_t>(result);
+    }
+
+    void Socket::sendRaw(const void* data, size_t len) const {
+        if (!_fd.is_valid_handle()) throw_last_error("Invalid socket. ");
+        sendAll(static_cast<const char*>(data), len, "send() failed: ");
+    }
+
     void Socket::throw_last_error(const char *operation) const {
 #ifdef _WIN32
         int err = WSAGetLastError();
@@ -3,8 +3,121 @@
 
 
 #include "../include/TcpServer.hpp"
+#include "utils/include/AsyncLogger.hpp"
+#include <algorithm>
+#include <chrono>
 
 namespace ref_storage::net {
 
+    TcpServer::TcpServer(size_t loops, utils::ThreadPool* blockingPool, Handler handler)
+        : _loops(std::max<size_t>(1, loops)), _handler(std::move(handler)) {
+        for (auto& l : _loops) l.loop = std::make_unique<EventLoop>(blockingPool);
+    }
 
-}
\ No newline at end of file
+    TcpServer::~TcpServer() { stop(); }
+
+    void TcpServer::start(Socket&& listener) {
+        if (_started) throw std::logic_error("TcpServer already started");
+        _listener = std::move(listener);
+        _listener.setNonBlocking(true);
+        _started = true;
+
+        for (auto& l : _loops) {
+            EventLoop* loop = l.loop.get();
+            l.thread = std::thread([loop]() {
+                try {
+                    loop->run();
+                } catch (const std::exception& e) {
+                    LOG_ERROR("Event loop terminated: {}", e.what());
+                }
+            });
+        }
+        _loops[0].loop->spawn(acceptLoop());
+    }
+
+    utils::Task<void> TcpServer::acceptLoop() {
+#ifdef __linux__
+        EventLoop* loop = _loops[0].loop.get();
+        int listen_fd = _listener.handle().native_handle();
+        while (!_stopping.load(std::memory_order_acquire) && !_released.load(std::memory_order_acquire)) {
+            int fd = accept4(listen_fd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+            if (fd < 0) {
+                if (errno == EAGAIN || errno == EWOULDBLOCK) { co_await loop->readable(listen_fd); continue; }
+                if (errno == EINTR || errno == ECONNABORTED) continue;
+                if (_stopping.load(std::memory_order_acquire)) break;
+                LOG_ERROR("accept4() failed, errno {}", errno);
+                co_await loop->readable(listen_fd);
+                continue;
+            }
+            size_t index = _next++ % _loops.size();
+            _active.fetch_add(1, std::memory_order_relaxed);
+            _loops[index].loop->spawn(serveConnection(Socket(SocketHandle(fd)), index));
+        }
+        loop->forget(listen_fd);
+#endif
+        co_return;
+    }
+
+    utils::Task<void> TcpServer::serveConnection(Socket sock, size_t loopIndex) {
+        Loop& l = _loops[loopIndex];
+        int fd = sock.handle().native_handle();
+        l.fds.insert(fd);
+        {
+            AsyncSocket conn(std::move(sock), l.loop.get());
+            try {
+                co_await _handler(conn);
+            } catch (const std::exception& e) {
+                LOG_ERROR("[异常退出]: {}", e.what());
+            }
+            l.fds.erase(fd);
+        }
+        if (_active.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _drained.notify_all();
+        }
+    }
+
+    void TcpServer::releaseListener() {
+        if (!_started || _stopping.load() || _released.exchange(true)) return;
+        std::mutex done_mutex;
+        std::condition_variable done_cv;
+        bool done = false;
+        // The acceptor lives on loop 0: wake it there, and close the descriptor once it has let go.
+        _loops[0].loop->post([&]() {
+            _loops[0].loop->cancel(_listener.handle().native_handle());
+            _listener.closeShared();
+            std::lock_guard<std::mutex> lock(done_mutex);
+            done = true;
+            done_cv.notify_all();
+        });
+        std::unique_lock<std::mutex> lock(done_mutex);
+        done_cv.wait(lock, [&] { return done; });
+    }
+
+    void TcpServer::stop() {
+        if (!_started || _stopping.exchange(true)) return;
+
+#ifdef __linux__
+        // Wake the acceptor and every connection; their next I/O fails and the handlers unwind.
+        shutdown(_listener.handle().native_handle(), SHUT_RDWR);
+        for (auto& l : _loops) {
+            Loop* lp = &l;
+            l.loop->post([lp]() {
+                for (int fd : lp->fds) shutdown(fd, SHUT_RDWR);
+            });
+        }
+#endif
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            if (!_drained.wait_for(lock, std::chrono::seconds(10), [this] { return _active.load() == 0; })) {
+                LOG_WARN("{} connection(s) still busy after shutdown; abandoning them.", _active.load());
+            }
+        }
+        for (auto& l : _loops) {
+            l.loop->stop();
+            if (l.thread.joinable()) l.thread.join();
+        }
+        _listener = Socket(SocketHandle());
+    }
+
+}
@@ -0,0 +1,176 @@
+//Copyright (c) 2026 Kaizhi Liu
+//Licensed under the Apache License, Version 2.0.
+
+#include "../include/UnixSocket.hpp"
+#include <cstring>
+#include <stdexcept>
+#include <system_error>
+#ifndef _WIN32
+    #include <sys/stat.h>
+    #include <sys/un.h>
+    #include <unistd.h>
+#endif
+
+namespace ref_storage::net {
+
+#ifdef _WIN32
+
+    Socket listenUnix(const std::string&) { throw std::runtime_error("Unix domain sockets are not supported on Windows"); }
+    Socket connectUnix(const std::string&) { throw std::runtime_error("Unix domain sockets are not supported on Windows"); }
+    void sendFds(const Socket&, std::string_view, const std::vector<int>&) {
+        throw std::runtime_error("Descriptor passing is not supported on Windows");
+    }
+    std::string recvFds(const Socket&, std::vector<int>&) {
+        throw std::runtime_error("Descriptor passing is not supported on Windows");
+    }
+    bool peerIsSameUser(const Socket&) { return false; }
+
+#else
+
+    namespace {
+        [[noreturn]] void throwErrno(const char* operation) {
+            throw std::system_error(errno, std::system_category(), operation);
+        }
+
+        sockaddr_un unixAddress(const std::string& path) {
+            sockaddr_un addr{};
+            addr.sun_family = AF_UNIX;
+            if (path.empty() || path.size() >= sizeof(addr.sun_path)) throw std::invalid_argument("Bad Unix socket path: " + path);
+            std::memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+            return addr;
+        }
+
+        Socket unixSocket() {
+            int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+            if (fd < 0) throwErrno("socket(AF_UNIX) failed");
+            return Socket(SocketHandle(fd));
+        }
+
+        int connectTo(const Socket& sock, const std::string& path) {
+            sockaddr_un addr = unixAddress(path);
+            return connect(sock.handle().native_handle(), reinterpret_cast<sockaddr*>(&addr), sizeof(addr));
+        }
+
+        void recvExactly(int fd, char* data, size_t len) {
+            while (len > 0) {
+                ssize_t n = recv(fd, data, len, 0);
+                if (n < 0 && errno == EINTR) continue;
+                if (n < 0) throwErrno("recv() failed");
+                if (n == 0) throw std::runtime_error("Peer closed the channel in the middle of a message");
+                data += n;
+                len -= static_cast<size_t>(n);
+            }
+        }
+    }
+
+    Socket listenUnix(const std::string& path) {
+        sockaddr_un addr = unixAddress(path);
+        Socket sock = unixSocket();
+        if (bind(sock.handle().native_handle(), reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0) {
+            if (errno != EADDRINUSE) throwErrno("bind() failed");
+            if (connectTo(unixSocket(), path) == 0) throw std::runtime_error("Another process is listening on " + path);
+            unlink(path.c_str());
+            if (bind(sock.handle().native_handle(), reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0) throwErrno("bind() failed");
+        }
+        // Before listen(): nobody can connect until only the owner may.
+        if (chmod(path.c_str(), S_IRUSR | S_IWUSR) < 0) throwErrno("chmod() failed");
+        if (listen(sock.handle().native_handle(), 4) < 0) throwErrno("listen() failed");
+        return sock;
+    }
+
+    Socket connectUnix(const std::string& path) {
+        Socket sock = unixSocket();
+        if (connectTo(sock, path) < 0) throwErrno("connect() failed");
+        return sock;
+    }
+
+    void sendFds(const Socket& channel, std::string_view message, const std::vector<int>& fds) {
+        if (fds.size() > kMaxPassedFds) throw std::invalid_argument("Too many descriptors for one message");
+        if (message.empty() || message.size() > Socket::kMaxFrameSize) throw std::invalid_argument("Bad message size");
+
+        uint32_t header = htonl(static_cast<uint32_t>(message.size()));
+        iovec iov[2] = {{&header, sizeof(header)}, {const_cast<char*>(message.data()), message.size()}};
+        alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int) * kMaxPassedFds)] = {};
+        msghdr msg{};
+        msg.msg_iov = iov;
+        msg.msg_iovlen = 2;
+        if (!fds.empty()) {
+            msg.msg_control = control;
+            msg.msg_controllen = CMSG_SPACE(sizeof(int) * fds.size());
+            cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+            cmsg->cmsg_level = SOL_SOCKET;
+            cmsg->cmsg_type = SCM_RIGHTS;
+            cmsg->cmsg_len = CMSG_LEN(sizeof(int) * fds.size());
+            std::memcpy(CMSG_DATA(cmsg), fds.data(), sizeof(int) * fds.size());
+        }
+
+        ssize_t sent;
+        do {
+            sent = sendmsg(channel.handle().native_handle(), &msg, MSG_NOSIGNAL);
+        } while (sent < 0 && errno == EINTR);
+        if (sent < 0) throwErrno("sendmsg() failed");
+
+        // The descriptors travel with the first byte; whatever did not fit goes out as plain data.
+        size_t total = sizeof(header) + message.size();
+        if (static_cast<size_t>(sent) < total) {
+            std::string rest(reinterpret_cast<const char*>(&header), sizeof(header));
+            rest.append(message);
+            channel.sendRaw(rest.data() + sent, total - static_cast<size_t>(sent));
+        }
+    }
+
+    std::string recvFds(const Socket& channel, std::vector<int>& fds) {
+        int fd = channel.handle().native_handle();
+        uint32_t header = 0;
+        iovec iov{&header, sizeof(header)};
+        alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int) * kMaxPassedFds)] = {};
+        msghdr msg{};
+        msg.msg_iov = &iov;
+        msg.msg_iovlen = 1;
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof(control);
+
+        ssize_t got;
+        do {
+            got = recvmsg(fd, &msg, MSG_CMSG_CLOEXEC);
+        } while (got < 0 && errno == EINTR);
+        if (got < 0) throwErrno("recvmsg() failed");
+
+        for (cmsghdr* cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+            if (cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS) continue;
+            size_t count = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+            const auto* data = reinterpret_cast<const unsigned char*>(CMSG_DATA(cmsg));
+            for (size_t i = 0; i < count; ++i) {
+                int passed;
+                std::memcpy(&passed, data + i * sizeof(int), sizeof(int));
+                fds.push_back(passed);
+            }
+        }
+        if (got == 0) return {};
+        if (msg.msg_flags & MSG_CTRUNC) throw std::runtime_error("Too many descriptors in one message");
+
+        recvExactly(fd, reinterpret_cast<char*>(&header) + got, sizeof(header) - static_cast<size_t>(got));
+        uint32_t len = ntohl(header);
+        if (len == 0 || len > Socket::kMaxFrameSize) throw std::runtime_error("Bad message size on the channel");
+        std::string message(len, '\0');
+        recvExactly(fd, message.data(), len);
+        return message;
+    }
+
+    bool peerIsSameUser(const Socket& channel) {
+#if defined(__linux__)
+        ucred peer{};
+        socklen_t len = sizeof(peer);
+        if (getsockopt(channel.handle().native_handle(), SOL_SOCKET, SO_PEERCRED, &peer, &len) < 0) throwErrno("getsockopt(SO_PEERCRED) failed");
+        return peer.uid == geteuid();
+#else
+        uid_t uid = 0;
+        gid_t gid = 0;
+        if (getpeereid(channel.handle().native_handle(), &uid, &gid) < 0) throwErrno("getpeereid() failed");
+        return uid == geteuid();
+#endif
+    }
+
+#endif
+
+}
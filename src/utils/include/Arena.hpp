@@ -0,0 +1,64 @@
+//Copyright (c) 2026 Kaizhi Liu
+//Licensed under the Apache License, Version 2.0.
+
+#pragma once
+
+#include <cstddef>
+#include <format>
+#include <iterator>
+#include <memory_resource>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "BufferPool.hpp"
+
+namespace ref_storage::utils {
+
+    /* Bump allocator for data that lives exactly as long as one request: header text, parsed tokens, replies.
+     * Memory comes in chunks from a BufferPool and is given back all at once by reset(); deallocate() does nothing.
+     * The first chunk is kept across resets, so a request whose scratch fits in it allocates nothing at all.
+     * Usable directly, or as a std::pmr::memory_resource for pmr containers. Not thread-safe.
+     */
+    class Arena final : public std::pmr::memory_resource {
+    public:
+        explicit Arena(BufferPool& pool, size_t chunkSize = BufferPool::kMinClassSize);
+
+        Arena(const Arena&) = delete;
+        Arena& operator=(const Arena&) = delete;
+
+        // A copy of text that stays valid until the next reset().
+        std::string_view copy(std::string_view text);
+
+        // std::format into the arena; the result stays valid until the next reset().
+        template <typename... Args>
+        std::string_view format(std::string_view fmt, const Args&... args) {
+            std::pmr::string text(this);
+            // Past the small-string buffer, so the characters are in the arena rather than in text itself.
+            text.reserve(kFormatReserve);
+            std::vformat_to(std::back_inserter(text), fmt, std::make_format_args(args...));
+            return {text.data(), text.size()};
+        }
+
+        // Forget everything allocated since the last reset, and return all chunks but the first to the pool.
+        void reset() noexcept;
+
+        // Bytes handed out since the last reset, padding included.
+        [[nodiscard]] size_t allocated() const noexcept { return allocated_; }
+
+    private:
+        static constexpr size_t kFormatReserve = 64;
+
+        void* do_allocate(size_t bytes, size_t alignment) override;
+        void do_deallocate(void*, size_t, size_t) override {}
+        bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override { return this == &other; }
+
+        BufferPool& pool_;
+        size_t chunk_size_;
+        BufferPool::Buffer first_;
+        std::vector<BufferPool::Buffer> extra_;
+        char* cur_ = nullptr;
+        char* end_ = nullptr;
+        size_t allocated_ = 0;
+    };
+
+}
@@ -5,50 +5,134 @@
 #define ASYNC_LOGGER_HPP
 
 #include <string>
-#include <fstream>
 #include <mutex>
 #include <condition_variable>
-#include <queue>
 #include <atomic>
+#include <chrono>
+#include <ctime>
+#include <thread>
+#include <memory>
+#include <vector>
 #include <iostream>
 #include <format>
 #include <string_view>
 #include <filesystem>
+#include "MpscRing.hpp"
+#include "LogFormat.hpp"
+#include "LogSink.hpp"
+
+// LOG_* calls below this level are compiled out entirely (0 = Debug ... 4 = Fatal). Override with -DREF_LOG_COMPILE_LEVEL=n.
+#ifndef REF_LOG_COMPILE_LEVEL
+#define REF_LOG_COMPILE_LEVEL 0
+#endif
 
 namespace ref_storage::utils {
 
-    enum class LogLevel {
-        Debug,
-        Info,
-        Warn,
-        Error,
-        Fatal
+    // What a producer does when the ring is full.
+    enum class OverflowPolicy {
+        Block,          // wait for the consumer; nothing is lost
+        Drop,           // discard the record and count it
+        DropDebugFirst  // shed Debug records once the ring is 3/4 full, block for everything else
+    };
+
+    // What the log file contains: formatted lines, or the raw records for storage_log_decode to format offline.
+    enum class LogOutput {
+        Text,
+        Binary
     };
 
-    struct LogEvent {
-        std::string consoleMsg;
-        std::string fileMsg;
+    enum class ConsoleOutput {
+        Off,
+        Buffered,   // left to stdout's buffering, flushed when the logger goes idle
+        Flushed     // flushed after every batch, for interactive runs
+    };
+
+    struct LoggerOptions {
+        LogLevel min_level = LogLevel::Info;
+        OverflowPolicy overflow = OverflowPolicy::Block;
+        // Number of ring slots (rounded up to a power of two), fixed for the life of the process.
+        size_t capacity = 8192;
+        LogOutput output = LogOutput::Text;
+        ConsoleOutput console = ConsoleOutput::Flushed;
+        // Gzip rotated files on a background thread (needs zlib at build time).
+        bool compress_rotated = true;
+        size_t max_file_size = 10 * 1024 * 1024;
+    };
+
+    /* One preallocated ring slot. For LOG_* calls it holds the site id and the encoded arguments; for records
+     * logged with a runtime format string (site 0) it holds the formatted message. Either way the timestamp and
+     * thread id stay raw until the consumer renders them.
+     */
+    struct LogRecord {
+        static constexpr size_t kMaxMessage = 960;
+
+        LogLevel level;
+        int line;
+        const char* file;
+        int64_t steady_ns;
+        uint64_t thread;
+        uint32_t site;
+        uint32_t length;
+        bool truncated;
+        char text[kMaxMessage];
     };
 
     class AsyncLogger {
     public:
+        static constexpr size_t kDrainBatch = 256;
+        static constexpr uint32_t kMaxSites = 4096;
+
         static AsyncLogger& getInstance();
 
-        void init(const std::string& filename, LogLevel minLevel = LogLevel::Info);
+        void init(const std::string& filename, const LoggerOptions& options = {});
         void stop();
         void emergencyFlush();
         void consumeLogs();
 
+        void setOverflowPolicy(OverflowPolicy policy) { m_policy.store(policy, std::memory_order_relaxed); }
+        void setMinLevel(LogLevel level) { m_minLevel.store(level, std::memory_order_relaxed); }
+        [[nodiscard]] uint64_t droppedCount() const { return m_dropped.load(std::memory_order_relaxed); }
+
+        // Give a call site its id; 0 once kMaxSites sites exist, in which case the site falls back to log().
+        static uint32_t registerSite(const LogSite* site);
+
+        // Deferred path behind the LOG_* macros: no formatting on the calling thread.
+        template <typename... Args>
+        void logAt(uint32_t siteId, const LogSite& site, const Args&... args) {
+            if (site.level < m_minLevel.load(std::memory_order_relaxed) || !m_running || !m_ring) return;
+            if (siteId == 0) {
+                log(site.level, site.file, site.line, site.format, args...);
+                return;
+            }
+            uint64_t ticket = 0;
+            LogRecord* record = claimSlot(site.level, ticket);
+            if (!record) return;
+
+            record->level = site.level;
+            record->line = site.line;
+            record->file = site.file;
+            record->steady_ns = steadyNow();
+            record->thread = currentThread();
+            record->site = siteId;
+            LogArgWriter writer(record->text, LogRecord::kMaxMessage);
+            (writer.write(args), ...);
+            record->length = static_cast<uint32_t>(writer.size());
+            record->truncated = writer.truncated();
+
+            m_ring->publish(ticket);
+            wakeConsumer();
+        }
+
         template <typename... Args>
         void log(LogLevel level, const char* file, int line, std::string_view fmt, Args&&... args) {
-            if (level < m_minLevel || !m_running) return;
+            if (level < m_minLevel.load(std::memory_order_relaxed) || !m_running) return;
             std::string message = std::vformat(fmt, std::make_format_args(args...));
             enqueueLog(level, file, line, message);
         }
 
         template <typename... Args>
         void syncLog(LogLevel level, const char* file, int line, std::string_view fmt, Args&&... args) {
-            if (level < m_minLevel) return;
+            if (level < m_minLevel.load(std::memory_order_relaxed)) return;
             std::string message = std::vformat(fmt, std::make_format_args(args...));
             writeSync(level, file, line, message);
         }
@@ -60,33 +144,71 @@ namespace ref_storage::utils {
         AsyncLogger();
         ~AsyncLogger();
 
+        static int64_t steadyNow() {
+            return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+        }
+        // The value std::thread::id prints as, without going through a stream.
+        static uint64_t currentThread();
+
         void enqueueLog(LogLevel level, const char* file, int line, const std::string& message);
+        LogRecord* claimSlot(LogLevel level, uint64_t& ticket);
+        void wakeConsumer();
+        size_t drainBatch(std::string& consoleOut, std::string& fileOut);
+        void formatRecord(const LogRecord& record, std::string& consoleOut, std::string& fileOut);
+        void appendText(LogLevel level, const char* file, int line, int64_t steadyNs, uint64_t thread,
+                        std::string_view message, std::string& consoleOut, std::string* fileOut);
+        void writeBatch(const std::string& consoleOut, const std::string& fileOut);
+        void flushOutputs();
+        std::string binaryHeader();
         void writeSync(LogLevel level, const char* file, int line, const std::string& message);
         void rotateLog();
 
         std::string getTimestamp();
-        std::string levelToString(LogLevel level);
+        std::string formatTimestamp(int64_t steadyNs);
         const char* getLevelColor(LogLevel level);
 
-        LogLevel m_minLevel;
-        std::ofstream m_fileStream;
+        std::atomic<LogLevel> m_minLevel;
+        LogOutput m_output = LogOutput::Text;
+        ConsoleOutput m_console = ConsoleOutput::Flushed;
+        LogFileSink m_sink;
 
-        std::mutex m_mutex;
-        std::condition_variable m_cv;
-        std::queue<LogEvent> m_queue;
+        std::mutex m_mutex;             // serialises writes to the console and the sink
+        std::unique_ptr<MpscRing<LogRecord>> m_ring;
+        std::atomic<OverflowPolicy> m_policy{OverflowPolicy::Block};
+        std::atomic<uint64_t> m_dropped{0};
+        uint64_t m_reportedDrops = 0;
         std::atomic<bool> m_running;
 
+        // The consumer sleeps here only after finding the ring empty; producers skip the lock while it is awake.
+        std::mutex m_wakeMutex;
+        std::condition_variable m_cv;
+        std::atomic<bool> m_consumerIdle{false};
+        std::atomic_flag m_draining = ATOMIC_FLAG_INIT;
+
+        // Records carry steady-clock timestamps; this pair, taken at init, maps them to wall-clock time.
+        int64_t m_wallBase = 0;
+        int64_t m_steadyBase = 0;
+        // Binary output: sites already described in the current file.
+        std::vector<bool> m_sitesWritten;
+
         std::string m_baseFilename;
         size_t m_maxFileSize;
-        size_t m_currentFileSize;
     };
 
 } // namespace ref_storage::utils
 
-#define LOG_DEBUG(fmt, ...) ref_storage::utils::AsyncLogger::getInstance().log(ref_storage::utils::LogLevel::Debug, __FILE__, __LINE__, fmt __VA_OPT__(,) __VA_ARGS__)
-#define LOG_INFO(fmt, ...)  ref_storage::utils::AsyncLogger::getInstance().log(ref_storage::utils::LogLevel::Info,  __FILE__, __LINE__, fmt __VA_OPT__(,) __VA_ARGS__)
-#define LOG_WARN(fmt, ...)  ref_storage::utils::AsyncLogger::getInstance().log(ref_storage::utils::LogLevel::Warn,  __FILE__, __LINE__, fmt __VA_OPT__(,) __VA_ARGS__)
-#define LOG_ERROR(fmt, ...) ref_storage::utils::AsyncLogger::getInstance().log(ref_storage::utils::LogLevel::Error, __FILE__, __LINE__, fmt __VA_OPT__(,) __VA_ARGS__)
+#define REF_LOG_AT(level, fmt, ...) do { \
+    if constexpr (static_cast<int>(level) >= REF_LOG_COMPILE_LEVEL) { \
+        static constexpr ref_storage::utils::LogSite ref_log_site{level, __FILE__, __LINE__, fmt}; \
+        static const uint32_t ref_log_site_id = ref_storage::utils::AsyncLogger::registerSite(&ref_log_site); \
+        ref_storage::utils::AsyncLogger::getInstance().logAt(ref_log_site_id, ref_log_site __VA_OPT__(,) __VA_ARGS__); \
+    } \
+} while(0)
+
+#define LOG_DEBUG(fmt, ...) REF_LOG_AT(ref_storage::utils::LogLevel::Debug, fmt __VA_OPT__(,) __VA_ARGS__)
+#define LOG_INFO(fmt, ...)  REF_LOG_AT(ref_storage::utils::LogLevel::Info,  fmt __VA_OPT__(,) __VA_ARGS__)
+#define LOG_WARN(fmt, ...)  REF_LOG_AT(ref_storage::utils::LogLevel::Warn,  fmt __VA_OPT__(,) __VA_ARGS__)
+#define LOG_ERROR(fmt, ...) REF_LOG_AT(ref_storage::utils::LogLevel::Error, fmt __VA_OPT__(,) __VA_ARGS__)
 
 #define LOG_FATAL(fmt, ...) do { \
     ref_storage::utils::AsyncLogger::getInstance().log(ref_storage::utils::LogLevel::Fatal, __FILE__, __LINE__, fmt __VA_OPT__(,) __VA_ARGS__); \
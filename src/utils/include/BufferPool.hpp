@@ -0,0 +1,101 @@
+//Copyright (c) 2026 Liu Kaizhi
+//Licensed under the Apache License, Version 2.0.
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace ref_storage::utils {
+
+    /* Pool of I/O buffers in power-of-two size classes, with one free list per NUMA node and class.
+     * A buffer is handed out from the free list of the node the calling thread runs on, and goes back to the list
+     * of the node it was allocated on. New buffers are touched page by page by the allocating thread, so under the
+     * kernel's first-touch policy their memory lands on that thread's node. Together with pinned workers
+     * (Affinity::Node or Affinity::Core) this keeps the data path from reading buffers across the socket interconnect.
+     *
+     * Each thread keeps a small cache per class in front of the node lists, so a thread that keeps acquiring and
+     * releasing buffers of one size does not touch a shared lock. Buffers are reference counted: share() hands the
+     * same memory to another owner, and the block returns to the pool when the last reference goes.
+     */
+    class BufferPool {
+    public:
+        static constexpr size_t kMinClassSize = 4096;
+
+        class Buffer {
+        public:
+            Buffer() noexcept = default;
+            Buffer(Buffer&& other) noexcept;
+            Buffer& operator=(Buffer&& other) noexcept;
+            Buffer(const Buffer&) = delete;
+            Buffer& operator=(const Buffer&) = delete;
+            ~Buffer();
+
+            [[nodiscard]] char* data() const noexcept { return m_data; }
+            // The size of the block's class, which may exceed what was asked for.
+            [[nodiscard]] size_t size() const noexcept;
+            [[nodiscard]] int node() const noexcept;
+            explicit operator bool() const noexcept { return m_data != nullptr; }
+
+            // Another reference to the same memory; the block is recycled once every reference is gone.
+            [[nodiscard]] Buffer share() const noexcept;
+            [[nodiscard]] uint32_t useCount() const noexcept;
+
+        private:
+            friend class BufferPool;
+            Buffer(BufferPool* pool, char* data) noexcept : m_pool(pool), m_data(data) {}
+            void release() noexcept;
+
+            BufferPool* m_pool = nullptr;
+            char* m_data = nullptr;
+        };
+
+        // Classes run from kMinClassSize up to maxBlockSize (rounded up to a power of two); maxCachedPerNode bounds
+        // the idle buffers kept per node and class, surplus buffers are freed.
+        explicit BufferPool(size_t maxBlockSize, size_t maxCachedPerNode = 64);
+        ~BufferPool();
+
+        BufferPool(const BufferPool&) = delete;
+        BufferPool& operator=(const BufferPool&) = delete;
+
+        // A buffer of the largest class.
+        [[nodiscard]] Buffer acquire();
+        // A buffer of the smallest class that holds minSize bytes; larger requests get an uncached block of their own.
+        [[nodiscard]] Buffer acquire(size_t minSize);
+
+        [[nodiscard]] size_t blockSize() const noexcept { return m_blockSize; }
+        [[nodiscard]] size_t classCount() const noexcept { return m_classCount; }
+        [[nodiscard]] size_t classSize(size_t cls) const noexcept { return kMinClassSize << cls; }
+        // Idle buffers on a node's free lists, all classes together; thread caches are not counted.
+        [[nodiscard]] size_t cached(size_t node) const;
+
+    private:
+        struct alignas(64) NodeList {
+            mutable std::mutex mutex;
+            std::vector<char*> free;
+        };
+
+        // Per-thread caches in front of the node lists, one per pool and class in use on the thread.
+        // threadCache() is null while the calling thread is being torn down.
+        struct ThreadCache;
+        static ThreadCache* threadCache();
+
+        [[nodiscard]] size_t classFor(size_t size) const noexcept;
+        NodeList& list(int node, size_t cls) { return *m_lists[static_cast<size_t>(node) * m_classCount + cls]; }
+        char* allocate(size_t cls, size_t size, int node);
+        void recycle(char* data) noexcept;
+        void giveBack(char* data, int node, size_t cls) noexcept;
+
+        uint64_t m_id;
+        size_t m_blockSize;
+        size_t m_classCount;
+        size_t m_maxCachedPerNode;
+        size_t m_nodeCount;
+        std::vector<std::unique_ptr<NodeList>> m_lists;     // node-major: [node * classCount + class]
+    };
+
+}
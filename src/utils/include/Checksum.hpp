@@ -0,0 +1,33 @@
+//Copyright (c) 2026 Kaizhi Liu
+//Licensed under the Apache License, Version 2.0.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace ref_storage::utils {
+
+    /* Incremental CRC-32 (IEEE 802.3, reflected polynomial 0xEDB88320).
+     * Uses slicing-by-8 tables so that streaming writers can checksum every chunk
+     * as it arrives without becoming the bottleneck of the data path.
+     * Start with crc = 0 and feed the previous result back in for the next chunk.
+     */
+    class Crc32 {
+    public:
+        [[nodiscard]] static uint32_t update(uint32_t crc, const void* data, size_t len) noexcept;
+
+        /* CRC of the concatenation A||B given crc(A), crc(B) and len(B), without touching the data.
+         * Lets multipart objects get a whole-object checksum from the checksums of their parts.
+         */
+        [[nodiscard]] static uint32_t combine(uint32_t crcA, uint32_t crcB, uint64_t lenB) noexcept;
+
+        void append(const void* data, size_t len) noexcept { m_value = update(m_value, data, len); }
+        [[nodiscard]] uint32_t value() const noexcept { return m_value; }
+        void reset() noexcept { m_value = 0; }
+
+    private:
+        uint32_t m_value = 0;
+    };
+
+}
@@ -0,0 +1,49 @@
+//Copyright (c) 2026 Kaizhi Liu
+//Licensed under the Apache License, Version 2.0.
+
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <utility>
+#include <variant>
+#include <vector>
+
+namespace ref_storage::utils {
+
+    /* A parsed JSON document, enough for configuration files: objects keep their members in file order, numbers
+     * are doubles. The accessors throw std::runtime_error when the value has another type.
+     */
+    class Json {
+    public:
+        enum class Type { Null, Bool, Number, String, Array, Object };
+        using Array = std::vector<Json>;
+        using Object = std::vector<std::pair<std::string, Json>>;
+
+        Json() = default;
+
+        // Throws std::runtime_error with the offset of the first error.
+        static Json parse(std::string_view text);
+
+        [[nodiscard]] Type type() const noexcept { return static_cast<Type>(value_.index()); }
+        [[nodiscard]] bool isNull() const noexcept { return type() == Type::Null; }
+        [[nodiscard]] bool isObject() const noexcept { return type() == Type::Object; }
+
+        [[nodiscard]] bool asBool() const;
+        [[nodiscard]] double asNumber() const;
+        [[nodiscard]] const std::string& asString() const;
+        [[nodiscard]] const Array& asArray() const;
+        [[nodiscard]] const Object& asObject() const;
+
+        // The member named key of an object, or nullptr.
+        [[nodiscard]] const Json* find(std::string_view key) const;
+
+        static const char* typeName(Type type);
+
+    private:
+        class Parser;
+
+        std::variant<std::nullptr_t, bool, double, std::string, Array, Object> value_;
+    };
+
+}
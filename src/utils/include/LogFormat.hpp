@@ -0,0 +1,120 @@
+//Copyright (c) 2026 Kaizhi Liu
+//Licensed under the Apache License, Version 2.0.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <format>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+namespace ref_storage::utils {
+
+    enum class LogLevel {
+        Debug,
+        Info,
+        Warn,
+        Error,
+        Fatal
+    };
+
+    const char* logLevelName(LogLevel level);
+
+    /* A LOG_* call site. Each one is a static constant registered once, so a record only has to carry the site id,
+     * a timestamp and the raw argument bytes; the format string is applied later by the consumer or the decoder.
+     */
+    struct LogSite {
+        LogLevel level;
+        const char* file;
+        int line;
+        std::string_view format;
+    };
+
+    /* Argument encoding: per argument one tag byte followed by the value.
+     * Integers, floating point, bool and char are stored as-is; anything viewable as a string is copied;
+     * other types are formatted with "{}" at the call site and stored as a string.
+     */
+    enum class LogArgTag : uint8_t { Int, UInt, Double, Bool, Char, String };
+
+    class LogArgWriter {
+    public:
+        LogArgWriter(char* buffer, size_t capacity) : begin_(buffer), cur_(buffer), end_(buffer + capacity) {}
+
+        template <typename T>
+        void write(const T& value) {
+            using V = std::remove_cvref_t<T>;
+            if constexpr (std::is_same_v<V, bool>) {
+                putScalar(LogArgTag::Bool, static_cast<uint8_t>(value));
+            } else if constexpr (std::is_same_v<V, char>) {
+                putScalar(LogArgTag::Char, value);
+            } else if constexpr (std::is_integral_v<V> && std::is_signed_v<V>) {
+                putScalar(LogArgTag::Int, static_cast<int64_t>(value));
+            } else if constexpr (std::is_integral_v<V>) {
+                putScalar(LogArgTag::UInt, static_cast<uint64_t>(value));
+            } else if constexpr (std::is_floating_point_v<V>) {
+                putScalar(LogArgTag::Double, static_cast<double>(value));
+            } else if constexpr (std::is_convertible_v<const T&, std::string_view>) {
+                putString(std::string_view(value));
+            } else {
+                putString(std::format("{}", value));
+            }
+        }
+
+        [[nodiscard]] size_t size() const noexcept { return static_cast<size_t>(cur_ - begin_); }
+        [[nodiscard]] bool truncated() const noexcept { return truncated_; }
+
+    private:
+        template <typename S>
+        void putScalar(LogArgTag tag, S value) {
+            if (truncated_ || static_cast<size_t>(end_ - cur_) < 1 + sizeof(S)) { truncated_ = true; return; }
+            *cur_++ = static_cast<char>(tag);
+            std::memcpy(cur_, &value, sizeof(S));
+            cur_ += sizeof(S);
+        }
+
+        // Strings that do not fit are cut short, so the arguments before them are still decodable.
+        void putString(std::string_view text) {
+            if (truncated_ || static_cast<size_t>(end_ - cur_) < 1 + sizeof(uint32_t)) { truncated_ = true; return; }
+            size_t room = static_cast<size_t>(end_ - cur_) - 1 - sizeof(uint32_t);
+            if (text.size() > room) {
+                text = text.substr(0, room);
+                truncated_ = true;
+            }
+            auto len = static_cast<uint32_t>(text.size());
+            *cur_++ = static_cast<char>(LogArgTag::String);
+            std::memcpy(cur_, &len, sizeof(len));
+            cur_ += sizeof(len);
+            std::memcpy(cur_, text.data(), text.size());
+            cur_ += text.size();
+        }
+
+        char* begin_;
+        char* cur_;
+        char* end_;
+        bool truncated_ = false;
+    };
+
+    /* Apply a std::format string to encoded arguments. Replacement fields may carry an index and a format spec;
+     * fields without a matching argument (a record cut short by truncation) are rendered as "{?}".
+     */
+    std::string formatLogArgs(std::string_view format, const char* args, size_t length);
+
+    /* Binary log file layout (little-endian, written by AsyncLogger in LogOutput::Binary mode):
+     *   header  "RSLOG001" u64 wall_clock_ns u64 steady_ns     - once per file, maps steady timestamps to wall time
+     *   'S'     u32 site u8 level u32 line u16 len file u32 len format
+     *                                                          - before the first event of a site in each file
+     *   'E'     u32 site u64 steady_ns u64 thread u8 truncated u32 len args
+     *   'T'     u8 level u64 steady_ns u64 thread u32 line u16 len file u32 len text
+     *                                                          - records logged with a runtime format string
+     */
+    inline constexpr char kBinaryLogMagic[8] = {'R', 'S', 'L', 'O', 'G', '0', '0', '1'};
+
+    template <typename T>
+    void appendBinary(std::string& out, T value) {
+        out.append(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+
+}
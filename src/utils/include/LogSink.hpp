@@ -0,0 +1,74 @@
+//Copyright (c) 2026 Kaizhi Liu
+//Licensed under the Apache License, Version 2.0.
+
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+namespace ref_storage::utils {
+
+    /* Append-only log file behind AsyncLogger.
+     * Data is staged in page-aligned 64 KiB blocks and written with one O_APPEND writev() once kFlushThreshold
+     * bytes are pending, or when the caller flushes (the logger does when its ring runs dry). Rotated files are
+     * handed to a background thread that gzips them (when built with zlib), so rotation costs the writer one
+     * rename() and one open().
+     * Not thread-safe: AsyncLogger serialises access.
+     */
+    class LogFileSink {
+    public:
+        static constexpr size_t kBlockSize = 64 * 1024;
+        static constexpr size_t kFlushThreshold = 256 * 1024;
+
+        LogFileSink() = default;
+        ~LogFileSink();
+
+        LogFileSink(const LogFileSink&) = delete;
+        LogFileSink& operator=(const LogFileSink&) = delete;
+
+        // Open (or create) path for appending. Returns false if the file cannot be opened.
+        bool open(const std::string& path, bool compressRotated);
+        [[nodiscard]] bool isOpen() const noexcept { return fd_ >= 0; }
+        // Bytes in the current file, including what is still staged.
+        [[nodiscard]] size_t size() const noexcept { return size_; }
+
+        void append(std::string_view data);
+        void flush();
+
+        // Flush, move the current file to backupPath, start a new one with `header`, and queue the old one for compression.
+        void rotate(const std::string& backupPath, std::string_view header);
+
+    private:
+        struct BlockDeleter { void operator()(char* p) const noexcept; };
+        using Block = std::unique_ptr<char[], BlockDeleter>;
+
+        bool openFile(bool truncate);
+        void archiveLoop();
+
+        std::string path_;
+        int fd_ = -1;
+        size_t size_ = 0;
+        bool write_failed_ = false;
+
+        std::vector<Block> blocks_;
+        size_t used_blocks_ = 0;     // blocks holding staged data; the last one may be partly filled
+        size_t last_fill_ = 0;
+        size_t pending_ = 0;
+
+        // Background compression of rotated files.
+        bool compress_ = false;
+        std::thread archiver_;
+        std::mutex archive_mutex_;
+        std::condition_variable archive_cv_;
+        std::deque<std::string> archive_queue_;
+        bool archive_stop_ = false;
+    };
+
+}
@@ -0,0 +1,178 @@
+//Copyright (c) 2026 Kaizhi Liu
+//Licensed under the Apache License, Version 2.0.
+
+#pragma once
+
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace ref_storage::utils {
+
+    /* Metrics are sharded so that recording is one relaxed atomic add on a cache line the calling thread rarely
+     * shares: each thread is assigned a shard on first use, and reads sum over the shards.
+     */
+    inline constexpr size_t kMetricShards = 8;
+
+    size_t metricShard() noexcept;
+
+    class Counter {
+    public:
+        void add(uint64_t n = 1) noexcept { shards_[metricShard()].value.fetch_add(n, std::memory_order_relaxed); }
+        [[nodiscard]] uint64_t value() const noexcept;
+
+    private:
+        struct alignas(64) Shard { std::atomic<uint64_t> value{0}; };
+        Shard shards_[kMetricShards];
+    };
+
+    // A value that goes up and down (open connections); a single atomic, since gauges are not written per byte.
+    class Gauge {
+    public:
+        void set(int64_t v) noexcept { value_.store(v, std::memory_order_relaxed); }
+        void add(int64_t n = 1) noexcept { value_.fetch_add(n, std::memory_order_relaxed); }
+        void sub(int64_t n = 1) noexcept { value_.fetch_sub(n, std::memory_order_relaxed); }
+        [[nodiscard]] int64_t value() const noexcept { return value_.load(std::memory_order_relaxed); }
+
+    private:
+        std::atomic<int64_t> value_{0};
+    };
+
+    struct HistogramSnapshot {
+        uint64_t count = 0;
+        uint64_t sum = 0;
+        uint64_t max = 0;
+        std::vector<uint64_t> buckets;
+
+        // Value at or below which `fraction` of the samples fall (upper bound of its bucket, capped by max).
+        [[nodiscard]] uint64_t percentile(double fraction) const;
+        [[nodiscard]] uint64_t mean() const { return count ? sum / count : 0; }
+    };
+
+    /* Log-linear (HDR-style) histogram of non-negative integers, by convention nanoseconds.
+     * Values below 32 are exact; above that every power of two is split into 16 buckets, so any recorded value is
+     * known to within 1/16 (6.25%). Values of 2^44 and more (about 4.9 hours in ns) land in the last bucket.
+     */
+    class Histogram {
+    public:
+        static constexpr unsigned kSubBucketBits = 4;
+        static constexpr unsigned kMaxBits = 44;
+        static constexpr size_t kSubBuckets = size_t{1} << kSubBucketBits;
+        static constexpr size_t kBuckets = 2 * kSubBuckets + (kMaxBits - kSubBucketBits - 1) * kSubBuckets;
+
+        void record(uint64_t value) noexcept {
+            Shard& shard = shards_[metricShard()];
+            shard.buckets[bucketOf(value)].fetch_add(1, std::memory_order_relaxed);
+            shard.sum.fetch_add(value, std::memory_order_relaxed);
+            if (value > shard.max.load(std::memory_order_relaxed)) shard.max.store(value, std::memory_order_relaxed);
+        }
+
+        void record(std::chrono::nanoseconds elapsed) noexcept {
+            record(static_cast<uint64_t>(elapsed.count() > 0 ? elapsed.count() : 0));
+        }
+
+        [[nodiscard]] HistogramSnapshot snapshot() const;
+
+        static constexpr size_t bucketOf(uint64_t value) noexcept {
+            if (value < 2 * kSubBuckets) return static_cast<size_t>(value);
+            unsigned msb = static_cast<unsigned>(std::bit_width(value)) - 1;
+            if (msb >= kMaxBits) return kBuckets - 1;
+            unsigned shift = msb - kSubBucketBits;
+            return 2 * kSubBuckets + (msb - kSubBucketBits - 1) * kSubBuckets + static_cast<size_t>((value >> shift) - kSubBuckets);
+        }
+
+        // Largest value that maps to bucket b.
+        static constexpr uint64_t bucketUpperBound(size_t b) noexcept {
+            if (b < 2 * kSubBuckets) return b;
+            size_t i = b - 2 * kSubBuckets;
+            unsigned shift = static_cast<unsigned>(i / kSubBuckets) + 1;
+            uint64_t lower = static_cast<uint64_t>(kSubBuckets + i % kSubBuckets) << shift;
+            return lower + (uint64_t{1} << shift) - 1;
+        }
+
+    private:
+        struct alignas(64) Shard {
+            std::atomic<uint64_t> sum{0};
+            std::atomic<uint64_t> max{0};
+            std::atomic<uint64_t> buckets[kBuckets]{};
+        };
+        Shard shards_[kMetricShards];
+    };
+
+    // Records the lifetime of the scope into a histogram.
+    class ScopedTimer {
+    public:
+        explicit ScopedTimer(Histogram& histogram) : histogram_(histogram), start_(std::chrono::steady_clock::now()) {}
+        ~ScopedTimer() { histogram_.record(std::chrono::steady_clock::now() - start_); }
+
+        ScopedTimer(const ScopedTimer&) = delete;
+        ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+    private:
+        Histogram& histogram_;
+        std::chrono::steady_clock::time_point start_;
+    };
+
+    enum class MetricKind { Counter, Gauge, Histogram };
+
+    struct MetricSample {
+        std::string name;
+        std::string help;
+        std::string labels;     // preformatted, e.g. op="PUT"; empty for none
+        MetricKind kind;
+        double value = 0;       // counters and gauges
+        HistogramSnapshot histogram;
+    };
+
+    /* Process-wide set of named metrics. Registration takes a lock and returns a reference that stays valid for the
+     * life of the process, so call sites look a metric up once and record through the reference afterwards.
+     * Asking again for the same name and labels returns the same metric.
+     */
+    class MetricsRegistry {
+    public:
+        static MetricsRegistry& global();
+
+        Counter& counter(const std::string& name, const std::string& help, const std::string& labels = {});
+        Gauge& gauge(const std::string& name, const std::string& help, const std::string& labels = {});
+        Histogram& histogram(const std::string& name, const std::string& help, const std::string& labels = {});
+        // A gauge computed when metrics are collected (queue depths, pool size). Replaces an earlier function of the same name and labels.
+        void gaugeFunction(const std::string& name, const std::string& help, const std::string& labels, std::function<double()> fn);
+
+        // Current values, in registration order.
+        [[nodiscard]] std::vector<MetricSample> collect() const;
+
+    private:
+        struct Entry {
+            std::string name;
+            std::string help;
+            std::string labels;
+            MetricKind kind;
+            std::unique_ptr<Counter> counter;
+            std::unique_ptr<Gauge> gauge;
+            std::unique_ptr<Histogram> histogram;
+            std::function<double()> function;
+        };
+
+        Entry& findOrAdd(const std::string& name, const std::string& help, const std::string& labels, MetricKind kind);
+
+        mutable std::mutex mutex_;
+        std::vector<std::unique_ptr<Entry>> entries_;
+    };
+
+    enum class ExpositionFormat { Prometheus, OpenMetrics };
+
+    /* Render samples in the Prometheus text format (0.0.4) or OpenMetrics 1.0 into out, replacing its contents.
+     * Samples of one family are grouped under a single HELP/TYPE header even when they were registered apart.
+     * Histograms are recorded in nanoseconds and exposed in seconds over fixed buckets from 1us to 10s; the HDR
+     * buckets are folded into each `le` bucket whose bound they fall under entirely.
+     */
+    void renderMetrics(const std::vector<MetricSample>& samples, ExpositionFormat format, std::string& out);
+
+}
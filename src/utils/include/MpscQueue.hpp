@@ -0,0 +1,77 @@
+//Copyright (c) 2026 Kaizhi Liu
+//Licensed under the Apache License, Version 2.0.
+
+#pragma once
+
+#include <atomic>
+
+namespace ref_storage::utils {
+
+    // Link field for nodes of an MpscQueue; derive the node type from it.
+    struct MpscNode {
+        std::atomic<MpscNode*> next{nullptr};
+    };
+
+    /* Unbounded intrusive multi-producer single-consumer queue (Dmitry Vyukov's design).
+     * push() is wait-free: one exchange plus one store, and never allocates.
+     * pop() must only be called by one thread at a time; it may transiently report empty while a producer is
+     * between its two steps, in which case that producer has not returned from push() yet.
+     */
+    template <typename Node>
+    class MpscQueue {
+    private:
+        alignas(64) std::atomic<MpscNode*> head;   // producers
+        alignas(64) MpscNode* tail;                // consumer
+        MpscNode stub;
+
+    public:
+        MpscQueue() : head(&stub), tail(&stub) {}
+
+        MpscQueue(const MpscQueue&) = delete;
+        MpscQueue& operator=(const MpscQueue&) = delete;
+
+        void push(Node* node) noexcept { pushNode(node); }
+
+        /* Push the chain first -> ... -> last, already linked through `next`, with a single exchange.
+         * Consumers see the nodes in chain order, contiguous with respect to other producers.
+         */
+        void pushChain(Node* first, Node* last) noexcept {
+            last->next.store(nullptr, std::memory_order_relaxed);
+            MpscNode* prev = head.exchange(last, std::memory_order_acq_rel);
+            prev->next.store(first, std::memory_order_release);
+        }
+
+        Node* pop() noexcept {
+            MpscNode* t = tail;
+            MpscNode* next = t->next.load(std::memory_order_acquire);
+            if (t == &stub) {
+                if (!next) return nullptr;
+                tail = next;
+                t = next;
+                next = next->next.load(std::memory_order_acquire);
+            }
+            if (next) {
+                tail = next;
+                return static_cast<Node*>(t);
+            }
+            if (t != head.load(std::memory_order_acquire)) return nullptr;
+
+            // t is the only node: put the stub back behind it so that t can be handed out.
+            pushNode(&stub);
+            next = t->next.load(std::memory_order_acquire);
+            if (next) {
+                tail = next;
+                return static_cast<Node*>(t);
+            }
+            return nullptr;
+        }
+
+    private:
+        void pushNode(MpscNode* node) noexcept {
+            node->next.store(nullptr, std::memory_order_relaxed);
+            MpscNode* prev = head.exchange(node, std::memory_order_acq_rel);
+            prev->next.store(node, std::memory_order_release);
+        }
+    };
+
+}
@@ -0,0 +1,90 @@
+//Copyright (c) 2026 Kaizhi Liu
+//Licensed under the Apache License, Version 2.0.
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+
+namespace ref_storage::utils {
+
+    /* Bounded multi-producer single-consumer ring of preallocated slots (Dmitry Vyukov's bounded queue).
+     * Records are built in place: a producer claims a slot, fills it and publishes it; the consumer reads the slot
+     * at the front and releases it. Claiming is one CAS on the producer index, and nothing is ever allocated after
+     * construction, so memory stays bounded no matter how far the consumer falls behind.
+     */
+    template <typename Slot>
+    class MpscRing {
+    private:
+        struct Cell {
+            std::atomic<uint64_t> sequence;
+            Slot slot;
+        };
+
+        std::unique_ptr<Cell[]> m_cells;
+        uint64_t m_mask;
+        alignas(64) std::atomic<uint64_t> m_enqueue{0};
+        alignas(64) uint64_t m_dequeue = 0;
+        alignas(64) std::atomic<uint64_t> m_published{0};   // approximate fill level, for policies
+
+    public:
+        // capacity is rounded up to a power of two.
+        explicit MpscRing(size_t capacity) {
+            size_t size = 2;
+            while (size < capacity) size <<= 1;
+            m_cells.reset(new Cell[size]);
+            m_mask = size - 1;
+            for (size_t i = 0; i < size; ++i) m_cells[i].sequence.store(i, std::memory_order_relaxed);
+        }
+
+        MpscRing(const MpscRing&) = delete;
+        MpscRing& operator=(const MpscRing&) = delete;
+
+        [[nodiscard]] size_t capacity() const noexcept { return static_cast<size_t>(m_mask + 1); }
+        [[nodiscard]] size_t size() const noexcept { return static_cast<size_t>(m_published.load(std::memory_order_relaxed)); }
+
+        // Producer: claim a free slot, or nullptr if the ring is full. Pass the returned ticket to publish().
+        Slot* tryClaim(uint64_t& ticket) noexcept {
+            uint64_t pos = m_enqueue.load(std::memory_order_relaxed);
+            while (true) {
+                Cell& cell = m_cells[pos & m_mask];
+                uint64_t seq = cell.sequence.load(std::memory_order_acquire);
+                auto diff = static_cast<int64_t>(seq - pos);
+                if (diff == 0) {
+                    if (m_enqueue.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                        ticket = pos;
+                        return &cell.slot;
+                    }
+                } else if (diff < 0) {
+                    return nullptr;
+                } else {
+                    pos = m_enqueue.load(std::memory_order_relaxed);
+                }
+            }
+        }
+
+        void publish(uint64_t ticket) noexcept {
+            m_published.fetch_add(1, std::memory_order_relaxed);
+            m_cells[ticket & m_mask].sequence.store(ticket + 1, std::memory_order_release);
+        }
+
+        // Consumer: the oldest published slot, or nullptr if there is none.
+        Slot* front() noexcept {
+            Cell& cell = m_cells[m_dequeue & m_mask];
+            uint64_t seq = cell.sequence.load(std::memory_order_acquire);
+            return seq == m_dequeue + 1 ? &cell.slot : nullptr;
+        }
+
+        // Consumer: hand the front slot back to the producers.
+        void pop() noexcept {
+            Cell& cell = m_cells[m_dequeue & m_mask];
+            cell.sequence.store(m_dequeue + m_mask + 1, std::memory_order_release);
+            ++m_dequeue;
+            m_published.fetch_sub(1, std::memory_order_relaxed);
+        }
+    };
+
+}
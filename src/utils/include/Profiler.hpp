@@ -0,0 +1,59 @@
+//Copyright (c) 2026 Kaizhi Liu
+//Licensed under the Apache License, Version 2.0.
+
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace ref_storage::utils {
+
+    struct ProfileReport {
+        // Collapsed stacks, one "thread;outer;...;inner count" line per distinct stack (flamegraph.pl, speedscope).
+        std::string folded;
+        size_t samples = 0;
+        size_t dropped = 0;
+        size_t threads = 0;
+        int hz = 0;
+        std::chrono::milliseconds duration{0};
+        // Functions that were on CPU most often, with their sample counts.
+        std::vector<std::pair<std::string, size_t>> top;
+    };
+
+    /* Sampling CPU profiler for the whole process, driven from the admin console.
+     * start() arms a CPU-time timer on every thread that exists at that moment; each expiry raises SIGPROF on that
+     * thread, whose handler walks the frame pointers into a preallocated sample buffer. Memory is read through
+     * process_vm_readv, so a frame that does not keep its frame pointer ends the walk rather than faulting.
+     * Names come from dladdr(): build with frame pointers and exported symbols (the storage_node target does).
+     * When no profile is running there are no timers and the handler is never entered, so the cost is nil.
+     * Linux only; elsewhere start() throws.
+     */
+    class Profiler {
+    public:
+        static constexpr size_t kMaxFrames = 64;
+        static constexpr size_t kMaxSamples = 1 << 15;
+
+        static Profiler& global();
+
+        // Throws std::runtime_error if a profile is already running or profiling is not supported.
+        void start(int hz = 99);
+        // Stops sampling and aggregates what was collected; throws if no profile is running.
+        ProfileReport stop();
+
+        [[nodiscard]] bool running() const;
+
+    private:
+        Profiler() = default;
+
+        mutable std::mutex mutex_;
+        bool running_ = false;
+        int hz_ = 0;
+        std::chrono::steady_clock::time_point started_;
+        std::vector<void*> timers_;
+    };
+
+}
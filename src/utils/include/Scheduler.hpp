@@ -0,0 +1,119 @@
+//Copyright (c) 2026 Liu Kaizhi
+//Licensed under the Apache License, Version 2.0.
+
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "ThreadPool.hpp"
+#include "UniqueFunction.hpp"
+#include "Metrics.hpp"
+
+namespace ref_storage::utils {
+
+    struct LaneOptions {
+        std::string name;
+        int priority = 0;           // lanes with a higher priority are always dispatched first
+        size_t max_threads = 1;     // tasks of this lane that may run at the same time
+        size_t queue_limit = 1024;  // tasks that may wait; further submissions are rejected
+        uint32_t weight = 1;        // share of dispatches against lanes of the same priority
+    };
+
+    /* QoS layer over a ThreadPool: work is submitted to named lanes instead of to the pool directly.
+     *
+     * Each lane has a thread budget, so a lane whose tasks block for a long time (a client session) can never
+     * occupy the threads reserved for another lane (the admin console). When more lanes have queued work than there
+     * are free threads, the highest priority wins, and lanes of equal priority share the threads in proportion to
+     * their weights (stride scheduling: every dispatch advances the lane's pass by 1/weight and the lowest pass goes
+     * next). A lane that was idle re-enters at the current pass, so it cannot bank credit while idle.
+     *
+     * The scheduler dispatches up to the sum of the lane budgets; if the pool is smaller (an elastic pool that shrank)
+     * the excess waits in the pool, whose supervisor then grows it. The time each task spent queued is recorded
+     * per lane.
+     */
+    class Scheduler {
+    public:
+        using LaneId = size_t;
+
+        struct LaneStats {
+            std::string name;
+            size_t queued = 0;
+            size_t running = 0;
+            uint64_t submitted = 0;
+            uint64_t completed = 0;
+            uint64_t rejected = 0;
+            std::chrono::microseconds queue_avg{0};
+            std::chrono::microseconds queue_p50{0};
+            std::chrono::microseconds queue_p99{0};
+            std::chrono::microseconds queue_max{0};
+        };
+
+        Scheduler(ThreadPool& pool, std::vector<LaneOptions> lanes);
+        ~Scheduler();
+
+        Scheduler(const Scheduler&) = delete;
+        Scheduler& operator=(const Scheduler&) = delete;
+
+        // Lane id by name; throws std::invalid_argument for unknown lanes.
+        [[nodiscard]] LaneId lane(const std::string& name) const;
+
+        // Queue fn on the lane. Returns false (and drops fn) if the lane's queue is full or the scheduler stopped.
+        bool trySubmit(LaneId lane, UniqueFunction<void()> fn);
+
+        [[nodiscard]] std::vector<LaneStats> stats() const;
+
+        // Change a lane's thread budget; running tasks above a lowered budget finish normally.
+        void setThreadBudget(LaneId lane, size_t threads);
+
+        // Threads the pool needs so that every lane can use its full budget at once.
+        [[nodiscard]] static size_t threadsRequired(const std::vector<LaneOptions>& lanes);
+
+    private:
+        using Clock = std::chrono::steady_clock;
+
+        struct Item {
+            UniqueFunction<void()> fn;
+            Clock::time_point queued_at;
+        };
+
+        // Queue-time histogram with power-of-two microsecond buckets.
+        static constexpr size_t kBuckets = 32;
+
+        struct Lane {
+            LaneOptions options;
+            std::deque<Item> queue;
+            size_t running = 0;
+            uint64_t pass = 0;
+            uint64_t stride = 0;
+            uint64_t submitted = 0;
+            uint64_t completed = 0;
+            uint64_t rejected = 0;
+            uint64_t queue_total_us = 0;
+            uint64_t queue_max_us = 0;
+            uint64_t dispatched = 0;
+            std::array<uint64_t, kBuckets> histogram{};
+            Histogram* wait_metric = nullptr;   // the same waits in the metrics registry
+        };
+
+        void dispatchLocked();
+        void runTask(LaneId id, UniqueFunction<void()>& fn);
+        static std::chrono::microseconds percentile(const Lane& lane, double fraction);
+
+        ThreadPool& pool_;
+        std::vector<Lane> lanes_;
+        size_t max_in_flight_;         // sum of the lane budgets; an elastic pool grows to absorb them
+        size_t in_flight_ = 0;
+        uint64_t virtual_time_ = 0;
+        bool stopping_ = false;
+
+        mutable std::mutex mutex_;
+        std::condition_variable idle_cv_;
+    };
+
+}
@@ -0,0 +1,224 @@
+//Copyright (c) 2026 Liu Kaizhi
+//Licensed under the Apache License, Version 2.0.
+
+#pragma once
+
+#include <coroutine>
+#include <cstddef>
+#include <exception>
+#include <optional>
+#include <semaphore>
+#include <utility>
+
+namespace ref_storage::utils {
+
+    /* Allocator for coroutine frames.
+     * Frames are recycled through per-thread free lists of 64-byte size classes, so the frame a handler allocates for
+     * every awaited operation normally comes straight off a list instead of from the global heap.
+     */
+    class FramePool {
+    public:
+        static void* allocate(size_t size);
+        static void deallocate(void* ptr, size_t size) noexcept;
+    };
+
+    template <typename T = void>
+    class Task;
+
+    namespace detail {
+
+        struct TaskPromiseBase {
+            std::coroutine_handle<> continuation = std::noop_coroutine();
+            std::exception_ptr exception;
+
+            struct FinalAwaiter {
+                bool await_ready() const noexcept { return false; }
+                template <typename Promise>
+                std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> h) noexcept {
+                    return h.promise().continuation;   // symmetric transfer back to whoever awaited us
+                }
+                void await_resume() const noexcept {}
+            };
+
+            std::suspend_always initial_suspend() const noexcept { return {}; }
+            FinalAwaiter final_suspend() const noexcept { return {}; }
+            void unhandled_exception() noexcept { exception = std::current_exception(); }
+
+            static void* operator new(size_t size) { return FramePool::allocate(size); }
+            static void operator delete(void* ptr, size_t size) noexcept { FramePool::deallocate(ptr, size); }
+        };
+
+        template <typename T>
+        struct TaskPromise : TaskPromiseBase {
+            std::optional<T> value;
+
+            Task<T> get_return_object() noexcept;
+
+            template <typename U>
+            void return_value(U&& v) { value.emplace(std::forward<U>(v)); }
+
+            T result() {
+                if (exception) std::rethrow_exception(exception);
+                return std::move(*value);
+            }
+        };
+
+        template <>
+        struct TaskPromise<void> : TaskPromiseBase {
+            Task<void> get_return_object() noexcept;
+            void return_void() const noexcept {}
+            void result() const {
+                if (exception) std::rethrow_exception(exception);
+            }
+        };
+
+    }
+
+    /* Lazily started coroutine returning T.
+     * Nothing runs until the task is awaited; the awaiting coroutine is resumed (by symmetric transfer, without
+     * growing the stack) when the task finishes, on whatever thread finished it. Exceptions propagate to the awaiter.
+     */
+    template <typename T>
+    class [[nodiscard]] Task {
+    public:
+        using promise_type = detail::TaskPromise<T>;
+        using Handle = std::coroutine_handle<promise_type>;
+
+        Task() noexcept = default;
+        explicit Task(Handle h) noexcept : handle_(h) {}
+        Task(Task&& other) noexcept : handle_(std::exchange(other.handle_, nullptr)) {}
+        Task& operator=(Task&& other) noexcept {
+            if (this != &other) {
+                if (handle_) handle_.destroy();
+                handle_ = std::exchange(other.handle_, nullptr);
+            }
+            return *this;
+        }
+        Task(const Task&) = delete;
+        Task& operator=(const Task&) = delete;
+        ~Task() {
+            if (handle_) handle_.destroy();
+        }
+
+        auto operator co_await() noexcept {
+            struct Awaiter {
+                Handle handle;
+                bool await_ready() const noexcept { return !handle || handle.done(); }
+                std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept {
+                    handle.promise().continuation = awaiting;
+                    return handle;
+                }
+                T await_resume() { return handle.promise().result(); }
+            };
+            return Awaiter{handle_};
+        }
+
+    private:
+        Handle handle_;
+    };
+
+    namespace detail {
+
+        template <typename T>
+        Task<T> TaskPromise<T>::get_return_object() noexcept {
+            return Task<T>(std::coroutine_handle<TaskPromise<T>>::from_promise(*this));
+        }
+
+        inline Task<void> TaskPromise<void>::get_return_object() noexcept {
+            return Task<void>(std::coroutine_handle<TaskPromise<void>>::from_promise(*this));
+        }
+
+        // Driver for syncWait(): signals a semaphore from its final suspend point.
+        struct BlockingTask {
+            struct promise_type {
+                std::binary_semaphore* done = nullptr;
+
+                BlockingTask get_return_object() noexcept {
+                    return BlockingTask{std::coroutine_handle<promise_type>::from_promise(*this)};
+                }
+                std::suspend_always initial_suspend() const noexcept { return {}; }
+                auto final_suspend() const noexcept {
+                    struct Release {
+                        bool await_ready() const noexcept { return false; }
+                        void await_suspend(std::coroutine_handle<promise_type> h) const noexcept { h.promise().done->release(); }
+                        void await_resume() const noexcept {}
+                    };
+                    return Release{};
+                }
+                void return_void() const noexcept {}
+                void unhandled_exception() const noexcept { std::terminate(); }
+            };
+            std::coroutine_handle<promise_type> handle;
+        };
+
+        template <typename T>
+        BlockingTask runBlocking(Task<T>& task, std::optional<T>& result, std::exception_ptr& error) {
+            try {
+                result.emplace(co_await task);
+            } catch (...) {
+                error = std::current_exception();
+            }
+        }
+
+        inline BlockingTask runBlocking(Task<void>& task, std::exception_ptr& error) {
+            try {
+                co_await task;
+            } catch (...) {
+                error = std::current_exception();
+            }
+        }
+
+        // Driver for spawn(): owns the task and frees itself when it finishes.
+        struct DetachedTask {
+            struct promise_type {
+                DetachedTask get_return_object() const noexcept { return {}; }
+                std::suspend_never initial_suspend() const noexcept { return {}; }
+                std::suspend_never final_suspend() const noexcept { return {}; }
+                void return_void() const noexcept {}
+                void unhandled_exception() const noexcept { std::terminate(); }
+
+                static void* operator new(size_t size) { return FramePool::allocate(size); }
+                static void operator delete(void* ptr, size_t size) noexcept { FramePool::deallocate(ptr, size); }
+            };
+        };
+
+        inline DetachedTask runDetached(Task<void> task) {
+            try {
+                co_await task;
+            } catch (...) {
+                // A detached task has nobody to report to; top-level handlers are expected to catch and log.
+            }
+        }
+
+    }
+
+    // Run a task to completion, blocking the calling thread until it finishes wherever it is resumed.
+    template <typename T>
+    T syncWait(Task<T> task) {
+        std::binary_semaphore done{0};
+        std::exception_ptr error;
+        if constexpr (std::is_void_v<T>) {
+            auto driver = detail::runBlocking(task, error);
+            driver.handle.promise().done = &done;
+            driver.handle.resume();
+            done.acquire();
+            driver.handle.destroy();
+            if (error) std::rethrow_exception(error);
+        } else {
+            std::optional<T> result;
+            auto driver = detail::runBlocking(task, result, error);
+            driver.handle.promise().done = &done;
+            driver.handle.resume();
+            done.acquire();
+            driver.handle.destroy();
+            if (error) std::rethrow_exception(error);
+            return std::move(*result);
+        }
+    }
+
+    // Start a task on the calling thread without waiting for it; its frame is freed when it finishes.
+    inline void spawn(Task<void> task) {
+        detail::runDetached(std::move(task));
+    }
+
+}
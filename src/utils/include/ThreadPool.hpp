@@ -3,60 +3,198 @@
 
 #pragma once
 
+#include <atomic>
+#include <chrono>
 #include <condition_variable>
 #include <thread>
 #include <vector>
-#include <queue>
 #include <functional>
 #include <future>
+#include <memory>
 #include <mutex>
+#include "WorkStealingDeque.hpp"
+#include "MpscQueue.hpp"
+#include "UniqueFunction.hpp"
+#include "Topology.hpp"
 
 namespace ref_storage::utils {
 
+    /* Work-stealing thread pool.
+     * Every worker owns a Chase-Lev deque: tasks submitted from inside the pool go to the submitting worker's
+     * own deque, and idle workers steal from the other end of their peers' deques. Tasks submitted from outside
+     * go through a lock-free injection queue that workers drain in batches. No lock is taken on the submit or
+     * execute path; the only mutex guards parking, which an idle worker only reaches after spinning briefly.
+     * At most half of the CPUs spin at once, and a parked worker is only woken when nobody is spinning.
+     *
+     * post() is the cheap path: the callable goes straight into a recycled task node (inline if it is small), with
+     * no promise, future or extra allocation. enqueue() builds on it for callers that need the result.
+     *
+     * With an Affinity other than None, worker i pins itself as Topology::placement(i) says before taking work.
+     *
+     * An elastic pool (constructed from ElasticOptions) keeps between min_threads and max_threads workers: a
+     * supervisor adds workers when tasks have been waiting with no idle worker for longer than grow_after, and a
+     * worker that stayed parked for idle_timeout exits. Only parked workers exit, and only with an empty deque,
+     * so resizing never disturbs a task in flight.
+     */
     class ThreadPool {
     private:
-        std::vector<std::thread> workers;
-        std::queue< std::packaged_task<void()> > tasks;
+        struct TaskNode : MpscNode {
+            UniqueFunction<void()> fn;
+        };
 
-        std::mutex queue_mutex;
-        std::condition_variable condition;
-        bool stop = false;
+        enum class SlotState { Free, Running, Exited };
+
+        struct Worker {
+            std::thread thread;
+            WorkStealingDeque<TaskNode*> deque;
+            std::atomic<SlotState> state{SlotState::Free};
+        };
+
+        // One slot per possible worker; slots are reused as the pool shrinks and grows.
+        std::vector<std::unique_ptr<Worker>> workers;
+        Affinity affinity;
+
+        MpscQueue<TaskNode> injector;
+        std::atomic<bool> injector_busy{false};      // single-consumer guard for the injection queue
+        std::atomic<int64_t> injected{0};            // tasks currently sitting in the injection queue
+
+        std::mutex park_mutex;
+        std::condition_variable park_condition;
+        std::atomic<size_t> idle{0};
+        std::atomic<size_t> searching{0};            // workers spinning for work; they pick up new tasks unprompted
+        size_t max_searching = 1;
+        size_t wake_tokens = 0;
+        std::atomic<bool> stop{false};
+
+        // Elasticity. live/min/max are read without locks; growth holds resize_mutex, retirement park_mutex.
+        bool elastic = false;
+        std::chrono::milliseconds grow_after{0};
+        std::chrono::milliseconds idle_timeout{0};
+        std::atomic<size_t> live{0};
+        std::atomic<size_t> min_threads{0};
+        std::atomic<size_t> max_threads{0};
+        size_t retire_requests = 0;                  // guarded by park_mutex
+        std::mutex resize_mutex;
+        std::thread supervisor;
+        std::mutex supervisor_mutex;
+        std::condition_variable supervisor_condition;
+
+        // Start workers until `target` (at most max_threads) are live.
+        void startWorkers(size_t target);
+        void supervise();
+        bool tryRetire(bool timed_out);
+
+        void workerLoop(size_t index);
+        TaskNode* findTask(size_t index);
+        TaskNode* takeFromInjector(size_t index);
+        [[nodiscard]] bool hasWork() const;
+        void submit(TaskNode* node);
+        void submitChain(TaskNode* first, TaskNode* last, size_t count);
+        void checkRunning() const;
+
+        // Task nodes are recycled through a small per-thread cache instead of going back to the allocator.
+        struct NodeCache {
+            std::vector<TaskNode*> nodes;
+            ~NodeCache();
+        };
+        static thread_local NodeCache node_cache;
+
+        static TaskNode* acquireNode();
+        static void releaseNode(TaskNode* node) noexcept;
+        void wakeOne();
+        void shutdown();
 
     public:
-        explicit ThreadPool(size_t threads);
+        struct ElasticOptions {
+            size_t min_threads = 1;
+            size_t max_threads = 1;
+            size_t initial_threads = 1;
+            std::chrono::milliseconds grow_after{5};      // queue latency that triggers growth
+            std::chrono::milliseconds idle_timeout{30000}; // parked this long, a worker above the minimum exits
+        };
+
+        // Fixed-size pool.
+        explicit ThreadPool(size_t threads, Affinity affinity = Affinity::None);
+        // Elastic pool.
+        explicit ThreadPool(const ElasticOptions& options, Affinity affinity = Affinity::None);
         ~ThreadPool();
 
+        // Live workers.
+        [[nodiscard]] size_t size() const noexcept { return live.load(std::memory_order_relaxed); }
+        [[nodiscard]] size_t idleWorkers() const noexcept { return idle.load(std::memory_order_relaxed); }
+        [[nodiscard]] size_t minThreads() const noexcept { return min_threads.load(std::memory_order_relaxed); }
+        [[nodiscard]] size_t maxThreads() const noexcept { return max_threads.load(std::memory_order_relaxed); }
+        // Hard upper bound fixed at construction; max_threads can be raised up to it.
+        [[nodiscard]] size_t capacity() const noexcept { return workers.size(); }
+        [[nodiscard]] bool isElastic() const noexcept { return elastic; }
+        // Tasks queued and not yet started; approximate while workers run.
+        [[nodiscard]] size_t pendingTasks() const;
+
+        /* Move the pool to `threads` workers (clamped to the bounds). Growth is immediate; shrinking retires
+         * workers as they go idle. Only meaningful for elastic pools; a fixed pool throws std::logic_error.
+         */
+        void resize(size_t threads);
+        // Change the bounds (max at most capacity()); the pool is moved inside them.
+        void setBounds(size_t min, size_t max);
+
+        // Fire-and-forget submission. Exceptions escaping fn are discarded.
+        template <class F>
+        void post(F&& fn) {
+            checkRunning();
+            TaskNode* node = acquireNode();
+            node->fn = UniqueFunction<void()>(std::forward<F>(fn));
+            submit(node);
+        }
+
+        // Submit every callable in [first, last) with one synchronisation on the shared queue and one wakeup.
+        template <class It>
+        void postBulk(It first, It last) {
+            checkRunning();
+            TaskNode* head = nullptr;
+            TaskNode* tail = nullptr;
+            size_t count = 0;
+            try {
+                for (; first != last; ++first) {
+                    TaskNode* node = acquireNode();
+                    node->fn = UniqueFunction<void()>(std::move(*first));
+                    if (tail) tail->next.store(node, std::memory_order_relaxed);
+                    else head = node;
+                    tail = node;
+                    ++count;
+                }
+            } catch (...) {
+                while (head) {
+                    auto* next = static_cast<TaskNode*>(head->next.load(std::memory_order_relaxed));
+                    releaseNode(head);
+                    head = head == tail ? nullptr : next;
+                }
+                throw;
+            }
+            if (count) submitChain(head, tail, count);
+        }
+
         // Submit Task.
         template <class F, class... Args>
         auto enqueue(F&& f, Args&&... args) -> std::future<std::invoke_result_t<F, Args...>> {
             using return_type = std::invoke_result_t<F, Args...>;
 
             // 创建 promise 和 future
-            auto promise = std::make_shared<std::promise<return_type>>();
-            auto future = promise->get_future();
+            std::promise<return_type> promise;
+            auto future = promise.get_future();
 
             // NOLINT(cert-err58-cpp)
-            auto task = [promise, f = std::forward<F>(f), args = std::make_tuple(std::forward<Args>(args)...)]() mutable {
+            post([promise = std::move(promise), f = std::forward<F>(f), args = std::make_tuple(std::forward<Args>(args)...)]() mutable {
                 try {
                     if constexpr (std::is_void_v<return_type>) {
                         std::apply(f, std::move(args));
-                        promise->set_value();
+                        promise.set_value();
                     } else {
-                        promise->set_value(std::apply(f, std::move(args)));
+                        promise.set_value(std::apply(f, std::move(args)));
                     }
                 } catch (...) {
-                    promise->set_exception(std::current_exception());
+                    promise.set_exception(std::current_exception());
                 }
-            };
-
-            {
-                std::unique_lock<std::mutex> lock(queue_mutex);
-                if (stop) {
-                    throw std::runtime_error("enqueue on stopped ThreadPool");
-                }
-                tasks.emplace(std::move(task));  // tasks 类型为 std::queue<std::function<void()>>
-            }
-            condition.notify_one();
+            });
             return future;
         }
     };
@@ -0,0 +1,61 @@
+//Copyright (c) 2026 Liu Kaizhi
+//Licensed under the Apache License, Version 2.0.
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+namespace ref_storage::utils {
+
+    // How threads are placed on the machine.
+    enum class Affinity {
+        None,   // leave placement to the OS scheduler
+        Node,   // pin each thread to all CPUs of one NUMA node; consecutive threads go round-robin over the nodes
+        Core,   // pin each thread to a single CPU; consecutive threads go round-robin over the nodes
+    };
+
+    [[nodiscard]] Affinity parseAffinity(const std::string& text);   // "none", "node" or "core"
+    [[nodiscard]] const char* affinityName(Affinity affinity);
+
+    struct CpuInfo {
+        int cpu = 0;
+        int core = 0;       // physical core id within the package
+        int package = 0;    // socket
+        int node = 0;       // NUMA node
+    };
+
+    /* CPU and NUMA layout of the machine, read once from sysfs (/sys/devices/system/{cpu,node}).
+     * Where sysfs is not available (Windows, containers that hide it), the machine is reported as a single node
+     * holding hardware_concurrency() CPUs, so callers never need a special case.
+     */
+    class Topology {
+    public:
+        static const Topology& system();
+
+        [[nodiscard]] const std::vector<CpuInfo>& cpus() const noexcept { return cpus_; }
+        [[nodiscard]] size_t nodeCount() const noexcept { return node_cpus_.size(); }
+        [[nodiscard]] const std::vector<int>& cpusOfNode(size_t node) const { return node_cpus_.at(node); }
+        [[nodiscard]] int nodeOfCpu(int cpu) const noexcept;
+
+        // CPUs the index-th thread of a group should be pinned to; empty for Affinity::None.
+        [[nodiscard]] std::vector<int> placement(size_t index, Affinity affinity) const;
+
+        // Node of the CPU the calling thread is running on right now (0 if unknown).
+        [[nodiscard]] int currentNode() const noexcept;
+
+        // Restrict the calling thread to the given CPUs. Returns false if the OS refused.
+        static bool pinCurrentThread(const std::vector<int>& cpus);
+
+        [[nodiscard]] std::string describe() const;
+
+    private:
+        Topology();
+
+        std::vector<CpuInfo> cpus_;
+        std::vector<std::vector<int>> node_cpus_;
+        std::vector<int> cpu_node_;              // indexed by cpu id
+        std::vector<int> interleaved_cpus_;      // cpus ordered node0[0], node1[0], node0[1], ...
+    };
+
+}
@@ -0,0 +1,145 @@
+//Copyright (c) 2026 Kaizhi Liu
+//Licensed under the Apache License, Version 2.0.
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__)
+    #ifdef _MSC_VER
+        #include <intrin.h>
+    #else
+        #include <x86intrin.h>
+    #endif
+    #define REF_STORAGE_HAVE_TSC 1
+#endif
+
+namespace ref_storage::utils {
+
+    /* Cycle counter for stage timestamps: rdtsc where available (a few ns, no syscall), steady_clock elsewhere.
+     * Assumes an invariant TSC that is synchronised across cores, as on every x86 server of the last decade, since a
+     * request may be timed on the event loop and on a pool thread.
+     */
+    class Tsc {
+    public:
+        static uint64_t now() noexcept {
+#ifdef REF_STORAGE_HAVE_TSC
+            return __rdtsc();
+#else
+            return static_cast<uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count());
+#endif
+        }
+
+        // Calibrated against steady_clock on first use (about 10 ms), so call it once at startup.
+        static double nanosPerTick();
+        static uint64_t toNanos(uint64_t ticks) { return static_cast<uint64_t>(static_cast<double>(ticks) * nanosPerTick()); }
+    };
+
+    enum class TraceStage : uint8_t { Parse, Queue, Recv, Storage, Send, Count };
+
+    inline constexpr size_t kTraceStages = static_cast<size_t>(TraceStage::Count);
+
+    const char* traceStageName(TraceStage stage) noexcept;
+
+    /* Where one request spent its time. The span is always in exactly one stage; enter() charges the time since the
+     * last transition to the stage being left, so stages that alternate (body frames received, then written) add up.
+     * One request at a time: a connection reuses its span, and a thread that picks up offloaded work only touches it
+     * while the connection's coroutine is suspended on that work.
+     */
+    class TraceSpan {
+    public:
+        void begin(TraceStage stage = TraceStage::Parse) noexcept {
+            ticks_.fill(0);
+            bytes_ = 0;
+            stage_ = stage;
+            start_ = last_ = Tsc::now();
+        }
+
+        void enter(TraceStage stage) noexcept {
+            uint64_t now = Tsc::now();
+            ticks_[static_cast<size_t>(stage_)] += now - last_;
+            last_ = now;
+            stage_ = stage;
+        }
+
+        void addBytes(uint64_t n) noexcept { bytes_ += n; }
+
+        // Close the current stage; returns the request's total ticks.
+        uint64_t end() noexcept {
+            enter(stage_);
+            return last_ - start_;
+        }
+
+        [[nodiscard]] const std::array<uint64_t, kTraceStages>& ticks() const noexcept { return ticks_; }
+        [[nodiscard]] uint64_t bytes() const noexcept { return bytes_; }
+
+    private:
+        std::array<uint64_t, kTraceStages> ticks_{};
+        uint64_t start_ = 0;
+        uint64_t last_ = 0;
+        uint64_t bytes_ = 0;
+        TraceStage stage_ = TraceStage::Parse;
+    };
+
+    struct TraceOptions {
+        // Requests slower than this are logged with their breakdown; zero disables the slow-request log.
+        std::chrono::microseconds slow_threshold{100'000};
+        // Keep one request in sample_every in the ring (slow requests always go in); zero disables sampling.
+        uint32_t sample_every = 64;
+        size_t ring_capacity = 1024;
+    };
+
+    struct TraceRecord {
+        std::chrono::system_clock::time_point started;
+        const char* op = "";
+        std::string detail;
+        uint64_t total_ns = 0;
+        std::array<uint64_t, kTraceStages> stage_ns{};
+        uint64_t bytes = 0;
+        bool slow = false;
+    };
+
+    /* Process-wide sink for finished spans: the slow-request log plus a fixed-size ring of recent samples.
+     * The common case (fast, not sampled) costs a compare and a thread-local increment; the ring is locked only for
+     * the requests that go into it.
+     */
+    class RequestTracer {
+    public:
+        static RequestTracer& global();
+
+        void configure(const TraceOptions& options);
+        [[nodiscard]] TraceOptions options() const;
+        void setSlowThreshold(std::chrono::microseconds threshold);
+
+        // op must be a string literal; detail (the key, usually) is only copied if the request is kept.
+        void finish(TraceSpan& span, const char* op, std::string_view detail);
+
+        // The most recent records, oldest first.
+        [[nodiscard]] std::vector<TraceRecord> recent(size_t count) const;
+        [[nodiscard]] uint64_t slowCount() const noexcept { return slow_count_; }
+
+    private:
+        RequestTracer();
+
+        void store(TraceRecord&& record);
+
+        mutable std::mutex mutex_;
+        TraceOptions options_;
+        std::vector<TraceRecord> ring_;
+        size_t next_ = 0;
+        size_t stored_ = 0;
+        // Read on every request without the lock.
+        std::atomic<uint64_t> slow_ticks_{0};
+        std::atomic<uint32_t> sample_every_{0};
+        std::atomic<uint64_t> slow_count_{0};
+    };
+
+}
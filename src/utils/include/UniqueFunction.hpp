@@ -0,0 +1,118 @@
+//Copyright (c) 2026 Liu Kaizhi
+//Licensed under the Apache License, Version 2.0.
+
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace ref_storage::utils {
+
+    template <typename Signature>
+    class UniqueFunction;
+
+    /* Move-only replacement for std::function.
+     * Callables up to kInlineSize bytes (a lambda capturing a handful of pointers or a shared_ptr) are stored
+     * inline, so wrapping them never allocates; larger ones fall back to the heap. Being move-only, it can hold
+     * lambdas that capture unique_ptr or promise objects, which std::function cannot.
+     */
+    template <typename R, typename... Args>
+    class UniqueFunction<R(Args...)> {
+    public:
+        static constexpr size_t kInlineSize = 6 * sizeof(void*);
+
+        UniqueFunction() noexcept = default;
+        UniqueFunction(std::nullptr_t) noexcept {}
+
+        template <typename F, typename = std::enable_if_t<!std::is_same_v<std::decay_t<F>, UniqueFunction> &&
+                                                          std::is_invocable_r_v<R, std::decay_t<F>&, Args...>>>
+        UniqueFunction(F&& f) {
+            using Fn = std::decay_t<F>;
+            if constexpr (fitsInline<Fn>()) {
+                ::new (static_cast<void*>(storage_)) Fn(std::forward<F>(f));
+                ops_ = &kInlineOps<Fn>;
+            } else {
+                *reinterpret_cast<Fn**>(storage_) = new Fn(std::forward<F>(f));
+                ops_ = &kHeapOps<Fn>;
+            }
+        }
+
+        UniqueFunction(UniqueFunction&& other) noexcept { moveFrom(other); }
+
+        UniqueFunction& operator=(UniqueFunction&& other) noexcept {
+            if (this != &other) {
+                reset();
+                moveFrom(other);
+            }
+            return *this;
+        }
+
+        UniqueFunction& operator=(std::nullptr_t) noexcept {
+            reset();
+            return *this;
+        }
+
+        UniqueFunction(const UniqueFunction&) = delete;
+        UniqueFunction& operator=(const UniqueFunction&) = delete;
+
+        ~UniqueFunction() { reset(); }
+
+        R operator()(Args... args) {
+            if (!ops_) throw std::bad_function_call();
+            return ops_->invoke(storage_, std::forward<Args>(args)...);
+        }
+
+        explicit operator bool() const noexcept { return ops_ != nullptr; }
+
+    private:
+        struct Ops {
+            R (*invoke)(void*, Args&&...);
+            void (*move)(void* dst, void* src) noexcept;   // move-construct dst from src, then destroy src
+            void (*destroy)(void*) noexcept;
+        };
+
+        template <typename Fn>
+        static constexpr bool fitsInline() {
+            return sizeof(Fn) <= kInlineSize && alignof(Fn) <= alignof(std::max_align_t) &&
+                   std::is_nothrow_move_constructible_v<Fn>;
+        }
+
+        template <typename Fn>
+        static constexpr Ops kInlineOps = {
+            [](void* s, Args&&... args) -> R { return std::invoke(*static_cast<Fn*>(s), std::forward<Args>(args)...); },
+            [](void* dst, void* src) noexcept {
+                ::new (dst) Fn(std::move(*static_cast<Fn*>(src)));
+                static_cast<Fn*>(src)->~Fn();
+            },
+            [](void* s) noexcept { static_cast<Fn*>(s)->~Fn(); },
+        };
+
+        template <typename Fn>
+        static constexpr Ops kHeapOps = {
+            [](void* s, Args&&... args) -> R { return std::invoke(**static_cast<Fn**>(s), std::forward<Args>(args)...); },
+            [](void* dst, void* src) noexcept { *static_cast<Fn**>(dst) = *static_cast<Fn**>(src); },
+            [](void* s) noexcept { delete *static_cast<Fn**>(s); },
+        };
+
+        void moveFrom(UniqueFunction& other) noexcept {
+            if (other.ops_) {
+                other.ops_->move(storage_, other.storage_);
+                ops_ = std::exchange(other.ops_, nullptr);
+            }
+        }
+
+        void reset() noexcept {
+            if (ops_) {
+                ops_->destroy(storage_);
+                ops_ = nullptr;
+            }
+        }
+
+        alignas(std::max_align_t) unsigned char storage_[kInlineSize];
+        const Ops* ops_ = nullptr;
+    };
+
+}
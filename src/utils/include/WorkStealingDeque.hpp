@@ -0,0 +1,116 @@
+//Copyright (c) 2026 Kaizhi Liu
+//Licensed under the Apache License, Version 2.0.
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace ref_storage::utils {
+
+    /* Chase-Lev work-stealing deque (Lê, Pop, Cohen, Zappa Nardelli, "Correct and Efficient Work-Stealing for
+     * Weak Memory Models", PPoPP 2013).
+     * The owning worker pushes and pops at the bottom without any read-modify-write in the common case;
+     * other workers steal from the top with a single CAS. The ring grows on demand; retired rings are kept
+     * until the deque is destroyed because a concurrent thief may still be reading from them.
+     * T must be trivially copyable (the thread pool stores task pointers).
+     */
+    template <typename T>
+    class WorkStealingDeque {
+    private:
+        struct Ring {
+            explicit Ring(int64_t cap) : capacity(cap), mask(cap - 1), slots(new std::atomic<T>[cap]) {}
+
+            T get(int64_t i) const noexcept { return slots[i & mask].load(std::memory_order_relaxed); }
+            void put(int64_t i, T v) noexcept { slots[i & mask].store(v, std::memory_order_relaxed); }
+
+            Ring* grow(int64_t bottom, int64_t top) const {
+                auto* bigger = new Ring(capacity * 2);
+                for (int64_t i = top; i != bottom; ++i) bigger->put(i, get(i));
+                return bigger;
+            }
+
+            int64_t capacity;
+            int64_t mask;
+            std::unique_ptr<std::atomic<T>[]> slots;
+        };
+
+        alignas(64) std::atomic<int64_t> top{0};
+        alignas(64) std::atomic<int64_t> bottom{0};
+        alignas(64) std::atomic<Ring*> ring;
+        std::vector<std::unique_ptr<Ring>> retired;   // touched by the owner only
+
+    public:
+        enum class StealResult { Success, Empty, Abort };
+
+        explicit WorkStealingDeque(int64_t capacity = 256) : ring(new Ring(capacity)) {}
+        ~WorkStealingDeque() { delete ring.load(std::memory_order_relaxed); }
+
+        WorkStealingDeque(const WorkStealingDeque&) = delete;
+        WorkStealingDeque& operator=(const WorkStealingDeque&) = delete;
+
+        // Owner only.
+        void push(T item) {
+            int64_t b = bottom.load(std::memory_order_relaxed);
+            int64_t t = top.load(std::memory_order_acquire);
+            Ring* r = ring.load(std::memory_order_relaxed);
+            if (b - t > r->capacity - 1) {
+                Ring* bigger = r->grow(b, t);
+                retired.emplace_back(r);
+                ring.store(bigger, std::memory_order_release);
+                r = bigger;
+            }
+            r->put(b, item);
+            std::atomic_thread_fence(std::memory_order_release);
+            bottom.store(b + 1, std::memory_order_relaxed);
+        }
+
+        // Owner only. LIFO end: the most recently pushed task is the one most likely to be cache-hot.
+        bool pop(T& out) {
+            int64_t b = bottom.load(std::memory_order_relaxed) - 1;
+            Ring* r = ring.load(std::memory_order_relaxed);
+            bottom.store(b, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            int64_t t = top.load(std::memory_order_relaxed);
+
+            if (t > b) {
+                bottom.store(b + 1, std::memory_order_relaxed);
+                return false;
+            }
+            out = r->get(b);
+            if (t == b) {
+                // Last element: race against thieves for it.
+                bool won = top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+                bottom.store(b + 1, std::memory_order_relaxed);
+                return won;
+            }
+            return true;
+        }
+
+        // Any thread. FIFO end.
+        StealResult steal(T& out) {
+            int64_t t = top.load(std::memory_order_acquire);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            int64_t b = bottom.load(std::memory_order_acquire);
+            if (t >= b) return StealResult::Empty;
+
+            Ring* r = ring.load(std::memory_order_acquire);
+            T item = r->get(t);
+            if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+                return StealResult::Abort;
+            }
+            out = item;
+            return StealResult::Success;
+        }
+
+        // Approximate; exact only when no other thread is operating on the deque.
+        [[nodiscard]] int64_t size() const noexcept {
+            int64_t b = bottom.load(std::memory_order_relaxed);
+            int64_t t = top.load(std::memory_order_relaxed);
+            return b > t ? b - t : 0;
+        }
+    };
+
+}
@@ -0,0 +1,54 @@
+//Copyright (c) 2026 Kaizhi Liu
+//Licensed under the Apache License, Version 2.0.
+
+#include "../include/Arena.hpp"
+#include <cstdint>
+#include <cstring>
+
+namespace ref_storage::utils {
+
+    Arena::Arena(BufferPool& pool, size_t chunkSize)
+        : pool_(pool), chunk_size_(chunkSize), first_(pool.acquire(chunkSize)) {
+        cur_ = first_.data();
+        end_ = cur_ + first_.size();
+    }
+
+    std::string_view Arena::copy(std::string_view text) {
+        if (text.empty()) return {};
+        char* out = static_cast<char*>(allocate(text.size(), 1));
+        std::memcpy(out, text.data(), text.size());
+        return {out, text.size()};
+    }
+
+    void Arena::reset() noexcept {
+        extra_.clear();
+        cur_ = first_.data();
+        end_ = cur_ + first_.size();
+        allocated_ = 0;
+    }
+
+    void* Arena::do_allocate(size_t bytes, size_t alignment) {
+        auto aligned = [alignment](char* p) {
+            auto address = reinterpret_cast<uintptr_t>(p);
+            return reinterpret_cast<char*>((address + alignment - 1) & ~(static_cast<uintptr_t>(alignment) - 1));
+        };
+
+        char* start = aligned(cur_);
+        if (start + bytes > end_) {
+            // Large blocks get a buffer of their own, so they do not waste the rest of the current chunk.
+            if (bytes + alignment > chunk_size_ / 2) {
+                extra_.push_back(pool_.acquire(bytes + alignment));
+                allocated_ += bytes;
+                return aligned(extra_.back().data());
+            }
+            extra_.push_back(pool_.acquire(chunk_size_));
+            cur_ = extra_.back().data();
+            end_ = cur_ + extra_.back().size();
+            start = aligned(cur_);
+        }
+        allocated_ += static_cast<size_t>(start + bytes - cur_);
+        cur_ = start + bytes;
+        return start;
+    }
+
+}
@@ -7,6 +7,12 @@
 #include <sstream>
 #include <csignal>
 #include <thread>
+#include <cstring>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <pthread.h>
+#endif
 
 namespace ref_storage::utils {
 
@@ -18,6 +24,11 @@ namespace ref_storage::utils {
     constexpr const char* COLOR_ERROR = "\033[31m";
     constexpr const char* COLOR_FATAL = "\033[1;31m";
 
+    namespace {
+        std::atomic<const LogSite*> g_sites[AsyncLogger::kMaxSites];
+        std::atomic<uint32_t> g_siteCount{0};
+    }
+
     extern "C" void crashSignalHandler(int signum) {
         AsyncLogger::getInstance().emergencyFlush();
         std::signal(signum, SIG_DFL);
@@ -32,29 +43,45 @@ namespace ref_storage::utils {
     AsyncLogger::AsyncLogger()
         : m_minLevel(LogLevel::Info),
           m_running(false),
-          m_maxFileSize(10 * 1024 * 1024),
-          m_currentFileSize(0) {
+          m_maxFileSize(10 * 1024 * 1024) {
     }
 
     AsyncLogger::~AsyncLogger() {
         stop();
-        if (m_fileStream.is_open()) m_fileStream.close();
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_sink.flush();
+    }
+
+    uint64_t AsyncLogger::currentThread() {
+#ifdef _WIN32
+        return static_cast<uint64_t>(::GetCurrentThreadId());
+#else
+        return static_cast<uint64_t>(::pthread_self());
+#endif
+    }
+
+    uint32_t AsyncLogger::registerSite(const LogSite* site) {
+        uint32_t id = g_siteCount.fetch_add(1, std::memory_order_relaxed) + 1;
+        if (id >= kMaxSites) return 0;
+        g_sites[id].store(site, std::memory_order_release);
+        return id;
     }
 
-    void AsyncLogger::init(const std::string& filename, LogLevel minLevel) {
-        m_minLevel = minLevel;
+    void AsyncLogger::init(const std::string& filename, const LoggerOptions& options) {
+        m_minLevel = options.min_level;
+        m_output = options.output;
         m_baseFilename = filename;
+        m_policy = options.overflow;
+        m_console = options.console;
+        m_maxFileSize = options.max_file_size;
+        if (!m_ring) m_ring = std::make_unique<MpscRing<LogRecord>>(options.capacity);
+        m_wallBase = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+        m_steadyBase = steadyNow();
 
-        m_fileStream.open(m_baseFilename, std::ios::app);
-        if (!m_fileStream.is_open()) {
+        if (!m_sink.open(m_baseFilename, options.compress_rotated)) {
             std::cout << "\n[LOGGER WARNING] Failed to open log file. Disk logging disabled.\n" << std::flush;
-            m_currentFileSize = 0;
-        } else {
-            try {
-                m_currentFileSize = static_cast<size_t>(std::filesystem::file_size(m_baseFilename));
-            } catch (const std::filesystem::filesystem_error&) {
-                m_currentFileSize = 0;
-            }
+        } else if (m_output == LogOutput::Binary) {
+            m_sink.append(binaryHeader());
         }
 
         std::signal(SIGSEGV, crashSignalHandler);
@@ -65,33 +92,40 @@ namespace ref_storage::utils {
         m_running = true;
     }
 
+    std::string AsyncLogger::binaryHeader() {
+        // Every file (and every run appending to one) starts with a header; site ids are only valid after it.
+        std::string header(kBinaryLogMagic, sizeof(kBinaryLogMagic));
+        appendBinary(header, m_wallBase);
+        appendBinary(header, m_steadyBase);
+        m_sitesWritten.assign(kMaxSites, false);
+        return header;
+    }
+
     void AsyncLogger::stop() {
         if (m_running) {
             m_running = false;
+            std::lock_guard<std::mutex> lock(m_wakeMutex);
             m_cv.notify_all();
         }
     }
 
     std::string AsyncLogger::getTimestamp() {
-        auto now = std::chrono::system_clock::now();
-        auto now_c = std::chrono::system_clock::to_time_t(now);
-        auto now_ms = std::chrono::duration_cast<std::chrono::milliseconds>(now.time_since_epoch()) % 1000;
-
-        std::stringstream ss;
-        ss << std::put_time(std::localtime(&now_c), "%Y-%m-%d %H:%M:%S")
-           << '.' << std::setfill('0') << std::setw(3) << now_ms.count();
-        return ss.str();
+        return formatTimestamp(steadyNow());
     }
 
-    std::string AsyncLogger::levelToString(LogLevel level) {
-        switch (level) {
-            case LogLevel::Debug: return "DEBUG";
-            case LogLevel::Info:  return "INFO ";
-            case LogLevel::Warn:  return "WARN ";
-            case LogLevel::Error: return "ERROR";
-            case LogLevel::Fatal: return "FATAL";
-            default: return "UNKNOWN";
+    std::string AsyncLogger::formatTimestamp(int64_t steadyNs) {
+        // localtime() once per second per thread; the consumer formats records in timestamp order.
+        thread_local std::time_t cached_second = -1;
+        thread_local std::string cached_text;
+        int64_t wall_ns = m_wallBase + (steadyNs - m_steadyBase);
+        auto second = static_cast<std::time_t>(wall_ns / 1000000000);
+        if (second != cached_second) {
+            std::stringstream ss;
+            ss << std::put_time(std::localtime(&second), "%Y-%m-%d %H:%M:%S");
+            cached_text = ss.str();
+            cached_second = second;
         }
+        return std::format("{}.{:03}", cached_text, (wall_ns / 1000000) % 1000);
     }
 
     const char* AsyncLogger::getLevelColor(LogLevel level) {
@@ -106,99 +140,220 @@ namespace ref_storage::utils {
     }
 
     void AsyncLogger::rotateLog() {
-        if (m_fileStream.is_open()) m_fileStream.close();
-
         std::string timestamp = getTimestamp();
         for (char &c : timestamp) if (c == ' ' || c == ':' || c == '.') c = '_';
 
         std::string backupName = m_baseFilename + "." + timestamp + ".bak";
-        try { std::filesystem::rename(m_baseFilename, backupName); }
-        catch (...) { /* 忽略重命名失败 */ }
+        m_sink.rotate(backupName, m_output == LogOutput::Binary ? binaryHeader() : std::string());
+    }
+
+    LogRecord* AsyncLogger::claimSlot(LogLevel level, uint64_t& ticket) {
+        OverflowPolicy policy = m_policy.load(std::memory_order_relaxed);
+        bool expendable = policy == OverflowPolicy::Drop || (policy == OverflowPolicy::DropDebugFirst && level == LogLevel::Debug);
+        if (policy == OverflowPolicy::DropDebugFirst && level == LogLevel::Debug &&
+            m_ring->size() >= m_ring->capacity() / 4 * 3) {
+            m_dropped.fetch_add(1, std::memory_order_relaxed);
+            return nullptr;
+        }
 
-        m_fileStream.open(m_baseFilename, std::ios::out | std::ios::trunc);
-        m_currentFileSize = 0;
+        for (int attempt = 0;; ++attempt) {
+            if (LogRecord* record = m_ring->tryClaim(ticket)) return record;
+            if (expendable || !m_running) {
+                m_dropped.fetch_add(1, std::memory_order_relaxed);
+                return nullptr;
+            }
+            // Block: the consumer is behind, make sure it is awake and back off.
+            wakeConsumer();
+            if (attempt < 64) std::this_thread::yield();
+            else std::this_thread::sleep_for(std::chrono::microseconds(50));
+        }
+    }
+
+    void AsyncLogger::wakeConsumer() {
+        // Pairs with the fence in consumeLogs(): either the consumer sees the published slot or we see it idle.
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (m_consumerIdle.load(std::memory_order_relaxed)) {
+            std::lock_guard<std::mutex> lock(m_wakeMutex);
+            m_cv.notify_one();
+        }
     }
 
     void AsyncLogger::enqueueLog(LogLevel level, const char* file, int line, const std::string& message) {
-        std::string timestamp = getTimestamp();
-        std::stringstream ss;
-        ss << std::this_thread::get_id();
-        std::string threadId = ss.str();
+        if (!m_ring) return;
+        uint64_t ticket = 0;
+        LogRecord* record = claimSlot(level, ticket);
+        if (!record) return;
+
+        record->level = level;
+        record->line = line;
+        record->file = file;
+        record->steady_ns = steadyNow();
+        record->thread = currentThread();
+        record->site = 0;
+        record->truncated = message.size() > LogRecord::kMaxMessage;
+        record->length = static_cast<uint32_t>(record->truncated ? LogRecord::kMaxMessage : message.size());
+        std::memcpy(record->text, message.data(), record->length);
 
-        std::string fileMsg = std::format("[T:{}] [{}] [{}] [{}:{}] {}\n",
-                                          threadId, timestamp, levelToString(level), file, line, message);
+        m_ring->publish(ticket);
+        wakeConsumer();
+    }
 
-        std::string consoleMsg = std::format("[{}T:{}{}] [{}{}{}] [{}{}{}] [{}:{}] {}\n",
-            COLOR_CYAN, threadId, COLOR_RESET, COLOR_CYAN, timestamp, COLOR_RESET,
-            getLevelColor(level), levelToString(level), COLOR_RESET, file, line, message);
+    void AsyncLogger::appendText(LogLevel level, const char* file, int line, int64_t steadyNs, uint64_t thread,
+                                 std::string_view message, std::string& consoleOut, std::string* fileOut) {
+        std::string timestamp = formatTimestamp(steadyNs);
+        if (m_console != ConsoleOutput::Off) consoleOut += std::format("[{}T:{}{}] [{}{}{}] [{}{}{}] [{}:{}] {}\n",
+            COLOR_CYAN, thread, COLOR_RESET, COLOR_CYAN, timestamp, COLOR_RESET,
+            getLevelColor(level), logLevelName(level), COLOR_RESET, file, line, message);
 
-        {
-            std::lock_guard<std::mutex> lock(m_mutex);
-            m_queue.push({std::move(consoleMsg), std::move(fileMsg)});
+        if (!fileOut) return;
+        if (m_output == LogOutput::Text) {
+            *fileOut += std::format("[T:{}] [{}] [{}] [{}:{}] {}\n", thread, timestamp, logLevelName(level), file, line, message);
+        } else {
+            std::string_view file_name(file);
+            *fileOut += 'T';
+            appendBinary(*fileOut, static_cast<uint8_t>(level));
+            appendBinary(*fileOut, steadyNs);
+            appendBinary(*fileOut, thread);
+            appendBinary(*fileOut, static_cast<uint32_t>(line));
+            appendBinary(*fileOut, static_cast<uint16_t>(file_name.size()));
+            fileOut->append(file_name);
+            appendBinary(*fileOut, static_cast<uint32_t>(message.size()));
+            fileOut->append(message);
         }
-        m_cv.notify_one();
     }
 
-    void AsyncLogger::writeSync(LogLevel level, const char* file, int line, const std::string& message) {
-        std::string timestamp = getTimestamp();
-        std::stringstream ss;
-        ss << std::this_thread::get_id();
+    void AsyncLogger::formatRecord(const LogRecord& record, std::string& consoleOut, std::string& fileOut) {
+        const LogSite* site = record.site ? g_sites[record.site].load(std::memory_order_acquire) : nullptr;
+        if (!site) {
+            std::string_view message(record.text, record.length);
+            std::string marked;
+            if (record.truncated) message = marked = std::string(message) + "...[truncated]";
+            appendText(record.level, record.file, record.line, record.steady_ns, record.thread, message, consoleOut, &fileOut);
+            return;
+        }
 
-        std::string fileMsg = std::format("[T:{}] [{}] [{}] [{}:{}] {}\n",
-                                          ss.str(), timestamp, levelToString(level), file, line, message);
-        std::string consoleMsg = std::format("[{}T:{}{}] [{}{}{}] [{}{}{}] [{}:{}] {}\n",
-            COLOR_CYAN, ss.str(), COLOR_RESET, COLOR_CYAN, timestamp, COLOR_RESET,
-            getLevelColor(level), levelToString(level), COLOR_RESET, file, line, message);
+        std::string message = formatLogArgs(site->format, record.text, record.length);
+        if (record.truncated) message += "...[truncated]";
 
-        std::lock_guard<std::mutex> lock(m_mutex);
-        std::cout << consoleMsg << std::flush;
+        if (m_output == LogOutput::Text) {
+            appendText(record.level, record.file, record.line, record.steady_ns, record.thread, message, consoleOut, &fileOut);
+            return;
+        }
+
+        // Binary: the console still gets text, the file gets the site (once per file) and the raw arguments.
+        appendText(record.level, record.file, record.line, record.steady_ns, record.thread, message, consoleOut, nullptr);
+
+        if (!m_sitesWritten[record.site]) {
+            std::string_view file_name(site->file);
+            fileOut += 'S';
+            appendBinary(fileOut, record.site);
+            appendBinary(fileOut, static_cast<uint8_t>(site->level));
+            appendBinary(fileOut, static_cast<uint32_t>(site->line));
+            appendBinary(fileOut, static_cast<uint16_t>(file_name.size()));
+            fileOut.append(file_name);
+            appendBinary(fileOut, static_cast<uint32_t>(site->format.size()));
+            fileOut.append(site->format);
+            m_sitesWritten[record.site] = true;
+        }
+        fileOut += 'E';
+        appendBinary(fileOut, record.site);
+        appendBinary(fileOut, record.steady_ns);
+        appendBinary(fileOut, record.thread);
+        appendBinary(fileOut, static_cast<uint8_t>(record.truncated));
+        appendBinary(fileOut, record.length);
+        fileOut.append(record.text, record.length);
+    }
+
+    size_t AsyncLogger::drainBatch(std::string& consoleOut, std::string& fileOut) {
+        size_t count = 0;
+        while (count < kDrainBatch) {
+            LogRecord* record = m_ring->front();
+            if (!record) break;
+            formatRecord(*record, consoleOut, fileOut);
+            m_ring->pop();
+            ++count;
+        }
 
-        if (m_fileStream.is_open()) {
-            m_fileStream << fileMsg;
-            m_fileStream.flush();
-            m_currentFileSize += fileMsg.size();
-            if (m_currentFileSize >= m_maxFileSize) rotateLog();
+        uint64_t dropped = m_dropped.load(std::memory_order_relaxed);
+        if (dropped != m_reportedDrops) {
+            std::string note = std::format("{} log records dropped, ring full.", dropped - m_reportedDrops);
+            appendText(LogLevel::Warn, "logger", 0, steadyNow(), currentThread(), note, consoleOut, &fileOut);
+            m_reportedDrops = dropped;
         }
+        return count;
+    }
+
+    void AsyncLogger::writeBatch(const std::string& consoleOut, const std::string& fileOut) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!consoleOut.empty()) {
+            std::cout.write(consoleOut.data(), static_cast<std::streamsize>(consoleOut.size()));
+            if (m_console == ConsoleOutput::Flushed) std::cout.flush();
+        }
+        if (m_sink.isOpen()) {
+            m_sink.append(fileOut);
+            if (m_sink.size() >= m_maxFileSize) rotateLog();
+        }
+    }
+
+    void AsyncLogger::flushOutputs() {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_sink.flush();
+        if (m_console != ConsoleOutput::Off) std::cout.flush();
+    }
+
+    void AsyncLogger::writeSync(LogLevel level, const char* file, int line, const std::string& message) {
+        std::string consoleOut, fileOut;
+        std::lock_guard<std::mutex> lock(m_mutex);
+        appendText(level, file, line, steadyNow(), currentThread(), message, consoleOut, &fileOut);
+        std::cout << consoleOut << std::flush;
+
+        // Rotation is left to the consumer, which knows which binary sites the current file already describes.
+        m_sink.append(fileOut);
+        m_sink.flush();
     }
 
     void AsyncLogger::consumeLogs() {
-        std::queue<LogEvent> localQueue;
-        while (m_running || !m_queue.empty()) {
-            {
-                std::unique_lock<std::mutex> lock(m_mutex);
-                m_cv.wait(lock, [this]{ return !m_queue.empty() || !m_running; });
-                if (m_queue.empty() && !m_running) break;
-                localQueue.swap(m_queue);
+        if (!m_ring) return;
+        std::string consoleOut, fileOut;
+        while (m_draining.test_and_set(std::memory_order_acquire)) std::this_thread::yield();
+        while (true) {
+            consoleOut.clear();
+            fileOut.clear();
+            if (drainBatch(consoleOut, fileOut) > 0 || !fileOut.empty()) {
+                writeBatch(consoleOut, fileOut);
+                continue;
             }
+            // The ring ran dry: push out what the sink has staged before sleeping.
+            flushOutputs();
+            if (!m_running) break;
 
-            bool wroteAnything = false;
-            while (!localQueue.empty()) {
-                const auto& event = localQueue.front();
-                std::cout << event.consoleMsg << std::flush;
-                if (m_fileStream.is_open()) {
-                    m_fileStream << event.fileMsg;
-                    m_currentFileSize += event.fileMsg.size();
-                    if (m_currentFileSize >= m_maxFileSize) rotateLog();
-                }
-                localQueue.pop();
-                wroteAnything = true;
+            // Nothing to write: give up the ring (emergencyFlush may drain it meanwhile) and sleep until a producer
+            // publishes. The timeout only guards against a producer that died between publish and wake.
+            m_draining.clear(std::memory_order_release);
+            {
+                std::unique_lock<std::mutex> lock(m_wakeMutex);
+                m_consumerIdle.store(true, std::memory_order_relaxed);
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                if (m_running && m_ring->front() == nullptr) m_cv.wait_for(lock, std::chrono::milliseconds(100));
+                m_consumerIdle.store(false, std::memory_order_relaxed);
             }
-            if (wroteAnything && m_fileStream.is_open()) m_fileStream.flush();
+            while (m_draining.test_and_set(std::memory_order_acquire)) std::this_thread::yield();
         }
+        m_draining.clear(std::memory_order_release);
     }
 
     void AsyncLogger::emergencyFlush() {
-        if (m_mutex.try_lock()) {
-            while (!m_queue.empty()) {
-                std::cout << m_queue.front().consoleMsg << std::flush;
-                if (m_fileStream.is_open()) m_fileStream << m_queue.front().fileMsg;
-                m_queue.pop();
-            }
-            m_mutex.unlock();
-        }
-        if (m_fileStream.is_open()) {
-            m_fileStream << "\n--- CRASH INTERCEPTED ---\n";
-            m_fileStream.flush();
+        // Best effort: only drain when the consumer is not in the middle of a batch, and never block on it.
+        if (m_ring && !m_draining.test_and_set(std::memory_order_acquire)) {
+            std::string consoleOut, fileOut;
+            while (drainBatch(consoleOut, fileOut) > 0) {}
+            std::cout << consoleOut << std::flush;
+            m_sink.append(fileOut);
+            m_draining.clear(std::memory_order_release);
         }
+        std::string consoleOut, fileOut;
+        appendText(LogLevel::Fatal, "logger", 0, steadyNow(), currentThread(), "--- CRASH INTERCEPTED ---", consoleOut, &fileOut);
+        m_sink.append(fileOut);
+        m_sink.flush();
     }
 } // namespace ref_storage::utils
\ No newline at end of file
@@ -0,0 +1,298 @@
+//Copyright (c) 2026 Liu Kaizhi
+//Licensed under the Apache License, Version 2.0.
+
+#include "../include/BufferPool.hpp"
+#include "../include/Topology.hpp"
+#include <algorithm>
+#include <bit>
+#include <new>
+#include <stdexcept>
+#include <unordered_set>
+#include <utility>
+
+namespace ref_storage::utils {
+
+    namespace {
+        constexpr size_t kPageSize = 4096;
+        constexpr uint32_t kOversized = UINT32_MAX;
+        // A thread caches up to this many bytes (and at most kMagazineSlots buffers) per pool and class.
+        constexpr size_t kMagazineBytes = 256 * 1024;
+        constexpr uint32_t kMagazineSlots = 16;
+
+        // Sits in front of every block, so a bare data pointer finds its class, node and reference count.
+        struct alignas(64) BlockHeader {
+            std::atomic<uint32_t> refs{1};
+            uint32_t cls = 0;
+            int32_t node = 0;
+            size_t size = 0;
+        };
+        static_assert(sizeof(BlockHeader) == 64);
+
+        BlockHeader* header(char* data) noexcept {
+            return reinterpret_cast<BlockHeader*>(data - sizeof(BlockHeader));
+        }
+
+        void freeBlock(char* data) noexcept {
+            BlockHeader* block = header(data);
+            block->~BlockHeader();
+            ::operator delete(block, std::align_val_t{alignof(BlockHeader)});
+        }
+
+        // Pools that are still alive, so that a thread exiting after a pool was destroyed frees its cached
+        // blocks instead of handing them back. Leaked on purpose: thread caches may outlive static destruction.
+        struct PoolRegistry {
+            std::mutex mutex;
+            std::unordered_set<uint64_t> live;
+            std::atomic<uint64_t> next_id{1};
+        };
+
+        PoolRegistry& registry() {
+            static auto* instance = new PoolRegistry();
+            return *instance;
+        }
+
+        thread_local bool t_cacheTornDown = false;
+    }
+
+    struct BufferPool::ThreadCache {
+        struct Magazine {
+            BufferPool* pool;
+            uint64_t pool_id;
+            size_t cls;
+            int node = -1;              // node of the cached blocks; -1 until the first one arrives
+            uint32_t capacity;
+            uint32_t count = 0;
+            char* blocks[kMagazineSlots];
+        };
+
+        std::vector<Magazine> magazines;
+
+        ~ThreadCache() {
+            t_cacheTornDown = true;
+            std::lock_guard<std::mutex> lock(registry().mutex);
+            for (Magazine& mag : magazines) {
+                if (registry().live.count(mag.pool_id)) {
+                    spill(mag, 0);
+                } else {
+                    for (uint32_t i = 0; i < mag.count; ++i) freeBlock(mag.blocks[i]);
+                }
+            }
+        }
+
+        Magazine* find(BufferPool* pool, size_t cls) noexcept {
+            for (Magazine& mag : magazines) {
+                if (mag.pool == pool && mag.pool_id == pool->m_id && mag.cls == cls) return &mag;
+            }
+            // A magazine left behind by a destroyed pool at the same address is reused; its blocks are freed.
+            for (Magazine& mag : magazines) {
+                if (mag.pool == pool && mag.cls == cls) {
+                    for (uint32_t i = 0; i < mag.count; ++i) freeBlock(mag.blocks[i]);
+                    mag = makeMagazine(pool, cls);
+                    return &mag;
+                }
+            }
+            try {
+                return &magazines.emplace_back(makeMagazine(pool, cls));
+            } catch (...) {
+                return nullptr;
+            }
+        }
+
+        // Hand all but keep blocks back to the node's list under one lock; the list's surplus is freed.
+        static void spill(Magazine& mag, uint32_t keep) noexcept {
+            if (mag.count <= keep) return;
+            NodeList& list = mag.pool->list(mag.node, mag.cls);
+            std::lock_guard<std::mutex> lock(list.mutex);
+            while (mag.count > keep) {
+                char* data = mag.blocks[--mag.count];
+                if (list.free.size() < mag.pool->m_maxCachedPerNode) {
+                    try {
+                        list.free.push_back(data);
+                        continue;
+                    } catch (...) {}
+                }
+                freeBlock(data);
+            }
+        }
+
+        static Magazine makeMagazine(BufferPool* pool, size_t cls) {
+            auto capacity = static_cast<uint32_t>(std::clamp<size_t>(kMagazineBytes / pool->classSize(cls), 1, kMagazineSlots));
+            return Magazine{pool, pool->m_id, cls, -1, capacity, 0, {}};
+        }
+    };
+
+    BufferPool::ThreadCache* BufferPool::threadCache() {
+        if (t_cacheTornDown) return nullptr;
+        thread_local ThreadCache cache;
+        return &cache;
+    }
+
+    BufferPool::Buffer::Buffer(Buffer&& other) noexcept
+        : m_pool(std::exchange(other.m_pool, nullptr)),
+          m_data(std::exchange(other.m_data, nullptr)) {}
+
+    BufferPool::Buffer& BufferPool::Buffer::operator=(Buffer&& other) noexcept {
+        if (this != &other) {
+            release();
+            m_pool = std::exchange(other.m_pool, nullptr);
+            m_data = std::exchange(other.m_data, nullptr);
+        }
+        return *this;
+    }
+
+    BufferPool::Buffer::~Buffer() { release(); }
+
+    size_t BufferPool::Buffer::size() const noexcept { return m_data ? header(m_data)->size : 0; }
+
+    int BufferPool::Buffer::node() const noexcept { return m_data ? header(m_data)->node : 0; }
+
+    BufferPool::Buffer BufferPool::Buffer::share() const noexcept {
+        if (!m_data) return {};
+        header(m_data)->refs.fetch_add(1, std::memory_order_relaxed);
+        return Buffer(m_pool, m_data);
+    }
+
+    uint32_t BufferPool::Buffer::useCount() const noexcept {
+        return m_data ? header(m_data)->refs.load(std::memory_order_relaxed) : 0;
+    }
+
+    void BufferPool::Buffer::release() noexcept {
+        if (m_data && header(m_data)->refs.fetch_sub(1, std::memory_order_acq_rel) == 1) m_pool->recycle(m_data);
+        m_data = nullptr;
+        m_pool = nullptr;
+    }
+
+    BufferPool::BufferPool(size_t maxBlockSize, size_t maxCachedPerNode)
+        : m_id(registry().next_id.fetch_add(1)), m_maxCachedPerNode(maxCachedPerNode),
+          m_nodeCount(std::max<size_t>(Topology::system().nodeCount(), 1)) {
+        if (maxBlockSize == 0) throw std::invalid_argument("Buffer pool block size must be positive");
+        m_classCount = classFor(maxBlockSize) + 1;
+        m_blockSize = classSize(m_classCount - 1);
+        for (size_t i = 0; i < m_nodeCount * m_classCount; ++i) m_lists.push_back(std::make_unique<NodeList>());
+        std::lock_guard<std::mutex> lock(registry().mutex);
+        registry().live.insert(m_id);
+    }
+
+    BufferPool::~BufferPool() {
+        {
+            std::lock_guard<std::mutex> lock(registry().mutex);
+            registry().live.erase(m_id);
+        }
+        // This thread's cached blocks can go right away; other threads free theirs when they exit.
+        if (ThreadCache* cache = threadCache()) {
+            for (auto& mag : cache->magazines) {
+                if (mag.pool != this || mag.pool_id != m_id) continue;
+                for (uint32_t i = 0; i < mag.count; ++i) freeBlock(mag.blocks[i]);
+                mag.count = 0;
+            }
+        }
+        for (auto& list : m_lists) {
+            for (char* data : list->free) freeBlock(data);
+        }
+    }
+
+    size_t BufferPool::classFor(size_t size) const noexcept {
+        if (size <= kMinClassSize) return 0;
+        return static_cast<size_t>(std::bit_width(size - 1)) - static_cast<size_t>(std::bit_width(kMinClassSize - 1));
+    }
+
+    char* BufferPool::allocate(size_t cls, size_t size, int node) {
+        void* raw = ::operator new(sizeof(BlockHeader) + size, std::align_val_t{alignof(BlockHeader)});
+        auto* block = new (raw) BlockHeader();
+        block->cls = cls < m_classCount ? static_cast<uint32_t>(cls) : kOversized;
+        block->node = node;
+        block->size = size;
+
+        // First touch from this thread decides which node backs each page.
+        char* data = static_cast<char*>(raw) + sizeof(BlockHeader);
+        for (size_t off = 0; off < size; off += kPageSize) data[off] = 0;
+        return data;
+    }
+
+    BufferPool::Buffer BufferPool::acquire() { return acquire(m_blockSize); }
+
+    BufferPool::Buffer BufferPool::acquire(size_t minSize) {
+        int node = Topology::system().currentNode();
+        if (node < 0 || static_cast<size_t>(node) >= m_nodeCount) node = 0;
+        if (minSize > m_blockSize) return Buffer(this, allocate(kOversized, minSize, node));
+
+        size_t cls = classFor(minSize);
+        ThreadCache::Magazine* mag = nullptr;
+        if (ThreadCache* cache = threadCache()) mag = cache->find(this, cls);
+
+        char* data = nullptr;
+        if (mag) {
+            // The thread moved to another node: its cached blocks belong to the old one.
+            if (mag->node != node) {
+                if (mag->node >= 0) ThreadCache::spill(*mag, 0);
+                mag->node = node;
+            }
+            if (mag->count == 0) {
+                // Refill half a magazine at once, so the node lock is taken once per several buffers.
+                NodeList& shared = list(node, cls);
+                std::lock_guard<std::mutex> lock(shared.mutex);
+                uint32_t want = std::max<uint32_t>(mag->capacity / 2, 1);
+                while (mag->count < want && !shared.free.empty()) {
+                    mag->blocks[mag->count++] = shared.free.back();
+                    shared.free.pop_back();
+                }
+            }
+            if (mag->count > 0) data = mag->blocks[--mag->count];
+        } else {
+            NodeList& shared = list(node, cls);
+            std::lock_guard<std::mutex> lock(shared.mutex);
+            if (!shared.free.empty()) {
+                data = shared.free.back();
+                shared.free.pop_back();
+            }
+        }
+
+        if (!data) return Buffer(this, allocate(cls, classSize(cls), node));
+        header(data)->refs.store(1, std::memory_order_relaxed);
+        return Buffer(this, data);
+    }
+
+    void BufferPool::recycle(char* data) noexcept {
+        BlockHeader* block = header(data);
+        if (block->cls == kOversized) {
+            freeBlock(data);
+            return;
+        }
+
+        ThreadCache::Magazine* mag = nullptr;
+        if (ThreadCache* cache = threadCache()) mag = cache->find(this, block->cls);
+        if (mag && mag->node < 0) mag->node = block->node;
+        if (!mag || mag->node != block->node) {
+            giveBack(data, block->node, block->cls);
+            return;
+        }
+        if (mag->count == mag->capacity) ThreadCache::spill(*mag, mag->capacity / 2);
+        mag->blocks[mag->count++] = data;
+    }
+
+    void BufferPool::giveBack(char* data, int node, size_t cls) noexcept {
+        NodeList& shared = list(node, cls);
+        {
+            std::lock_guard<std::mutex> lock(shared.mutex);
+            if (shared.free.size() < m_maxCachedPerNode) {
+                try {
+                    shared.free.push_back(data);
+                    return;
+                } catch (...) {}
+            }
+        }
+        freeBlock(data);
+    }
+
+    size_t BufferPool::cached(size_t node) const {
+        if (node >= m_nodeCount) throw std::out_of_range("No such NUMA node");
+        size_t total = 0;
+        for (size_t cls = 0; cls < m_classCount; ++cls) {
+            const NodeList& shared = *m_lists[node * m_classCount + cls];
+            std::lock_guard<std::mutex> lock(shared.mutex);
+            total += shared.free.size();
+        }
+        return total;
+    }
+
+}
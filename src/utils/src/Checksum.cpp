@@ -0,0 +1,100 @@
+//Copyright (c) 2026 Kaizhi Liu
+//Licensed under the Apache License, Version 2.0.
+
+#include "../include/Checksum.hpp"
+#include <array>
+#include <cstring>
+
+namespace ref_storage::utils {
+
+    namespace {
+
+        using Crc32Tables = std::array<std::array<uint32_t, 256>, 8>;
+
+        constexpr Crc32Tables makeTables() {
+            Crc32Tables tables{};
+            for (uint32_t i = 0; i < 256; ++i) {
+                uint32_t c = i;
+                for (int k = 0; k < 8; ++k) c = (c & 1) ? (0xEDB88320u ^ (c >> 1)) : (c >> 1);
+                tables[0][i] = c;
+            }
+            for (uint32_t i = 0; i < 256; ++i) {
+                for (size_t t = 1; t < 8; ++t) {
+                    tables[t][i] = (tables[t - 1][i] >> 8) ^ tables[0][tables[t - 1][i] & 0xFF];
+                }
+            }
+            return tables;
+        }
+
+        constexpr Crc32Tables kTables = makeTables();
+
+        uint32_t gf2MatrixTimes(const uint32_t* mat, uint32_t vec) noexcept {
+            uint32_t sum = 0;
+            while (vec) {
+                if (vec & 1) sum ^= *mat;
+                vec >>= 1;
+                ++mat;
+            }
+            return sum;
+        }
+
+        void gf2MatrixSquare(uint32_t* square, const uint32_t* mat) noexcept {
+            for (int n = 0; n < 32; ++n) square[n] = gf2MatrixTimes(mat, mat[n]);
+        }
+
+    }
+
+    uint32_t Crc32::update(uint32_t crc, const void* data, size_t len) noexcept {
+        const auto* p = static_cast<const unsigned char*>(data);
+        crc = ~crc;
+
+        // Slicing-by-8: consume eight bytes per iteration (little-endian load).
+        while (len >= 8) {
+            uint32_t lo, hi;
+            std::memcpy(&lo, p, 4);
+            std::memcpy(&hi, p + 4, 4);
+            lo ^= crc;
+            crc = kTables[7][lo & 0xFF] ^ kTables[6][(lo >> 8) & 0xFF] ^
+                  kTables[5][(lo >> 16) & 0xFF] ^ kTables[4][lo >> 24] ^
+                  kTables[3][hi & 0xFF] ^ kTables[2][(hi >> 8) & 0xFF] ^
+                  kTables[1][(hi >> 16) & 0xFF] ^ kTables[0][hi >> 24];
+            p += 8;
+            len -= 8;
+        }
+        while (len--) crc = kTables[0][(crc ^ *p++) & 0xFF] ^ (crc >> 8);
+
+        return ~crc;
+    }
+
+    uint32_t Crc32::combine(uint32_t crcA, uint32_t crcB, uint64_t lenB) noexcept {
+        if (lenB == 0) return crcA;
+
+        // Same approach as zlib's crc32_combine(): apply lenB zero bytes to crcA through
+        // repeated squaring of the "shift by one zero bit" operator, then xor in crcB.
+        uint32_t even[32];
+        uint32_t odd[32];
+
+        odd[0] = 0xEDB88320u;
+        uint32_t row = 1;
+        for (int n = 1; n < 32; ++n) {
+            odd[n] = row;
+            row <<= 1;
+        }
+        gf2MatrixSquare(even, odd);  // two zero bits
+        gf2MatrixSquare(odd, even);  // four zero bits
+
+        do {
+            gf2MatrixSquare(even, odd);
+            if (lenB & 1) crcA = gf2MatrixTimes(even, crcA);
+            lenB >>= 1;
+            if (lenB == 0) break;
+
+            gf2MatrixSquare(odd, even);
+            if (lenB & 1) crcA = gf2MatrixTimes(odd, crcA);
+            lenB >>= 1;
+        } while (lenB != 0);
+
+        return crcA ^ crcB;
+    }
+
+}
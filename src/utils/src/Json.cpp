@@ -0,0 +1,247 @@
+//Copyright (c) 2026 Kaizhi Liu
+//Licensed under the Apache License, Version 2.0.
+
+#include "../include/Json.hpp"
+#include <charconv>
+#include <cstdint>
+#include <format>
+#include <stdexcept>
+
+namespace ref_storage::utils {
+
+    class Json::Parser {
+    public:
+        explicit Parser(std::string_view text) : text_(text) { }
+
+        Json document() {
+            Json value = parseValue(0);
+            skipSpace();
+            if (pos_ != text_.size()) fail("unexpected trailing characters");
+            return value;
+        }
+
+    private:
+        // Nesting this deep is never a configuration file, and would otherwise exhaust the stack.
+        static constexpr int kMaxDepth = 64;
+
+        [[noreturn]] void fail(std::string_view what) const {
+            throw std::runtime_error(std::format("JSON: {} at offset {}", what, pos_));
+        }
+
+        void skipSpace() {
+            while (pos_ < text_.size() && (text_[pos_] == ' ' || text_[pos_] == '\t' || text_[pos_] == '\n' || text_[pos_] == '\r')) ++pos_;
+        }
+
+        char peek() {
+            skipSpace();
+            if (pos_ == text_.size()) fail("unexpected end of input");
+            return text_[pos_];
+        }
+
+        void expect(char c) {
+            if (peek() != c) fail(std::format("expected '{}'", c));
+            ++pos_;
+        }
+
+        void literal(std::string_view word) {
+            if (text_.substr(pos_, word.size()) != word) fail("invalid literal");
+            pos_ += word.size();
+        }
+
+        Json parseValue(int depth) {
+            if (depth > kMaxDepth) fail("nesting too deep");
+            Json out;
+            switch (peek()) {
+                case '{': out.value_ = parseObject(depth); break;
+                case '[': out.value_ = parseArray(depth); break;
+                case '"': out.value_ = parseString(); break;
+                case 't': literal("true"); out.value_ = true; break;
+                case 'f': literal("false"); out.value_ = false; break;
+                case 'n': literal("null"); out.value_ = nullptr; break;
+                default: out.value_ = parseNumber(); break;
+            }
+            return out;
+        }
+
+        Object parseObject(int depth) {
+            Object members;
+            expect('{');
+            if (peek() == '}') {
+                ++pos_;
+                return members;
+            }
+            while (true) {
+                if (peek() != '"') fail("expected a member name");
+                std::string key = parseString();
+                for (const auto& member : members) {
+                    if (member.first == key) fail(std::format("duplicate member \"{}\"", key));
+                }
+                expect(':');
+                members.emplace_back(std::move(key), parseValue(depth + 1));
+                if (peek() == '}') {
+                    ++pos_;
+                    return members;
+                }
+                expect(',');
+            }
+        }
+
+        Array parseArray(int depth) {
+            Array items;
+            expect('[');
+            if (peek() == ']') {
+                ++pos_;
+                return items;
+            }
+            while (true) {
+                items.push_back(parseValue(depth + 1));
+                if (peek() == ']') {
+                    ++pos_;
+                    return items;
+                }
+                expect(',');
+            }
+        }
+
+        double parseNumber() {
+            size_t start = pos_;
+            if (pos_ < text_.size() && text_[pos_] == '-') ++pos_;
+            auto digits = [this]() {
+                size_t first = pos_;
+                while (pos_ < text_.size() && text_[pos_] >= '0' && text_[pos_] <= '9') ++pos_;
+                return pos_ - first;
+            };
+            size_t integral_start = pos_;
+            if (digits() == 0) fail("invalid value");
+            if (text_[integral_start] == '0' && pos_ - integral_start > 1) fail("leading zero in number");
+            if (pos_ < text_.size() && text_[pos_] == '.') {
+                ++pos_;
+                if (digits() == 0) fail("invalid number");
+            }
+            if (pos_ < text_.size() && (text_[pos_] == 'e' || text_[pos_] == 'E')) {
+                ++pos_;
+                if (pos_ < text_.size() && (text_[pos_] == '+' || text_[pos_] == '-')) ++pos_;
+                if (digits() == 0) fail("invalid number");
+            }
+            double value = 0;
+            auto [end, ec] = std::from_chars(text_.data() + start, text_.data() + pos_, value);
+            if (ec != std::errc() || end != text_.data() + pos_) fail("number out of range");
+            return value;
+        }
+
+        uint32_t hex4() {
+            if (text_.size() - pos_ < 4) fail("truncated \\u escape");
+            uint32_t code = 0;
+            for (int i = 0; i < 4; ++i) {
+                char c = text_[pos_++];
+                code <<= 4;
+                if (c >= '0' && c <= '9') code |= static_cast<uint32_t>(c - '0');
+                else if (c >= 'a' && c <= 'f') code |= static_cast<uint32_t>(c - 'a' + 10);
+                else if (c >= 'A' && c <= 'F') code |= static_cast<uint32_t>(c - 'A' + 10);
+                else fail("invalid \\u escape");
+            }
+            return code;
+        }
+
+        static void appendUtf8(std::string& out, uint32_t code) {
+            if (code < 0x80) {
+                out += static_cast<char>(code);
+            } else if (code < 0x800) {
+                out += static_cast<char>(0xC0 | (code >> 6));
+                out += static_cast<char>(0x80 | (code & 0x3F));
+            } else if (code < 0x10000) {
+                out += static_cast<char>(0xE0 | (code >> 12));
+                out += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+                out += static_cast<char>(0x80 | (code & 0x3F));
+            } else {
+                out += static_cast<char>(0xF0 | (code >> 18));
+                out += static_cast<char>(0x80 | ((code >> 12) & 0x3F));
+                out += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+                out += static_cast<char>(0x80 | (code & 0x3F));
+            }
+        }
+
+        std::string parseString() {
+            std::string out;
+            ++pos_;     // the opening quote, checked by the caller
+            while (true) {
+                if (pos_ == text_.size()) fail("unterminated string");
+                char c = text_[pos_++];
+                if (c == '"') return out;
+                if (static_cast<unsigned char>(c) < 0x20) fail("control character in string");
+                if (c != '\\') {
+                    out += c;
+                    continue;
+                }
+                if (pos_ == text_.size()) fail("unterminated string");
+                switch (text_[pos_++]) {
+                    case '"': out += '"'; break;
+                    case '\\': out += '\\'; break;
+                    case '/': out += '/'; break;
+                    case 'b': out += '\b'; break;
+                    case 'f': out += '\f'; break;
+                    case 'n': out += '\n'; break;
+                    case 'r': out += '\r'; break;
+                    case 't': out += '\t'; break;
+                    case 'u': {
+                        uint32_t code = hex4();
+                        if (code >= 0xD800 && code < 0xDC00) {
+                            if (text_.substr(pos_, 2) != "\\u") fail("unpaired surrogate");
+                            pos_ += 2;
+                            uint32_t low = hex4();
+                            if (low < 0xDC00 || low >= 0xE000) fail("unpaired surrogate");
+                            code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+                        } else if (code >= 0xDC00 && code < 0xE000) {
+                            fail("unpaired surrogate");
+                        }
+                        appendUtf8(out, code);
+                        break;
+                    }
+                    default: fail("invalid escape");
+                }
+            }
+        }
+
+        std::string_view text_;
+        size_t pos_ = 0;
+    };
+
+    Json Json::parse(std::string_view text) {
+        return Parser(text).document();
+    }
+
+    const char* Json::typeName(Type type) {
+        switch (type) {
+            case Type::Null: return "null";
+            case Type::Bool: return "a boolean";
+            case Type::Number: return "a number";
+            case Type::String: return "a string";
+            case Type::Array: return "an array";
+            default: return "an object";
+        }
+    }
+
+    namespace {
+        template <typename T>
+        const T& as(const auto& value, Json::Type wanted, Json::Type actual) {
+            if (const T* held = std::get_if<T>(&value)) return *held;
+            throw std::runtime_error(std::format("JSON: expected {}, found {}", Json::typeName(wanted), Json::typeName(actual)));
+        }
+    }
+
+    bool Json::asBool() const { return as<bool>(value_, Type::Bool, type()); }
+    double Json::asNumber() const { return as<double>(value_, Type::Number, type()); }
+    const std::string& Json::asString() const { return as<std::string>(value_, Type::String, type()); }
+    const Json::Array& Json::asArray() const { return as<Array>(value_, Type::Array, type()); }
+    const Json::Object& Json::asObject() const { return as<Object>(value_, Type::Object, type()); }
+
+    const Json* Json::find(std::string_view key) const {
+        if (const Object* members = std::get_if<Object>(&value_)) {
+            for (const auto& [name, value] : *members) {
+                if (name == key) return &value;
+            }
+        }
+        return nullptr;
+    }
+
+}
@@ -0,0 +1,119 @@
+//Copyright (c) 2026 Kaizhi Liu
+//Licensed under the Apache License, Version 2.0.
+
+#include "../include/LogFormat.hpp"
+#include <vector>
+
+namespace ref_storage::utils {
+
+    namespace {
+
+        struct DecodedArg {
+            LogArgTag tag;
+            int64_t i = 0;
+            uint64_t u = 0;
+            double d = 0;
+            std::string_view s;
+        };
+
+        std::vector<DecodedArg> decodeArgs(const char* args, size_t length) {
+            std::vector<DecodedArg> out;
+            const char* p = args;
+            const char* end = args + length;
+            auto take = [&](void* dst, size_t n) {
+                if (static_cast<size_t>(end - p) < n) return false;
+                std::memcpy(dst, p, n);
+                p += n;
+                return true;
+            };
+            while (p < end) {
+                DecodedArg arg{static_cast<LogArgTag>(*p++), 0, 0, 0, {}};
+                bool ok = true;
+                switch (arg.tag) {
+                    case LogArgTag::Int: ok = take(&arg.i, sizeof(int64_t)); break;
+                    case LogArgTag::UInt: ok = take(&arg.u, sizeof(uint64_t)); break;
+                    case LogArgTag::Double: ok = take(&arg.d, sizeof(double)); break;
+                    case LogArgTag::Bool: { uint8_t b = 0; ok = take(&b, 1); arg.u = b; break; }
+                    case LogArgTag::Char: { char c = 0; ok = take(&c, 1); arg.i = c; break; }
+                    case LogArgTag::String: {
+                        uint32_t len = 0;
+                        ok = take(&len, sizeof(len)) && static_cast<size_t>(end - p) >= len;
+                        if (ok) {
+                            arg.s = std::string_view(p, len);
+                            p += len;
+                        }
+                        break;
+                    }
+                    default: ok = false;
+                }
+                if (!ok) break;
+                out.push_back(arg);
+            }
+            return out;
+        }
+
+        std::string formatOne(const std::string& field, const DecodedArg& arg) {
+            switch (arg.tag) {
+                case LogArgTag::Int: return std::vformat(field, std::make_format_args(arg.i));
+                case LogArgTag::UInt: return std::vformat(field, std::make_format_args(arg.u));
+                case LogArgTag::Double: return std::vformat(field, std::make_format_args(arg.d));
+                case LogArgTag::Bool: { bool b = arg.u != 0; return std::vformat(field, std::make_format_args(b)); }
+                case LogArgTag::Char: { char c = static_cast<char>(arg.i); return std::vformat(field, std::make_format_args(c)); }
+                case LogArgTag::String: return std::vformat(field, std::make_format_args(arg.s));
+            }
+            return "{?}";
+        }
+
+    }
+
+    const char* logLevelName(LogLevel level) {
+        switch (level) {
+            case LogLevel::Debug: return "DEBUG";
+            case LogLevel::Info:  return "INFO ";
+            case LogLevel::Warn:  return "WARN ";
+            case LogLevel::Error: return "ERROR";
+            case LogLevel::Fatal: return "FATAL";
+            default: return "UNKNOWN";
+        }
+    }
+
+    std::string formatLogArgs(std::string_view format, const char* args, size_t length) {
+        std::vector<DecodedArg> decoded = decodeArgs(args, length);
+        std::string out;
+        out.reserve(format.size() + length);
+        size_t next_arg = 0;
+
+        for (size_t i = 0; i < format.size(); ++i) {
+            char c = format[i];
+            if (c == '{' && i + 1 < format.size() && format[i + 1] == '{') { out += '{'; ++i; continue; }
+            if (c == '}' && i + 1 < format.size() && format[i + 1] == '}') { out += '}'; ++i; continue; }
+            if (c != '{') { out += c; continue; }
+
+            size_t close = format.find('}', i);
+            if (close == std::string_view::npos) { out.append(format.substr(i)); break; }
+            std::string_view field = format.substr(i + 1, close - i - 1);
+            i = close;
+
+            // "{[index][:spec]}": rebuild the field without the index and format the one argument it refers to.
+            size_t colon = field.find(':');
+            std::string_view index_text = field.substr(0, colon);
+            size_t index = next_arg++;
+            if (!index_text.empty()) {
+                index = 0;
+                for (char d : index_text) index = index * 10 + static_cast<size_t>(d - '0');
+            }
+            if (index >= decoded.size()) { out += "{?}"; continue; }
+
+            std::string single = "{";
+            if (colon != std::string_view::npos) single.append(field.substr(colon));
+            single += '}';
+            try {
+                out += formatOne(single, decoded[index]);
+            } catch (const std::exception&) {
+                out += "{?}";
+            }
+        }
+        return out;
+    }
+
+}
@@ -0,0 +1,211 @@
+//Copyright (c) 2026 Kaizhi Liu
+//Licensed under the Apache License, Version 2.0.
+
+#include "../include/LogSink.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <new>
+#include <fcntl.h>
+#include <sys/stat.h>
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
+#ifdef REF_STORAGE_HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+namespace ref_storage::utils {
+
+    namespace {
+
+        constexpr std::align_val_t kBlockAlign{4096};
+
+#ifdef REF_STORAGE_HAVE_ZLIB
+        // Gzip `path` into `path`.gz and remove the original; a partial .gz is removed on failure.
+        void compressFile(const std::string& path) {
+            std::string target = path + ".gz";
+            std::FILE* in = std::fopen(path.c_str(), "rb");
+            if (!in) return;
+            gzFile out = gzopen(target.c_str(), "wb6");
+            bool ok = out != nullptr;
+            std::vector<char> buffer(256 * 1024);
+            while (ok) {
+                size_t n = std::fread(buffer.data(), 1, buffer.size(), in);
+                if (n == 0) break;
+                ok = gzwrite(out, buffer.data(), static_cast<unsigned>(n)) == static_cast<int>(n);
+            }
+            ok = !std::ferror(in) && ok;
+            std::fclose(in);
+            if (out && gzclose(out) != Z_OK) ok = false;
+
+            std::error_code ec;
+            if (ok) std::filesystem::remove(path, ec);
+            else std::filesystem::remove(target, ec);
+        }
+#endif
+
+    }
+
+    void LogFileSink::BlockDeleter::operator()(char* p) const noexcept {
+        ::operator delete[](p, kBlockAlign);
+    }
+
+    LogFileSink::~LogFileSink() {
+        flush();
+        if (fd_ >= 0) {
+#ifdef _WIN32
+            ::_close(fd_);
+#else
+            ::close(fd_);
+#endif
+        }
+        if (archiver_.joinable()) {
+            {
+                std::lock_guard<std::mutex> lock(archive_mutex_);
+                archive_stop_ = true;
+            }
+            archive_cv_.notify_all();
+            archiver_.join();
+        }
+    }
+
+    bool LogFileSink::open(const std::string& path, bool compressRotated) {
+        path_ = path;
+        compress_ = compressRotated;
+        return openFile(false);
+    }
+
+    bool LogFileSink::openFile(bool truncate) {
+#ifdef _WIN32
+        int flags = _O_WRONLY | _O_CREAT | _O_APPEND | _O_BINARY | (truncate ? _O_TRUNC : 0);
+        fd_ = ::_open(path_.c_str(), flags, _S_IREAD | _S_IWRITE);
+#else
+        int flags = O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC | (truncate ? O_TRUNC : 0);
+        fd_ = ::open(path_.c_str(), flags, 0644);
+#endif
+        size_ = 0;
+        if (fd_ < 0) return false;
+        struct stat st {};
+        if (::fstat(fd_, &st) == 0) size_ = static_cast<size_t>(st.st_size);
+        return true;
+    }
+
+    void LogFileSink::append(std::string_view data) {
+        if (fd_ < 0) return;
+        size_ += data.size();
+        pending_ += data.size();
+        while (!data.empty()) {
+            if (used_blocks_ == 0 || last_fill_ == kBlockSize) {
+                if (used_blocks_ == blocks_.size()) {
+                    blocks_.emplace_back(static_cast<char*>(::operator new[](kBlockSize, kBlockAlign)));
+                }
+                ++used_blocks_;
+                last_fill_ = 0;
+            }
+            size_t n = std::min(data.size(), kBlockSize - last_fill_);
+            std::memcpy(blocks_[used_blocks_ - 1].get() + last_fill_, data.data(), n);
+            last_fill_ += n;
+            data.remove_prefix(n);
+        }
+        if (pending_ >= kFlushThreshold) flush();
+    }
+
+    void LogFileSink::flush() {
+        if (fd_ < 0 || pending_ == 0) return;
+
+#ifdef _WIN32
+        for (size_t i = 0; i < used_blocks_; ++i) {
+            size_t len = i + 1 == used_blocks_ ? last_fill_ : kBlockSize;
+            const char* p = blocks_[i].get();
+            while (len > 0) {
+                int n = ::_write(fd_, p, static_cast<unsigned>(len));
+                if (n <= 0) { write_failed_ = true; break; }
+                p += n;
+                len -= static_cast<size_t>(n);
+            }
+        }
+#else
+        std::vector<iovec> iov(used_blocks_);
+        for (size_t i = 0; i < used_blocks_; ++i) {
+            iov[i].iov_base = blocks_[i].get();
+            iov[i].iov_len = i + 1 == used_blocks_ ? last_fill_ : kBlockSize;
+        }
+        // One writev() per flush in the common case; loop over short writes.
+        size_t first = 0;
+        while (first < iov.size()) {
+            int count = static_cast<int>(std::min<size_t>(iov.size() - first, IOV_MAX));
+            ssize_t n = ::writev(fd_, iov.data() + first, count);
+            if (n < 0) {
+                if (errno == EINTR) continue;
+                write_failed_ = true;
+                break;
+            }
+            auto left = static_cast<size_t>(n);
+            while (first < iov.size() && left >= iov[first].iov_len) left -= iov[first++].iov_len;
+            if (left > 0) {
+                iov[first].iov_base = static_cast<char*>(iov[first].iov_base) + left;
+                iov[first].iov_len -= left;
+            }
+        }
+#endif
+        if (write_failed_) {
+            // Reported once; the data is dropped rather than letting the log path stall on a broken disk.
+            std::fprintf(stderr, "[LOGGER WARNING] Write to %s failed: %s\n", path_.c_str(), std::strerror(errno));
+            write_failed_ = false;
+        }
+        used_blocks_ = 0;
+        last_fill_ = 0;
+        pending_ = 0;
+    }
+
+    void LogFileSink::rotate(const std::string& backupPath, std::string_view header) {
+        flush();
+        if (fd_ >= 0) {
+#ifdef _WIN32
+            ::_close(fd_);
+#else
+            ::close(fd_);
+#endif
+            fd_ = -1;
+        }
+
+        std::error_code ec;
+        std::filesystem::rename(path_, backupPath, ec);
+        openFile(true);
+        if (!header.empty()) append(header);
+
+        if (ec || !compress_) return;
+#ifdef REF_STORAGE_HAVE_ZLIB
+        {
+            std::lock_guard<std::mutex> lock(archive_mutex_);
+            archive_queue_.push_back(backupPath);
+        }
+        if (!archiver_.joinable()) archiver_ = std::thread([this]() { archiveLoop(); });
+        archive_cv_.notify_one();
+#endif
+    }
+
+    void LogFileSink::archiveLoop() {
+        std::unique_lock<std::mutex> lock(archive_mutex_);
+        while (true) {
+            archive_cv_.wait(lock, [this]() { return archive_stop_ || !archive_queue_.empty(); });
+            // Files queued before shutdown are still compressed.
+            if (archive_queue_.empty()) return;
+            std::string path = std::move(archive_queue_.front());
+            archive_queue_.pop_front();
+            lock.unlock();
+#ifdef REF_STORAGE_HAVE_ZLIB
+            compressFile(path);
+#endif
+            lock.lock();
+        }
+    }
+
+}
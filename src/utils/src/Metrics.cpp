@@ -0,0 +1,242 @@
+//Copyright (c) 2026 Kaizhi Liu
+//Licensed under the Apache License, Version 2.0.
+
+#include "../include/Metrics.hpp"
+#include <algorithm>
+#include <charconv>
+#include <stdexcept>
+#include <string_view>
+
+namespace ref_storage::utils {
+
+    static_assert(Histogram::bucketOf(Histogram::bucketUpperBound(Histogram::kBuckets - 1)) == Histogram::kBuckets - 1);
+    static_assert(Histogram::bucketOf(Histogram::bucketUpperBound(100)) == 100);
+    static_assert(Histogram::bucketOf(Histogram::bucketUpperBound(100) + 1) == 101);
+
+    size_t metricShard() noexcept {
+        static std::atomic<size_t> next{0};
+        thread_local size_t shard = next.fetch_add(1, std::memory_order_relaxed) % kMetricShards;
+        return shard;
+    }
+
+    uint64_t Counter::value() const noexcept {
+        uint64_t total = 0;
+        for (const auto& shard : shards_) total += shard.value.load(std::memory_order_relaxed);
+        return total;
+    }
+
+    uint64_t HistogramSnapshot::percentile(double fraction) const {
+        if (count == 0) return 0;
+        auto target = static_cast<uint64_t>(fraction * static_cast<double>(count) + 0.5);
+        target = std::clamp<uint64_t>(target, 1, count);
+        uint64_t seen = 0;
+        for (size_t b = 0; b < buckets.size(); ++b) {
+            seen += buckets[b];
+            if (seen >= target) return std::min(Histogram::bucketUpperBound(b), max);
+        }
+        return max;
+    }
+
+    HistogramSnapshot Histogram::snapshot() const {
+        HistogramSnapshot snap;
+        snap.buckets.assign(kBuckets, 0);
+        for (const auto& shard : shards_) {
+            snap.sum += shard.sum.load(std::memory_order_relaxed);
+            snap.max = std::max(snap.max, shard.max.load(std::memory_order_relaxed));
+            for (size_t b = 0; b < kBuckets; ++b) snap.buckets[b] += shard.buckets[b].load(std::memory_order_relaxed);
+        }
+        for (uint64_t n : snap.buckets) snap.count += n;
+        return snap;
+    }
+
+    MetricsRegistry& MetricsRegistry::global() {
+        static MetricsRegistry registry;
+        return registry;
+    }
+
+    MetricsRegistry::Entry& MetricsRegistry::findOrAdd(const std::string& name, const std::string& help,
+                                                       const std::string& labels, MetricKind kind) {
+        for (auto& entry : entries_) {
+            if (entry->name == name && entry->labels == labels) {
+                if (entry->kind != kind) throw std::invalid_argument("Metric registered with another type: " + name);
+                return *entry;
+            }
+        }
+        auto entry = std::make_unique<Entry>();
+        entry->name = name;
+        entry->help = help;
+        entry->labels = labels;
+        entry->kind = kind;
+        entries_.push_back(std::move(entry));
+        return *entries_.back();
+    }
+
+    Counter& MetricsRegistry::counter(const std::string& name, const std::string& help, const std::string& labels) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        Entry& entry = findOrAdd(name, help, labels, MetricKind::Counter);
+        if (!entry.counter) entry.counter = std::make_unique<Counter>();
+        return *entry.counter;
+    }
+
+    Gauge& MetricsRegistry::gauge(const std::string& name, const std::string& help, const std::string& labels) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        Entry& entry = findOrAdd(name, help, labels, MetricKind::Gauge);
+        if (!entry.gauge && !entry.function) entry.gauge = std::make_unique<Gauge>();
+        if (!entry.gauge) throw std::invalid_argument("Metric is a gauge function: " + name);
+        return *entry.gauge;
+    }
+
+    Histogram& MetricsRegistry::histogram(const std::string& name, const std::string& help, const std::string& labels) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        Entry& entry = findOrAdd(name, help, labels, MetricKind::Histogram);
+        if (!entry.histogram) entry.histogram = std::make_unique<Histogram>();
+        return *entry.histogram;
+    }
+
+    void MetricsRegistry::gaugeFunction(const std::string& name, const std::string& help, const std::string& labels,
+                                        std::function<double()> fn) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        Entry& entry = findOrAdd(name, help, labels, MetricKind::Gauge);
+        if (entry.gauge) throw std::invalid_argument("Metric is a plain gauge: " + name);
+        entry.function = std::move(fn);
+    }
+
+    std::vector<MetricSample> MetricsRegistry::collect() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        std::vector<MetricSample> samples;
+        samples.reserve(entries_.size());
+        for (const auto& entry : entries_) {
+            MetricSample sample{entry->name, entry->help, entry->labels, entry->kind, 0, {}};
+            switch (entry->kind) {
+                case MetricKind::Counter: sample.value = static_cast<double>(entry->counter->value()); break;
+                case MetricKind::Gauge:
+                    sample.value = entry->function ? entry->function() : static_cast<double>(entry->gauge->value());
+                    break;
+                case MetricKind::Histogram: sample.histogram = entry->histogram->snapshot(); break;
+            }
+            samples.push_back(std::move(sample));
+        }
+        return samples;
+    }
+
+    namespace {
+
+        // Exposed histogram buckets, in nanoseconds.
+        constexpr uint64_t kExposedBucketsNs[] = {
+            1'000, 5'000, 10'000, 25'000, 50'000, 100'000, 250'000, 500'000,
+            1'000'000, 2'500'000, 5'000'000, 10'000'000, 25'000'000, 50'000'000, 100'000'000,
+            250'000'000, 500'000'000, 1'000'000'000, 2'500'000'000, 5'000'000'000, 10'000'000'000,
+        };
+
+        void appendNumber(std::string& out, double value) {
+            char buf[32];
+            auto res = std::to_chars(buf, buf + sizeof(buf), value, std::chars_format::general);
+            out.append(buf, res.ptr);
+        }
+
+        void appendNumber(std::string& out, uint64_t value) {
+            char buf[24];
+            auto res = std::to_chars(buf, buf + sizeof(buf), value);
+            out.append(buf, res.ptr);
+        }
+
+        // HELP text escapes backslash and newline.
+        void appendHelp(std::string& out, const std::string& help) {
+            for (char c : help) {
+                if (c == '\\') out += "\\\\";
+                else if (c == '\n') out += "\\n";
+                else out += c;
+            }
+        }
+
+        void appendSeries(std::string& out, std::string_view name, std::string_view suffix,
+                          const std::string& labels, std::string_view extraLabel = {}) {
+            out += name;
+            out += suffix;
+            if (!labels.empty() || !extraLabel.empty()) {
+                out += '{';
+                out += labels;
+                if (!labels.empty() && !extraLabel.empty()) out += ',';
+                out += extraLabel;
+                out += '}';
+            }
+            out += ' ';
+        }
+
+        void appendHistogram(std::string& out, std::string_view name, const MetricSample& sample) {
+            const HistogramSnapshot& h = sample.histogram;
+            uint64_t cumulative = 0;
+            size_t b = 0;
+            std::string le;
+            for (uint64_t boundNs : kExposedBucketsNs) {
+                while (b < h.buckets.size() && Histogram::bucketUpperBound(b) <= boundNs) cumulative += h.buckets[b++];
+                le = "le=\"";
+                appendNumber(le, static_cast<double>(boundNs) / 1e9);
+                le += '"';
+                appendSeries(out, name, "_bucket", sample.labels, le);
+                appendNumber(out, cumulative);
+                out += '\n';
+            }
+            appendSeries(out, name, "_bucket", sample.labels, "le=\"+Inf\"");
+            appendNumber(out, h.count);
+            out += '\n';
+            appendSeries(out, name, "_count", sample.labels);
+            appendNumber(out, h.count);
+            out += '\n';
+            appendSeries(out, name, "_sum", sample.labels);
+            appendNumber(out, static_cast<double>(h.sum) / 1e9);
+            out += '\n';
+        }
+
+        std::string_view typeName(MetricKind kind) {
+            switch (kind) {
+                case MetricKind::Counter: return "counter";
+                case MetricKind::Gauge: return "gauge";
+                case MetricKind::Histogram: return "histogram";
+            }
+            return "unknown";
+        }
+
+    }
+
+    void renderMetrics(const std::vector<MetricSample>& samples, ExpositionFormat format, std::string& out) {
+        out.clear();
+        const bool openMetrics = format == ExpositionFormat::OpenMetrics;
+        std::vector<bool> done(samples.size(), false);
+
+        for (size_t i = 0; i < samples.size(); ++i) {
+            if (done[i]) continue;
+            const MetricSample& head = samples[i];
+
+            // OpenMetrics names the counter family without the _total suffix its samples carry.
+            std::string_view family = head.name;
+            const bool counter = head.kind == MetricKind::Counter;
+            if (openMetrics && counter && family.ends_with("_total")) family.remove_suffix(6);
+
+            out += "# HELP ";
+            out += family;
+            out += ' ';
+            appendHelp(out, head.help);
+            out += "\n# TYPE ";
+            out += family;
+            out += ' ';
+            out += typeName(head.kind);
+            out += '\n';
+
+            for (size_t j = i; j < samples.size(); ++j) {
+                const MetricSample& sample = samples[j];
+                if (done[j] || sample.name != head.name || sample.kind != head.kind) continue;
+                done[j] = true;
+                if (sample.kind == MetricKind::Histogram) {
+                    appendHistogram(out, family, sample);
+                } else {
+                    appendSeries(out, family, openMetrics && counter ? "_total" : "", sample.labels);
+                    appendNumber(out, sample.value);
+                    out += '\n';
+                }
+            }
+        }
+        if (openMetrics) out += "# EOF\n";
+    }
+
+}
@@ -0,0 +1,267 @@
+//Copyright (c) 2026 Kaizhi Liu
+//Licensed under the Apache License, Version 2.0.
+
+#include "../include/Profiler.hpp"
+#include <algorithm>
+#include <atomic>
+#include <map>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+#include <unordered_map>
+
+#ifdef __linux__
+    #include <cerrno>
+    #include <csignal>
+    #include <ctime>
+    #include <cxxabi.h>
+    #include <dirent.h>
+    #include <dlfcn.h>
+    #include <fstream>
+    #include <sys/syscall.h>
+    #include <sys/uio.h>
+    #include <ucontext.h>
+    #include <unistd.h>
+#endif
+
+namespace ref_storage::utils {
+
+    Profiler& Profiler::global() {
+        static Profiler instance;
+        return instance;
+    }
+
+    bool Profiler::running() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return running_;
+    }
+
+#ifdef __linux__
+
+    namespace {
+
+        static_assert(sizeof(timer_t) <= sizeof(void*));
+
+        struct Sample {
+            pid_t tid;
+            uint32_t depth;
+            uintptr_t pcs[Profiler::kMaxFrames];
+        };
+
+        // Everything the signal handler touches; published through g_buffer while a profile runs.
+        struct SampleBuffer {
+            std::unique_ptr<Sample[]> samples{new Sample[Profiler::kMaxSamples]};
+            std::atomic<size_t> next{0};
+            std::atomic<size_t> dropped{0};
+        };
+
+        std::atomic<SampleBuffer*> g_buffer{nullptr};
+        std::atomic<int> g_inHandler{0};
+        pid_t g_pid = 0;
+
+        // Copy len bytes from our own address space, failing instead of faulting on unmapped memory.
+        bool safeRead(uintptr_t address, void* out, size_t len) {
+            iovec local{out, len};
+            iovec remote{reinterpret_cast<void*>(address), len};
+            return ::process_vm_readv(g_pid, &local, 1, &remote, 1, 0) == static_cast<ssize_t>(len);
+        }
+
+        void onProfSignal(int, siginfo_t*, void* context) {
+            int savedErrno = errno;
+            g_inHandler.fetch_add(1, std::memory_order_acquire);
+            SampleBuffer* buffer = g_buffer.load(std::memory_order_acquire);
+            size_t index = buffer ? buffer->next.fetch_add(1, std::memory_order_relaxed) : 0;
+            if (buffer && index >= Profiler::kMaxSamples) {
+                buffer->dropped.fetch_add(1, std::memory_order_relaxed);
+            } else if (buffer) {
+                Sample& sample = buffer->samples[index];
+                const auto& mc = static_cast<ucontext_t*>(context)->uc_mcontext;
+#if defined(__x86_64__)
+                uintptr_t pc = static_cast<uintptr_t>(mc.gregs[REG_RIP]);
+                uintptr_t fp = static_cast<uintptr_t>(mc.gregs[REG_RBP]);
+                uintptr_t sp = static_cast<uintptr_t>(mc.gregs[REG_RSP]);
+#elif defined(__aarch64__)
+                uintptr_t pc = static_cast<uintptr_t>(mc.pc);
+                uintptr_t fp = static_cast<uintptr_t>(mc.regs[29]);
+                uintptr_t sp = static_cast<uintptr_t>(mc.sp);
+#else
+                uintptr_t pc = 0, fp = 0, sp = 0;
+#endif
+                sample.tid = static_cast<pid_t>(::syscall(SYS_gettid));
+                sample.pcs[0] = pc;
+                uint32_t depth = pc ? 1 : 0;
+                // Frame records are {caller's frame pointer, return address}, and each one sits above the last.
+                while (depth < Profiler::kMaxFrames && fp >= sp && fp % sizeof(uintptr_t) == 0) {
+                    uintptr_t record[2];
+                    if (!safeRead(fp, record, sizeof(record)) || record[1] == 0) break;
+                    sample.pcs[depth++] = record[1];
+                    if (record[0] <= fp) break;
+                    fp = record[0];
+                }
+                sample.depth = depth;
+            }
+            g_inHandler.fetch_sub(1, std::memory_order_release);
+            errno = savedErrno;
+        }
+
+        void installHandler() {
+            static std::once_flag once;
+            std::call_once(once, []() {
+                // Stays installed: a SIGPROF that is still pending after stop() must not hit the default action.
+                struct sigaction action{};
+                action.sa_sigaction = onProfSignal;
+                action.sa_flags = SA_SIGINFO | SA_RESTART;
+                sigemptyset(&action.sa_mask);
+                if (::sigaction(SIGPROF, &action, nullptr) != 0) throw std::runtime_error("sigaction(SIGPROF) failed");
+            });
+        }
+
+        std::vector<pid_t> listThreads() {
+            std::vector<pid_t> tids;
+            if (DIR* dir = ::opendir("/proc/self/task")) {
+                while (dirent* entry = ::readdir(dir)) {
+                    if (entry->d_name[0] != '.') tids.push_back(static_cast<pid_t>(std::atoi(entry->d_name)));
+                }
+                ::closedir(dir);
+            }
+            return tids;
+        }
+
+        std::string threadName(pid_t tid) {
+            std::ifstream comm("/proc/self/task/" + std::to_string(tid) + "/comm");
+            std::string name;
+            std::getline(comm, name);
+            return name.empty() ? "thread-" + std::to_string(tid) : name + "-" + std::to_string(tid);
+        }
+
+        // Function name for an address: the demangled symbol, else module+offset for addr2line.
+        std::string symbolize(uintptr_t address) {
+            Dl_info info{};
+            std::string name;
+            if (::dladdr(reinterpret_cast<void*>(address), &info) && info.dli_sname) {
+                int status = 0;
+                char* demangled = abi::__cxa_demangle(info.dli_sname, nullptr, nullptr, &status);
+                name = status == 0 && demangled ? demangled : info.dli_sname;
+                std::free(demangled);
+            } else if (info.dli_fname) {
+                std::string module = info.dli_fname;
+                module = module.substr(module.find_last_of('/') + 1);
+                char offset[32];
+                std::snprintf(offset, sizeof(offset), "+0x%lx", static_cast<unsigned long>(address - reinterpret_cast<uintptr_t>(info.dli_fbase)));
+                name = module + offset;
+            } else {
+                char raw[32];
+                std::snprintf(raw, sizeof(raw), "0x%lx", static_cast<unsigned long>(address));
+                name = raw;
+            }
+            // ';' separates frames in the collapsed format.
+            std::replace(name.begin(), name.end(), ';', ':');
+            return name;
+        }
+
+    }
+
+    void Profiler::start(int hz) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (running_) throw std::runtime_error("A profile is already running");
+        hz = std::clamp(hz, 1, 1000);
+        installHandler();
+        g_pid = ::getpid();
+        g_buffer.store(new SampleBuffer(), std::memory_order_release);
+
+        const long intervalNs = 1'000'000'000L / hz;
+        for (pid_t tid : listThreads()) {
+            // The CPU-time clock of thread tid (MAKE_THREAD_CPUCLOCK(tid, CPUCLOCK_SCHED) in the kernel): the timer
+            // only advances while the thread runs, so idle threads are not sampled.
+            clockid_t clock = static_cast<clockid_t>((~static_cast<unsigned>(tid) << 3) | 2 | 4);
+            sigevent event{};
+            event.sigev_notify = SIGEV_THREAD_ID;
+            event.sigev_signo = SIGPROF;
+            event._sigev_un._tid = tid;
+            timer_t timer;
+            if (::timer_create(clock, &event, &timer) != 0) continue;  // the thread has exited since
+            itimerspec spec{};
+            spec.it_interval.tv_nsec = intervalNs % 1'000'000'000L;
+            spec.it_interval.tv_sec = intervalNs / 1'000'000'000L;
+            spec.it_value = spec.it_interval;
+            ::timer_settime(timer, 0, &spec, nullptr);
+            timers_.push_back(reinterpret_cast<void*>(timer));
+        }
+
+        hz_ = hz;
+        started_ = std::chrono::steady_clock::now();
+        running_ = true;
+    }
+
+    ProfileReport Profiler::stop() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        if (!running_) throw std::runtime_error("No profile is running");
+        for (void* timer : timers_) ::timer_delete(reinterpret_cast<timer_t>(timer));
+
+        ProfileReport report;
+        report.threads = timers_.size();
+        report.hz = hz_;
+        report.duration = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - started_);
+        timers_.clear();
+        running_ = false;
+
+        std::unique_ptr<SampleBuffer> buffer(g_buffer.exchange(nullptr, std::memory_order_acq_rel));
+        while (g_inHandler.load(std::memory_order_acquire) != 0) std::this_thread::yield();
+        lock.unlock();
+
+        size_t count = std::min(buffer->next.load(), kMaxSamples);
+        report.samples = count;
+        report.dropped = buffer->dropped.load();
+
+        std::unordered_map<uintptr_t, std::string> names;
+        std::unordered_map<pid_t, std::string> threads;
+        auto nameOf = [&names](uintptr_t address) -> const std::string& {
+            auto it = names.find(address);
+            if (it == names.end()) it = names.emplace(address, symbolize(address)).first;
+            return it->second;
+        };
+
+        std::map<std::string, size_t> stacks;
+        std::unordered_map<std::string, size_t> selfCounts;
+        std::string line;
+        for (size_t i = 0; i < count; ++i) {
+            const Sample& sample = buffer->samples[i];
+            auto thread = threads.find(sample.tid);
+            if (thread == threads.end()) thread = threads.emplace(sample.tid, threadName(sample.tid)).first;
+
+            line = thread->second;
+            for (uint32_t d = sample.depth; d > 0; --d) {
+                // Return addresses point after the call; step back into it so the caller's line is the one named.
+                uintptr_t address = sample.pcs[d - 1] - (d > 1 ? 1 : 0);
+                line += ';';
+                line += nameOf(address);
+            }
+            ++stacks[line];
+            if (sample.depth > 0) ++selfCounts[nameOf(sample.pcs[0])];
+        }
+
+        for (const auto& [stack, samples] : stacks) {
+            report.folded += stack;
+            report.folded += ' ';
+            report.folded += std::to_string(samples);
+            report.folded += '\n';
+        }
+        report.top.assign(selfCounts.begin(), selfCounts.end());
+        std::sort(report.top.begin(), report.top.end(), [](const auto& a, const auto& b) { return a.second > b.second; });
+        if (report.top.size() > 10) report.top.resize(10);
+        return report;
+    }
+
+#else
+
+    void Profiler::start(int) {
+        throw std::runtime_error("Profiling is only supported on Linux");
+    }
+
+    ProfileReport Profiler::stop() {
+        throw std::runtime_error("No profile is running");
+    }
+
+#endif
+
+}
@@ -0,0 +1,172 @@
+//Copyright (c) 2026 Liu Kaizhi
+//Licensed under the Apache License, Version 2.0.
+
+#include "../include/Scheduler.hpp"
+#include "../include/Metrics.hpp"
+#include <bit>
+#include <format>
+#include <stdexcept>
+
+namespace ref_storage::utils {
+
+    namespace {
+        constexpr uint64_t kStrideBase = 1u << 20;
+    }
+
+    Scheduler::Scheduler(ThreadPool& pool, std::vector<LaneOptions> lanes)
+        : pool_(pool), lanes_(lanes.size()), max_in_flight_(threadsRequired(lanes)) {
+        if (lanes.empty()) throw std::invalid_argument("Scheduler needs at least one lane");
+        for (size_t i = 0; i < lanes.size(); ++i) {
+            if (lanes[i].max_threads == 0 || lanes[i].weight == 0) {
+                throw std::invalid_argument("Lane '" + lanes[i].name + "' needs a non-zero thread budget and weight");
+            }
+            lanes_[i].stride = kStrideBase / lanes[i].weight;
+            lanes_[i].wait_metric = &MetricsRegistry::global().histogram(
+                "refstorage_pool_queue_wait_seconds", "Time tasks spent queued in a scheduler lane before dispatch.",
+                std::format("lane=\"{}\"", lanes[i].name));
+            lanes_[i].options = std::move(lanes[i]);
+        }
+    }
+
+    Scheduler::~Scheduler() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        stopping_ = true;
+        for (auto& lane : lanes_) lane.queue.clear();
+        idle_cv_.wait(lock, [this] { return in_flight_ == 0; });
+    }
+
+    size_t Scheduler::threadsRequired(const std::vector<LaneOptions>& lanes) {
+        size_t total = 0;
+        for (const auto& lane : lanes) total += lane.max_threads;
+        return total;
+    }
+
+    void Scheduler::setThreadBudget(LaneId id, size_t threads) {
+        if (threads == 0) throw std::invalid_argument("Thread budget must be non-zero");
+        std::lock_guard<std::mutex> lock(mutex_);
+        Lane& lane = lanes_.at(id);
+        max_in_flight_ = max_in_flight_ - lane.options.max_threads + threads;
+        lane.options.max_threads = threads;
+        dispatchLocked();
+    }
+
+    Scheduler::LaneId Scheduler::lane(const std::string& name) const {
+        for (LaneId id = 0; id < lanes_.size(); ++id) {
+            if (lanes_[id].options.name == name) return id;
+        }
+        throw std::invalid_argument("Unknown scheduler lane: " + name);
+    }
+
+    bool Scheduler::trySubmit(LaneId id, UniqueFunction<void()> fn) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        Lane& lane = lanes_.at(id);
+        if (stopping_ || lane.queue.size() >= lane.options.queue_limit) {
+            ++lane.rejected;
+            return false;
+        }
+        if (lane.queue.empty() && lane.running == 0) lane.pass = std::max(lane.pass, virtual_time_);
+        lane.queue.push_back({std::move(fn), Clock::now()});
+        ++lane.submitted;
+        dispatchLocked();
+        return true;
+    }
+
+    void Scheduler::dispatchLocked() {
+        while (in_flight_ < max_in_flight_) {
+            Lane* best = nullptr;
+            LaneId best_id = 0;
+            for (LaneId id = 0; id < lanes_.size(); ++id) {
+                Lane& lane = lanes_[id];
+                if (lane.queue.empty() || lane.running >= lane.options.max_threads) continue;
+                if (!best || lane.options.priority > best->options.priority ||
+                    (lane.options.priority == best->options.priority && lane.pass < best->pass)) {
+                    best = &lane;
+                    best_id = id;
+                }
+            }
+            if (!best) return;
+
+            Item item = std::move(best->queue.front());
+            best->queue.pop_front();
+            ++best->running;
+            ++in_flight_;
+            virtual_time_ = best->pass;
+            best->pass += best->stride;
+
+            auto queued_for = Clock::now() - item.queued_at;
+            best->wait_metric->record(queued_for);
+            uint64_t waited = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(queued_for).count());
+            best->queue_total_us += waited;
+            best->queue_max_us = std::max(best->queue_max_us, waited);
+            ++best->histogram[std::min<size_t>(std::bit_width(waited), kBuckets - 1)];
+            ++best->dispatched;
+
+            try {
+                pool_.post([this, best_id, fn = std::move(item.fn)]() mutable { runTask(best_id, fn); });
+            } catch (...) {
+                // The pool is shutting down; the task is dropped.
+                --best->running;
+                --in_flight_;
+                idle_cv_.notify_all();
+                return;
+            }
+        }
+    }
+
+    void Scheduler::runTask(LaneId id, UniqueFunction<void()>& fn) {
+        try {
+            fn();
+        } catch (...) {
+            // Lanes are fire-and-forget like ThreadPool::post().
+        }
+        fn = nullptr;
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        Lane& lane = lanes_[id];
+        --lane.running;
+        --in_flight_;
+        ++lane.completed;
+        if (stopping_) {
+            if (in_flight_ == 0) idle_cv_.notify_all();
+            return;
+        }
+        dispatchLocked();
+    }
+
+    std::chrono::microseconds Scheduler::percentile(const Lane& lane, double fraction) {
+        if (lane.dispatched == 0) return std::chrono::microseconds(0);
+        auto target = static_cast<uint64_t>(fraction * static_cast<double>(lane.dispatched));
+        if (target == 0) target = 1;
+        uint64_t seen = 0;
+        for (size_t b = 0; b < kBuckets; ++b) {
+            seen += lane.histogram[b];
+            if (seen >= target) {
+                // Bucket b holds waits in [2^(b-1), 2^b) microseconds; report its upper bound, capped by the max.
+                uint64_t upper = b == 0 ? 0 : (uint64_t{1} << b) - 1;
+                return std::chrono::microseconds(std::min(upper, lane.queue_max_us));
+            }
+        }
+        return std::chrono::microseconds(lane.queue_max_us);
+    }
+
+    std::vector<Scheduler::LaneStats> Scheduler::stats() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        std::vector<LaneStats> result;
+        for (const auto& lane : lanes_) {
+            LaneStats s;
+            s.name = lane.options.name;
+            s.queued = lane.queue.size();
+            s.running = lane.running;
+            s.submitted = lane.submitted;
+            s.completed = lane.completed;
+            s.rejected = lane.rejected;
+            if (lane.dispatched) s.queue_avg = std::chrono::microseconds(lane.queue_total_us / lane.dispatched);
+            s.queue_p50 = percentile(lane, 0.50);
+            s.queue_p99 = percentile(lane, 0.99);
+            s.queue_max = std::chrono::microseconds(lane.queue_max_us);
+            result.push_back(std::move(s));
+        }
+        return result;
+    }
+
+}
@@ -0,0 +1,56 @@
+//Copyright (c) 2026 Liu Kaizhi
+//Licensed under the Apache License, Version 2.0.
+
+#include "../include/Task.hpp"
+#include <array>
+#include <new>
+#include <vector>
+
+namespace ref_storage::utils {
+
+    namespace {
+
+        constexpr size_t kClassSize = 64;
+        constexpr size_t kClasses = 32;            // frames up to 2 KiB are pooled
+        constexpr size_t kMaxCachedPerClass = 64;
+
+        struct FrameCache {
+            std::array<std::vector<void*>, kClasses> bins;
+            ~FrameCache() {
+                for (auto& bin : bins) {
+                    for (void* ptr : bin) ::operator delete(ptr);
+                }
+            }
+        };
+
+        thread_local FrameCache tl_frames;
+
+        size_t sizeClass(size_t size) { return (size + kClassSize - 1) / kClassSize - 1; }
+
+    }
+
+    void* FramePool::allocate(size_t size) {
+        size_t cls = sizeClass(size);
+        if (cls >= kClasses) return ::operator new(size);
+        auto& bin = tl_frames.bins[cls];
+        if (bin.empty()) return ::operator new((cls + 1) * kClassSize);
+        void* ptr = bin.back();
+        bin.pop_back();
+        return ptr;
+    }
+
+    void FramePool::deallocate(void* ptr, size_t size) noexcept {
+        size_t cls = sizeClass(size);
+        if (cls < kClasses) {
+            auto& bin = tl_frames.bins[cls];
+            if (bin.size() < kMaxCachedPerClass) {
+                try {
+                    bin.push_back(ptr);
+                    return;
+                } catch (...) {}
+            }
+        }
+        ::operator delete(ptr);
+    }
+
+}
@@ -3,52 +3,378 @@
 
 
 #include "../include/ThreadPool.hpp"
+#include <algorithm>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#include <immintrin.h>
+#define REF_STORAGE_CPU_RELAX() _mm_pause()
+#else
+#define REF_STORAGE_CPU_RELAX() std::this_thread::yield()
+#endif
 
 namespace ref_storage::utils {
 
-    ThreadPool::ThreadPool(size_t threads) {
+    namespace {
+        // Identifies the pool (and slot) the current thread works for, so that nested submissions stay local.
+        thread_local const void* tl_pool = nullptr;
+        thread_local size_t tl_index = 0;
+
+        constexpr int kSpinRounds = 64;
+        constexpr int kInjectorBatch = 32;
+        constexpr size_t kNodeCacheSize = 256;
+    }
+
+    ThreadPool::ThreadPool(size_t threads, Affinity affinity) : affinity(affinity) {
+        if (threads == 0) threads = 1;
+        max_searching = std::max<size_t>(1, std::thread::hardware_concurrency() / 2);
+        for (size_t i = 0; i < threads; i++) workers.push_back(std::make_unique<Worker>());
+        min_threads = threads;
+        max_threads = threads;
+
+        try {
+            startWorkers(threads);
+        } catch (...) {
+            shutdown();
+            throw;
+        }
+    }
+
+    ThreadPool::ThreadPool(const ElasticOptions& options, Affinity affinity) : affinity(affinity) {
+        size_t max = std::max<size_t>(1, options.max_threads);
+        size_t min = std::clamp<size_t>(options.min_threads, 1, max);
+        max_searching = std::max<size_t>(1, std::thread::hardware_concurrency() / 2);
+        for (size_t i = 0; i < max; i++) workers.push_back(std::make_unique<Worker>());
+        min_threads = min;
+        max_threads = max;
+        elastic = true;
+        grow_after = std::max(options.grow_after, std::chrono::milliseconds(1));
+        idle_timeout = options.idle_timeout;
 
         try {
-            for (size_t i = 0; i < threads; i++) {
-                workers.emplace_back([this]() {
-                    while (true) {
-                        std::packaged_task<void()> task;
-                        {
-                            std::unique_lock<std::mutex> lock(queue_mutex);
-                            condition.wait(lock, [this] { return stop || !tasks.empty(); });
-                            if (stop && tasks.empty())
-                                return;
-                            task = std::move(tasks.front());
-                            tasks.pop();
-                        }
-                        task();  // 执行任务
-                    }
+            startWorkers(std::clamp(options.initial_threads, min, max));
+            supervisor = std::thread([this]() { supervise(); });
+        } catch (...) {
+            shutdown();
+            throw;
+        }
+    }
+
+    void ThreadPool::startWorkers(size_t target) {
+        // The deficit is worked out under the lock, so a resize and a supervisor growth together never pass max.
+        std::lock_guard<std::mutex> lock(resize_mutex);
+        target = std::min(target, max_threads.load(std::memory_order_relaxed));
+        size_t current = live.load(std::memory_order_relaxed);
+        size_t count = target > current ? target - current : 0;
+        for (size_t i = 0; i < workers.size() && count > 0; ++i) {
+            Worker& worker = *workers[i];
+            if (worker.state.load(std::memory_order_acquire) == SlotState::Running) continue;
+            if (worker.thread.joinable()) worker.thread.join();   // an exited worker, done or about to be
+
+            std::vector<int> cpus = Topology::system().placement(i, affinity);
+            worker.state.store(SlotState::Running, std::memory_order_release);
+            live.fetch_add(1, std::memory_order_relaxed);
+            try {
+                worker.thread = std::thread([this, i, cpus = std::move(cpus)]() {
+                    Topology::pinCurrentThread(cpus);
+                    workerLoop(i);
                 });
+            } catch (...) {
+                worker.state.store(SlotState::Free, std::memory_order_release);
+                live.fetch_sub(1, std::memory_order_relaxed);
+                throw;
+            }
+            --count;
+        }
+    }
+
+    size_t ThreadPool::pendingTasks() const {
+        auto pending = static_cast<size_t>(std::max<int64_t>(0, injected.load(std::memory_order_relaxed)));
+        for (const auto& worker : workers) pending += worker->deque.size();
+        return pending;
+    }
+
+    void ThreadPool::supervise() {
+        const auto tick = std::max(grow_after / 2, std::chrono::milliseconds(1));
+        bool stalled = false;
+        auto stalled_since = std::chrono::steady_clock::now();
+
+        std::unique_lock<std::mutex> lock(supervisor_mutex);
+        while (!stop.load(std::memory_order_acquire)) {
+            supervisor_condition.wait_for(lock, tick);
+            if (stop.load(std::memory_order_acquire)) break;
+
+            // Queued work with every worker busy means the queue wait is growing.
+            size_t pending = pendingTasks();
+            if (pending == 0 || idle.load(std::memory_order_relaxed) > 0 || searching.load(std::memory_order_relaxed) > 0) {
+                stalled = false;
+                continue;
+            }
+            auto now = std::chrono::steady_clock::now();
+            if (!stalled) {
+                stalled = true;
+                stalled_since = now;
+                continue;
             }
-        }catch (...) {
+            if (now - stalled_since < grow_after) continue;
+
+            stalled = false;
+            size_t current = live.load(std::memory_order_relaxed);
+            size_t max = max_threads.load(std::memory_order_relaxed);
+            if (current >= max) continue;
             {
-                std::unique_lock<std::mutex> lock(this->queue_mutex);
-                stop = true;
+                std::lock_guard<std::mutex> park_lock(park_mutex);
+                retire_requests = 0;
             }
-            condition.notify_all();
-            for (std::thread& worker : workers) {
-                if (worker.joinable()) {
-                    worker.join();
-                }
+            try {
+                startWorkers(current + pending);
+            } catch (const std::exception&) {
+                // Out of threads; try again on the next stall.
             }
-            throw;
         }
+    }
+
+    bool ThreadPool::tryRetire(bool timed_out) {
+        // Called with park_mutex held by a parked worker whose deque is empty.
+        size_t current = live.load(std::memory_order_relaxed);
+        size_t min = min_threads.load(std::memory_order_relaxed);
+        if (current <= min) {
+            retire_requests = 0;
+            return false;
+        }
+        if (retire_requests > 0) --retire_requests;
+        else if (!timed_out) return false;
+        live.fetch_sub(1, std::memory_order_relaxed);
+        return true;
+    }
 
+    void ThreadPool::resize(size_t threads) {
+        if (!elastic) throw std::logic_error("resize() on a fixed-size ThreadPool");
+        threads = std::clamp(threads, min_threads.load(), max_threads.load());
+        size_t current = live.load(std::memory_order_relaxed);
+        if (threads > current) {
+            {
+                std::lock_guard<std::mutex> lock(park_mutex);
+                retire_requests = 0;
+            }
+            startWorkers(threads);
+        } else if (threads < current) {
+            {
+                std::lock_guard<std::mutex> lock(park_mutex);
+                retire_requests = current - threads;
+            }
+            park_condition.notify_all();
+        }
+    }
+
+    void ThreadPool::setBounds(size_t min, size_t max) {
+        if (!elastic) throw std::logic_error("setBounds() on a fixed-size ThreadPool");
+        max = std::clamp<size_t>(max, 1, workers.size());
+        min = std::clamp<size_t>(min, 1, max);
+        min_threads = min;
+        max_threads = max;
+        resize(live.load());
     }
 
     ThreadPool::~ThreadPool() {
+        shutdown();
+    }
+
+    void ThreadPool::shutdown() {
+        {
+            std::lock_guard<std::mutex> lock(park_mutex);
+            stop.store(true, std::memory_order_release);
+        }
+        park_condition.notify_all();
+        {
+            std::lock_guard<std::mutex> lock(supervisor_mutex);
+        }
+        supervisor_condition.notify_all();
+        if (supervisor.joinable()) supervisor.join();
+        // Growth is over now; the slot threads below are final.
+        std::lock_guard<std::mutex> lock(resize_mutex);
+        for (auto& worker : workers) {
+            if (worker->thread.joinable()) worker->thread.join();
+        }
+    }
+
+    void ThreadPool::checkRunning() const {
+        if (stop.load(std::memory_order_acquire)) {
+            throw std::runtime_error("enqueue on stopped ThreadPool");
+        }
+    }
+
+    thread_local ThreadPool::NodeCache ThreadPool::node_cache;
+
+    ThreadPool::NodeCache::~NodeCache() {
+        for (TaskNode* node : nodes) delete node;
+    }
+
+    ThreadPool::TaskNode* ThreadPool::acquireNode() {
+        if (node_cache.nodes.empty()) return new TaskNode();
+        TaskNode* node = node_cache.nodes.back();
+        node_cache.nodes.pop_back();
+        return node;
+    }
+
+    void ThreadPool::releaseNode(TaskNode* node) noexcept {
+        node->fn = nullptr;
+        if (node_cache.nodes.size() < kNodeCacheSize) {
+            try {
+                if (node_cache.nodes.capacity() == 0) node_cache.nodes.reserve(kNodeCacheSize);
+                node_cache.nodes.push_back(node);
+                return;
+            } catch (...) {}
+        }
+        delete node;
+    }
+
+    void ThreadPool::submitChain(TaskNode* first, TaskNode* last, size_t count) {
+        if (tl_pool == this) {
+            auto& deque = workers[tl_index]->deque;
+            for (TaskNode* node = first; ; node = static_cast<TaskNode*>(node->next.load(std::memory_order_relaxed))) {
+                deque.push(node);
+                if (node == last) break;
+            }
+        } else {
+            injected.fetch_add(static_cast<int64_t>(count), std::memory_order_relaxed);
+            injector.pushChain(first, last);
+        }
+
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (searching.load(std::memory_order_relaxed) == 0 && idle.load(std::memory_order_relaxed) > 0) wakeOne();
+    }
+
+    void ThreadPool::submit(TaskNode* node) {
+        if (tl_pool == this) {
+            workers[tl_index]->deque.push(node);
+        } else {
+            injected.fetch_add(1, std::memory_order_relaxed);
+            injector.push(node);
+        }
+
+        // Pairs with the fence in workerLoop(): either the parking worker sees this task, or we see it idle.
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (searching.load(std::memory_order_relaxed) == 0 && idle.load(std::memory_order_relaxed) > 0) wakeOne();
+    }
+
+    void ThreadPool::wakeOne() {
         {
-            std::unique_lock<std::mutex> lock(queue_mutex);
-            stop = true;
+            std::lock_guard<std::mutex> lock(park_mutex);
+            if (wake_tokens >= idle.load(std::memory_order_relaxed)) return;
+            ++wake_tokens;
+        }
+        park_condition.notify_one();
+    }
+
+    bool ThreadPool::hasWork() const {
+        if (injected.load(std::memory_order_relaxed) > 0) return true;
+        for (const auto& worker : workers) {
+            if (worker->deque.size() > 0) return true;
         }
-        condition.notify_all();
-        for (std::thread& worker : workers) {
-            worker.join();
+        return false;
+    }
+
+    ThreadPool::TaskNode* ThreadPool::takeFromInjector(size_t index) {
+        if (injected.load(std::memory_order_relaxed) <= 0) return nullptr;
+        if (injector_busy.exchange(true, std::memory_order_acquire)) return nullptr;
+
+        // Take one task to run now and move a batch into our deque, where peers can steal it.
+        TaskNode* first = injector.pop();
+        int taken = first ? 1 : 0;
+        while (first && taken < kInjectorBatch) {
+            TaskNode* next = injector.pop();
+            if (!next) break;
+            workers[index]->deque.push(next);
+            ++taken;
+        }
+        injector_busy.store(false, std::memory_order_release);
+        if (taken) injected.fetch_sub(taken, std::memory_order_relaxed);
+        return first;
+    }
+
+    ThreadPool::TaskNode* ThreadPool::findTask(size_t index) {
+        TaskNode* node = nullptr;
+        if (workers[index]->deque.pop(node)) return node;
+        if ((node = takeFromInjector(index))) return node;
+
+        // Steal, starting from a different victim each time to spread contention.
+        static thread_local uint64_t seed = 0x9E3779B97F4A7C15ull ^ reinterpret_cast<uintptr_t>(&seed);
+        seed ^= seed << 13; seed ^= seed >> 7; seed ^= seed << 17;
+        size_t n = workers.size();
+        size_t start = static_cast<size_t>(seed % n);
+        for (size_t k = 0; k < n; ++k) {
+            size_t victim = (start + k) % n;
+            if (victim == index) continue;
+            while (true) {
+                auto result = workers[victim]->deque.steal(node);
+                if (result == WorkStealingDeque<TaskNode*>::StealResult::Success) return node;
+                if (result == WorkStealingDeque<TaskNode*>::StealResult::Empty) break;
+            }
+        }
+        return nullptr;
+    }
+
+    void ThreadPool::workerLoop(size_t index) {
+        tl_pool = this;
+        tl_index = index;
+        bool is_searching = false;
+
+        while (true) {
+            TaskNode* node = findTask(index);
+            if (!node && !is_searching && searching.load(std::memory_order_relaxed) < max_searching) {
+                searching.fetch_add(1, std::memory_order_relaxed);
+                is_searching = true;
+            }
+            for (int spin = 0; is_searching && !node && spin < kSpinRounds; ++spin) {
+                REF_STORAGE_CPU_RELAX();
+                node = findTask(index);
+            }
+            if (is_searching) {
+                is_searching = false;
+                // The last searcher to find work hands the search over, so queued tasks keep fanning out.
+                if (searching.fetch_sub(1, std::memory_order_seq_cst) == 1 && node && hasWork()) wakeOne();
+            }
+
+            if (node) {
+                try {
+                    node->fn();  // 执行任务
+                } catch (...) {
+                    // post() is fire-and-forget; enqueue() routes exceptions into the future itself.
+                }
+                releaseNode(node);
+                continue;
+            }
+
+            std::unique_lock<std::mutex> lock(park_mutex);
+            idle.fetch_add(1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (hasWork()) {
+                idle.fetch_sub(1, std::memory_order_relaxed);
+                continue;
+            }
+            if (stop.load(std::memory_order_acquire)) {
+                idle.fetch_sub(1, std::memory_order_relaxed);
+                return;
+            }
+            bool timed_out = false;
+            if (elastic) {
+                timed_out = !park_condition.wait_for(lock, idle_timeout, [this] {
+                    return wake_tokens > 0 || retire_requests > 0 || stop.load(std::memory_order_acquire);
+                });
+            } else {
+                park_condition.wait(lock, [this] { return wake_tokens > 0 || stop.load(std::memory_order_acquire); });
+            }
+            if (wake_tokens > 0) {
+                --wake_tokens;
+            } else if (elastic && !stop.load(std::memory_order_acquire) && tryRetire(timed_out)) {
+                idle.fetch_sub(1, std::memory_order_relaxed);
+                workers[index]->state.store(SlotState::Exited, std::memory_order_release);
+                return;
+            }
+            idle.fetch_sub(1, std::memory_order_relaxed);
+            // A woken worker searches first, so producers don't wake anyone else meanwhile.
+            searching.fetch_add(1, std::memory_order_relaxed);
+            is_searching = true;
         }
     }
 }
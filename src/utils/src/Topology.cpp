@@ -0,0 +1,187 @@
+//Copyright (c) 2026 Liu Kaizhi
+//Licensed under the Apache License, Version 2.0.
+
+#include "../include/Topology.hpp"
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <thread>
+
+#ifdef _WIN32
+    #include <windows.h>
+#elif __linux__
+    #include <pthread.h>
+    #include <sched.h>
+#endif
+
+namespace ref_storage::utils {
+
+    namespace fs = std::filesystem;
+
+    namespace {
+
+        bool readInt(const fs::path& path, int& value) {
+            std::ifstream in(path);
+            return static_cast<bool>(in >> value);
+        }
+
+        // Parse a sysfs cpu list such as "0-3,8-11".
+        std::vector<int> parseCpuList(const std::string& text) {
+            std::vector<int> cpus;
+            size_t pos = 0;
+            while (pos < text.size()) {
+                size_t comma = text.find(',', pos);
+                std::string range = text.substr(pos, comma == std::string::npos ? std::string::npos : comma - pos);
+                pos = comma == std::string::npos ? text.size() : comma + 1;
+                if (range.empty() || range == "\n") continue;
+                try {
+                    size_t dash = range.find('-');
+                    int first = std::stoi(range.substr(0, dash));
+                    int last = dash == std::string::npos ? first : std::stoi(range.substr(dash + 1));
+                    for (int cpu = first; cpu <= last; ++cpu) cpus.push_back(cpu);
+                } catch (const std::exception&) {
+                    return {};
+                }
+            }
+            return cpus;
+        }
+
+    }
+
+    Affinity parseAffinity(const std::string& text) {
+        if (text == "none") return Affinity::None;
+        if (text == "node") return Affinity::Node;
+        if (text == "core") return Affinity::Core;
+        throw std::invalid_argument("Unknown affinity mode: " + text);
+    }
+
+    const char* affinityName(Affinity affinity) {
+        switch (affinity) {
+            case Affinity::Node: return "node";
+            case Affinity::Core: return "core";
+            default: return "none";
+        }
+    }
+
+    const Topology& Topology::system() {
+        static const Topology topology;
+        return topology;
+    }
+
+    Topology::Topology() {
+#ifdef __linux__
+        std::error_code ec;
+        const fs::path cpu_root = "/sys/devices/system/cpu";
+        for (const auto& entry : fs::directory_iterator(cpu_root, ec)) {
+            std::string name = entry.path().filename().string();
+            if (name.size() < 4 || name.compare(0, 3, "cpu") != 0 ||
+                !std::all_of(name.begin() + 3, name.end(), [](char c) { return c >= '0' && c <= '9'; })) continue;
+            // Offline CPUs have no topology directory.
+            if (!fs::exists(entry.path() / "topology", ec)) continue;
+
+            CpuInfo info;
+            info.cpu = std::stoi(name.substr(3));
+            readInt(entry.path() / "topology" / "core_id", info.core);
+            readInt(entry.path() / "topology" / "physical_package_id", info.package);
+            cpus_.push_back(info);
+        }
+        std::sort(cpus_.begin(), cpus_.end(), [](const CpuInfo& a, const CpuInfo& b) { return a.cpu < b.cpu; });
+
+        const fs::path node_root = "/sys/devices/system/node";
+        for (int node = 0; fs::exists(node_root / ("node" + std::to_string(node)), ec); ++node) {
+            std::ifstream in(node_root / ("node" + std::to_string(node)) / "cpulist");
+            std::string text;
+            std::getline(in, text);
+            for (int cpu : parseCpuList(text)) {
+                for (auto& info : cpus_) {
+                    if (info.cpu == cpu) info.node = node;
+                }
+            }
+        }
+#endif
+        if (cpus_.empty()) {
+            unsigned count = std::max(1u, std::thread::hardware_concurrency());
+            for (unsigned cpu = 0; cpu < count; ++cpu) cpus_.push_back({static_cast<int>(cpu), static_cast<int>(cpu), 0, 0});
+        }
+
+        // Memory-only nodes have no CPUs and cannot host threads; number the remaining nodes densely.
+        int max_node = 0, max_cpu = 0;
+        for (const auto& info : cpus_) {
+            max_node = std::max(max_node, info.node);
+            max_cpu = std::max(max_cpu, info.cpu);
+        }
+        std::vector<int> dense(static_cast<size_t>(max_node) + 1, -1);
+        for (const auto& info : cpus_) dense[info.node] = 0;
+        int next = 0;
+        for (int& id : dense) {
+            if (id == 0) id = next++;
+        }
+
+        node_cpus_.resize(static_cast<size_t>(next));
+        cpu_node_.assign(static_cast<size_t>(max_cpu) + 1, 0);
+        for (auto& info : cpus_) {
+            info.node = dense[info.node];
+            node_cpus_[info.node].push_back(info.cpu);
+            cpu_node_[info.cpu] = info.node;
+        }
+
+        for (size_t i = 0; interleaved_cpus_.size() < cpus_.size(); ++i) {
+            for (const auto& cpus : node_cpus_) {
+                if (i < cpus.size()) interleaved_cpus_.push_back(cpus[i]);
+            }
+        }
+    }
+
+    int Topology::nodeOfCpu(int cpu) const noexcept {
+        if (cpu < 0 || static_cast<size_t>(cpu) >= cpu_node_.size()) return 0;
+        return cpu_node_[cpu];
+    }
+
+    std::vector<int> Topology::placement(size_t index, Affinity affinity) const {
+        switch (affinity) {
+            case Affinity::Node: return node_cpus_[index % node_cpus_.size()];
+            case Affinity::Core: return {interleaved_cpus_[index % interleaved_cpus_.size()]};
+            default: return {};
+        }
+    }
+
+    int Topology::currentNode() const noexcept {
+#ifdef __linux__
+        return nodeOfCpu(sched_getcpu());
+#elif defined(_WIN32)
+        return nodeOfCpu(static_cast<int>(GetCurrentProcessorNumber()));
+#else
+        return 0;
+#endif
+    }
+
+    bool Topology::pinCurrentThread(const std::vector<int>& cpus) {
+        if (cpus.empty()) return true;
+#ifdef __linux__
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        for (int cpu : cpus) {
+            if (cpu >= 0 && cpu < CPU_SETSIZE) CPU_SET(cpu, &set);
+        }
+        return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#elif defined(_WIN32)
+        DWORD_PTR mask = 0;
+        for (int cpu : cpus) {
+            if (cpu >= 0 && cpu < static_cast<int>(sizeof(DWORD_PTR) * 8)) mask |= DWORD_PTR{1} << cpu;
+        }
+        return mask != 0 && SetThreadAffinityMask(GetCurrentThread(), mask) != 0;
+#else
+        return false;
+#endif
+    }
+
+    std::string Topology::describe() const {
+        std::string out = std::to_string(cpus_.size()) + " CPUs, " + std::to_string(node_cpus_.size()) + " NUMA node(s)";
+        for (size_t node = 0; node < node_cpus_.size(); ++node) {
+            out += "; node" + std::to_string(node) + ": " + std::to_string(node_cpus_[node].size()) + " CPUs";
+        }
+        return out;
+    }
+
+}
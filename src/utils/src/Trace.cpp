@@ -0,0 +1,123 @@
+//Copyright (c) 2026 Kaizhi Liu
+//Licensed under the Apache License, Version 2.0.
+
+#include "../include/Trace.hpp"
+#include "../include/AsyncLogger.hpp"
+#include <algorithm>
+#include <thread>
+
+namespace ref_storage::utils {
+
+    namespace {
+
+        constexpr size_t kMaxDetail = 128;
+
+        constexpr const char* kStageNames[kTraceStages] = {"parse", "queue", "recv", "storage", "send"};
+
+    }
+
+    double Tsc::nanosPerTick() {
+#ifdef REF_STORAGE_HAVE_TSC
+        static const double ratio = []() {
+            auto wallStart = std::chrono::steady_clock::now();
+            uint64_t tscStart = now();
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            auto wall = std::chrono::steady_clock::now() - wallStart;
+            uint64_t ticks = now() - tscStart;
+            return ticks ? static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(wall).count()) / static_cast<double>(ticks) : 1.0;
+        }();
+        return ratio;
+#else
+        using Period = std::chrono::steady_clock::period;
+        return 1e9 * static_cast<double>(Period::num) / static_cast<double>(Period::den);
+#endif
+    }
+
+    const char* traceStageName(TraceStage stage) noexcept {
+        size_t index = static_cast<size_t>(stage);
+        return index < kTraceStages ? kStageNames[index] : "?";
+    }
+
+    RequestTracer& RequestTracer::global() {
+        static RequestTracer instance;
+        return instance;
+    }
+
+    RequestTracer::RequestTracer() {
+        configure(options_);
+    }
+
+    void RequestTracer::configure(const TraceOptions& options) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        options_ = options;
+        ring_.assign(options.ring_capacity, TraceRecord{});
+        next_ = 0;
+        stored_ = 0;
+        sample_every_.store(options.ring_capacity ? options.sample_every : 0, std::memory_order_relaxed);
+        uint64_t threshold_ns = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(options.slow_threshold).count());
+        slow_ticks_.store(threshold_ns ? std::max<uint64_t>(1, static_cast<uint64_t>(static_cast<double>(threshold_ns) / Tsc::nanosPerTick())) : 0,
+                          std::memory_order_relaxed);
+    }
+
+    TraceOptions RequestTracer::options() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return options_;
+    }
+
+    void RequestTracer::setSlowThreshold(std::chrono::microseconds threshold) {
+        TraceOptions updated = options();
+        updated.slow_threshold = threshold;
+        configure(updated);
+    }
+
+    void RequestTracer::finish(TraceSpan& span, const char* op, std::string_view detail) {
+        uint64_t total = span.end();
+        uint64_t slow_ticks = slow_ticks_.load(std::memory_order_relaxed);
+        bool slow = slow_ticks != 0 && total >= slow_ticks;
+
+        thread_local uint32_t since_sample = 0;
+        uint32_t every = sample_every_.load(std::memory_order_relaxed);
+        bool sampled = every != 0 && ++since_sample >= every;
+        if (sampled) since_sample = 0;
+        if (!slow && !sampled) return;
+
+        TraceRecord record;
+        record.op = op;
+        record.detail.assign(detail.substr(0, kMaxDetail));
+        record.total_ns = Tsc::toNanos(total);
+        for (size_t i = 0; i < kTraceStages; ++i) record.stage_ns[i] = Tsc::toNanos(span.ticks()[i]);
+        record.bytes = span.bytes();
+        record.slow = slow;
+        record.started = std::chrono::system_clock::now() -
+                         std::chrono::duration_cast<std::chrono::system_clock::duration>(std::chrono::nanoseconds(record.total_ns));
+
+        if (slow) {
+            slow_count_.fetch_add(1, std::memory_order_relaxed);
+            const auto& ns = record.stage_ns;
+            LOG_WARN("[Slow] {} {} took {} us: parse={} queue={} recv={} storage={} send={} us, {} bytes",
+                     op, record.detail, record.total_ns / 1000, ns[0] / 1000, ns[1] / 1000, ns[2] / 1000,
+                     ns[3] / 1000, ns[4] / 1000, record.bytes);
+        }
+        store(std::move(record));
+    }
+
+    void RequestTracer::store(TraceRecord&& record) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (ring_.empty()) return;
+        ring_[next_] = std::move(record);
+        next_ = (next_ + 1) % ring_.size();
+        stored_ = std::min(stored_ + 1, ring_.size());
+    }
+
+    std::vector<TraceRecord> RequestTracer::recent(size_t count) const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        count = std::min(count, stored_);
+        std::vector<TraceRecord> records;
+        records.reserve(count);
+        for (size_t i = count; i > 0; --i) {
+            records.push_back(ring_[(next_ + ring_.size() - i) % ring_.size()]);
+        }
+        return records;
+    }
+
+}
@@ -0,0 +1,476 @@
+//Copyright (c) 2026 Kaizhi Liu
+//Licensed under the Apache License, Version 2.0.
+
+/* Open-loop load generator for the node's data-plane protocol (see RequestHandler.hpp).
+ *
+ *   storage_loadgen [options]
+ *     --host <addr>           node address (default ::1)
+ *     --port <n>              data port (default 12344)
+ *     --connections <n>       connections, each with its own sender and receiver thread (default 8)
+ *     --rate <req/s>          total arrival rate, split evenly over the connections (default 1000)
+ *     --duration <s>          measured run length (default 10)
+ *     --warmup <s>            run at the same rate before measuring (default 2)
+ *     --depth <n>             requests in flight per connection (default 1)
+ *     --reads <fraction>      share of GETs; the rest are PUTs (default 0.9)
+ *     --keys <n>              key space (default 10000)
+ *     --zipf <theta>          key skew, 0 for uniform, below 1 otherwise (default 0.99)
+ *     --sizes <list>          object sizes, as comma-separated SIZE[:WEIGHT] where SIZE is N or LO-HI (uniform) with
+ *                             optional k/m suffix, e.g. 4k:70,64k:25,1m-4m:5 (default 4k)
+ *     --arrival <kind>        uniform or poisson inter-arrival times (default poisson)
+ *     --no-preload            skip writing every key once before the run
+ *     --seed <n>              seed for sizes, keys and arrivals (default 1)
+ *
+ * Requests are issued on a fixed schedule, whether or not earlier requests have completed, and each latency is
+ * measured from the time the request was due rather than from when it could be sent. A node that stalls therefore
+ * shows up in the percentiles instead of silently lowering the offered load (coordinated omission).
+ * "send lag" reports how far behind schedule the generator itself ran; if it is large, add connections or depth.
+ * Latencies go into utils::Histogram, which keeps HDR-style buckets of 1/16 relative precision.
+ */
+
+#include "net/include/Socket.hpp"
+#include "utils/include/Metrics.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace {
+
+    using Clock = std::chrono::steady_clock;
+    using namespace ref_storage;
+
+    constexpr size_t kChunk = 256 * 1024;
+
+    struct SizeClass {
+        uint64_t lo = 0;
+        uint64_t hi = 0;
+        double weight = 1;
+    };
+
+    struct Config {
+        std::string host = "::1";
+        std::string port = "12344";
+        size_t connections = 8;
+        double rate = 1000;
+        double duration = 10;
+        double warmup = 2;
+        size_t depth = 1;
+        double reads = 0.9;
+        uint64_t keys = 10000;
+        double zipf = 0.99;
+        std::vector<SizeClass> sizes{{4096, 4096, 1}};
+        bool poisson = true;
+        bool preload = true;
+        uint64_t seed = 1;
+    };
+
+    uint64_t parseSize(const std::string& text) {
+        size_t used = 0;
+        uint64_t value = std::stoull(text, &used);
+        std::string suffix = text.substr(used);
+        if (suffix == "k" || suffix == "K") value <<= 10;
+        else if (suffix == "m" || suffix == "M") value <<= 20;
+        else if (!suffix.empty()) throw std::invalid_argument("bad size: " + text);
+        return value;
+    }
+
+    std::vector<SizeClass> parseSizes(const std::string& list) {
+        std::vector<SizeClass> sizes;
+        size_t pos = 0;
+        while (pos <= list.size()) {
+            size_t comma = list.find(',', pos);
+            std::string entry = list.substr(pos, comma == std::string::npos ? std::string::npos : comma - pos);
+            SizeClass size;
+            size_t colon = entry.find(':');
+            if (colon != std::string::npos) {
+                size.weight = std::stod(entry.substr(colon + 1));
+                entry.resize(colon);
+            }
+            size_t dash = entry.find('-');
+            size.lo = parseSize(entry.substr(0, dash));
+            size.hi = dash == std::string::npos ? size.lo : parseSize(entry.substr(dash + 1));
+            if (size.hi < size.lo || size.weight <= 0) throw std::invalid_argument("bad size class: " + entry);
+            sizes.push_back(size);
+            if (comma == std::string::npos) break;
+            pos = comma + 1;
+        }
+        return sizes;
+    }
+
+    /* Zipfian ranks over [0, n), after Gray et al., "Quickly generating billion-record synthetic databases" (the
+     * generator YCSB uses). Rank 0 is the hottest key; ranks are hashed onto keys so hot keys are not adjacent.
+     */
+    class Zipf {
+    public:
+        Zipf(uint64_t n, double theta) : n_(n), theta_(theta) {
+            if (theta_ <= 0) return;
+            double zeta2 = 1 + std::pow(0.5, theta_);
+            for (uint64_t i = 1; i <= n_; ++i) zetan_ += 1 / std::pow(static_cast<double>(i), theta_);
+            alpha_ = 1 / (1 - theta_);
+            eta_ = (1 - std::pow(2.0 / static_cast<double>(n_), 1 - theta_)) / (1 - zeta2 / zetan_);
+        }
+
+        template <typename Rng>
+        uint64_t next(Rng& rng) const {
+            std::uniform_real_distribution<double> uniform(0, 1);
+            double u = uniform(rng);
+            uint64_t rank;
+            if (theta_ <= 0) rank = static_cast<uint64_t>(u * static_cast<double>(n_));
+            else {
+                double uz = u * zetan_;
+                if (uz < 1) rank = 0;
+                else if (uz < 1 + std::pow(0.5, theta_)) rank = 1;
+                else rank = static_cast<uint64_t>(static_cast<double>(n_) * std::pow(eta_ * u - eta_ + 1, alpha_));
+            }
+            rank = std::min(rank, n_ - 1);
+            // Fibonacci hashing spreads the ranks over the key space.
+            return (rank * 11400714819323198485ull) % n_;
+        }
+
+    private:
+        uint64_t n_;
+        double theta_;
+        double zetan_ = 0;
+        double alpha_ = 0;
+        double eta_ = 0;
+    };
+
+    net::Socket connectTo(const Config& config) {
+        addrinfo hints{};
+        hints.ai_family = AF_UNSPEC;
+        hints.ai_socktype = SOCK_STREAM;
+        addrinfo* result = nullptr;
+        if (::getaddrinfo(config.host.c_str(), config.port.c_str(), &hints, &result) != 0 || !result) {
+            throw std::runtime_error("cannot resolve " + config.host);
+        }
+        int fd = -1;
+        for (addrinfo* ai = result; ai; ai = ai->ai_next) {
+            fd = ::socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+            if (fd >= 0 && ::connect(fd, ai->ai_addr, ai->ai_addrlen) == 0) break;
+            if (fd >= 0) ::close(fd);
+            fd = -1;
+        }
+        ::freeaddrinfo(result);
+        if (fd < 0) throw std::runtime_error("cannot connect to " + config.host + ":" + config.port);
+        // Header and payload are separate writes; without this, pipelined requests would wait for delayed ACKs.
+        int one = 1;
+        ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        return net::Socket(net::SocketHandle(fd));
+    }
+
+    struct Stats {
+        utils::Histogram get;
+        utils::Histogram put;
+        utils::Histogram lag;
+        std::atomic<uint64_t> bytes{0};
+        std::atomic<uint64_t> errors{0};
+        std::atomic<uint64_t> misses{0};
+    };
+
+    struct Request {
+        Clock::time_point due;
+        bool read;
+        bool measured;
+    };
+
+    // Send "PUT key size" and the body as frames of at most kChunk bytes.
+    void sendPut(const net::Socket& sock, const std::string& key, uint64_t size, const std::vector<char>& payload) {
+        std::string header = "PUT " + key + " " + std::to_string(size);
+        sock.sendData(header.data(), header.size(), 0);
+        for (uint64_t sent = 0; sent < size;) {
+            size_t len = static_cast<size_t>(std::min<uint64_t>(kChunk, size - sent));
+            sock.sendData(payload.data() + (sent % (payload.size() - kChunk + 1)), len, 0);
+            sent += len;
+        }
+    }
+
+    // Read one reply; for a successful GET also the object it announces. Returns false on "ERR".
+    bool readReply(const net::Socket& sock, bool read, std::vector<char>& buf, uint64_t& bytes) {
+        size_t len = sock.recvFrame(buf.data(), buf.size());
+        if (len == 0) throw std::runtime_error("connection closed by node");
+        std::string reply(buf.data(), len);
+        if (reply.rfind("OK", 0) != 0) return false;
+        if (!read) return true;
+
+        uint64_t size = std::strtoull(reply.c_str() + 3, nullptr, 10);
+        for (uint64_t got = 0; got < size;) {
+            size_t n = sock.recvFrame(buf.data(), buf.size());
+            if (n == 0) throw std::runtime_error("connection closed during GET body");
+            got += n;
+        }
+        bytes += size;
+        return true;
+    }
+
+    class Connection {
+    public:
+        Connection(const Config& config, size_t index, Stats& stats, const std::vector<char>& payload, const Zipf& zipf)
+            : config_(config), index_(index), stats_(stats), payload_(payload), zipf_(zipf), sock_(connectTo(config)) { }
+
+        void run(Clock::time_point start, Clock::time_point measureFrom, Clock::time_point end) {
+            std::thread receiver([this]() { receiveLoop(); });
+            try {
+                sendLoop(start, measureFrom, end);
+            } catch (const std::exception& e) {
+                std::fprintf(stderr, "connection %zu: %s\n", index_, e.what());
+            }
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                sending_done_ = true;
+            }
+            cv_.notify_all();
+            receiver.join();
+        }
+
+        // Write keys [from, to) once, closed loop, so the run starts with every key present.
+        void preload(uint64_t from, uint64_t to) {
+            std::vector<char> buf(kChunk);
+            std::mt19937_64 rng(config_.seed * 7919 + index_);
+            for (uint64_t key = from; key < to; ++key) {
+                sendPut(sock_, "lg-" + std::to_string(key), pickSize(rng), payload_);
+                uint64_t ignored = 0;
+                if (!readReply(sock_, false, buf, ignored)) stats_.errors.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+
+    private:
+        uint64_t pickSize(std::mt19937_64& rng) const {
+            double total = 0;
+            for (const auto& size : config_.sizes) total += size.weight;
+            double pick = std::uniform_real_distribution<double>(0, total)(rng);
+            for (const auto& size : config_.sizes) {
+                if (pick < size.weight) return std::uniform_int_distribution<uint64_t>(size.lo, size.hi)(rng);
+                pick -= size.weight;
+            }
+            return config_.sizes.back().hi;
+        }
+
+        void sendLoop(Clock::time_point start, Clock::time_point measureFrom, Clock::time_point end) {
+            std::mt19937_64 rng(config_.seed * 1000003 + index_);
+            std::exponential_distribution<double> gaps(config_.rate / static_cast<double>(config_.connections));
+            const double interval = static_cast<double>(config_.connections) / config_.rate;
+            std::uniform_real_distribution<double> coin(0, 1);
+
+            // Stagger the connections so uniform arrivals do not all fire at once.
+            double offset = interval * static_cast<double>(index_) / static_cast<double>(config_.connections);
+            for (;;) {
+                offset += config_.poisson ? gaps(rng) : interval;
+                auto due = start + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(offset));
+                if (due >= end) return;
+                std::this_thread::sleep_until(due);
+
+                bool read = coin(rng) < config_.reads;
+                std::string key = "lg-" + std::to_string(zipf_.next(rng));
+                uint64_t size = read ? 0 : pickSize(rng);
+                {
+                    std::unique_lock<std::mutex> lock(mutex_);
+                    cv_.wait(lock, [this]() { return in_flight_.size() < config_.depth || failed_; });
+                    if (failed_) return;
+                    in_flight_.push_back({due, read, due >= measureFrom});
+                }
+                cv_.notify_all();
+                if (due >= measureFrom) stats_.lag.record(Clock::now() - due);
+
+                if (read) {
+                    std::string header = "GET " + key;
+                    sock_.sendData(header.data(), header.size(), 0);
+                } else {
+                    sendPut(sock_, key, size, payload_);
+                    if (due >= measureFrom) stats_.bytes.fetch_add(size, std::memory_order_relaxed);
+                }
+            }
+        }
+
+        void receiveLoop() {
+            std::vector<char> buf(kChunk);
+            try {
+                for (;;) {
+                    Request request;
+                    {
+                        std::unique_lock<std::mutex> lock(mutex_);
+                        cv_.wait(lock, [this]() { return !in_flight_.empty() || sending_done_; });
+                        if (in_flight_.empty()) return;
+                        request = in_flight_.front();
+                    }
+
+                    uint64_t bytes = 0;
+                    bool ok = readReply(sock_, request.read, buf, bytes);
+                    auto latency = Clock::now() - request.due;
+                    if (request.measured) {
+                        if (!ok && request.read) stats_.misses.fetch_add(1, std::memory_order_relaxed);
+                        else if (!ok) stats_.errors.fetch_add(1, std::memory_order_relaxed);
+                        (request.read ? stats_.get : stats_.put).record(latency);
+                        stats_.bytes.fetch_add(bytes, std::memory_order_relaxed);
+                    }
+
+                    {
+                        std::lock_guard<std::mutex> lock(mutex_);
+                        in_flight_.pop_front();
+                    }
+                    cv_.notify_all();
+                }
+            } catch (const std::exception& e) {
+                std::fprintf(stderr, "connection %zu: %s\n", index_, e.what());
+                std::lock_guard<std::mutex> lock(mutex_);
+                failed_ = true;
+                cv_.notify_all();
+            }
+        }
+
+        const Config& config_;
+        size_t index_;
+        Stats& stats_;
+        const std::vector<char>& payload_;
+        const Zipf& zipf_;
+        net::Socket sock_;
+
+        std::mutex mutex_;
+        std::condition_variable cv_;
+        std::deque<Request> in_flight_;
+        bool sending_done_ = false;
+        bool failed_ = false;
+    };
+
+    void printHistogram(const char* name, const utils::HistogramSnapshot& h, double seconds) {
+        if (h.count == 0) {
+            std::printf("%-5s        0 requests\n", name);
+            return;
+        }
+        auto us = [](uint64_t ns) { return static_cast<double>(ns) / 1000.0; };
+        std::printf("%-5s %8llu requests %10.1f req/s   us: mean %.1f  p50 %.1f  p90 %.1f  p99 %.1f  p99.9 %.1f  p99.99 %.1f  max %.1f\n",
+                    name, static_cast<unsigned long long>(h.count), static_cast<double>(h.count) / seconds,
+                    us(h.mean()), us(h.percentile(0.50)), us(h.percentile(0.90)), us(h.percentile(0.99)),
+                    us(h.percentile(0.999)), us(h.percentile(0.9999)), us(h.max));
+    }
+
+    utils::HistogramSnapshot merge(utils::HistogramSnapshot a, const utils::HistogramSnapshot& b) {
+        a.count += b.count;
+        a.sum += b.sum;
+        a.max = std::max(a.max, b.max);
+        for (size_t i = 0; i < a.buckets.size() && i < b.buckets.size(); ++i) a.buckets[i] += b.buckets[i];
+        return a;
+    }
+
+    bool parseArgs(int argc, char** argv, Config& config) {
+        for (int i = 1; i < argc; ++i) {
+            std::string arg = argv[i];
+            if (arg == "--no-preload") { config.preload = false; continue; }
+            if (i + 1 >= argc) return false;
+            std::string value = argv[++i];
+            if (arg == "--host") config.host = value;
+            else if (arg == "--port") config.port = value;
+            else if (arg == "--connections") config.connections = std::max<size_t>(1, std::stoull(value));
+            else if (arg == "--rate") config.rate = std::stod(value);
+            else if (arg == "--duration") config.duration = std::stod(value);
+            else if (arg == "--warmup") config.warmup = std::stod(value);
+            else if (arg == "--depth") config.depth = std::max<size_t>(1, std::stoull(value));
+            else if (arg == "--reads") config.reads = std::stod(value);
+            else if (arg == "--keys") config.keys = std::max<uint64_t>(1, std::stoull(value));
+            else if (arg == "--zipf") config.zipf = std::stod(value);
+            else if (arg == "--sizes") config.sizes = parseSizes(value);
+            else if (arg == "--arrival") config.poisson = value != "uniform";
+            else if (arg == "--seed") config.seed = std::stoull(value);
+            else return false;
+        }
+        return config.rate > 0 && config.duration > 0 && config.zipf < 1;
+    }
+
+}
+
+int main(int argc, char** argv) {
+    Config config;
+    try {
+        if (!parseArgs(argc, argv, config)) {
+            std::fprintf(stderr, "Usage: %s [--host a] [--port n] [--connections n] [--rate r] [--duration s] [--warmup s] "
+                                 "[--depth n] [--reads f] [--keys n] [--zipf theta<1] [--sizes list] "
+                                 "[--arrival uniform|poisson] [--no-preload] [--seed n]\n", argv[0]);
+            return 2;
+        }
+    } catch (const std::exception& e) {
+        std::fprintf(stderr, "Invalid argument: %s\n", e.what());
+        return 2;
+    }
+
+    uint64_t largest = 0;
+    for (const auto& size : config.sizes) largest = std::max(largest, size.hi);
+    // Bodies are cut from one random buffer; large ones walk through it chunk by chunk.
+    std::vector<char> payload(static_cast<size_t>(std::min<uint64_t>(largest, 4 * kChunk)) + kChunk);
+    std::mt19937 fill(static_cast<uint32_t>(config.seed));
+    for (auto& c : payload) c = static_cast<char>(fill());
+
+    Zipf zipf(config.keys, config.zipf);
+    Stats stats;
+    std::vector<std::unique_ptr<Connection>> connections;
+    try {
+        for (size_t i = 0; i < config.connections; ++i) {
+            connections.push_back(std::make_unique<Connection>(config, i, stats, payload, zipf));
+        }
+    } catch (const std::exception& e) {
+        std::fprintf(stderr, "%s\n", e.what());
+        return 1;
+    }
+
+    if (config.preload) {
+        std::fprintf(stderr, "Preloading %llu keys...\n", static_cast<unsigned long long>(config.keys));
+        std::vector<std::thread> loaders;
+        for (size_t i = 0; i < connections.size(); ++i) {
+            uint64_t from = config.keys * i / connections.size();
+            uint64_t to = config.keys * (i + 1) / connections.size();
+            loaders.emplace_back([&, i, from, to]() {
+                try {
+                    connections[i]->preload(from, to);
+                } catch (const std::exception& e) {
+                    std::fprintf(stderr, "preload: %s\n", e.what());
+                }
+            });
+        }
+        for (auto& loader : loaders) loader.join();
+        stats.errors = 0;
+    }
+
+    std::fprintf(stderr, "Running %.0f req/s over %zu connections (depth %zu) for %.0f s after %.0f s of warm-up...\n",
+                 config.rate, config.connections, config.depth, config.duration, config.warmup);
+    auto start = Clock::now() + std::chrono::milliseconds(50);
+    auto measureFrom = start + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(config.warmup));
+    auto end = measureFrom + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(config.duration));
+
+    std::vector<std::thread> threads;
+    for (auto& connection : connections) {
+        threads.emplace_back([&connection, start, measureFrom, end]() { connection->run(start, measureFrom, end); });
+    }
+    for (auto& thread : threads) thread.join();
+    double measured = std::chrono::duration<double>(end - measureFrom).count();
+
+    auto get = stats.get.snapshot();
+    auto put = stats.put.snapshot();
+    auto all = merge(get, put);
+    uint64_t expected = static_cast<uint64_t>(config.rate * config.duration);
+    std::printf("offered %.1f req/s, completed %.1f req/s (%llu of ~%llu), %.1f MiB/s, %llu errors, %llu misses\n",
+                config.rate, static_cast<double>(all.count) / measured, static_cast<unsigned long long>(all.count),
+                static_cast<unsigned long long>(expected),
+                static_cast<double>(stats.bytes.load()) / measured / (1 << 20),
+                static_cast<unsigned long long>(stats.errors.load()), static_cast<unsigned long long>(stats.misses.load()));
+    printHistogram("GET", get, measured);
+    printHistogram("PUT", put, measured);
+    printHistogram("ALL", all, measured);
+    auto lag = stats.lag.snapshot();
+    std::printf("send lag us: p50 %.1f  p99 %.1f  max %.1f\n", static_cast<double>(lag.percentile(0.5)) / 1000.0,
+                static_cast<double>(lag.percentile(0.99)) / 1000.0, static_cast<double>(lag.max) / 1000.0);
+    return 0;
+}
@@ -0,0 +1,160 @@
+//Copyright (c) 2026 Kaizhi Liu
+//Licensed under the Apache License, Version 2.0.
+
+/* Offline formatter for logs written with utils::LogOutput::Binary.
+ *
+ *   storage_log_decode <file>...
+ *
+ * Prints each record as the text log would have: "[T:<thread>] [<time>] [<LEVEL>] [<file>:<line>] <message>".
+ * Rotated files can be decoded on their own: every file starts with a header and describes its sites again.
+ */
+
+#include "utils/include/LogFormat.hpp"
+#include <cstdio>
+#include <ctime>
+#include <fstream>
+#include <iterator>
+#include <unordered_map>
+
+using namespace ref_storage::utils;
+
+namespace {
+
+    struct Site {
+        LogLevel level;
+        uint32_t line;
+        std::string file;
+        std::string format;
+    };
+
+    class Reader {
+    public:
+        explicit Reader(const std::string& data) : data_(data) {}
+
+        [[nodiscard]] bool done() const { return pos_ >= data_.size(); }
+
+        template <typename T>
+        bool get(T& value) {
+            if (data_.size() - pos_ < sizeof(T)) return false;
+            std::memcpy(&value, data_.data() + pos_, sizeof(T));
+            pos_ += sizeof(T);
+            return true;
+        }
+
+        bool bytes(std::string& out, size_t n) {
+            if (data_.size() - pos_ < n) return false;
+            out.assign(data_, pos_, n);
+            pos_ += n;
+            return true;
+        }
+
+        bool magic() {
+            if (data_.compare(pos_, sizeof(kBinaryLogMagic), kBinaryLogMagic, sizeof(kBinaryLogMagic)) != 0) return false;
+            pos_ += sizeof(kBinaryLogMagic);
+            return true;
+        }
+
+        [[nodiscard]] size_t offset() const { return pos_; }
+
+    private:
+        const std::string& data_;
+        size_t pos_ = 0;
+    };
+
+    std::string timestamp(int64_t wall_base, int64_t steady_base, int64_t steady_ns) {
+        int64_t wall_ns = wall_base + (steady_ns - steady_base);
+        auto second = static_cast<std::time_t>(wall_ns / 1000000000);
+        char text[32];
+        std::strftime(text, sizeof(text), "%Y-%m-%d %H:%M:%S", std::localtime(&second));
+        return std::format("{}.{:03}", text, (wall_ns / 1000000) % 1000);
+    }
+
+    void print(uint64_t thread, const std::string& time, LogLevel level, const std::string& file, uint32_t line, const std::string& message) {
+        std::string out = std::format("[T:{}] [{}] [{}] [{}:{}] {}\n", thread, time, logLevelName(level), file, line, message);
+        std::fwrite(out.data(), 1, out.size(), stdout);
+    }
+
+    bool decode(const std::string& path) {
+        std::ifstream in(path, std::ios::binary);
+        if (!in) {
+            std::fprintf(stderr, "%s: cannot open\n", path.c_str());
+            return false;
+        }
+        std::string data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+        Reader r(data);
+
+        std::unordered_map<uint32_t, Site> sites;
+        int64_t wall_base = 0, steady_base = 0;
+        bool have_header = false;
+
+        while (!r.done()) {
+            size_t at = r.offset();
+            if (r.magic()) {
+                // A new run (or a new file) starts: site ids are only meaningful within one header.
+                if (!r.get(wall_base) || !r.get(steady_base)) break;
+                sites.clear();
+                have_header = true;
+                continue;
+            }
+            char kind = 0;
+            r.get(kind);
+            bool ok = have_header;
+            if (ok && kind == 'S') {
+                uint32_t id = 0, line = 0, fmt_len = 0;
+                uint8_t level = 0;
+                uint16_t file_len = 0;
+                Site site;
+                ok = r.get(id) && r.get(level) && r.get(line) && r.get(file_len) && r.bytes(site.file, file_len) &&
+                     r.get(fmt_len) && r.bytes(site.format, fmt_len);
+                site.level = static_cast<LogLevel>(level);
+                site.line = line;
+                if (ok) sites[id] = std::move(site);
+            } else if (ok && kind == 'E') {
+                uint32_t id = 0, len = 0;
+                int64_t steady_ns = 0;
+                uint64_t thread = 0;
+                uint8_t truncated = 0;
+                std::string args;
+                ok = r.get(id) && r.get(steady_ns) && r.get(thread) && r.get(truncated) && r.get(len) && r.bytes(args, len);
+                if (ok) {
+                    auto it = sites.find(id);
+                    if (it == sites.end()) {
+                        std::fprintf(stderr, "%s: record for unknown site %u at offset %zu\n", path.c_str(), id, at);
+                        continue;
+                    }
+                    std::string message = formatLogArgs(it->second.format, args.data(), args.size());
+                    if (truncated) message += "...[truncated]";
+                    print(thread, timestamp(wall_base, steady_base, steady_ns), it->second.level, it->second.file, it->second.line, message);
+                }
+            } else if (ok && kind == 'T') {
+                uint8_t level = 0;
+                int64_t steady_ns = 0;
+                uint64_t thread = 0;
+                uint32_t line = 0, len = 0;
+                uint16_t file_len = 0;
+                std::string file, message;
+                ok = r.get(level) && r.get(steady_ns) && r.get(thread) && r.get(line) && r.get(file_len) &&
+                     r.bytes(file, file_len) && r.get(len) && r.bytes(message, len);
+                if (ok) print(thread, timestamp(wall_base, steady_base, steady_ns), static_cast<LogLevel>(level), file, line, message);
+            } else {
+                ok = false;
+            }
+            if (!ok) {
+                std::fprintf(stderr, "%s: malformed or truncated record at offset %zu\n", path.c_str(), at);
+                return false;
+            }
+        }
+        return true;
+    }
+
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        std::fprintf(stderr, "usage: %s <binary log>...\n", argv[0]);
+        return 2;
+    }
+    bool ok = true;
+    for (int i = 1; i < argc; ++i) ok = decode(argv[i]) && ok;
+    return ok ? 0 : 1;
+}